@@ -1,18 +1,52 @@
 #include "Constants.h"
 #include "Game.h"
+#include "GeometryRegistry.h"
+#include "RegressionSuite.h"
+#include "RunSettings.h"
+#include "SelfTest.h"
+#include "ThreadPool.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+	RunSettings settings;
+
+	if (!settings.Parse(argc, argv))
+	{
+		RunSettings::PrintUsage(argv[0]);
+		return 1;
+	}
+
+	if (settings.m_mode == eRunMode::e_Regress)
+	{
+		return RegressionSuite::Run(settings);
+	}
+
+	if (settings.m_mode == eRunMode::e_SelfTest)
+	{
+		return SelfTest::Run(settings);
+	}
+
+	if (settings.m_mode == eRunMode::e_Cook)
+	{
+		// Cooking never uploads anything, so it runs without a context
+		ThreadPool threadPool;
+		GeometryRegistry registry(&threadPool);
+
+		return registry.Cook(settings.m_cookSource, settings.m_cookDestination, eVertexFormat::e_Quantized) ? 0 : 1;
+	}
+
 	Game game("3D Graphics Programming ICA SCOTT Thomas W9036922",
-		constants::k_screenWidth, constants::k_screenHeight,
+		settings.m_width, settings.m_height,
 		4, 5,
-		true);
+		true,
+		settings);
 
-	while (!game.GetWindowShouldClose())
+	if (settings.m_mode == eRunMode::e_Headless)
 	{
-		game.Update();
-		game.Render();
+		return game.RunHeadless() ? 0 : 1;
 	}
 
+	game.Run();
+
 	return 0;
 }
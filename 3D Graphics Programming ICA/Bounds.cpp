@@ -0,0 +1,106 @@
+#include "Bounds.h"
+
+#include <cfloat>
+#include <cmath>
+#include <glm/common.hpp>
+
+glm::vec3 AABB::GetCentre() const
+{
+	return (m_min + m_max) * 0.5f;
+}
+
+glm::vec3 AABB::GetExtents() const
+{
+	return (m_max - m_min) * 0.5f;
+}
+
+float AABB::GetSurfaceArea() const
+{
+	const glm::vec3 size = m_max - m_min;
+
+	if (size.x < 0.f || size.y < 0.f || size.z < 0.f)
+		return 0.f;
+
+	return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+void AABB::Grow(const glm::vec3& point)
+{
+	m_min = glm::min(m_min, point);
+	m_max = glm::max(m_max, point);
+}
+
+void AABB::Grow(const AABB& other)
+{
+	m_min = glm::min(m_min, other.m_min);
+	m_max = glm::max(m_max, other.m_max);
+}
+
+bool AABB::Overlaps(const AABB& other) const
+{
+	return m_min.x <= other.m_max.x && m_max.x >= other.m_min.x &&
+		m_min.y <= other.m_max.y && m_max.y >= other.m_min.y &&
+		m_min.z <= other.m_max.z && m_max.z >= other.m_min.z;
+}
+
+AABB AABB::Empty()
+{
+	return { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+}
+
+AABB ComputeBounds(const Vertex* vertexArray, const unsigned numOfVertices)
+{
+	AABB bounds = AABB::Empty();
+
+	for (unsigned i = 0; i < numOfVertices; ++i)
+	{
+		bounds.Grow(vertexArray[i].m_position);
+	}
+
+	return bounds;
+}
+
+AABB TransformBounds(const AABB& bounds, const glm::mat4& matrix)
+{
+	const glm::vec3 centre = bounds.GetCentre();
+	const glm::vec3 extents = bounds.GetExtents();
+
+	const glm::vec3 worldCentre = glm::vec3(matrix * glm::vec4(centre, 1.f));
+
+	glm::vec3 worldExtents(0.f);
+	for (int row = 0; row < 3; ++row)
+	{
+		worldExtents[row] =
+			std::abs(matrix[0][row]) * extents.x +
+			std::abs(matrix[1][row]) * extents.y +
+			std::abs(matrix[2][row]) * extents.z;
+	}
+
+	return { worldCentre - worldExtents, worldCentre + worldExtents };
+}
+
+void BoundsSoA::Resize(const unsigned count)
+{
+	const size_t padded = (static_cast<size_t>(count) + 7) & ~static_cast<size_t>(7);
+
+	m_centreX.resize(padded, 0.f);
+	m_centreY.resize(padded, 0.f);
+	m_centreZ.resize(padded, 0.f);
+	m_extentX.resize(padded, 0.f);
+	m_extentY.resize(padded, 0.f);
+	m_extentZ.resize(padded, 0.f);
+	m_count = count;
+}
+
+void BoundsSoA::Set(const unsigned index, const AABB& bounds)
+{
+	const glm::vec3 centre = bounds.GetCentre();
+	const glm::vec3 extents = bounds.GetExtents();
+
+	m_centreX[index] = centre.x;
+	m_centreY[index] = centre.y;
+	m_centreZ[index] = centre.z;
+	m_extentX[index] = extents.x;
+	m_extentY[index] = extents.y;
+	m_extentZ[index] = extents.z;
+}
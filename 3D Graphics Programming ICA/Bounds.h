@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/matrix.hpp>
+
+#include "Vertex.h"
+
+struct AABB
+{
+	glm::vec3 m_min;
+	glm::vec3 m_max;
+
+	glm::vec3 GetCentre() const;
+	glm::vec3 GetExtents() const;
+	float GetSurfaceArea() const;
+
+	void Grow(const glm::vec3& point);
+	void Grow(const AABB& other);
+
+	bool Overlaps(const AABB& other) const;
+
+	static AABB Empty();
+};
+
+AABB ComputeBounds(const Vertex* vertexArray, unsigned numOfVertices);
+
+// Bounds of the transformed box, using the absolute rotation part to grow the extents
+AABB TransformBounds(const AABB& bounds, const glm::mat4& matrix);
+
+// Boxes as centre/extent arrays so the frustum test can load eight of them at once. The arrays
+// are padded to a multiple of eight, padding lanes are never reported as visible.
+struct BoundsSoA
+{
+	std::vector<float> m_centreX, m_centreY, m_centreZ;
+	std::vector<float> m_extentX, m_extentY, m_extentZ;
+	unsigned m_count = 0;
+
+	void Resize(unsigned count);
+
+	void Set(unsigned index, const AABB& bounds);
+};
@@ -0,0 +1,578 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+Bvh::Bvh(ThreadPool* threadPool) :
+	m_threadPool(threadPool),
+	m_nodeCount(0),
+	m_weightedArea(0.f),
+	m_builtCost(0.f)
+{
+}
+
+void Bvh::Build(const std::vector<AABB>& bounds)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const unsigned numOfObjects = static_cast<unsigned>(bounds.size());
+
+	m_objectBounds = bounds;
+	m_buildReferences.resize(numOfObjects);
+	m_objectIndices.resize(numOfObjects);
+	m_leafOfObject.assign(numOfObjects, 0);
+
+	for (unsigned i = 0; i < numOfObjects; ++i)
+	{
+		m_buildReferences[i] = { bounds[i], bounds[i].GetCentre(), i };
+	}
+
+	// A binary tree over n objects never needs more than 2n - 1 nodes
+	m_nodes.assign(std::max(numOfObjects * 2, 1u), BvhNode());
+	m_parents.assign(m_nodes.size(), 0);
+	m_nodeCount = 1;
+
+	InitialiseNode(0, 0, numOfObjects);
+
+	// Split the top of the tree on this thread until there is enough independent work, then
+	// finish each subtree on its own worker
+	std::vector<unsigned> subtrees;
+	std::vector<unsigned> frontier = { 0 };
+
+	while (!frontier.empty())
+	{
+		const unsigned nodeIndex = frontier.back();
+		frontier.pop_back();
+
+		if (!m_threadPool || m_nodes[nodeIndex].m_count <= k_parallelSubtreeObjects)
+		{
+			subtrees.push_back(nodeIndex);
+			continue;
+		}
+
+		if (SplitNode(nodeIndex))
+		{
+			frontier.push_back(m_nodes[nodeIndex].m_left);
+			frontier.push_back(m_nodes[nodeIndex].m_left + 1);
+		}
+	}
+
+	const auto buildRange = [this, &subtrees](const unsigned begin, const unsigned end)
+	{
+		for (unsigned i = begin; i < end; ++i)
+		{
+			BuildSubtree(subtrees[i]);
+		}
+	};
+
+	if (m_threadPool)
+	{
+		m_threadPool->ParallelFor(static_cast<unsigned>(subtrees.size()), 1, buildRange);
+	} else
+	{
+		buildRange(0, static_cast<unsigned>(subtrees.size()));
+	}
+
+	m_nodes.resize(m_nodeCount);
+	m_parents.resize(m_nodeCount);
+
+	for (unsigned i = 0; i < numOfObjects; ++i)
+	{
+		m_objectIndices[i] = m_buildReferences[i].m_object;
+	}
+
+	m_buildReferences.clear();
+	m_buildReferences.shrink_to_fit();
+
+	for (unsigned nodeIndex = 0; nodeIndex < m_nodes.size(); ++nodeIndex)
+	{
+		const BvhNode& node = m_nodes[nodeIndex];
+
+		if (node.m_left == 0)
+		{
+			for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+			{
+				m_leafOfObject[m_objectIndices[i]] = nodeIndex;
+			}
+		}
+	}
+
+	m_weightedArea = ComputeWeightedArea();
+	m_builtCost = GetCost();
+
+	m_stats.m_builds++;
+	m_stats.m_buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void Bvh::Refit(const std::vector<unsigned>& changedObjects, const std::vector<AABB>& bounds)
+{
+	if (m_nodes.empty() || changedObjects.empty())
+		return;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (const unsigned object : changedObjects)
+	{
+		m_objectBounds[object] = bounds[object];
+	}
+
+	unsigned nodesRefitted = 0;
+
+	for (const unsigned object : changedObjects)
+	{
+		unsigned nodeIndex = m_leafOfObject[object];
+
+		// Walk towards the root until a node's bounds come out unchanged, everything above it
+		// is then unaffected by this object
+		for (;;)
+		{
+			BvhNode& node = m_nodes[nodeIndex];
+			AABB refitted = AABB::Empty();
+
+			if (node.m_left == 0)
+			{
+				for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+				{
+					refitted.Grow(m_objectBounds[m_objectIndices[i]]);
+				}
+			} else
+			{
+				refitted = m_nodes[node.m_left].m_bounds;
+				refitted.Grow(m_nodes[node.m_left + 1].m_bounds);
+			}
+
+			nodesRefitted++;
+
+			if (refitted.m_min == node.m_bounds.m_min && refitted.m_max == node.m_bounds.m_max)
+				break;
+
+			const float oldWeight = GetNodeWeight(node);
+			node.m_bounds = refitted;
+			m_weightedArea += GetNodeWeight(node) - oldWeight;
+
+			if (nodeIndex == 0)
+				break;
+
+			nodeIndex = m_parents[nodeIndex];
+		}
+	}
+
+	m_stats.m_refits++;
+	m_stats.m_nodesRefitted += nodesRefitted;
+	m_stats.m_refitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool Bvh::NeedsRebuild() const
+{
+	return GetCost() > m_builtCost * k_rebuildCostRatio;
+}
+
+float Bvh::GetCost() const
+{
+	if (m_nodes.empty())
+		return 0.f;
+
+	const float rootArea = m_nodes[0].m_bounds.GetSurfaceArea();
+
+	return rootArea > 0.f ? m_weightedArea / rootArea : 0.f;
+}
+
+unsigned Bvh::GetObjectCount() const
+{
+	return static_cast<unsigned>(m_objectIndices.size());
+}
+
+const BvhStats& Bvh::GetStats() const
+{
+	return m_stats;
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned>& results) const
+{
+	if (m_nodes.empty() || m_objectIndices.empty())
+		return;
+
+	// Each stack entry carries the planes its box still straddles, children of a node that is
+	// fully inside a plane never test that plane again
+	struct Entry
+	{
+		unsigned m_node;
+		unsigned m_planeMask;
+	};
+
+	std::vector<Entry> stack = { { 0, 0x3fu } };
+
+	while (!stack.empty())
+	{
+		const Entry entry = stack.back();
+		stack.pop_back();
+		const BvhNode& node = m_nodes[entry.m_node];
+
+		const glm::vec3 centre = node.m_bounds.GetCentre();
+		const glm::vec3 extents = node.m_bounds.GetExtents();
+
+		unsigned planeMask = entry.m_planeMask;
+		bool outside = false;
+
+		for (int i = 0; i < 6 && !outside; ++i)
+		{
+			if (!(planeMask & (1u << i)))
+				continue;
+
+			const glm::vec4& plane = frustum.GetPlane(i);
+			const float distance = plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w;
+			const float radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+
+			if (distance + radius < 0.f)
+			{
+				outside = true;
+			} else if (distance - radius >= 0.f)
+			{
+				planeMask &= ~(1u << i);
+			}
+		}
+
+		if (outside)
+			continue;
+
+		if (planeMask == 0 || node.m_left == 0)
+		{
+			if (node.m_left == 0 && planeMask != 0)
+			{
+				// Partially inside leaf, test its objects individually
+				for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+				{
+					if (frustum.IsVisible(m_objectBounds[m_objectIndices[i]]))
+					{
+						results.push_back(m_objectIndices[i]);
+					}
+				}
+			} else
+			{
+				AppendSubtree(node, results);
+			}
+
+			continue;
+		}
+
+		stack.push_back({ node.m_left, planeMask });
+		stack.push_back({ node.m_left + 1, planeMask });
+	}
+}
+
+void Bvh::QueryOverlap(const AABB& bounds, std::vector<unsigned>& results) const
+{
+	if (m_nodes.empty() || m_objectIndices.empty())
+		return;
+
+	std::vector<unsigned> stack = { 0 };
+
+	while (!stack.empty())
+	{
+		const BvhNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.m_bounds.Overlaps(bounds))
+			continue;
+
+		if (node.m_left == 0)
+		{
+			for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+			{
+				if (m_objectBounds[m_objectIndices[i]].Overlaps(bounds))
+				{
+					results.push_back(m_objectIndices[i]);
+				}
+			}
+
+			continue;
+		}
+
+		stack.push_back(node.m_left);
+		stack.push_back(node.m_left + 1);
+	}
+}
+
+bool Bvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, const float maxDistance,
+	unsigned& hitObject, float& hitDistance) const
+{
+	if (m_nodes.empty() || m_objectIndices.empty())
+		return false;
+
+	const glm::vec3 inverseDirection(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+
+	// Slab test, returns the entry distance or FLT_MAX on a miss
+	const auto intersect = [&origin, &inverseDirection](const AABB& box, const float closest)
+	{
+		const glm::vec3 t0 = (box.m_min - origin) * inverseDirection;
+		const glm::vec3 t1 = (box.m_max - origin) * inverseDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+
+		const float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+		return entry <= exit && entry < closest ? entry : FLT_MAX;
+	};
+
+	float closest = maxDistance;
+	bool hit = false;
+
+	std::vector<unsigned> stack;
+
+	if (intersect(m_nodes[0].m_bounds, closest) != FLT_MAX)
+	{
+		stack.push_back(0);
+	}
+
+	while (!stack.empty())
+	{
+		const BvhNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.m_left == 0)
+		{
+			for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+			{
+				const float distance = intersect(m_objectBounds[m_objectIndices[i]], closest);
+
+				if (distance != FLT_MAX)
+				{
+					closest = distance;
+					hitObject = m_objectIndices[i];
+					hit = true;
+				}
+			}
+
+			continue;
+		}
+
+		// Visit the nearer child first so the far one is usually culled by the closer hit
+		unsigned nearChild = node.m_left;
+		unsigned farChild = node.m_left + 1;
+		float nearDistance = intersect(m_nodes[nearChild].m_bounds, closest);
+		float farDistance = intersect(m_nodes[farChild].m_bounds, closest);
+
+		if (farDistance < nearDistance)
+		{
+			std::swap(nearChild, farChild);
+			std::swap(nearDistance, farDistance);
+		}
+
+		if (farDistance != FLT_MAX)
+		{
+			stack.push_back(farChild);
+		}
+
+		if (nearDistance != FLT_MAX)
+		{
+			stack.push_back(nearChild);
+		}
+	}
+
+	if (hit)
+	{
+		hitDistance = closest;
+	}
+
+	return hit;
+}
+
+unsigned Bvh::AllocateNodePair()
+{
+	return m_nodeCount.fetch_add(2);
+}
+
+void Bvh::InitialiseNode(const unsigned nodeIndex, const unsigned first, const unsigned count)
+{
+	BvhNode& node = m_nodes[nodeIndex];
+	node.m_left = 0;
+	node.m_first = first;
+	node.m_count = count;
+	node.m_bounds = AABB::Empty();
+
+	for (unsigned i = first; i < first + count; ++i)
+	{
+		node.m_bounds.Grow(m_buildReferences[i].m_bounds);
+	}
+}
+
+bool Bvh::SplitNode(const unsigned nodeIndex)
+{
+	BvhNode& node = m_nodes[nodeIndex];
+
+	if (node.m_count <= k_maxLeafObjects)
+		return false;
+
+	AABB centroidBounds = AABB::Empty();
+	for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+	{
+		centroidBounds.Grow(m_buildReferences[i].m_centroid);
+	}
+
+	// Bin the centroids along all three axes in one pass, then sweep each axis for the cheapest
+	// SAH split
+	AABB binBounds[3][k_numOfBins];
+	unsigned binCounts[3][k_numOfBins] = {};
+	float binScales[3];
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float axisExtent = centroidBounds.m_max[axis] - centroidBounds.m_min[axis];
+		binScales[axis] = axisExtent > 0.f ? k_numOfBins / axisExtent : 0.f;
+
+		for (auto& bin : binBounds[axis])
+		{
+			bin = AABB::Empty();
+		}
+	}
+
+	for (unsigned i = node.m_first; i < node.m_first + node.m_count; ++i)
+	{
+		const BvhBuildReference& reference = m_buildReferences[i];
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const unsigned bin = std::min(static_cast<unsigned>((reference.m_centroid[axis] - centroidBounds.m_min[axis]) * binScales[axis]), k_numOfBins - 1);
+			binCounts[axis][bin]++;
+			binBounds[axis][bin].Grow(reference.m_bounds);
+		}
+	}
+
+	int bestAxis = -1;
+	unsigned bestBin = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (binScales[axis] == 0.f)
+			continue;
+
+		float leftAreas[k_numOfBins - 1];
+		unsigned leftCounts[k_numOfBins - 1];
+		AABB leftBox = AABB::Empty();
+		unsigned leftCount = 0;
+
+		for (unsigned bin = 0; bin < k_numOfBins - 1; ++bin)
+		{
+			leftCount += binCounts[axis][bin];
+			if (binCounts[axis][bin])
+			{
+				leftBox.Grow(binBounds[axis][bin]);
+			}
+			leftCounts[bin] = leftCount;
+			leftAreas[bin] = leftBox.GetSurfaceArea();
+		}
+
+		AABB rightBox = AABB::Empty();
+		unsigned rightCount = 0;
+
+		for (unsigned bin = k_numOfBins - 1; bin > 0; --bin)
+		{
+			rightCount += binCounts[axis][bin];
+			if (binCounts[axis][bin])
+			{
+				rightBox.Grow(binBounds[axis][bin]);
+			}
+
+			if (leftCounts[bin - 1] == 0 || rightCount == 0)
+				continue;
+
+			const float cost = leftAreas[bin - 1] * leftCounts[bin - 1] + rightBox.GetSurfaceArea() * rightCount;
+
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+			}
+		}
+	}
+
+	const float parentArea = node.m_bounds.GetSurfaceArea();
+	const float leafCost = k_intersectionCost * node.m_count;
+	const float splitCost = parentArea > 0.f
+		? k_traversalCost + k_intersectionCost * bestCost / parentArea
+		: FLT_MAX;
+
+	unsigned middle;
+
+	if (bestAxis >= 0 && (splitCost < leafCost || node.m_count > k_forceSplitObjects))
+	{
+		const float axisMin = centroidBounds.m_min[bestAxis];
+		const float binScale = binScales[bestAxis];
+
+		const auto first = m_buildReferences.begin() + node.m_first;
+		const auto split = std::partition(first, first + node.m_count,
+			[&](const BvhBuildReference& reference)
+			{
+				const unsigned bin = std::min(static_cast<unsigned>((reference.m_centroid[bestAxis] - axisMin) * binScale), k_numOfBins - 1);
+				return bin < bestBin;
+			});
+
+		middle = static_cast<unsigned>(split - m_buildReferences.begin());
+	} else if (node.m_count > k_forceSplitObjects)
+	{
+		// Every centroid is in the same place, SAH can't separate them so just halve the list
+		middle = node.m_first + node.m_count / 2;
+	} else
+	{
+		return false;
+	}
+
+	const unsigned left = AllocateNodePair();
+
+	InitialiseNode(left, node.m_first, middle - node.m_first);
+	InitialiseNode(left + 1, middle, node.m_first + node.m_count - middle);
+	m_parents[left] = nodeIndex;
+	m_parents[left + 1] = nodeIndex;
+
+	node.m_left = left;
+
+	return true;
+}
+
+void Bvh::BuildSubtree(const unsigned nodeIndex)
+{
+	std::vector<unsigned> stack = { nodeIndex };
+
+	while (!stack.empty())
+	{
+		const unsigned current = stack.back();
+		stack.pop_back();
+
+		if (SplitNode(current))
+		{
+			stack.push_back(m_nodes[current].m_left);
+			stack.push_back(m_nodes[current].m_left + 1);
+		}
+	}
+}
+
+float Bvh::GetNodeWeight(const BvhNode& node) const
+{
+	const float cost = node.m_left == 0 ? k_intersectionCost * node.m_count : k_traversalCost;
+
+	return node.m_bounds.GetSurfaceArea() * cost;
+}
+
+float Bvh::ComputeWeightedArea() const
+{
+	float weightedArea = 0.f;
+
+	for (const BvhNode& node : m_nodes)
+	{
+		weightedArea += GetNodeWeight(node);
+	}
+
+	return weightedArea;
+}
+
+void Bvh::AppendSubtree(const BvhNode& node, std::vector<unsigned>& results) const
+{
+	results.insert(results.end(),
+		m_objectIndices.begin() + node.m_first,
+		m_objectIndices.begin() + node.m_first + node.m_count);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <glm/vec3.hpp>
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+struct BvhNode
+{
+	AABB m_bounds;
+	unsigned m_left;	// 0 for leaves, otherwise the left child with the right one next to it
+	unsigned m_first;	// Objects of any subtree are contiguous in the object index list
+	unsigned m_count;
+};
+
+struct BvhBuildReference
+{
+	AABB m_bounds;
+	glm::vec3 m_centroid;
+	unsigned m_object;
+};
+
+struct BvhStats
+{
+	unsigned m_builds = 0;
+	unsigned m_refits = 0;
+	unsigned m_nodesRefitted = 0;
+	double m_buildMilliseconds = 0.0;
+	double m_refitMilliseconds = 0.0;
+};
+
+// Bounding volume hierarchy over object AABBs, object ids are indices into the bounds passed to
+// Build(). Built top down with binned SAH, refitted in place when a few objects move, and flagged
+// for a rebuild once refitting has pushed the SAH cost too far past the freshly built tree.
+class Bvh
+{
+public:
+	explicit Bvh(ThreadPool* threadPool = nullptr);
+
+	void Build(const std::vector<AABB>& bounds);
+
+	void Refit(const std::vector<unsigned>& changedObjects, const std::vector<AABB>& bounds);
+
+	bool NeedsRebuild() const;
+
+	float GetCost() const;
+
+	unsigned GetObjectCount() const;
+
+	const BvhStats& GetStats() const;
+
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned>& results) const;
+
+	void QueryOverlap(const AABB& bounds, std::vector<unsigned>& results) const;
+
+	// Closest object whose bounds the ray hits, direction doesn't need to be normalised
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+		unsigned& hitObject, float& hitDistance) const;
+
+private:
+	static constexpr unsigned k_numOfBins = 16;
+	static constexpr unsigned k_maxLeafObjects = 4;
+	static constexpr unsigned k_forceSplitObjects = 32;
+	static constexpr unsigned k_parallelSubtreeObjects = 4096;
+	static constexpr float k_traversalCost = 1.f;
+	static constexpr float k_intersectionCost = 1.f;
+	static constexpr float k_rebuildCostRatio = 1.4f;
+
+	ThreadPool* m_threadPool;
+	std::vector<BvhNode> m_nodes;
+	std::vector<unsigned> m_parents;
+	std::vector<unsigned> m_objectIndices;
+	std::vector<unsigned> m_leafOfObject;
+	std::vector<AABB> m_objectBounds;
+	// Partitioned in place of the object indices during a build so binning reads memory linearly
+	std::vector<BvhBuildReference> m_buildReferences;
+	std::atomic<unsigned> m_nodeCount;
+
+	float m_weightedArea;
+	float m_builtCost;
+	BvhStats m_stats;
+
+	unsigned AllocateNodePair();
+
+	void InitialiseNode(unsigned nodeIndex, unsigned first, unsigned count);
+
+	// Returns false when the node should stay a leaf
+	bool SplitNode(unsigned nodeIndex);
+
+	void BuildSubtree(unsigned nodeIndex);
+
+	float GetNodeWeight(const BvhNode& node) const;
+
+	float ComputeWeightedArea() const;
+
+	void AppendSubtree(const BvhNode& node, std::vector<unsigned>& results) const;
+};
@@ -23,6 +23,25 @@ const glm::vec3& Camera::GetPosition() const
 	return m_position;
 }
 
+float Camera::GetYaw() const
+{
+	return m_yaw;
+}
+
+float Camera::GetPitch() const
+{
+	return m_pitch;
+}
+
+void Camera::SetPose(const glm::vec3& position, const float yaw, const float pitch)
+{
+	m_position = position;
+	m_yaw = yaw;
+	m_pitch = pitch;
+
+	UpdateCameraVectors();
+}
+
 void Camera::Move(const float deltaTime, const eDirection direction)
 {
 	const float velocity = m_movementSpeed * deltaTime;
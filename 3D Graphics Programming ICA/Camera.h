@@ -19,6 +19,13 @@ public:
 
 	const glm::vec3& GetPosition() const;
 
+	float GetYaw() const;
+
+	float GetPitch() const;
+
+	// Places the camera outright, as a recorded or scripted path does
+	void SetPose(const glm::vec3& position, float yaw, float pitch);
+
 	void Move(float deltaTime, eDirection direction);
 
 	void ProcessMouseMovement(float xOffset, float yOffset, GLboolean constrainPitch = true);
@@ -0,0 +1,144 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+	constexpr unsigned k_orbitKeys = 72;
+}
+
+CameraPath CameraPath::MakeOrbit(const float radius, const float height, const float periodSeconds)
+{
+	CameraPath path;
+
+	// One key past a full turn so the last stretch blends back to the start
+	for (unsigned i = 0; i <= k_orbitKeys; ++i)
+	{
+		const float turn = static_cast<float>(i) / static_cast<float>(k_orbitKeys);
+		const float angle = turn * 2.f * glm::pi<float>();
+
+		CameraKey key;
+		key.m_time = turn * periodSeconds;
+		key.m_position = glm::vec3(radius * std::cos(angle), height, radius * std::sin(angle));
+
+		// Facing the origin, Camera's front is (cos yaw cos pitch, sin pitch, sin yaw cos pitch)
+		key.m_yaw = glm::degrees(angle) + 180.f;
+		key.m_pitch = -glm::degrees(std::atan2(height, radius));
+
+		path.AddKey(key);
+	}
+
+	return path;
+}
+
+bool CameraPath::Load(const std::string& fileName)
+{
+	std::ifstream file(fileName);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::CAMERA_PATH::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	m_keys.clear();
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream stream(line);
+		CameraKey key;
+
+		if (!(stream >> key.m_time >> key.m_position.x >> key.m_position.y >> key.m_position.z >> key.m_yaw >> key.m_pitch))
+		{
+			std::cout << "ERROR::CAMERA_PATH::BAD_KEY: " << line << "\n";
+			m_keys.clear();
+			return false;
+		}
+
+		AddKey(key);
+	}
+
+	return !m_keys.empty();
+}
+
+bool CameraPath::Save(const std::string& fileName) const
+{
+	std::ofstream file(fileName, std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::CAMERA_PATH::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	file << "# time x y z yaw pitch\n";
+
+	for (const CameraKey& key : m_keys)
+	{
+		file << key.m_time << " " << key.m_position.x << " " << key.m_position.y << " " << key.m_position.z << " "
+			<< key.m_yaw << " " << key.m_pitch << "\n";
+	}
+
+	return file.good();
+}
+
+void CameraPath::AddKey(const CameraKey& key)
+{
+	m_keys.push_back(key);
+}
+
+CameraKey CameraPath::Sample(float time) const
+{
+	if (m_keys.empty())
+		return CameraKey{ 0.f, glm::vec3(0.f, 0.f, 1.f), -90.f, 0.f };
+
+	const float duration = GetDuration();
+
+	if (duration <= 0.f)
+		return m_keys.front();
+
+	time = m_keys.front().m_time + std::fmod(std::max(time, 0.f), duration);
+
+	// The first key after time, the one before it is the other end of the blend
+	const auto next = std::upper_bound(m_keys.begin(), m_keys.end(), time,
+		[](const float t, const CameraKey& key) { return t < key.m_time; });
+
+	if (next == m_keys.end())
+		return m_keys.back();
+
+	if (next == m_keys.begin())
+		return m_keys.front();
+
+	const CameraKey& a = *(next - 1);
+	const CameraKey& b = *next;
+	const float span = b.m_time - a.m_time;
+	const float t = span > 0.f ? (time - a.m_time) / span : 0.f;
+
+	CameraKey key;
+	key.m_time = time;
+	key.m_position = a.m_position + (b.m_position - a.m_position) * t;
+	key.m_yaw = a.m_yaw + (b.m_yaw - a.m_yaw) * t;
+	key.m_pitch = a.m_pitch + (b.m_pitch - a.m_pitch) * t;
+
+	return key;
+}
+
+bool CameraPath::IsEmpty() const
+{
+	return m_keys.empty();
+}
+
+float CameraPath::GetDuration() const
+{
+	return m_keys.empty() ? 0.f : m_keys.back().m_time - m_keys.front().m_time;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/vec3.hpp>
+
+struct CameraKey
+{
+	float m_time;	// Seconds from the start of the path
+	glm::vec3 m_position;
+	float m_yaw;	// Degrees, as Camera keeps them, not wrapped so keys can be blended
+	float m_pitch;
+};
+
+// Camera poses over time, either recorded from a windowed run or scripted, played back to drive
+// the camera without input. Saved as text, one "time x y z yaw pitch" key per line.
+class CameraPath
+{
+public:
+	// Circles the origin once every periodSeconds, looking at it
+	static CameraPath MakeOrbit(float radius, float height, float periodSeconds);
+
+	bool Load(const std::string& fileName);
+	bool Save(const std::string& fileName) const;
+
+	// Keys must come in time order
+	void AddKey(const CameraKey& key);
+
+	// The pose at a time, blended between keys. Paths loop, so any time is valid
+	CameraKey Sample(float time) const;
+
+	bool IsEmpty() const;
+
+	float GetDuration() const;
+
+private:
+	std::vector<CameraKey> m_keys;
+};
@@ -4,4 +4,42 @@ namespace constants
 {
 	constexpr int k_screenWidth = 1280;
 	constexpr int k_screenHeight = 960;
+
+	// Uniform block binding shared by every program, must match the GLSL layout qualifier
+	constexpr unsigned k_frameConstantsBinding = 0;
+	constexpr int k_frameConstantsRegions = 3;
+
+	// Point lights the FrameConstants block has room for, must match MAX_LIGHTS in frame_constants.glsl
+	constexpr int k_maxLights = 16;
+
+	// The instanced cube floor is k_instancedGridSize x k_instancedGridSize cubes
+	constexpr int k_instancedGridSize = 10;
+
+	// Starting size of the shared vertex/index buffers, they double whenever an upload doesn't fit
+	constexpr unsigned k_arenaVertexCapacity = 1 << 16;
+	constexpr unsigned k_arenaIndexCapacity = 1 << 18;
+
+	// Shader storage binding of the per-draw data read by gl_DrawIDARB
+	constexpr unsigned k_drawDataBinding = 1;
+
+	// Below this many meshes a flat SIMD cull beats walking the BVH
+	constexpr unsigned k_bvhMinObjects = 256;
+
+	// Texture streaming goes through a ring of k_textureUploadSlots pixel unpack buffers, and no
+	// more than k_textureUploadBudget bytes are uploaded per frame
+	constexpr unsigned k_textureUploadSlots = 3;
+	constexpr unsigned k_textureUploadSlotBytes = 4 << 20;
+	constexpr unsigned k_textureUploadBudget = 4 << 20;
+
+	// TextureCache starts evicting and dropping mips of least recently used textures above this
+	constexpr unsigned k_textureBudgetBytes = 256 << 20;
+
+	// Layers a texture array starts with, it doubles from there
+	constexpr unsigned k_textureArrayLayers = 4;
+
+	// Headless runs advance the clock by this much a frame, whatever the frame actually took
+	constexpr float k_headlessFrameTime = 1.f / 60.f;
+
+	// Degrees a second the animated synthetic meshes turn about their own Y axis
+	constexpr float k_animationSpeed = 45.f;
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "FrameConstants.h"
+
+#include <cstring>
+#include <iostream>
+
+FrameConstantsBuffer::FrameConstantsBuffer(const GLuint bindingPoint) :
+	m_ID(0),
+	m_bindingPoint(bindingPoint),
+	m_regionSize(0),
+	m_mappedData(nullptr),
+	m_fences{},
+	m_currentRegion(0)
+{
+	// Each region has to start on a valid glBindBufferRange offset
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = alignment > 0 ? alignment : 256;
+
+	m_regionSize = (static_cast<GLsizeiptr>(sizeof(FrameConstants)) + alignment - 1) / alignment * alignment;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glCreateBuffers(1, &m_ID);
+	glNamedBufferStorage(m_ID, m_regionSize * constants::k_frameConstantsRegions, nullptr, flags);
+
+	m_mappedData = static_cast<unsigned char*>(
+		glMapNamedBufferRange(m_ID, 0, m_regionSize * constants::k_frameConstantsRegions, flags)
+	);
+
+	if (!m_mappedData)
+	{
+		std::cout << "ERROR::FRAME_CONSTANTS::COULD_NOT_MAP_BUFFER" << "\n";
+	}
+}
+
+FrameConstantsBuffer::~FrameConstantsBuffer()
+{
+	for (GLsync& fence : m_fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (m_mappedData)
+	{
+		glUnmapNamedBuffer(m_ID);
+	}
+
+	glDeleteBuffers(1, &m_ID);
+}
+
+void FrameConstantsBuffer::Write(const FrameConstants& constants)
+{
+	if (!m_mappedData)
+		return;
+
+	WaitForRegion(m_currentRegion);
+
+	const GLintptr offset = m_regionSize * m_currentRegion;
+	std::memcpy(m_mappedData + offset, &constants, sizeof(FrameConstants));
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, m_bindingPoint, m_ID, offset, sizeof(FrameConstants));
+}
+
+void FrameConstantsBuffer::EndFrame()
+{
+	m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_currentRegion = (m_currentRegion + 1) % constants::k_frameConstantsRegions;
+}
+
+void FrameConstantsBuffer::WaitForRegion(const int region)
+{
+	GLsync& fence = m_fences[region];
+
+	if (!fence)
+		return;
+
+	// The region is only in use if the GPU is more than two frames behind, so this rarely spins
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <gl/glew.h>
+#include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
+
+#include "Constants.h"
+
+// Mirrors the std140 FrameConstants block in frame_constants.glsl
+struct FrameConstants
+{
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	glm::vec4 m_cameraPosition;
+	GLint m_lightCount;
+	GLint m_padding[3];		// std140 starts the array on the next 16 bytes
+	glm::vec4 m_lightPositions[constants::k_maxLights];
+};
+
+static_assert(sizeof(FrameConstants) == 160 + 16 * constants::k_maxLights, "FrameConstants must match the std140 layout of the block");
+
+// Persistently mapped uniform buffer split into one region per frame in flight. Each region is
+// fenced after the frame that reads it, so the CPU never writes into memory the GPU is still using.
+class FrameConstantsBuffer
+{
+public:
+	explicit FrameConstantsBuffer(GLuint bindingPoint);
+
+	~FrameConstantsBuffer();
+
+	FrameConstantsBuffer(const FrameConstantsBuffer&) = delete;
+	FrameConstantsBuffer& operator=(const FrameConstantsBuffer&) = delete;
+
+	void Write(const FrameConstants& constants);
+
+	void EndFrame();
+
+private:
+	GLuint m_ID;
+	GLuint m_bindingPoint;
+	GLsizeiptr m_regionSize;
+	unsigned char* m_mappedData;
+	GLsync m_fences[constants::k_frameConstantsRegions];
+	int m_currentRegion;
+
+	void WaitForRegion(int region);
+};
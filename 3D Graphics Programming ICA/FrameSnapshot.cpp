@@ -0,0 +1,89 @@
+#include "FrameSnapshot.h"
+
+#include <chrono>
+
+FrameSnapshotBuffer::FrameSnapshotBuffer() :
+	m_published(0),
+	m_released(0),
+	m_closed(false)
+{
+}
+
+FrameSnapshot* FrameSnapshotBuffer::BeginWrite()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// The one being drawn and the one waiting are both off limits
+	if (!m_closed && m_published - m_released >= k_snapshots)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		m_condition.wait(lock, [this]() { return m_closed || m_published - m_released < k_snapshots; });
+
+		m_stats.m_updateWaits++;
+		m_stats.m_updateWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	if (m_closed)
+		return nullptr;
+
+	FrameSnapshot& snapshot = m_snapshots[m_published % k_snapshots];
+	snapshot.m_frame = m_published;
+
+	return &snapshot;
+}
+
+void FrameSnapshotBuffer::EndWrite()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_published++;
+		m_stats.m_published++;
+	}
+
+	m_condition.notify_all();
+}
+
+const FrameSnapshot* FrameSnapshotBuffer::BeginRead()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (!m_closed && m_published == m_released)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		m_condition.wait(lock, [this]() { return m_closed || m_published > m_released; });
+
+		m_stats.m_renderWaits++;
+		m_stats.m_renderWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	if (m_published == m_released)
+		return nullptr;
+
+	return &m_snapshots[m_released % k_snapshots];
+}
+
+void FrameSnapshotBuffer::EndRead()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_released++;
+	}
+
+	m_condition.notify_all();
+}
+
+void FrameSnapshotBuffer::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+	}
+
+	m_condition.notify_all();
+}
+
+FrameSnapshotStats FrameSnapshotBuffer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <glm/matrix.hpp>
+
+#include "FrameConstants.h"
+#include "Geometry.h"
+
+// A visible mesh as the update thread left it, the world matrix copied out of the scene graph
+struct SnapshotDraw
+{
+	const Geometry* m_geometry;
+	glm::mat4 m_modelMatrix;
+	float m_depth;		// View distance over the far plane, for the queue's sort key
+	unsigned m_materialId;
+};
+
+// Everything the render thread needs to draw a frame. The update thread fills it in and publishes
+// it, after which nothing changes it until the render thread has drawn it and handed it back.
+struct FrameSnapshot
+{
+	uint64_t m_frame = 0;
+	float m_deltaTime = 0.f;
+	int m_frameBufferWidth = 0;
+	int m_frameBufferHeight = 0;
+	FrameConstants m_frameConstants = {};
+	std::vector<SnapshotDraw> m_draws;
+	// One per unbatched mesh, in the game's order, so drawing them never reads the scene graph
+	std::vector<glm::mat4> m_unbatchedModelMatrices;
+};
+
+struct FrameSnapshotStats
+{
+	unsigned m_published = 0;
+	unsigned m_updateWaits = 0;		// Update found every snapshot still waiting to be drawn
+	unsigned m_renderWaits = 0;		// Render found nothing published yet
+	double m_updateWaitMs = 0.0;
+	double m_renderWaitMs = 0.0;
+};
+
+// Three snapshots handed from the update thread to the render thread in order: one being drawn,
+// one waiting and one being built. The update thread can get a frame ahead of what is being drawn
+// but no further, it waits rather than drop a frame, so every snapshot is drawn exactly once.
+// Snapshots are reused, their draw lists keep their capacity from frame to frame.
+class FrameSnapshotBuffer
+{
+public:
+	static constexpr unsigned k_snapshots = 3;
+
+	FrameSnapshotBuffer();
+
+	FrameSnapshotBuffer(const FrameSnapshotBuffer&) = delete;
+	FrameSnapshotBuffer& operator=(const FrameSnapshotBuffer&) = delete;
+
+	// Update thread. Waits for a free snapshot, null once closed
+	FrameSnapshot* BeginWrite();
+	void EndWrite();
+
+	// Render thread. Waits for the next published snapshot, null once closed with none left
+	const FrameSnapshot* BeginRead();
+	void EndRead();
+
+	// Wakes both sides, the render thread still gets what was already published
+	void Close();
+
+	FrameSnapshotStats GetStats() const;
+
+private:
+	FrameSnapshot m_snapshots[k_snapshots];
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	// Snapshot n lives in m_snapshots[n % k_snapshots]
+	uint64_t m_published;
+	uint64_t m_released;
+	bool m_closed;
+	FrameSnapshotStats m_stats;
+};
@@ -0,0 +1,158 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Index of the lowest set bit, the mask is never zero when this is called
+	unsigned LowestBit(const unsigned mask)
+	{
+		unsigned index = 0;
+		while (!(mask & (1u << index)))
+		{
+			++index;
+		}
+		return index;
+	}
+}
+
+Frustum::Frustum() :
+	m_planes{}
+{
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) :
+	m_planes{}
+{
+	Extract(viewProjection);
+}
+
+void Frustum::Extract(const glm::mat4& viewProjection)
+{
+	// Gribb/Hartmann: each plane is the last row of the matrix plus or minus one of the others
+	const auto row = [&viewProjection](const int index)
+	{
+		return glm::vec4(viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index]);
+	};
+
+	const glm::vec4 row0 = row(0);
+	const glm::vec4 row1 = row(1);
+	const glm::vec4 row2 = row(2);
+	const glm::vec4 row3 = row(3);
+
+	m_planes[0] = row3 + row0; // Left
+	m_planes[1] = row3 - row0; // Right
+	m_planes[2] = row3 + row1; // Bottom
+	m_planes[3] = row3 - row1; // Top
+	m_planes[4] = row3 + row2; // Near
+	m_planes[5] = row3 - row2; // Far
+
+	for (auto& plane : m_planes)
+	{
+		const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane = plane * (1.f / length);
+	}
+}
+
+bool Frustum::IsVisible(const AABB& bounds) const
+{
+	const glm::vec3 centre = bounds.GetCentre();
+	const glm::vec3 extents = bounds.GetExtents();
+
+	for (const auto& plane : m_planes)
+	{
+		const float distance = plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w;
+		const float radius = std::abs(plane.x) * extents.x + std::abs(plane.y) * extents.y + std::abs(plane.z) * extents.z;
+
+		if (distance + radius < 0.f)
+			return false;
+	}
+
+	return true;
+}
+
+void Frustum::Cull(const BoundsSoA& bounds, std::vector<unsigned>& visible) const
+{
+#if defined(__AVX__)
+	constexpr unsigned k_width = 8;
+	using Vec = __m256;
+	const auto set1 = [](const float value) { return _mm256_set1_ps(value); };
+	const auto load = [](const float* data) { return _mm256_loadu_ps(data); };
+	const auto add = [](const Vec a, const Vec b) { return _mm256_add_ps(a, b); };
+	const auto mul = [](const Vec a, const Vec b) { return _mm256_mul_ps(a, b); };
+	const auto insideMask = [](const Vec value) { return _mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ); };
+	const auto andMask = [](const Vec a, const Vec b) { return _mm256_and_ps(a, b); };
+	const auto moveMask = [](const Vec value) { return static_cast<unsigned>(_mm256_movemask_ps(value)); };
+#else
+	constexpr unsigned k_width = 4;
+	using Vec = __m128;
+	const auto set1 = [](const float value) { return _mm_set1_ps(value); };
+	const auto load = [](const float* data) { return _mm_loadu_ps(data); };
+	const auto add = [](const Vec a, const Vec b) { return _mm_add_ps(a, b); };
+	const auto mul = [](const Vec a, const Vec b) { return _mm_mul_ps(a, b); };
+	const auto insideMask = [](const Vec value) { return _mm_cmpge_ps(value, _mm_setzero_ps()); };
+	const auto andMask = [](const Vec a, const Vec b) { return _mm_and_ps(a, b); };
+	const auto moveMask = [](const Vec value) { return static_cast<unsigned>(_mm_movemask_ps(value)); };
+#endif
+
+	// Plane terms are the same for every box, so broadcast them once
+	Vec planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int i = 0; i < 6; ++i)
+	{
+		planeX[i] = set1(m_planes[i].x);
+		planeY[i] = set1(m_planes[i].y);
+		planeZ[i] = set1(m_planes[i].z);
+		planeW[i] = set1(m_planes[i].w);
+		absX[i] = set1(std::abs(m_planes[i].x));
+		absY[i] = set1(std::abs(m_planes[i].y));
+		absZ[i] = set1(std::abs(m_planes[i].z));
+	}
+
+	const Vec allInside = insideMask(set1(0.f));
+
+	for (unsigned base = 0; base < bounds.m_count; base += k_width)
+	{
+		const Vec centreX = load(&bounds.m_centreX[base]);
+		const Vec centreY = load(&bounds.m_centreY[base]);
+		const Vec centreZ = load(&bounds.m_centreZ[base]);
+		const Vec extentX = load(&bounds.m_extentX[base]);
+		const Vec extentY = load(&bounds.m_extentY[base]);
+		const Vec extentZ = load(&bounds.m_extentZ[base]);
+
+		Vec inside = allInside;
+
+		for (int i = 0; i < 6; ++i)
+		{
+			const Vec distance = add(add(mul(planeX[i], centreX), mul(planeY[i], centreY)), add(mul(planeZ[i], centreZ), planeW[i]));
+			const Vec radius = add(add(mul(absX[i], extentX), mul(absY[i], extentY)), mul(absZ[i], extentZ));
+
+			inside = andMask(inside, insideMask(add(distance, radius)));
+		}
+
+		unsigned mask = moveMask(inside);
+
+		// Drop the padding lanes past the last box
+		const unsigned remaining = bounds.m_count - base;
+		if (remaining < k_width)
+		{
+			mask &= (1u << remaining) - 1u;
+		}
+
+		while (mask)
+		{
+			visible.push_back(base + LowestBit(mask));
+			mask &= mask - 1u;
+		}
+	}
+}
+
+const glm::vec4& Frustum::GetPlane(const int index) const
+{
+	return m_planes[index];
+}
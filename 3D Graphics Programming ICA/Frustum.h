@@ -0,0 +1,28 @@
+#pragma once
+#include <vector>
+#include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
+
+#include "Bounds.h"
+
+class Frustum
+{
+public:
+	Frustum();
+
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	// Pulls the six normalised planes out of projection * view
+	void Extract(const glm::mat4& viewProjection);
+
+	bool IsVisible(const AABB& bounds) const;
+
+	// Appends the index of every box that touches the frustum, eight boxes per iteration on AVX
+	// and four on SSE
+	void Cull(const BoundsSoA& bounds, std::vector<unsigned>& visible) const;
+
+	const glm::vec4& GetPlane(int index) const;
+
+private:
+	glm::vec4 m_planes[6];
+};
@@ -1,7 +1,18 @@
 #include "Game.h"
 
-Game::Game(const std::string& title, const int width, const int height, const int glVersionMajor, const int glVersionMinor, const bool resizable) :
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+Game::Game(const std::string& title, const int width, const int height, const int glVersionMajor, const int glVersionMinor, const bool resizable,
+	const RunSettings& settings) :
+	m_settings(settings),
 	m_window(nullptr),
+	m_headlessContext(nullptr),
+	m_renderTarget(nullptr),
+	m_title(title),
 	m_windowWidth(width),
 	m_windowHeight(height),
 	m_frameBufferWidth(m_windowWidth),
@@ -11,6 +22,13 @@ Game::Game(const std::string& title, const int width, const int height, const in
 	m_deltaTime(0.f),
 	m_currentFrameTime(0.f),
 	m_prevFrameTime(0.f),
+	m_statsTimer(0.f),
+	m_statsFrames(0),
+	m_startTime(std::chrono::steady_clock::now()),
+	m_firstFrameRendered(false),
+	m_firstFrameMs(0.0),
+	m_streamingTime(0.f),
+	m_streamingWorstFrame(0.f),
 	m_prevMouseX(0.0),
 	m_prevMouseY(0.0),
 	m_currentMouseX(0.0),
@@ -24,53 +42,144 @@ Game::Game(const std::string& title, const int width, const int height, const in
 	),
 	m_cameraDirection(eDirection::e_None),
 	m_projectionMatrix(1.f),
+	m_projectionDirty(false),
 	m_fov(90.f),
 	m_nearPlane(0.1f),
-	m_farPlane(1000.f)
+	m_farPlane(1000.f),
+	m_textureStreamer(new TextureStreamer(m_threadPool)),
+	m_textureCache(new TextureCache(*m_textureStreamer)),
+	m_geometryRegistry(new GeometryRegistry(&m_threadPool)),
+	m_sceneGraph(&m_threadPool),
+	m_shaderVariants(m_shaders, glVersionMajor, glVersionMinor),
+	m_shaderVariantsLogged(false),
+	m_texturePool(new TextureArrayPool()),
+	m_texturesPooled(false),
+	m_useTextureArrays(false),
+	m_renderQueue(new RenderQueue(m_shaders, m_materials)),
+	m_meshBvh(&m_threadPool),
+	m_viewportWidth(0),
+	m_viewportHeight(0),
+	m_frameConstantsBuffer(nullptr),
+	m_textureBinds(0),
+	m_textureArrayBinds(0),
+	m_traceKeyDown(false),
+	m_traceRequested(false)
 {
-	InitGLFW();
-	InitWindow(title, resizable);
+	//Startup is captured too, P writes everything so far out as a trace. Headless runs only pay for
+	//capturing when a trace was asked for
+	Profiler::SetThreadName("Main");
+
+	if (m_settings.m_mode == eRunMode::e_Windowed || !m_settings.m_traceFile.empty())
+	{
+		Profiler::StartCapture();
+	}
+
+	if (m_settings.m_mode == eRunMode::e_Headless)
+	{
+		InitHeadlessContext();
+	} else
+	{
+		InitGLFW();
+		InitWindow(title, resizable);
+	}
+
 	InitGLEW();
 	InitOpenGlOptions();
+	InitRenderTarget();
+	InitCameraPath();
 
 	InitMatrices();
 	InitShaders();
 	InitTextures();
 	InitMaterials();
+	InitShaderVariants();
 	InitMeshes();
+	InitBatches();
 	InitLights();
+	InitSyntheticScene();
 	InitUniforms();
+	LogGeometryStats();
 }
 
 Game::~Game()
 {
-	glfwDestroyWindow(m_window);
-	glfwTerminate();
+	StopRenderThread();
 
-	for (auto* shader : m_shaders)
+	if (!m_settings.m_recordCameraFile.empty() && m_cameraPath.Save(m_settings.m_recordCameraFile))
 	{
-		delete shader;
+		std::cout << "CAMERA_PATH: " << m_cameraPath.GetDuration() << "s recorded to " << m_settings.m_recordCameraFile << "\n";
+	}
+
+	//Everything holding GL objects goes while the context is still current
+	ReleaseGpuResources();
+
+	if (m_window)
+	{
+		glfwDestroyWindow(m_window);
+		glfwTerminate();
 	}
 
-	for (auto* texture : m_textures)
+	delete m_headlessContext;
+}
+
+void Game::ReleaseGpuResources()
+{
+	//The profiler outlives the context, so a later Game's GPU scopes don't use its queries
+	Profiler::ReleaseGpuQueries();
+
+	for (auto* shader : m_shaders)
 	{
-		delete texture;
+		delete shader;
 	}
+	m_shaders.clear();
 
 	for (auto* material : m_materials)
 	{
 		delete material;
 	}
+	m_materials.clear();
 
+	//Meshes and batches hold geometry, which gives its range back to the registry's arenas
 	for (auto* mesh : m_meshes)
 	{
 		delete mesh;
 	}
+	m_meshes.clear();
+
+	for (auto* batch : m_batches)
+	{
+		delete batch;
+	}
+	m_batches.clear();
+
+	for (auto* mesh : m_unbatchedMeshes)
+	{
+		delete mesh;
+	}
+	m_unbatchedMeshes.clear();
 
 	for (auto* light : m_lights)
 	{
 		delete light;
 	}
+	m_lights.clear();
+
+	delete m_frameConstantsBuffer;
+	m_frameConstantsBuffer = nullptr;
+
+	m_renderQueue.reset();
+
+	//The streamer waits for its decodes before freeing its ring, then the textures go from both
+	//the game and the cache
+	m_textureStreamer.reset();
+	m_textures.clear();
+	m_textureCache.reset();
+	m_texturePool.reset();
+
+	m_geometryRegistry.reset();
+
+	delete m_renderTarget;
+	m_renderTarget = nullptr;
 }
 
 //Accessor
@@ -88,36 +197,411 @@ void Game::SetWindowShouldClose() const
 //Functions
 void Game::Update()
 {
+	ProfileScope scope("Game::Update");
+
 	UpdateDeltaTime();
-	UpdateInput();
+	UpdateTitle();
+
+	if (m_settings.m_mode == eRunMode::e_Headless)
+	{
+		UpdateCameraPath();
+	} else
+	{
+		UpdateInput();
+	}
+
+	UpdateAnimation();
+
+	// Rebuild only the world matrices under nodes that changed since last frame
+	{
+		ProfileScope sceneScope("SceneGraph::Update");
+		m_sceneGraph.Update();
+	}
+
+	UpdateVisibility();
+	UpdateSnapshot();
 	//Game::updateInput(window, *meshes[MESH_QUAD]);
 }
 
-void Game::Render()
+bool Game::Render()
+{
+	const FrameSnapshot* snapshot = m_snapshots.BeginRead();
+
+	if (!snapshot)
+		return false;
+
+	Profiler::BeginFrame();
+
+	//The trace key is read on the main thread, but only the profiler's frame thread may write it
+	if (m_traceRequested.exchange(false) && Profiler::WriteChromeTrace("profile.json"))
+	{
+		std::cout << "PROFILER: trace written to profile.json" << "\n";
+	}
+
+	RenderFrame(*snapshot);
+
+	m_snapshots.EndRead();
+	return true;
+}
+
+void Game::Run()
+{
+	if (!m_settings.m_renderThread)
+	{
+		while (!GetWindowShouldClose())
+		{
+			Update();
+			Render();
+		}
+
+		return;
+	}
+
+	StartRenderThread();
+
+	while (!GetWindowShouldClose())
+	{
+		Update();
+	}
+
+	StopRenderThread();
+}
+
+void Game::RenderFrame(const FrameSnapshot& snapshot)
 {
+	ProfileScope scope("Game::Render");
+	GpuProfileScope gpuScope("Game::Render");
+
+	m_textureStreamer->Update();
+	m_textureCache->Update();
+
+	if (!m_texturesPooled && m_textureStreamer->IsIdle())
+	{
+		InitTextureArrays();
+	}
+
+	UpdateUniforms(snapshot);
+
 	glClearColor(0.f, 0.f, 0.f, 1.f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-	UpdateUniforms();
+	//Queue every visible mesh, the queue sorts them so shared state is only set once
+	//Synthetic materials are made with the same features as the scene's, so one variant draws them all
+	const Material& material = *m_materials[static_cast<int>(eMaterials::ALIEN_MATERIAL)];
+	const unsigned meshShader = m_shaderVariants.Resolve(
+		static_cast<unsigned>(m_useTextureArrays ? eShaders::ARRAY_PROGRAM : eShaders::INDIRECT_PROGRAM), material.GetShaderFeatures());
 
-	m_materials[static_cast<int>(eMaterials::ALIEN_MATERIAL)]->SendToShader(*m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]);
+	for (const SnapshotDraw& draw : snapshot.m_draws)
+	{
+		const MaterialTextures& textures = m_materialTextures[draw.m_materialId];
+
+		m_renderQueue->Submit(eRenderPass::e_Opaque,
+			meshShader,
+			draw.m_materialId,
+			m_useTextureArrays ? textures.m_arrayTextureSet : textures.m_textureSet,
+			*draw.m_geometry,
+			draw.m_modelMatrix,
+			draw.m_depth);
+	}
 
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->Use();
+	m_renderQueue->Flush();
+
+	Shader& instancedShader = *m_shaders[m_shaderVariants.Resolve(static_cast<unsigned>(eShaders::INSTANCED_PROGRAM), material.GetShaderFeatures())];
+	material.SendToShader(instancedShader);
 
 	m_textures[static_cast<int>(eTextures::BOX)]->Bind(0);
 	m_textures[static_cast<int>(eTextures::BOX_SPECULAR)]->Bind(1);
+	m_textureCache->Touch(m_textures[static_cast<int>(eTextures::BOX)].get());
+	m_textureCache->Touch(m_textures[static_cast<int>(eTextures::BOX_SPECULAR)].get());
 
-	m_meshes[static_cast<int>(eMeshes::ALIEN)]->Render(*m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]);
+	unsigned batchDrawCalls = 0;
+
+	for (auto* batch : m_batches)
+	{
+		batch->Render(instancedShader);
+		batchDrawCalls += batch->GetInstanceCount() > 0 ? 1 : 0;
+	}
+
+	//Unbatched cubes share the batches' textures, each one sets its uniforms and draws on its own
+	if (!m_unbatchedMeshes.empty())
+	{
+		Shader& coreShader = *m_shaders[m_shaderVariants.Resolve(static_cast<unsigned>(eShaders::CORE_PROGRAM), material.GetShaderFeatures())];
+		material.SendToShader(coreShader);
+
+		//Matrices come from the snapshot, the scene graph may already be a frame ahead
+		for (size_t i = 0; i < m_unbatchedMeshes.size(); ++i)
+		{
+			m_unbatchedMeshes[i]->Render(coreShader, snapshot.m_unbatchedModelMatrices[i]);
+		}
+
+		batchDrawCalls += static_cast<unsigned>(m_unbatchedMeshes.size());
+	}
+
+	m_frameConstantsBuffer->EndFrame();
+
+	if (m_window)
+	{
+		glfwSwapBuffers(m_window);
+	}
 
-	glfwSwapBuffers(m_window);
 	glFlush();
 
+	if (!m_firstFrameRendered)
+	{
+		m_firstFrameRendered = true;
+		m_firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+		std::cout << "STARTUP: first frame after " << m_firstFrameMs << "ms" << "\n";
+	}
+
+	const UniformStats& frameStats = Shader::GetFrameStats();
+	m_uniformStats.m_uploads += frameStats.m_uploads;
+	m_uniformStats.m_glCalls += frameStats.m_glCalls;
+	m_uniformStats.m_glCallsSaved += frameStats.m_glCallsSaved;
+	m_uniformStats.m_lookups += frameStats.m_lookups;
+
+	const RenderStats& renderStats = m_renderQueue->GetFrameStats();
+	m_renderStats.m_packets += renderStats.m_packets;
+	m_renderStats.m_drawCalls += renderStats.m_drawCalls + batchDrawCalls;
+	m_renderStats.m_programChangesAvoided += renderStats.m_programChangesAvoided;
+	m_renderStats.m_vaoChangesAvoided += renderStats.m_vaoChangesAvoided;
+	m_renderStats.m_textureBinds += renderStats.m_textureBinds;
+	m_renderStats.m_textureBindsAvoided += renderStats.m_textureBindsAvoided;
+	m_renderStats.m_materialChangesAvoided += renderStats.m_materialChangesAvoided;
+	m_renderStats.m_keyOverflows += renderStats.m_keyOverflows;
+	m_textureBinds += Texture::GetFrameBinds() + m_texturePool->GetFrameBinds();
+	m_textureArrayBinds += m_texturePool->GetFrameBinds();
+	m_statsFrames++;
+
+	Profiler::RecordCounter("draw calls", renderStats.m_drawCalls + batchDrawCalls);
+	Profiler::RecordCounter("uniform GL calls", frameStats.m_glCalls);
+	Profiler::RecordCounter("texture binds", Texture::GetFrameBinds() + m_texturePool->GetFrameBinds());
+	Shader::ResetFrameStats();
+	Texture::ResetFrameBinds();
+	m_texturePool->ResetFrameBinds();
+
+	UpdateStats(snapshot);
+
 	glBindVertexArray(0);
 	glUseProgram(0);
 	glActiveTexture(0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+bool Game::RunHeadless(HeadlessResult* result)
+{
+	if (!m_headlessContext || !m_headlessContext->IsValid() || !m_renderTarget || !m_renderTarget->IsComplete())
+	{
+		std::cout << "ERROR::GAME::NO_HEADLESS_CONTEXT" << "\n";
+		return false;
+	}
+
+	if (m_cameraPath.IsEmpty())
+	{
+		std::cout << "ERROR::GAME::NO_CAMERA_PATH: " << m_settings.m_cameraFile << "\n";
+		return false;
+	}
+
+	//Nothing is timed until every texture has streamed in and every variant drawn with has linked,
+	//then the warm up frames settle caches and the driver. Warm up stays on this thread, the
+	//render thread would race it for the streamer's state. The frame delta is fixed here, so the
+	//frames textures stream behind are timed on the wall clock, all but the first, which is startup's
+	unsigned warmupFrames = 0;
+	double streamingMs = 0.0;
+	double streamingWorstFrameMs = 0.0;
+
+	while (warmupFrames < m_settings.m_warmupFrames || !m_textureStreamer->IsIdle() || !m_texturesPooled || !m_shaderVariants.IsSettled())
+	{
+		const bool streaming = !m_textureStreamer->IsIdle() && m_firstFrameRendered;
+		const auto frameStart = std::chrono::steady_clock::now();
+
+		Update();
+		Render();
+		glFinish();
+
+		if (streaming)
+		{
+			const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			streamingMs += frameMs;
+			streamingWorstFrameMs = std::max(streamingWorstFrameMs, frameMs);
+		}
+
+		if (m_textureStreamer->IsIdle() && m_texturesPooled && m_shaderVariants.IsSettled())
+		{
+			warmupFrames++;
+		}
+	}
+
+	m_uniformStats = UniformStats();
+	m_renderStats = RenderStats();
+	m_textureBinds = 0;
+	m_textureArrayBinds = 0;
+	m_statsFrames = 0;
+
+	//The path starts over so the timed frames, and the last one's image, are the same every run
+	//however long the warm up took
+	m_currentFrameTime = 0.f;
+
+	HeadlessResult localResult;
+	HeadlessResult& timed = result ? *result : localResult;
+	const unsigned frames = m_settings.m_frames;
+
+	timed.m_frameMs.assign(frames, 0.0);
+	timed.m_cpuMs.assign(frames, 0.0);
+	timed.m_updateMs.assign(frames, 0.0);
+	timed.m_renderMs.assign(frames, 0.0);
+	timed.m_firstFrameMs = m_firstFrameMs;
+	timed.m_streamingMs = streamingMs;
+	timed.m_streamingWorstFrameMs = streamingWorstFrameMs;
+	timed.m_texturesStreamed = m_textureStreamer->GetStats().m_completed;
+
+	std::vector<std::chrono::steady_clock::time_point> finished(frames);
+	unsigned visibleMeshes = 0;
+
+	//Time spent blocked on the snapshots is left out, it is the other thread's work
+	const auto updateFrame = [&](const unsigned frame)
+	{
+		const double waitedMs = m_snapshots.GetStats().m_updateWaitMs;
+		const auto start = std::chrono::steady_clock::now();
+		Update();
+		const auto updated = std::chrono::steady_clock::now();
+
+		timed.m_updateMs[frame] = std::chrono::duration<double, std::milli>(updated - start).count() - (m_snapshots.GetStats().m_updateWaitMs - waitedMs);
+		visibleMeshes += static_cast<unsigned>(m_visibleMeshes.size());
+	};
+
+	//With no swap to wait on, glFinish stands in for it so each frame includes its GPU work
+	const auto renderFrame = [&](const unsigned frame)
+	{
+		const double waitedMs = m_snapshots.GetStats().m_renderWaitMs;
+		const auto start = std::chrono::steady_clock::now();
+		Render();
+		const auto submitted = std::chrono::steady_clock::now();
+		glFinish();
+
+		timed.m_renderMs[frame] = std::chrono::duration<double, std::milli>(submitted - start).count() - (m_snapshots.GetStats().m_renderWaitMs - waitedMs);
+		finished[frame] = std::chrono::steady_clock::now();
+	};
+
+	const auto timingStart = std::chrono::steady_clock::now();
+
+	if (m_settings.m_renderThread)
+	{
+		//The render thread takes the context for the timed frames, this thread keeps updating
+		ReleaseContext();
+
+		std::thread renderThread([&]()
+		{
+			MakeContextCurrent();
+			Profiler::SetThreadName("Render");
+
+			for (unsigned frame = 0; frame < frames; ++frame)
+			{
+				renderFrame(frame);
+			}
+
+			ReleaseContext();
+		});
+
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			updateFrame(frame);
+		}
+
+		renderThread.join();
+		MakeContextCurrent();
+	} else
+	{
+		for (unsigned frame = 0; frame < frames; ++frame)
+		{
+			updateFrame(frame);
+			renderFrame(frame);
+		}
+	}
+
+	for (unsigned frame = 0; frame < frames; ++frame)
+	{
+		const auto previous = frame == 0 ? timingStart : finished[frame - 1];
+		timed.m_frameMs[frame] = std::chrono::duration<double, std::milli>(finished[frame] - previous).count();
+		timed.m_cpuMs[frame] = timed.m_updateMs[frame] + timed.m_renderMs[frame];
+	}
+
+	//Reads back the last GPU frames and drains the CPU scopes of the final frame
+	Profiler::BeginFrame();
+
+	const double statsFrames = static_cast<double>(std::max(m_statsFrames, 1u));
+
+	timed.m_visibleMeshes = visibleMeshes / statsFrames;
+	timed.m_drawCalls = m_renderStats.m_drawCalls / statsFrames;
+	timed.m_uniformGlCalls = m_uniformStats.m_glCalls / statsFrames;
+	timed.m_textureBinds = m_textureBinds / statsFrames;
+	timed.m_textureArrayBinds = m_textureArrayBinds / statsFrames;
+	timed.m_textureArrays = m_useTextureArrays ? m_texturePool->GetNumOfArrays() : 0;
+	timed.m_width = m_renderTarget->GetWidth();
+	timed.m_height = m_renderTarget->GetHeight();
+	m_renderTarget->ReadPixels(timed.m_image);
+
+	bool written = m_settings.m_statsFile.empty() || WriteFrameStats(timed);
+
+	if (!m_settings.m_traceFile.empty())
+	{
+		written = Profiler::WriteChromeTrace(m_settings.m_traceFile) && written;
+	}
+
+	return written;
+}
+
+void Game::StartRenderThread()
+{
+	//The context moves with the drawing, GLFW's events stay on the main thread
+	ReleaseContext();
+
+	m_renderThread = std::thread([this]()
+	{
+		MakeContextCurrent();
+		Profiler::SetThreadName("Render");
+
+		while (Render())
+		{
+		}
+
+		ReleaseContext();
+	});
+}
+
+void Game::StopRenderThread()
+{
+	if (!m_renderThread.joinable())
+		return;
+
+	//Whatever was already published still gets drawn, then the context comes back for cleanup
+	m_snapshots.Close();
+	m_renderThread.join();
+
+	MakeContextCurrent();
+}
+
+void Game::MakeContextCurrent() const
+{
+	if (m_window)
+	{
+		glfwMakeContextCurrent(m_window);
+	} else if (m_headlessContext)
+	{
+		m_headlessContext->MakeCurrent();
+	}
+}
+
+void Game::ReleaseContext() const
+{
+	if (m_window)
+	{
+		glfwMakeContextCurrent(nullptr);
+	} else if (m_headlessContext)
+	{
+		m_headlessContext->ReleaseCurrent();
+	}
+}
+
 void Game::InitGLFW()
 {
 	if (glfwInit() == GLFW_FALSE)
@@ -143,18 +627,33 @@ void Game::InitWindow(const std::string& title, const bool resizable)
 	}
 
 	glfwGetFramebufferSize(m_window, &m_frameBufferWidth, &m_frameBufferHeight);
+	glfwSetWindowUserPointer(m_window, this);
 	glfwSetFramebufferSizeCallback(m_window, Game::FrameBufferResizeCallback);
 
 	glfwMakeContextCurrent(m_window);
 	glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 }
 
+void Game::InitHeadlessContext()
+{
+	m_headlessContext = new HeadlessContext(m_glVersionMajor, m_glVersionMinor);
+}
+
 void Game::InitGLEW()
 {
 	glewExperimental = GL_TRUE;
 
+	const GLenum result = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	//GLEW built for GLX finds no display under EGL, the entry points it loaded are fine regardless
+	const bool initialised = result == GLEW_OK || (m_headlessContext && result == GLEW_ERROR_NO_GLX_DISPLAY);
+#else
+	const bool initialised = result == GLEW_OK;
+#endif
+
 	//Error
-	if (glewInit() != GLEW_OK)
+	if (!initialised)
 	{
 		std::cout << "ERROR::MAIN.CPP::GLEW_INIT_FAILED" << "\n";
 		glfwTerminate();
@@ -175,8 +674,39 @@ void Game::InitOpenGlOptions()
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
+void Game::InitRenderTarget()
+{
+	//Headless frames go into an offscreen buffer the size a window would have been
+	if (m_settings.m_mode != eRunMode::e_Headless)
+		return;
+
+	m_renderTarget = new RenderTarget(m_frameBufferWidth, m_frameBufferHeight);
+	m_renderTarget->Bind();
+}
+
+void Game::InitCameraPath()
+{
+	if (m_settings.m_mode != eRunMode::e_Headless)
+		return;
+
+	//A path that won't load is left empty rather than swapped for the orbit, RunHeadless then fails
+	if (!m_settings.m_cameraFile.empty())
+	{
+		m_cameraPath.Load(m_settings.m_cameraFile);
+		return;
+	}
+
+	//Without a recorded path the camera circles the scene, taking in the synthetic content too
+	const float radius = m_settings.m_scene.m_meshes > 0 || m_settings.m_scene.m_instances > 0 ? m_settings.m_scene.m_extent : 8.f;
+	m_cameraPath = CameraPath::MakeOrbit(radius, radius * 0.25f, 10.f);
+}
+
 void Game::InitMatrices()
 {
+	// A minimised window reports a 0x0 framebuffer, keep the last projection until it comes back
+	if (m_frameBufferWidth <= 0 || m_frameBufferHeight <= 0)
+		return;
+
 	m_projectionMatrix = glm::mat4(1.f);
 	m_projectionMatrix = glm::perspective(
 		glm::radians(m_fov),
@@ -188,42 +718,266 @@ void Game::InitMatrices()
 
 void Game::InitShaders()
 {
-	m_shaders.push_back(new Shader(m_glVersionMajor, m_glVersionMinor, "vertex_core.glsl", "fragment_core.glsl"));
+	ProfileScope scope("Game::InitShaders");
+
+	//Each slot of eShaders is the fallback of a family, which can draw any material. Specialised
+	//variants are requested once the materials exist
+	m_shaderVariants.AddFamily("vertex_core.glsl", "fragment_core.glsl");
+	m_shaderVariants.AddFamily("vertex_instanced.glsl", "fragment_core.glsl");
+
+	//Meshes are merged into multi-draw calls when the driver exposes gl_DrawIDARB, otherwise the
+	//indirect slot holds a plain core program and the queue draws them one at a time. Runs can
+	//also ask for that to compare the two
+	const bool multiDraw = GLEW_ARB_shader_draw_parameters && m_settings.m_multiDraw;
+	const std::string indirectVertexFile = multiDraw ? "vertex_indirect.glsl" : "vertex_core.glsl";
+	m_shaderVariants.AddFamily(indirectVertexFile, "fragment_core.glsl");
+	m_shaderVariants.AddFamily(indirectVertexFile, "fragment_core.glsl", static_cast<unsigned>(eShaderFeature::e_TextureArray));
+
+	if (multiDraw)
+	{
+		m_renderQueue->SetIndirectShader(static_cast<unsigned>(eShaders::INDIRECT_PROGRAM));
+		m_renderQueue->SetIndirectShader(static_cast<unsigned>(eShaders::ARRAY_PROGRAM));
+	}
 }
 
 void Game::InitTextures()
 {
-	m_textures.push_back(new Texture("Data/alien.png", GL_TEXTURE_2D));
-	m_textures.push_back(new Texture("Data/alien_specular.png", GL_TEXTURE_2D));
-	m_textures.push_back(new Texture("Data/box.png", GL_TEXTURE_2D));
-	m_textures.push_back(new Texture("Data/box_specular.png", GL_TEXTURE_2D));
+	ProfileScope scope("Game::InitTextures");
+
+	//Placeholders until the streamer has decoded and uploaded them, the cache shares repeats
+	m_textures.push_back(m_textureCache->Acquire("Data/alien.png", GL_TEXTURE_2D));
+	m_textures.push_back(m_textureCache->Acquire("Data/alien_specular.png", GL_TEXTURE_2D));
+	m_textures.push_back(m_textureCache->Acquire("Data/box.png", GL_TEXTURE_2D));
+	m_textures.push_back(m_textureCache->Acquire("Data/box_specular.png", GL_TEXTURE_2D));
+}
+
+void Game::InitTextureArrays()
+{
+	ProfileScope scope("Game::InitTextureArrays");
+
+	//Once streamed in, every material's textures are copied into array layers. Materials whose
+	//textures match in size and format then share one binding per array, only the layer uniforms
+	//differ. All of them move over or none do
+	m_texturesPooled = true;
+
+	if (!m_settings.m_textureArrays)
+		return;
+
+	std::vector<TextureArrayHandle> handles;
+	bool pooled = true;
+
+	for (const MaterialTextures& textures : m_materialTextures)
+	{
+		handles.push_back(m_texturePool->Add(*m_textures[textures.m_diffuse]));
+		handles.push_back(m_texturePool->Add(*m_textures[textures.m_specular]));
+
+		pooled = pooled && handles[handles.size() - 2].IsValid() && handles.back().IsValid();
+	}
+
+	if (!pooled)
+	{
+		for (const TextureArrayHandle& handle : handles)
+		{
+			m_texturePool->Remove(handle);
+		}
+
+		return;
+	}
+
+	for (size_t material = 0; material < m_materialTextures.size(); ++material)
+	{
+		const TextureArrayHandle& diffuse = handles[material * 2];
+		const TextureArrayHandle& specular = handles[material * 2 + 1];
+
+		m_materials[material]->SetTextureLayers(static_cast<GLint>(diffuse.m_layer), static_cast<GLint>(specular.m_layer));
+		m_materialTextures[material].m_arrayTextureSet = m_renderQueue->RegisterArrayTextureSet(*m_texturePool, { diffuse.m_array, specular.m_array });
+	}
+
+	m_useTextureArrays = true;
+
+	const TextureArrayStats arrayStats = m_texturePool->GetStats();
+	std::cout << "TEXTURE_ARRAYS: " << arrayStats.m_layers << " layers in " << arrayStats.m_arrays << " arrays, "
+		<< arrayStats.m_bytes / 1024.0 << " KB" << "\n";
 }
 
 void Game::InitMaterials()
 {
 	m_materials.push_back(new Material(glm::vec3(0.1f), glm::vec3(1.f), glm::vec3(1.f),
 		0, 1));
+	m_materialTextures.push_back({ static_cast<unsigned>(eTextures::BOX), static_cast<unsigned>(eTextures::BOX_SPECULAR), 0, 0 });
+
+	//Synthetic materials draw like the scene's, with generated textures of their own in place of
+	//the box's. Streamed ones start as placeholders like the scene's files
+	const SyntheticSceneSettings& scene = m_settings.m_scene;
+	const int size = static_cast<int>(scene.m_materialTextureSize);
+	std::vector<unsigned char> diffuse;
+	std::vector<unsigned char> specular;
+
+	for (unsigned i = 0; i < scene.m_materials; ++i)
+	{
+		SyntheticScene::MakeMaterialImages(i, size, diffuse, specular);
+
+		const unsigned firstTexture = static_cast<unsigned>(m_textures.size());
+
+		for (std::vector<unsigned char>* image : { &diffuse, &specular })
+		{
+			if (scene.m_streamMaterials)
+			{
+				const std::string name = "material " + std::to_string(i) + (image == &diffuse ? " diffuse" : " specular");
+				m_textures.emplace_back(m_textureStreamer->Load(name, std::move(*image), size, size, GL_TEXTURE_2D));
+				continue;
+			}
+
+			auto texture = std::make_shared<Texture>(GL_TEXTURE_2D);
+			texture->UploadImage(image->data(), size, size);
+			m_textures.push_back(texture);
+		}
+
+		m_materials.push_back(new Material(glm::vec3(0.1f), glm::vec3(1.f), glm::vec3(1.f), 0, 1));
+		m_materialTextures.push_back({ firstTexture, firstTexture + 1, 0, 0 });
+	}
+
+	for (MaterialTextures& textures : m_materialTextures)
+	{
+		textures.m_textureSet = m_renderQueue->RegisterTextureSet({ m_textures[textures.m_diffuse].get(), m_textures[textures.m_specular].get() });
+	}
+}
+
+void Game::InitShaderVariants()
+{
+	ProfileScope scope("Game::InitShaderVariants");
+
+	//Everything is submitted up front so the driver can compile it all in parallel, drawing uses
+	//the fallbacks until the variants are done
+	for (const Material* material : m_materials)
+	{
+		const unsigned features = material->GetShaderFeatures();
+
+		for (const eShaders family : { eShaders::CORE_PROGRAM, eShaders::INSTANCED_PROGRAM, eShaders::INDIRECT_PROGRAM, eShaders::ARRAY_PROGRAM })
+		{
+			//Only unbatched synthetic cubes draw with the core program
+			if (family == eShaders::CORE_PROGRAM && !m_settings.m_scene.m_unbatched)
+				continue;
+
+			const unsigned shaderId = m_shaderVariants.Request(static_cast<unsigned>(family), features);
+
+			if (GLEW_ARB_shader_draw_parameters && m_settings.m_multiDraw && (family == eShaders::INDIRECT_PROGRAM || family == eShaders::ARRAY_PROGRAM))
+			{
+				m_renderQueue->SetIndirectShader(shaderId);
+			}
+		}
+	}
 }
 
 void Game::InitMeshes()
 {
 	m_meshes.push_back(
 		new Mesh(
+			m_sceneGraph,
+			k_invalidNode,
+			m_geometryRegistry->Get(ePrimitiveType::e_Cube, eVertexFormat::e_Quantized),
 			glm::vec3(0.f),
 			glm::vec3(0.f),
-			glm::vec3(1.f),
-			ePrimitiveType::e_Cube
+			glm::vec3(1.f)
 		)
 	);
 
 	m_meshes.push_back(
 		new Mesh(
+			m_sceneGraph,
+			k_invalidNode,
+			m_geometryRegistry->Get(ePrimitiveType::e_Cube, eVertexFormat::e_Quantized),
 			glm::vec3(0.f),
 			glm::vec3(0.f),
-			glm::vec3(1.f),
-			ePrimitiveType::e_Cube
+			glm::vec3(1.f)
 		)
 	);
+
+	//Cooked ahead of time with --cook, so it goes straight from the file into the arena
+	m_meshes.push_back(
+		new Mesh(
+			m_sceneGraph,
+			k_invalidNode,
+			*m_geometryRegistry,
+			"Data/torus.mesh",
+			glm::vec3(2.5f, 0.f, 0.f),
+			glm::vec3(90.f, 0.f, 0.f),
+			glm::vec3(1.f)
+		)
+	);
+}
+
+void Game::InitBatches()
+{
+	const int gridSize = constants::k_instancedGridSize;
+
+	auto* cubes = new InstancedBatch(m_geometryRegistry->Get(ePrimitiveType::e_Cube), gridSize * gridSize);
+
+	// A floor of cubes below the scene, all drawn with one call
+	for (int x = 0; x < gridSize; ++x)
+	{
+		for (int z = 0; z < gridSize; ++z)
+		{
+			const glm::vec3 position(
+				(static_cast<float>(x) - gridSize * 0.5f) * 1.5f,
+				-2.f,
+				(static_cast<float>(z) - gridSize * 0.5f) * 1.5f
+			);
+
+			cubes->AddInstance(glm::translate(glm::mat4(1.f), position));
+		}
+	}
+
+	m_batches.push_back(cubes);
+}
+
+void Game::InitSyntheticScene()
+{
+	const SyntheticSceneSettings& scene = m_settings.m_scene;
+	const size_t firstMesh = m_meshes.size();
+
+	//The scene's own meshes draw with its material
+	m_meshMaterials.assign(firstMesh, static_cast<unsigned>(eMaterials::ALIEN_MATERIAL));
+
+	if (scene.m_meshes == 0 && scene.m_instances == 0 && scene.m_lights == 0)
+		return;
+
+	SyntheticScene::Generate(scene, m_sceneGraph, *m_geometryRegistry, m_meshes, m_batches, m_unbatchedMeshes, m_lights);
+
+	//Synthetic materials come straight after the scene's
+	for (size_t i = firstMesh; i < m_meshes.size(); ++i)
+	{
+		m_meshMaterials.push_back(scene.m_materials > 0 ?
+			1 + static_cast<unsigned>((i - firstMesh) % scene.m_materials) : static_cast<unsigned>(eMaterials::ALIEN_MATERIAL));
+	}
+
+	const size_t lastAnimated = std::min(m_meshes.size(), firstMesh + scene.m_animated);
+
+	for (size_t i = firstMesh; i < lastAnimated; ++i)
+	{
+		m_animatedNodes.push_back(m_meshes[i]->GetNode());
+	}
+
+	std::cout << "SYNTHETIC_SCENE: " << scene.m_meshes << " meshes in chains of " << scene.m_depth << ", "
+		<< scene.m_instances << (scene.m_unbatched ? " unbatched" : "") << " instances, " << scene.m_materials << " materials, "
+		<< scene.m_lights << " lights, " << m_animatedNodes.size() << " animated, seed " << scene.m_seed << "\n";
+}
+
+void Game::LogGeometryStats()
+{
+	const GeometryStats& stats = m_geometryRegistry->GetStats();
+	std::cout << "GEOMETRY_REGISTRY: " << stats.m_uploads << " uploads for " << stats.m_requests << " requests, "
+		<< stats.m_bytesSaved << " GPU bytes saved, " << stats.m_milliseconds << "ms building" << "\n";
+
+	const ArenaStats floatArena = m_geometryRegistry->GetArena(eVertexFormat::e_Float, GL_UNSIGNED_SHORT).GetStats();
+	const ArenaStats quantizedArena = m_geometryRegistry->GetArena(eVertexFormat::e_Quantized, GL_UNSIGNED_SHORT).GetStats();
+	std::cout << "VERTEX_FORMATS: float " << floatArena.m_vertexStride << " bytes/vertex (" << floatArena.m_verticesUsed << " vertices), quantized "
+		<< quantizedArena.m_vertexStride << " bytes/vertex (" << quantizedArena.m_verticesUsed << " vertices), "
+		<< stats.m_quantizedBytesSaved << " vertex bytes saved per full pass" << "\n";
+
+	const float triangles = static_cast<float>(std::max(stats.m_trianglesOptimized, 1u));
+	std::cout << "MESH_OPTIMIZER: " << stats.m_verticesWelded << " vertices welded, ACMR " << stats.m_cacheMissesBefore / triangles
+		<< " -> " << stats.m_cacheMissesAfter / triangles << ", " << stats.m_indexBytesSaved << " index bytes saved by 16 bit indices" << "\n";
 }
 
 void Game::InitLights()
@@ -233,43 +987,301 @@ void Game::InitLights()
 
 void Game::InitUniforms()
 {
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->SetMat4Fv(m_camera.GetViewMatrix(), "view_matrix");
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->SetMat4Fv(m_projectionMatrix, "projection_matrix");
-
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->SetVec3F(*m_lights[static_cast<int>(eLights::MAIN_LIGHT)], "light_position");
+	//The light goes through the FrameConstants block, so no program has to be waited on for it
+	m_frameConstantsBuffer = new FrameConstantsBuffer(constants::k_frameConstantsBinding);
 }
 
 void Game::UpdateDeltaTime()
 {
+	//A fixed step keeps a camera path playing back the same frames however fast they render
+	if (m_settings.m_mode == eRunMode::e_Headless)
+	{
+		m_deltaTime = constants::k_headlessFrameTime;
+		m_currentFrameTime += m_deltaTime;
+		return;
+	}
+
 	m_currentFrameTime = static_cast<float>(glfwGetTime());
 	m_deltaTime = m_currentFrameTime - m_prevFrameTime;
 	m_prevFrameTime = m_currentFrameTime;
 }
 
-void Game::UpdateUniforms()
+void Game::UpdateTitle()
 {
-	// Update the view matrix 
-	const glm::mat4 viewMatrix = m_camera.GetViewMatrix();
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->SetVec3F(m_camera.GetPosition(), "camera_position");
+	if (!m_window)
+		return;
 
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->SetMat4Fv(viewMatrix, "view_matrix");
+	std::string title;
 
-	glfwGetFramebufferSize(m_window, &m_frameBufferWidth, &m_frameBufferHeight);
+	{
+		std::lock_guard<std::mutex> lock(m_titleMutex);
+		title.swap(m_pendingTitle);
+	}
 
-	m_projectionMatrix = glm::perspective(
-		glm::radians(m_fov),
-		static_cast<float>(m_frameBufferWidth) / static_cast<float>(m_frameBufferHeight),
-		m_nearPlane,
-		m_farPlane
-	);
+	if (!title.empty())
+	{
+		glfwSetWindowTitle(m_window, title.c_str());
+	}
+}
+
+void Game::UpdateStats(const FrameSnapshot& snapshot)
+{
+	// Worst frame while textures stream in, reported once the last one has arrived. The first
+	// delta includes startup, so it isn't counted
+	if (!m_textureStreamer->IsIdle())
+	{
+		m_streamingTime += snapshot.m_deltaTime;
 
-	m_shaders[static_cast<int>(eShaders::CORE_PROGRAM)]->SetMat4Fv(m_projectionMatrix, "projection_matrix");
+		if (m_firstFrameRendered)
+		{
+			m_streamingWorstFrame = std::max(m_streamingWorstFrame, snapshot.m_deltaTime);
+		}
+	} else if (m_streamingTime > 0.f)
+	{
+		const TextureStreamStats& streamStats = m_textureStreamer->GetStats();
+		std::cout << "TEXTURE_STREAMER: " << streamStats.m_completed << " textures (" << streamStats.m_failed << " failed), "
+			<< streamStats.m_bytesUploaded / 1048576.0 << " MB in " << m_streamingTime * 1000.f << "ms, worst frame "
+			<< m_streamingWorstFrame * 1000.f << "ms, " << streamStats.m_fenceWaits << " fence waits" << "\n";
+
+		std::cout << "TEXTURE_COMPRESSION: " << streamStats.m_compressedBytes / 1048576.0 << " MB on the GPU instead of "
+			<< streamStats.m_uncompressedBytes / 1048576.0 << " MB, " << streamStats.m_compressedCacheHits << " cache hits" << "\n";
+
+		m_streamingTime = 0.f;
+		m_streamingWorstFrame = 0.f;
+	}
+
+	//Shader startup is reported once the array textures are decided on and nothing drawn with is
+	//still compiling
+	if (!m_shaderVariantsLogged && m_texturesPooled && m_shaderVariants.IsSettled())
+	{
+		m_shaderVariantsLogged = true;
+
+		const ShaderVariantStats& variantStats = m_shaderVariants.GetStats();
+		std::cout << "SHADER_VARIANTS: " << variantStats.m_variants << " variants (" << variantStats.m_failed << " failed), "
+			<< (Shader::HasParallelCompile() ? "parallel" : "serial") << " compile, " << variantStats.m_submitMs << "ms submitting, all ready after "
+			<< variantStats.m_allReadyMs << "ms, " << variantStats.m_fallbackResolves << " draws used a fallback" << "\n";
+
+		const ProgramCacheStats& cacheStats = ProgramCache::GetStats();
+		std::cout << "PROGRAM_CACHE: " << cacheStats.m_hits << " hits, " << cacheStats.m_misses << " misses ("
+			<< cacheStats.m_rejected << " binaries rejected), " << cacheStats.m_compileMs << "ms compiling, "
+			<< cacheStats.m_loadMs << "ms loading binaries, " << cacheStats.m_savedMs << "ms saved" << "\n";
+	}
+
+	//Headless runs have no title bar, the totals keep building up for RunHeadless instead
+	if (!m_window)
+		return;
+
+	m_statsTimer += snapshot.m_deltaTime;
+
+	if (m_statsTimer < 1.f || m_statsFrames == 0)
+		return;
+
+	const TextureCacheStats& cacheStats = m_textureCache->GetStats();
+	const FrameTimeSummary frameSummary = Profiler::GetFrameSummary();
+
+	const auto toMs = [](const double milliseconds)
+	{
+		std::ostringstream text;
+		text << std::fixed << std::setprecision(2) << milliseconds;
+		return text.str();
+	};
+
+	// Show the per-frame average in the title bar once a second
+	const std::string stats = m_title +
+		" | frame ms p50/p95/p99: " + toMs(frameSummary.m_cpuP50Ms) + "/" + toMs(frameSummary.m_cpuP95Ms) + "/" + toMs(frameSummary.m_cpuP99Ms) +
+		" (GPU " + toMs(frameSummary.m_gpuP50Ms) + "/" + toMs(frameSummary.m_gpuP95Ms) + "/" + toMs(frameSummary.m_gpuP99Ms) + ")" +
+		" | uniform uploads/frame: " + std::to_string(m_uniformStats.m_uploads / m_statsFrames) +
+		" | GL calls/frame: " + std::to_string(m_uniformStats.m_glCalls / m_statsFrames) +
+		" | GL calls saved/frame: " + std::to_string(m_uniformStats.m_glCallsSaved / m_statsFrames) +
+		" | uniform lookups/frame: " + std::to_string(m_uniformStats.m_lookups / m_statsFrames) +
+		" | draws/frame: " + std::to_string(m_renderStats.m_packets / m_statsFrames) +
+		" | draw calls/frame: " + std::to_string(m_renderStats.m_drawCalls / m_statsFrames) +
+		" | texture binds/frame: " + std::to_string(m_textureBinds / m_statsFrames) +
+		" | texture KB: " + std::to_string(cacheStats.m_residentBytes / 1024) + "/" + std::to_string(cacheStats.m_budgetBytes / 1024) +
+		" (" + std::to_string(cacheStats.m_hits) + " hits, " + std::to_string(cacheStats.m_misses) + " misses, " +
+		std::to_string(cacheStats.m_evictions) + " evicted, " + std::to_string(cacheStats.m_demotions) + " demoted)" +
+		" | state changes avoided/frame: " + std::to_string(
+			(m_renderStats.m_programChangesAvoided + m_renderStats.m_vaoChangesAvoided +
+			m_renderStats.m_textureBindsAvoided + m_renderStats.m_materialChangesAvoided) / m_statsFrames);
+
+	{
+		std::lock_guard<std::mutex> lock(m_titleMutex);
+		m_pendingTitle = stats;
+	}
+
+	m_uniformStats = UniformStats();
+	m_renderStats = RenderStats();
+	m_textureBinds = 0;
+	m_statsFrames = 0;
+	m_statsTimer = 0.f;
+}
+
+void Game::UpdateUniforms(const FrameSnapshot& snapshot)
+{
+	//The resize callback runs on the main thread, so the viewport follows the snapshot instead
+	if (snapshot.m_frameBufferWidth != m_viewportWidth || snapshot.m_frameBufferHeight != m_viewportHeight)
+	{
+		m_viewportWidth = snapshot.m_frameBufferWidth;
+		m_viewportHeight = snapshot.m_frameBufferHeight;
+		glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+	}
+
+	// One write per frame, shared by every program through the FrameConstants block
+	m_frameConstantsBuffer->Write(snapshot.m_frameConstants);
+}
+
+void Game::UpdateMeshBounds()
+{
+	const unsigned numOfMeshes = static_cast<unsigned>(m_meshes.size());
+	const bool useBvh = numOfMeshes >= constants::k_bvhMinObjects;
+
+	if (m_meshWorldBounds.size() != numOfMeshes)
+	{
+		//The mesh list changed so every bound is recomputed and the BVH built from scratch
+		m_meshWorldBounds.resize(numOfMeshes);
+		m_meshBounds.Resize(numOfMeshes);
+		m_meshOfNode.assign(m_sceneGraph.GetNodeCount(), ~0u);
+
+		for (unsigned i = 0; i < numOfMeshes; ++i)
+		{
+			const Mesh& mesh = *m_meshes[i];
+			m_meshWorldBounds[i] = TransformBounds(mesh.GetGeometry()->GetBounds(), mesh.GetModelMatrix());
+			m_meshBounds.Set(i, m_meshWorldBounds[i]);
+
+			if (mesh.GetNode() >= m_meshOfNode.size())
+			{
+				m_meshOfNode.resize(mesh.GetNode() + 1, ~0u);
+			}
+			m_meshOfNode[mesh.GetNode()] = i;
+		}
+
+		if (useBvh)
+		{
+			m_meshBvh.Build(m_meshWorldBounds);
+		}
+
+		return;
+	}
+
+	//Only meshes whose world matrix moved this frame need new bounds
+	m_changedMeshes.clear();
+
+	for (const NodeId node : m_sceneGraph.GetUpdatedNodes())
+	{
+		if (node >= m_meshOfNode.size() || m_meshOfNode[node] == ~0u)
+			continue;
+
+		const unsigned i = m_meshOfNode[node];
+		const Mesh& mesh = *m_meshes[i];
+		m_meshWorldBounds[i] = TransformBounds(mesh.GetGeometry()->GetBounds(), mesh.GetModelMatrix());
+		m_meshBounds.Set(i, m_meshWorldBounds[i]);
+		m_changedMeshes.push_back(i);
+	}
+
+	if (useBvh && !m_changedMeshes.empty())
+	{
+		m_meshBvh.Refit(m_changedMeshes, m_meshWorldBounds);
+
+		if (m_meshBvh.NeedsRebuild())
+		{
+			m_meshBvh.Build(m_meshWorldBounds);
+		}
+	}
+}
+
+void Game::UpdateVisibility()
+{
+	ProfileScope scope("Game::UpdateVisibility");
+
+	if (m_projectionDirty)
+	{
+		InitMatrices();
+		m_projectionDirty = false;
+	}
+
+	m_frustum.Extract(m_projectionMatrix * m_camera.GetViewMatrix());
+
+	UpdateMeshBounds();
+
+	m_visibleMeshes.clear();
+
+	if (m_meshes.size() >= constants::k_bvhMinObjects)
+	{
+		m_meshBvh.QueryFrustum(m_frustum, m_visibleMeshes);
+	} else
+	{
+		m_frustum.Cull(m_meshBounds, m_visibleMeshes);
+	}
+}
+
+void Game::UpdateAnimation()
+{
+	for (const NodeId node : m_animatedNodes)
+	{
+		const glm::vec3 rotation = m_sceneGraph.GetRotation(node);
+		m_sceneGraph.SetRotation(node, glm::vec3(rotation.x, std::fmod(rotation.y + constants::k_animationSpeed * m_deltaTime, 360.f), rotation.z));
+	}
+}
+
+void Game::UpdateSnapshot()
+{
+	ProfileScope scope("Game::UpdateSnapshot");
+
+	FrameSnapshot* snapshot = m_snapshots.BeginWrite();
+
+	if (!snapshot)
+		return;
+
+	snapshot->m_deltaTime = m_deltaTime;
+	snapshot->m_frameBufferWidth = m_frameBufferWidth;
+	snapshot->m_frameBufferHeight = m_frameBufferHeight;
+
+	FrameConstants& frameConstants = snapshot->m_frameConstants;
+	frameConstants.m_viewMatrix = m_camera.GetViewMatrix();
+	frameConstants.m_projectionMatrix = m_projectionMatrix;
+	frameConstants.m_cameraPosition = glm::vec4(m_camera.GetPosition(), 1.f);
+
+	//Lights past what the block holds are left out
+	frameConstants.m_lightCount = static_cast<GLint>(std::min(m_lights.size(), static_cast<size_t>(constants::k_maxLights)));
+
+	for (GLint light = 0; light < frameConstants.m_lightCount; ++light)
+	{
+		frameConstants.m_lightPositions[light] = glm::vec4(*m_lights[light], 1.f);
+	}
+
+	//World matrices are copied out, the scene graph is free to move on to the next frame
+	const glm::vec3 cameraPosition = m_camera.GetPosition();
+	snapshot->m_draws.clear();
+
+	for (const unsigned meshIndex : m_visibleMeshes)
+	{
+		const Mesh& mesh = *m_meshes[meshIndex];
+		const float depth = glm::length(m_meshWorldBounds[meshIndex].GetCentre() - cameraPosition) / m_farPlane;
+
+		snapshot->m_draws.push_back({ mesh.GetGeometry().get(), mesh.GetModelMatrix(), depth, m_meshMaterials[meshIndex] });
+	}
+
+	snapshot->m_unbatchedModelMatrices.clear();
+
+	for (const Mesh* mesh : m_unbatchedMeshes)
+	{
+		snapshot->m_unbatchedModelMatrices.push_back(mesh->GetModelMatrix());
+	}
+
+	m_snapshots.EndWrite();
 }
 
 void Game::FrameBufferResizeCallback(GLFWwindow* window, const int frameBufferWidth, const int frameBufferHeight)
 {
-	glViewport(0, 0, frameBufferWidth, frameBufferHeight);
-};
+	Game* game = static_cast<Game*>(glfwGetWindowUserPointer(window));
+
+	if (game)
+	{
+		game->m_frameBufferWidth = frameBufferWidth;
+		game->m_frameBufferHeight = frameBufferHeight;
+		game->m_projectionDirty = true;
+	}
+}
 
 void Game::UpdateInput()
 {
@@ -278,6 +1290,17 @@ void Game::UpdateInput()
 	MouseInput();
 
 	m_camera.Update(static_cast<float>(m_mouseOffsetX), static_cast<float>(m_mouseOffsetY), true);
+
+	if (!m_settings.m_recordCameraFile.empty())
+	{
+		m_cameraPath.AddKey({ m_currentFrameTime, m_camera.GetPosition(), m_camera.GetYaw(), m_camera.GetPitch() });
+	}
+}
+
+void Game::UpdateCameraPath()
+{
+	const CameraKey key = m_cameraPath.Sample(m_currentFrameTime);
+	m_camera.SetPose(key.m_position, key.m_yaw, key.m_pitch);
 }
 
 void Game::KeyBoardInput()
@@ -305,6 +1328,16 @@ void Game::KeyBoardInput()
 	{
 		m_camera.Move(m_deltaTime, eDirection::e_Right);
 	}
+
+	//Once per press, the trace carries on capturing afterwards
+	const bool traceKeyDown = glfwGetKey(m_window, GLFW_KEY_P) == GLFW_PRESS;
+
+	if (traceKeyDown && !m_traceKeyDown)
+	{
+		m_traceRequested = true;
+	}
+
+	m_traceKeyDown = traceKeyDown;
 }
 
 void Game::MouseInput()
@@ -324,3 +1357,106 @@ void Game::MouseInput()
 	m_prevMouseX = m_currentMouseX;
 	m_prevMouseY = m_currentMouseY;
 }
+
+bool Game::WriteFrameStats(const HeadlessResult& result) const
+{
+	std::ofstream file(m_settings.m_statsFile, std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::GAME::COULD_NOT_OPEN_FILE: " << m_settings.m_statsFile << "\n";
+		return false;
+	}
+
+	const auto writeSummary = [&file](const char* name, std::vector<double> samples)
+	{
+		double total = 0.0;
+		for (const double sample : samples)
+		{
+			total += sample;
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		file << "\t\"" << name << "\": { \"mean\": " << (samples.empty() ? 0.0 : total / static_cast<double>(samples.size()))
+			<< ", \"p50\": " << Profiler::GetPercentile(samples, 0.50)
+			<< ", \"p95\": " << Profiler::GetPercentile(samples, 0.95)
+			<< ", \"p99\": " << Profiler::GetPercentile(samples, 0.99)
+			<< ", \"max\": " << (samples.empty() ? 0.0 : samples.back()) << " },\n";
+	};
+
+	const auto escape = [](const char* text)
+	{
+		std::string escaped;
+		for (; text && *text; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+			{
+				escaped += '\\';
+			}
+
+			escaped += *text;
+		}
+
+		return escaped;
+	};
+
+	const FrameTimeSummary gpuSummary = Profiler::GetFrameSummary();
+	const double frames = static_cast<double>(std::max(m_statsFrames, 1u));
+	const SyntheticSceneSettings& scene = m_settings.m_scene;
+	const std::vector<double>& frameMs = result.m_frameMs;
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\n";
+	file << "\t\"renderer\": \"" << escape(reinterpret_cast<const char*>(glGetString(GL_RENDERER))) << "\",\n";
+	file << "\t\"width\": " << m_frameBufferWidth << ",\n";
+	file << "\t\"height\": " << m_frameBufferHeight << ",\n";
+	file << "\t\"frames\": " << frameMs.size() << ",\n";
+	file << "\t\"render_thread\": " << (m_settings.m_renderThread ? "true" : "false") << ",\n";
+	file << "\t\"multi_draw\": " << (m_settings.m_multiDraw ? "true" : "false") << ",\n";
+	file << "\t\"camera_path\": \"" << (m_settings.m_cameraFile.empty() ? "orbit" : escape(m_settings.m_cameraFile.c_str())) << "\",\n";
+	file << "\t\"scene\": { \"meshes\": " << m_meshes.size() << ", \"synthetic_meshes\": " << scene.m_meshes
+		<< ", \"synthetic_instances\": " << scene.m_instances << ", \"unbatched\": " << (scene.m_unbatched ? "true" : "false")
+		<< ", \"animated\": " << m_animatedNodes.size()
+		<< ", \"synthetic_lights\": " << scene.m_lights
+		<< ", \"lights\": " << m_lights.size() << ", \"depth\": " << scene.m_depth
+		<< ", \"seed\": " << scene.m_seed << ", \"extent\": " << scene.m_extent << " },\n";
+
+	// frame_ms is from one frame's glFinish to the next, cpu_ms the update and render threads'
+	// work added up, so it goes over frame_ms when they overlap. gpu_ms is the profiler's window
+	writeSummary("frame_ms", frameMs);
+	writeSummary("cpu_ms", result.m_cpuMs);
+	writeSummary("update_ms", result.m_updateMs);
+	writeSummary("render_ms", result.m_renderMs);
+	file << "\t\"gpu_ms\": { \"frames\": " << gpuSummary.m_frames << ", \"p50\": " << gpuSummary.m_gpuP50Ms
+		<< ", \"p95\": " << gpuSummary.m_gpuP95Ms << ", \"p99\": " << gpuSummary.m_gpuP99Ms << " },\n";
+
+	const FrameSnapshotStats snapshotStats = m_snapshots.GetStats();
+	file << "\t\"snapshot_waits\": { \"update\": " << snapshotStats.m_updateWaits << ", \"update_ms\": " << snapshotStats.m_updateWaitMs
+		<< ", \"render\": " << snapshotStats.m_renderWaits << ", \"render_ms\": " << snapshotStats.m_renderWaitMs << " },\n";
+
+	file << "\t\"per_frame\": { \"visible_meshes\": " << result.m_visibleMeshes
+		<< ", \"draws\": " << m_renderStats.m_packets / frames
+		<< ", \"draw_calls\": " << m_renderStats.m_drawCalls / frames
+		<< ", \"sort_key_overflows\": " << m_renderStats.m_keyOverflows / frames
+		<< ", \"uniform_uploads\": " << m_uniformStats.m_uploads / frames
+		<< ", \"uniform_gl_calls\": " << m_uniformStats.m_glCalls / frames
+		<< ", \"uniform_lookups\": " << m_uniformStats.m_lookups / frames
+		<< ", \"texture_binds\": " << m_textureBinds / frames << " },\n";
+
+	file << "\t\"frame_times_ms\": [";
+	for (size_t i = 0; i < frameMs.size(); ++i)
+	{
+		file << (i == 0 ? "" : ", ") << frameMs[i];
+	}
+	file << "]\n}\n";
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::GAME::COULD_NOT_WRITE_FILE: " << m_settings.m_statsFile << "\n";
+		return false;
+	}
+
+	std::cout << "HEADLESS: " << frameMs.size() << " frames, stats written to " << m_settings.m_statsFile << "\n";
+	return true;
+}
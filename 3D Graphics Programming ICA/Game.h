@@ -1,21 +1,77 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <gl/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/vec3.hpp>
 #include <glm/matrix.hpp>
 
 
+#include "Bvh.h"
 #include "Camera.h"
+#include "CameraPath.h"
+#include "FrameConstants.h"
+#include "FrameSnapshot.h"
+#include "Frustum.h"
+#include "GeometryRegistry.h"
+#include "HeadlessContext.h"
+#include "InstancedBatch.h"
 #include "Material.h"
 #include "Mesh.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "RenderTarget.h"
+#include "RunSettings.h"
+#include "ShaderVariants.h"
 #include "Texture.h"
+#include "TextureArrayPool.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
 
-enum class eShaders { CORE_PROGRAM = 0 };
+enum class eShaders { CORE_PROGRAM = 0, INSTANCED_PROGRAM, INDIRECT_PROGRAM, ARRAY_PROGRAM };
 enum class eTextures { ALIEN, ALIEN_SPECULAR, BOX, BOX_SPECULAR };
 enum class eMaterials { ALIEN_MATERIAL = 0 };
 enum class eMeshes { ALIEN = 0 };
+enum class eBatches { CUBES = 0 };
 enum class eLights { MAIN_LIGHT = 0 };
 
+// What a headless run measured, for callers that check it rather than only write it out
+struct HeadlessResult
+{
+	// Per frame. Frame time is from one frame finishing to the next, CPU time is the update and
+	// render threads' work added together, neither counting time spent waiting on the other
+	std::vector<double> m_frameMs;
+	std::vector<double> m_cpuMs;
+	std::vector<double> m_updateMs;
+	std::vector<double> m_renderMs;
+
+	// Averages over the timed frames
+	double m_visibleMeshes = 0.0;
+	double m_drawCalls = 0.0;
+	double m_uniformGlCalls = 0.0;
+	double m_textureBinds = 0.0;
+	double m_textureArrayBinds = 0.0;
+
+	// Arrays the texture pool ended up with, none when textures are bound one by one
+	unsigned m_textureArrays = 0;
+
+	// Wall clock from the Game being constructed to its first frame, then over the frames after it
+	// that textures were still streaming in behind
+	double m_firstFrameMs = 0.0;
+	double m_streamingMs = 0.0;
+	double m_streamingWorstFrameMs = 0.0;
+	unsigned m_texturesStreamed = 0;
+
+	// The last timed frame, tightly packed RGBA8 rows starting from the bottom
+	std::vector<unsigned char> m_image;
+	int m_width = 0;
+	int m_height = 0;
+};
+
 class Game
 {
 public:
@@ -25,20 +81,39 @@ public:
 		int height,
 		int glVersionMajor, 
 		int glVersionMinor,
-		bool resizable
+		bool resizable,
+		const RunSettings& settings = RunSettings()
 	);
 
 	~Game();
 
+	// Input, simulation and culling, ending with the frame's snapshot being published. Waits
+	// while the render thread is a whole frame behind
 	void Update();
-	void Render();
+
+	// Draws the next published snapshot from the thread the context is current on. False once
+	// the snapshots have been closed and there are none left to draw
+	bool Render();
+
+	// The windowed loop, until the window is closed. Unless single threaded, rendering moves to a
+	// thread of its own and this thread only updates
+	void Run();
+
+	// Renders the configured number of frames offscreen along the camera path and writes their
+	// timings as JSON, unless there is no stats file, and into result when given. False if there
+	// was no context to render with or nothing could be written
+	bool RunHeadless(HeadlessResult* result = nullptr);
 	
 	int GetWindowShouldClose() const;
 	void SetWindowShouldClose() const;
 
 	static void FrameBufferResizeCallback(GLFWwindow* window, int frameBufferWidth, int frameBufferHeight);
 private:
+	const RunSettings m_settings;
 	GLFWwindow* m_window;
+	HeadlessContext* m_headlessContext;
+	RenderTarget* m_renderTarget;
+	const std::string m_title;
 	const int m_windowWidth;
 	const int m_windowHeight;
 	int m_frameBufferWidth;
@@ -50,6 +125,14 @@ private:
 	float m_deltaTime;
 	float m_currentFrameTime;
 	float m_prevFrameTime;
+	float m_statsTimer;
+	unsigned m_statsFrames;
+
+	std::chrono::steady_clock::time_point m_startTime;
+	bool m_firstFrameRendered;
+	double m_firstFrameMs;
+	float m_streamingTime;
+	float m_streamingWorstFrame;
 
 	double m_prevMouseX;
 	double m_prevMouseY;
@@ -61,33 +144,116 @@ private:
 	
 	Camera m_camera;
 	eDirection m_cameraDirection;
+	CameraPath m_cameraPath;
 
 	glm::mat4 m_projectionMatrix;
+	bool m_projectionDirty;
 	float m_fov;
 	float m_nearPlane;
 	float m_farPlane;
 
+	ThreadPool m_threadPool;
+	std::unique_ptr<TextureStreamer> m_textureStreamer;
+	std::unique_ptr<TextureCache> m_textureCache;
+	std::unique_ptr<GeometryRegistry> m_geometryRegistry;
+	SceneGraph m_sceneGraph;
+
 	std::vector<Shader*> m_shaders;
-	std::vector<Texture*> m_textures;
+	ShaderVariants m_shaderVariants;
+	bool m_shaderVariantsLogged;
+	std::vector<std::shared_ptr<Texture>> m_textures;
+	std::unique_ptr<TextureArrayPool> m_texturePool;
+	bool m_texturesPooled;
+	bool m_useTextureArrays;
 	std::vector<Material*> m_materials;
+	//Per material, its maps in m_textures and the texture sets drawing with them or their layers
+	struct MaterialTextures
+	{
+		unsigned m_diffuse;
+		unsigned m_specular;
+		unsigned m_textureSet;
+		unsigned m_arrayTextureSet;
+	};
+	std::vector<MaterialTextures> m_materialTextures;
 	std::vector<Mesh*> m_meshes;
+	std::vector<unsigned> m_meshMaterials;
+	std::vector<InstancedBatch*> m_batches;
+	//Synthetic cubes drawn the way they were before batching, to measure batching against. Their
+	//model matrices reach the render thread in the snapshot, like the queued meshes'
+	std::vector<Mesh*> m_unbatchedMeshes;
+	std::unique_ptr<RenderQueue> m_renderQueue;
 	std::vector<glm::vec3*> m_lights;
 
+	Frustum m_frustum;
+	BoundsSoA m_meshBounds;
+	Bvh m_meshBvh;
+	std::vector<AABB> m_meshWorldBounds;
+	std::vector<unsigned> m_meshOfNode;
+	std::vector<unsigned> m_changedMeshes;
+	std::vector<unsigned> m_visibleMeshes;
+	std::vector<NodeId> m_animatedNodes;
+
+	//Update writes snapshots, Render reads them. Everything Render touches besides the snapshot,
+	//GL objects and the stats below, belongs to whichever thread renders
+	FrameSnapshotBuffer m_snapshots;
+	std::thread m_renderThread;
+	int m_viewportWidth;
+	int m_viewportHeight;
+
+	FrameConstantsBuffer* m_frameConstantsBuffer;
+	UniformStats m_uniformStats;
+	RenderStats m_renderStats;
+	unsigned m_textureBinds;
+	unsigned m_textureArrayBinds;
+	bool m_traceKeyDown;
+	std::atomic<bool> m_traceRequested;
+
+	//The title is made up where the stats are and set where the window's events are handled
+	std::mutex m_titleMutex;
+	std::string m_pendingTitle;
+
 	void InitGLFW();
 	void InitWindow(const std::string& title, bool resizable);
+	void InitHeadlessContext();
 	void InitGLEW();
 	void InitOpenGlOptions();
+	void InitRenderTarget();
+	void InitCameraPath();
 	void InitMatrices();
 	void InitShaders();
 	void InitTextures();
+	void InitTextureArrays();
 	void InitMaterials();
+	void InitShaderVariants();
 	void InitMeshes();
+	void InitBatches();
+	void InitSyntheticScene();
 	void InitLights();
 	void InitUniforms();
+	//Called after everything that requests geometry, so the synthetic scene is counted too
+	void LogGeometryStats();
+
+	void StartRenderThread();
+	void StopRenderThread();
+	//Frees every GL object the game owns, the context has to be current and still alive
+	void ReleaseGpuResources();
+	void MakeContextCurrent() const;
+	void ReleaseContext() const;
 
 	void UpdateDeltaTime();
-	void UpdateUniforms();
+	void UpdateTitle();
+	void UpdateAnimation();
+	void UpdateMeshBounds();
+	void UpdateVisibility();
+	void UpdateSnapshot();
 	void UpdateInput();
+	void UpdateCameraPath();
 	void KeyBoardInput();
 	void MouseInput();
+
+	void RenderFrame(const FrameSnapshot& snapshot);
+	void UpdateUniforms(const FrameSnapshot& snapshot);
+	void UpdateStats(const FrameSnapshot& snapshot);
+
+	bool WriteFrameStats(const HeadlessResult& result) const;
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "Geometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+Geometry::Geometry(GeometryArena& arena, const Vertex* vertexArray, const unsigned numOfVertices, const GLuint* indexArray, const unsigned numOfIndices) :
+	m_arena(arena),
+	m_range(),
+	m_bounds(ComputeBounds(vertexArray, numOfVertices)),
+	m_dequant({ glm::vec3(1.f), glm::vec3(0.f) })
+{
+	std::vector<GLuint> sequentialIndices;
+
+	if (numOfIndices == 0)
+	{
+		sequentialIndices.resize(numOfVertices);
+		std::iota(sequentialIndices.begin(), sequentialIndices.end(), 0);
+	}
+
+	const GLuint* indices = numOfIndices > 0 ? indexArray : sequentialIndices.data();
+	const unsigned indexCount = numOfIndices > 0 ? numOfIndices : numOfVertices;
+
+	if (m_arena.GetFormat() == eVertexFormat::e_Float)
+	{
+		m_range = m_arena.Allocate(vertexArray, numOfVertices, indices, indexCount);
+		return;
+	}
+
+	m_dequant = ComputePositionDequant(m_bounds);
+
+	std::vector<QuantizedVertex> quantized(numOfVertices);
+	EncodeVertices(vertexArray, numOfVertices, m_dequant, quantized.data());
+
+#ifdef _DEBUG
+	float maxTexcoord = 0.f;
+	for (unsigned i = 0; i < numOfVertices; ++i)
+	{
+		maxTexcoord = std::max(maxTexcoord, std::max(std::abs(vertexArray[i].m_texcoord.x), std::abs(vertexArray[i].m_texcoord.y)));
+	}
+
+	const QuantizationError error = MeasureQuantizationError(vertexArray, quantized.data(), numOfVertices, m_dequant);
+	const QuantizationError bounds = GetQuantizationErrorBounds(m_dequant, maxTexcoord);
+
+	if (error.m_position > bounds.m_position || error.m_normalDegrees > bounds.m_normalDegrees ||
+		error.m_texcoord > bounds.m_texcoord || error.m_colour > bounds.m_colour)
+	{
+		std::cout << "ERROR::GEOMETRY::QUANTIZATION_ERROR_OUT_OF_BOUNDS" << "\n";
+	}
+#endif
+
+	m_range = m_arena.Allocate(quantized.data(), numOfVertices, indices, indexCount);
+}
+
+Geometry::Geometry(GeometryArena& arena, const void* vertexData, const unsigned numOfVertices, const void* indexData, const unsigned numOfIndices,
+	const AABB& bounds, const PositionDequant& dequant) :
+	m_arena(arena),
+	m_range(arena.AllocateEncoded(vertexData, numOfVertices, indexData, numOfIndices)),
+	m_bounds(bounds),
+	m_dequant(dequant)
+{
+}
+
+Geometry::~Geometry()
+{
+	m_arena.Free(m_range);
+}
+
+void Geometry::Bind() const
+{
+	m_arena.Bind();
+}
+
+void Geometry::Draw() const
+{
+	glDrawElementsBaseVertex(GL_TRIANGLES, m_range.m_numIndices, m_arena.GetIndexType(),
+		reinterpret_cast<GLvoid*>(static_cast<size_t>(m_range.m_firstIndex) * m_arena.GetIndexSize()), m_range.m_baseVertex);
+}
+
+void Geometry::DrawInstanced(const GLsizei instanceCount) const
+{
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_range.m_numIndices, m_arena.GetIndexType(),
+		reinterpret_cast<GLvoid*>(static_cast<size_t>(m_range.m_firstIndex) * m_arena.GetIndexSize()), instanceCount, m_range.m_baseVertex);
+}
+
+void Geometry::SetupVertexAttributes() const
+{
+	m_arena.SetupVertexAttributes();
+}
+
+GLuint Geometry::GetVertexArray() const
+{
+	return m_arena.GetVertexArray();
+}
+
+DrawElementsIndirectCommand Geometry::GetDrawCommand(const GLuint baseInstance) const
+{
+	return { m_range.m_numIndices, 1, m_range.m_firstIndex, m_range.m_baseVertex, baseInstance };
+}
+
+eVertexFormat Geometry::GetFormat() const
+{
+	return m_arena.GetFormat();
+}
+
+GLenum Geometry::GetIndexType() const
+{
+	return m_arena.GetIndexType();
+}
+
+glm::vec4 Geometry::GetPositionScale() const
+{
+	return glm::vec4(m_dequant.m_scale, GetFormat() == eVertexFormat::e_Quantized ? 1.f : 0.f);
+}
+
+glm::vec4 Geometry::GetPositionBias() const
+{
+	return glm::vec4(m_dequant.m_bias, 0.f);
+}
+
+unsigned Geometry::GetNumVertices() const
+{
+	return m_range.m_numVertices;
+}
+
+unsigned Geometry::GetNumIndices() const
+{
+	return m_range.m_numIndices;
+}
+
+size_t Geometry::GetGpuBytes() const
+{
+	return m_range.m_numVertices * GetVertexStride(GetFormat()) + m_range.m_numIndices * m_arena.GetIndexSize();
+}
+
+void Geometry::ReadBack(std::vector<unsigned char>& vertexData, std::vector<unsigned char>& indexData) const
+{
+	m_arena.ReadBack(m_range, vertexData, indexData);
+}
+
+const AABB& Geometry::GetBounds() const
+{
+	return m_bounds;
+}
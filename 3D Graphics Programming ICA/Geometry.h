@@ -0,0 +1,68 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <gl/glew.h>
+#include <glm/vec4.hpp>
+
+#include "Bounds.h"
+#include "GeometryArena.h"
+#include "Vertex.h"
+
+// One uploaded vertex/index set, living in a range of the shared GeometryArena. Shared between
+// every Mesh and InstancedBatch that draws it. Geometry without indices gets a sequential index
+// list so everything can go through the same indexed and indirect draw paths. Vertices are encoded
+// into the arena's format on the way in.
+class Geometry
+{
+public:
+	Geometry(GeometryArena& arena, const Vertex* vertexArray, unsigned numOfVertices, const GLuint* indexArray, unsigned numOfIndices);
+
+	// Data already encoded for the arena, as stored in a cooked MeshFile
+	Geometry(GeometryArena& arena, const void* vertexData, unsigned numOfVertices, const void* indexData, unsigned numOfIndices,
+		const AABB& bounds, const PositionDequant& dequant);
+
+	~Geometry();
+
+	Geometry(const Geometry&) = delete;
+	Geometry& operator=(const Geometry&) = delete;
+
+	void Bind() const;
+
+	void Draw() const;
+
+	void DrawInstanced(GLsizei instanceCount) const;
+
+	// Points the attributes of the currently bound VAO at this geometry's buffers
+	void SetupVertexAttributes() const;
+
+	GLuint GetVertexArray() const;
+
+	DrawElementsIndirectCommand GetDrawCommand(GLuint baseInstance = 0) const;
+
+	eVertexFormat GetFormat() const;
+
+	GLenum GetIndexType() const;
+
+	// position_scale and position_bias for the vertex shaders. w of the scale is 1 when normals
+	// are octahedral encoded
+	glm::vec4 GetPositionScale() const;
+	glm::vec4 GetPositionBias() const;
+
+	unsigned GetNumVertices() const;
+	unsigned GetNumIndices() const;
+	size_t GetGpuBytes() const;
+
+	// This geometry's encoded vertices and indices as they sit in the arena buffers
+	void ReadBack(std::vector<unsigned char>& vertexData, std::vector<unsigned char>& indexData) const;
+
+	// Object space bounds of every vertex
+	const AABB& GetBounds() const;
+
+private:
+	GeometryArena& m_arena;
+	GeometryRange m_range;
+	AABB m_bounds;
+	PositionDequant m_dequant;
+};
+
+using GeometryHandle = std::shared_ptr<const Geometry>;
@@ -0,0 +1,295 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <vector>
+
+ArenaAllocator::ArenaAllocator(const unsigned capacity) :
+	m_capacity(0),
+	m_used(0)
+{
+	Grow(capacity);
+}
+
+unsigned ArenaAllocator::Allocate(const unsigned size)
+{
+	if (size == 0)
+		return k_invalidOffset;
+
+	for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end(); ++it)
+	{
+		if (it->second < size)
+			continue;
+
+		const unsigned offset = it->first;
+		const unsigned remaining = it->second - size;
+
+		m_freeBlocks.erase(it);
+
+		if (remaining > 0)
+		{
+			m_freeBlocks.emplace(offset + size, remaining);
+		}
+
+		m_used += size;
+
+		return offset;
+	}
+
+	return k_invalidOffset;
+}
+
+void ArenaAllocator::Free(unsigned offset, unsigned size)
+{
+	if (size == 0)
+		return;
+
+	m_used -= size;
+
+	auto next = m_freeBlocks.lower_bound(offset);
+
+	// Merge with the block before if it ends where this one starts
+	if (next != m_freeBlocks.begin())
+	{
+		const auto previous = std::prev(next);
+
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			m_freeBlocks.erase(previous);
+		}
+	}
+
+	// ...and with the block after if it starts where this one ends
+	if (next != m_freeBlocks.end() && offset + size == next->first)
+	{
+		size += next->second;
+		m_freeBlocks.erase(next);
+	}
+
+	m_freeBlocks.emplace(offset, size);
+}
+
+void ArenaAllocator::Grow(const unsigned newCapacity)
+{
+	if (newCapacity <= m_capacity)
+		return;
+
+	const unsigned oldCapacity = m_capacity;
+	m_capacity = newCapacity;
+
+	// Free() merges the new tail with a trailing free block, it isn't a real allocation
+	m_used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+unsigned ArenaAllocator::GetCapacity() const
+{
+	return m_capacity;
+}
+
+unsigned ArenaAllocator::GetUsed() const
+{
+	return m_used;
+}
+
+unsigned ArenaAllocator::GetFreeBlockCount() const
+{
+	return static_cast<unsigned>(m_freeBlocks.size());
+}
+
+unsigned ArenaAllocator::GetLargestFreeBlock() const
+{
+	unsigned largest = 0;
+
+	for (const auto& block : m_freeBlocks)
+	{
+		largest = std::max(largest, block.second);
+	}
+
+	return largest;
+}
+
+GeometryArena::GeometryArena(const eVertexFormat format, const GLenum indexType, const unsigned vertexCapacity, const unsigned indexCapacity) :
+	m_format(format),
+	m_vertexStride(GetVertexStride(format)),
+	m_indexType(indexType),
+	m_indexSize(indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)),
+	m_vao(0),
+	m_vbo(0),
+	m_ebo(0),
+	m_vertices(vertexCapacity),
+	m_indices(indexCapacity),
+	m_grows(0)
+{
+}
+
+GeometryArena::~GeometryArena()
+{
+	if (m_vao == 0)
+		return;
+
+	glDeleteVertexArrays(1, &m_vao);
+
+	glDeleteBuffers(1, &m_vbo);
+	glDeleteBuffers(1, &m_ebo);
+}
+
+GeometryRange GeometryArena::Allocate(const void* vertexData, const unsigned numOfVertices, const GLuint* indexArray, const unsigned numOfIndices)
+{
+	// Indices are relative to the base vertex, so a 16 bit arena only needs each geometry to fit
+	if (m_indexType == GL_UNSIGNED_SHORT)
+	{
+		const std::vector<GLushort> shortIndices(indexArray, indexArray + numOfIndices);
+		return AllocateEncoded(vertexData, numOfVertices, shortIndices.data(), numOfIndices);
+	}
+
+	return AllocateEncoded(vertexData, numOfVertices, indexArray, numOfIndices);
+}
+
+GeometryRange GeometryArena::AllocateEncoded(const void* vertexData, const unsigned numOfVertices, const void* indexData, const unsigned numOfIndices)
+{
+	if (m_vao == 0)
+	{
+		InitialiseBuffers();
+	}
+
+	GeometryRange range{};
+	range.m_numVertices = numOfVertices;
+	range.m_numIndices = numOfIndices;
+	range.m_baseVertex = static_cast<GLint>(AllocateGrowing(m_vertices, m_vbo, m_vertexStride, numOfVertices));
+	range.m_firstIndex = AllocateGrowing(m_indices, m_ebo, m_indexSize, numOfIndices);
+
+	glNamedBufferSubData(m_vbo, static_cast<GLintptr>(range.m_baseVertex) * m_vertexStride,
+		static_cast<GLsizeiptr>(numOfVertices) * m_vertexStride, vertexData);
+	glNamedBufferSubData(m_ebo, static_cast<GLintptr>(range.m_firstIndex) * m_indexSize,
+		static_cast<GLsizeiptr>(numOfIndices) * m_indexSize, indexData);
+
+	return range;
+}
+
+void GeometryArena::Free(const GeometryRange& range)
+{
+	m_vertices.Free(static_cast<unsigned>(range.m_baseVertex), range.m_numVertices);
+	m_indices.Free(range.m_firstIndex, range.m_numIndices);
+}
+
+void GeometryArena::ReadBack(const GeometryRange& range, std::vector<unsigned char>& vertexData, std::vector<unsigned char>& indexData) const
+{
+	vertexData.resize(static_cast<size_t>(range.m_numVertices) * m_vertexStride);
+	indexData.resize(static_cast<size_t>(range.m_numIndices) * m_indexSize);
+
+	if (m_vao == 0)
+		return;
+
+	glGetNamedBufferSubData(m_vbo, static_cast<GLintptr>(range.m_baseVertex) * m_vertexStride,
+		static_cast<GLsizeiptr>(vertexData.size()), vertexData.data());
+	glGetNamedBufferSubData(m_ebo, static_cast<GLintptr>(range.m_firstIndex) * m_indexSize,
+		static_cast<GLsizeiptr>(indexData.size()), indexData.data());
+}
+
+void GeometryArena::Bind() const
+{
+	glBindVertexArray(m_vao);
+}
+
+GLuint GeometryArena::GetVertexArray() const
+{
+	return m_vao;
+}
+
+void GeometryArena::SetupVertexAttributes() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+
+	::SetupVertexAttributes(m_format);
+}
+
+eVertexFormat GeometryArena::GetFormat() const
+{
+	return m_format;
+}
+
+GLenum GeometryArena::GetIndexType() const
+{
+	return m_indexType;
+}
+
+unsigned GeometryArena::GetIndexSize() const
+{
+	return m_indexSize;
+}
+
+ArenaStats GeometryArena::GetStats() const
+{
+	ArenaStats stats;
+	stats.m_vertexStride = m_vertexStride;
+	stats.m_indexSize = m_indexSize;
+	stats.m_vertexCapacity = m_vertices.GetCapacity();
+	stats.m_verticesUsed = m_vertices.GetUsed();
+	stats.m_indexCapacity = m_indices.GetCapacity();
+	stats.m_indicesUsed = m_indices.GetUsed();
+	stats.m_freeBlocks = m_vertices.GetFreeBlockCount() + m_indices.GetFreeBlockCount();
+	stats.m_grows = m_grows;
+
+	return stats;
+}
+
+void GeometryArena::InitialiseBuffers()
+{
+	//GEN VBO AND EBO, MUTABLE SO THEY CAN BE RESIZED IN PLACE
+	glCreateBuffers(1, &m_vbo);
+	glNamedBufferData(m_vbo, static_cast<GLsizeiptr>(m_vertices.GetCapacity()) * m_vertexStride, nullptr, GL_STATIC_DRAW);
+
+	glCreateBuffers(1, &m_ebo);
+	glNamedBufferData(m_ebo, static_cast<GLsizeiptr>(m_indices.GetCapacity()) * m_indexSize, nullptr, GL_STATIC_DRAW);
+
+	//VAO
+	glCreateVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	SetupVertexAttributes();
+
+	//BIND VAO 0
+	glBindVertexArray(0);
+}
+
+unsigned GeometryArena::AllocateGrowing(ArenaAllocator& allocator, const GLuint buffer, const unsigned elementSize, const unsigned count)
+{
+	unsigned offset = allocator.Allocate(count);
+
+	while (offset == ArenaAllocator::k_invalidOffset && count > 0)
+	{
+		const unsigned oldCapacity = allocator.GetCapacity();
+		const unsigned newCapacity = std::max(oldCapacity * 2, oldCapacity + count);
+
+		GrowBuffer(buffer, oldCapacity * elementSize, newCapacity * elementSize);
+		allocator.Grow(newCapacity);
+		m_grows++;
+
+		offset = allocator.Allocate(count);
+	}
+
+	return offset == ArenaAllocator::k_invalidOffset ? 0 : offset;
+}
+
+void GeometryArena::GrowBuffer(const GLuint buffer, const unsigned oldBytes, const unsigned newBytes) const
+{
+	if (oldBytes == 0)
+	{
+		glNamedBufferData(buffer, newBytes, nullptr, GL_STATIC_DRAW);
+		return;
+	}
+
+	// Round trip through a scratch buffer so the arena buffer keeps its name
+	GLuint scratch = 0;
+	glCreateBuffers(1, &scratch);
+	glNamedBufferData(scratch, oldBytes, nullptr, GL_STREAM_COPY);
+	glCopyNamedBufferSubData(buffer, scratch, 0, 0, oldBytes);
+
+	glNamedBufferData(buffer, newBytes, nullptr, GL_STATIC_DRAW);
+	glCopyNamedBufferSubData(scratch, buffer, 0, 0, oldBytes);
+
+	glDeleteBuffers(1, &scratch);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <gl/glew.h>
+
+#include "VertexFormat.h"
+
+// First fit sub-allocator over a linear range of elements. Free blocks are kept sorted by offset
+// so a freed block merges with both neighbours straight away.
+class ArenaAllocator
+{
+public:
+	static constexpr unsigned k_invalidOffset = ~0u;
+
+	explicit ArenaAllocator(unsigned capacity = 0);
+
+	// Returns k_invalidOffset if no free block is big enough
+	unsigned Allocate(unsigned size);
+
+	void Free(unsigned offset, unsigned size);
+
+	// Extends the range, the new space joins the last free block if it touches the old end
+	void Grow(unsigned newCapacity);
+
+	unsigned GetCapacity() const;
+	unsigned GetUsed() const;
+	unsigned GetFreeBlockCount() const;
+	unsigned GetLargestFreeBlock() const;
+
+private:
+	std::map<unsigned, unsigned> m_freeBlocks;
+	unsigned m_capacity;
+	unsigned m_used;
+};
+
+// Where a Geometry lives inside the arena buffers
+struct GeometryRange
+{
+	GLint m_baseVertex;
+	unsigned m_numVertices;
+	unsigned m_firstIndex;
+	unsigned m_numIndices;
+};
+
+// Layout of one glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand
+{
+	GLuint m_count;
+	GLuint m_instanceCount;
+	GLuint m_firstIndex;
+	GLint m_baseVertex;
+	GLuint m_baseInstance;
+};
+
+struct ArenaStats
+{
+	unsigned m_vertexStride = 0;
+	unsigned m_indexSize = 0;
+	unsigned m_vertexCapacity = 0;
+	unsigned m_verticesUsed = 0;
+	unsigned m_indexCapacity = 0;
+	unsigned m_indicesUsed = 0;
+	unsigned m_freeBlocks = 0;
+	unsigned m_grows = 0;
+};
+
+// Every Geometry's vertices and indices packed into one VBO and one EBO behind a single VAO, so
+// meshes with different geometry can share a bind and be drawn by one multi-draw call. All the
+// vertices in one arena share a vertex format and all the indices share an index type. Buffers
+// grow by doubling and keep their names, so VAOs pointing at them never need updating.
+// GL objects are created on the first allocation, the arena can exist before the context does.
+class GeometryArena
+{
+public:
+	// indexType is GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+	GeometryArena(eVertexFormat format, GLenum indexType, unsigned vertexCapacity, unsigned indexCapacity);
+
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// Vertex data must already be in the arena's format, indices are narrowed to the arena's type
+	GeometryRange Allocate(const void* vertexData, unsigned numOfVertices, const GLuint* indexArray, unsigned numOfIndices);
+
+	// Both vertex and index data already in the arena's layout, uploaded as they are
+	GeometryRange AllocateEncoded(const void* vertexData, unsigned numOfVertices, const void* indexData, unsigned numOfIndices);
+
+	void Free(const GeometryRange& range);
+
+	// Copies a range back out of the GL buffers, for checking what was uploaded
+	void ReadBack(const GeometryRange& range, std::vector<unsigned char>& vertexData, std::vector<unsigned char>& indexData) const;
+
+	void Bind() const;
+
+	GLuint GetVertexArray() const;
+
+	// Points the attributes of the currently bound VAO at the arena buffers
+	void SetupVertexAttributes() const;
+
+	eVertexFormat GetFormat() const;
+
+	GLenum GetIndexType() const;
+	unsigned GetIndexSize() const;
+
+	ArenaStats GetStats() const;
+
+private:
+	eVertexFormat m_format;
+	unsigned m_vertexStride;
+	GLenum m_indexType;
+	unsigned m_indexSize;
+	GLuint m_vao;
+	GLuint m_vbo;
+	GLuint m_ebo;
+
+	ArenaAllocator m_vertices;
+	ArenaAllocator m_indices;
+	unsigned m_grows;
+
+	void InitialiseBuffers();
+
+	unsigned AllocateGrowing(ArenaAllocator& allocator, GLuint buffer, unsigned elementSize, unsigned count);
+
+	void GrowBuffer(GLuint buffer, unsigned oldBytes, unsigned newBytes) const;
+};
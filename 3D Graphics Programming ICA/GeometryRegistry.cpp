@@ -0,0 +1,337 @@
+#include "GeometryRegistry.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "Constants.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+
+GeometryRegistry::GeometryRegistry(ThreadPool* threadPool) :
+	m_threadPool(threadPool)
+{
+	for (int format = 0; format < 2; ++format)
+	{
+		for (int shortIndices = 0; shortIndices < 2; ++shortIndices)
+		{
+			m_arenas[format][shortIndices].reset(new GeometryArena(static_cast<eVertexFormat>(format),
+				shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, constants::k_arenaVertexCapacity, constants::k_arenaIndexCapacity));
+		}
+	}
+}
+
+GeometryHandle GeometryRegistry::Get(const ePrimitiveType type, const eVertexFormat format)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_stats.m_requests++;
+
+	std::weak_ptr<const Geometry>& slot = m_primitives[static_cast<int>(type) << 1 | static_cast<int>(format)];
+	GeometryHandle geometry = slot.lock();
+
+	if (geometry)
+	{
+		// Hits skip building the primitive on the CPU entirely
+		m_stats.m_hits++;
+		m_stats.m_bytesSaved += geometry->GetGpuBytes();
+	} else
+	{
+		Primitive* primitive = CreatePrimitive(type);
+
+		if (primitive)
+		{
+			geometry = Intern(slot, format,
+				primitive->GetVertices().data(), static_cast<unsigned>(primitive->GetVertices().size()),
+				primitive->GetIndices().data(), static_cast<unsigned>(primitive->GetIndices().size()));
+		} else
+		{
+			std::cout << "ERROR::GEOMETRY_REGISTRY::COULD_NOT_CREATE_PRIMITIVE" << "\n";
+		}
+
+		delete primitive;
+	}
+
+	m_stats.m_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return geometry;
+}
+
+GeometryHandle GeometryRegistry::Get(const Vertex* vertexArray, const unsigned numOfVertices, const GLuint* indexArray, const unsigned numOfIndices,
+	const eVertexFormat format)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_stats.m_requests++;
+
+	const uint64_t hash = Hash(vertexArray, numOfVertices, indexArray, numOfIndices, format);
+	GeometryHandle geometry;
+
+	// Different data can share a hash, only the same bytes are the same geometry
+	const auto range = m_hashedGeometry.equal_range(hash);
+	for (auto it = range.first; it != range.second && !geometry; ++it)
+	{
+		if (Matches(it->second, vertexArray, numOfVertices, indexArray, numOfIndices, format))
+		{
+			geometry = it->second.m_geometry.lock();
+		}
+	}
+
+	if (geometry)
+	{
+		m_stats.m_hits++;
+		m_stats.m_bytesSaved += geometry->GetGpuBytes();
+	} else
+	{
+		PruneHashedGeometry();
+
+		HashedGeometry entry;
+		entry.m_format = format;
+		entry.m_indexed = indexArray != nullptr;
+		entry.m_vertices.assign(vertexArray, vertexArray + numOfVertices);
+
+		if (indexArray)
+		{
+			entry.m_indices.assign(indexArray, indexArray + numOfIndices);
+		}
+
+		HashedGeometry& interned = m_hashedGeometry.emplace(hash, std::move(entry))->second;
+		geometry = Intern(interned.m_geometry, format, vertexArray, numOfVertices, indexArray, numOfIndices);
+	}
+
+	m_stats.m_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return geometry;
+}
+
+GeometryHandle GeometryRegistry::Load(const std::string& fileName, const eVertexFormat format)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_stats.m_requests++;
+
+	const bool cooked = fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".mesh") == 0;
+
+	std::weak_ptr<const Geometry>& slot = m_models[cooked ? fileName : fileName + "#" + std::to_string(static_cast<int>(format))];
+	GeometryHandle geometry = slot.lock();
+
+	if (geometry)
+	{
+		// Hits skip reading the file entirely
+		m_stats.m_hits++;
+		m_stats.m_bytesSaved += geometry->GetGpuBytes();
+	} else if (cooked)
+	{
+		geometry = LoadCooked(slot, fileName);
+	} else
+	{
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+		ObjLoadStats loadStats;
+
+		if (ObjLoader::Load(fileName, vertices, indices, m_threadPool, &loadStats))
+		{
+			geometry = Intern(slot, format, vertices.data(), static_cast<unsigned>(vertices.size()),
+				indices.data(), static_cast<unsigned>(indices.size()));
+
+			std::cout << "GEOMETRY_REGISTRY::LOADED: " << fileName << ", " << loadStats.m_triangles << " triangles in "
+				<< loadStats.m_milliseconds << "ms (" << loadStats.m_bytes / 1048576.0 / (loadStats.m_milliseconds / 1000.0) << " MB/s)" << "\n";
+		}
+	}
+
+	m_stats.m_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	return geometry;
+}
+
+bool GeometryRegistry::Cook(const std::string& sourceFileName, const std::string& cookedFileName, const eVertexFormat format)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+
+	if (!ObjLoader::Load(sourceFileName, vertices, indices, m_threadPool))
+		return false;
+
+	MeshOptimizer::Optimize(vertices, indices);
+
+	const unsigned numOfVertices = static_cast<unsigned>(vertices.size());
+	const unsigned numOfIndices = static_cast<unsigned>(indices.size());
+
+	MeshFileContents contents;
+	contents.m_format = format;
+	contents.m_indexType = ChooseIndexType(numOfVertices);
+	contents.m_numOfVertices = numOfVertices;
+	contents.m_numOfIndices = numOfIndices;
+	contents.m_bounds = ComputeBounds(vertices.data(), numOfVertices);
+	contents.m_lods.push_back({ 0, numOfIndices, 0.f, 0 });
+
+	// Encode exactly as Geometry would on upload
+	std::vector<QuantizedVertex> quantized;
+	std::vector<GLushort> shortIndices;
+
+	if (format == eVertexFormat::e_Quantized)
+	{
+		contents.m_dequant = ComputePositionDequant(contents.m_bounds);
+		quantized.resize(numOfVertices);
+		EncodeVertices(vertices.data(), numOfVertices, contents.m_dequant, quantized.data());
+		contents.m_vertexData = quantized.data();
+	} else
+	{
+		contents.m_vertexData = vertices.data();
+	}
+
+	if (contents.m_indexType == GL_UNSIGNED_SHORT)
+	{
+		shortIndices.assign(indices.begin(), indices.end());
+		contents.m_indexData = shortIndices.data();
+	} else
+	{
+		contents.m_indexData = indices.data();
+	}
+
+	if (!MeshFile::Write(cookedFileName, contents))
+		return false;
+
+	std::cout << "GEOMETRY_REGISTRY::COOKED: " << sourceFileName << " -> " << cookedFileName << ", " << numOfVertices << " vertices, "
+		<< numOfIndices / 3 << " triangles in " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()
+		<< "ms" << "\n";
+
+	return true;
+}
+
+const GeometryStats& GeometryRegistry::GetStats() const
+{
+	return m_stats;
+}
+
+GeometryArena& GeometryRegistry::GetArena(const eVertexFormat format, const GLenum indexType)
+{
+	return *m_arenas[static_cast<int>(format)][indexType == GL_UNSIGNED_SHORT ? 1 : 0];
+}
+
+GeometryHandle GeometryRegistry::LoadCooked(std::weak_ptr<const Geometry>& slot, const std::string& fileName)
+{
+	MeshFile file;
+
+	if (!file.Open(fileName))
+		return nullptr;
+
+	const MeshFileHeader& header = file.GetHeader();
+
+	// Blobs go from the mapping to the arena buffers with no CPU side copy
+	GeometryHandle geometry = std::make_shared<const Geometry>(GetArena(file.GetFormat(), file.GetIndexType()),
+		file.GetVertexData(), header.m_numOfVertices, file.GetIndexData(), header.m_numOfIndices,
+		file.GetBounds(), file.GetDequant());
+	slot = geometry;
+
+	m_stats.m_uploads++;
+	m_stats.m_bytesUploaded += geometry->GetGpuBytes();
+
+	return geometry;
+}
+
+GeometryHandle GeometryRegistry::Intern(std::weak_ptr<const Geometry>& slot, const eVertexFormat format,
+	const Vertex* vertexArray, const unsigned numOfVertices, const GLuint* indexArray, const unsigned numOfIndices)
+{
+	// The source data was hashed before this, so identical requests still hit
+	std::vector<Vertex> vertices(vertexArray, vertexArray + numOfVertices);
+	std::vector<GLuint> indices;
+
+	if (indexArray)
+	{
+		indices.assign(indexArray, indexArray + numOfIndices);
+	}
+
+	// Non-indexed input is a transform per corner before optimising
+	const unsigned missesBefore = indices.empty() ? numOfVertices :
+		MeshOptimizer::AnalyzeVertexCache(indices.data(), numOfIndices, numOfVertices).m_vertexTransforms;
+
+	MeshOptimizer::Optimize(vertices, indices);
+
+	const unsigned numOfOptimizedVertices = static_cast<unsigned>(vertices.size());
+	const unsigned numOfOptimizedIndices = static_cast<unsigned>(indices.size());
+
+	const GLenum indexType = ChooseIndexType(numOfOptimizedVertices);
+
+	GeometryHandle geometry = std::make_shared<const Geometry>(GetArena(format, indexType),
+		vertices.data(), numOfOptimizedVertices, indices.data(), numOfOptimizedIndices);
+	slot = geometry;
+
+	m_stats.m_uploads++;
+	m_stats.m_bytesUploaded += geometry->GetGpuBytes();
+	m_stats.m_quantizedBytesSaved += static_cast<size_t>(numOfOptimizedVertices) * (sizeof(Vertex) - GetVertexStride(format));
+	m_stats.m_indexBytesSaved += static_cast<size_t>(numOfOptimizedIndices) * (sizeof(GLuint) - GetArena(format, indexType).GetIndexSize());
+	m_stats.m_verticesWelded += numOfVertices - numOfOptimizedVertices;
+	m_stats.m_trianglesOptimized += numOfOptimizedIndices / 3;
+	m_stats.m_cacheMissesBefore += missesBefore;
+	m_stats.m_cacheMissesAfter += MeshOptimizer::AnalyzeVertexCache(indices.data(), numOfOptimizedIndices, numOfOptimizedVertices).m_vertexTransforms;
+
+	return geometry;
+}
+
+void GeometryRegistry::PruneHashedGeometry()
+{
+	for (auto it = m_hashedGeometry.begin(); it != m_hashedGeometry.end();)
+	{
+		if (it->second.m_geometry.expired())
+		{
+			it = m_hashedGeometry.erase(it);
+		} else
+		{
+			++it;
+		}
+	}
+}
+
+GLenum GeometryRegistry::ChooseIndexType(const unsigned numOfVertices)
+{
+	return numOfVertices <= std::numeric_limits<GLushort>::max() + 1u ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+bool GeometryRegistry::Matches(const HashedGeometry& entry, const Vertex* vertexArray, const unsigned numOfVertices, const GLuint* indexArray,
+	const unsigned numOfIndices, const eVertexFormat format)
+{
+	if (entry.m_format != format || entry.m_indexed != (indexArray != nullptr) || entry.m_vertices.size() != numOfVertices ||
+		entry.m_indices.size() != (indexArray ? numOfIndices : 0))
+		return false;
+
+	// Byte for byte, the same as the hash sees it
+	if (numOfVertices > 0 && std::memcmp(entry.m_vertices.data(), vertexArray, numOfVertices * sizeof(Vertex)) != 0)
+		return false;
+
+	return !indexArray || numOfIndices == 0 || std::memcmp(entry.m_indices.data(), indexArray, numOfIndices * sizeof(GLuint)) == 0;
+}
+
+uint64_t GeometryRegistry::Hash(const Vertex* vertexArray, const unsigned numOfVertices, const GLuint* indexArray, const unsigned numOfIndices,
+	const eVertexFormat format)
+{
+	// FNV-1a over the raw bytes, with the counts mixed in so a vertex/index split can't collide
+	uint64_t hash = 14695981039346656037ull;
+
+	const auto mix = [&hash](const void* data, const size_t size)
+	{
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
+
+	mix(&numOfVertices, sizeof(numOfVertices));
+	mix(&numOfIndices, sizeof(numOfIndices));
+	mix(&format, sizeof(format));
+	mix(vertexArray, numOfVertices * sizeof(Vertex));
+
+	if (indexArray)
+	{
+		mix(indexArray, numOfIndices * sizeof(GLuint));
+	}
+
+	return hash;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Geometry.h"
+#include "Primitives.h"
+
+struct GeometryStats
+{
+	unsigned m_requests = 0;
+	unsigned m_hits = 0;
+	unsigned m_uploads = 0;
+	size_t m_bytesUploaded = 0;
+	size_t m_bytesSaved = 0;
+	size_t m_quantizedBytesSaved = 0;
+	size_t m_indexBytesSaved = 0;
+	unsigned m_verticesWelded = 0;
+	unsigned m_trianglesOptimized = 0;
+	unsigned m_cacheMissesBefore = 0;
+	unsigned m_cacheMissesAfter = 0;
+	double m_milliseconds = 0.0;
+};
+
+// Interns geometry so identical data is built and uploaded once. Primitives are keyed by type,
+// raw arrays by a hash of their contents, checked against a copy of the arrays before it counts
+// as a hit. The registry only holds weak references, so geometry is freed once the last handle to
+// it goes away. Everything is uploaded into the GeometryArena for
+// the vertex format it was asked for, the same data in two formats is two separate geometries.
+// New geometry goes through the MeshOptimizer first, and into a 16 bit index arena when its
+// welded vertex count fits.
+class ThreadPool;
+
+class GeometryRegistry
+{
+public:
+	// The pool, if given, is used to parse model files
+	explicit GeometryRegistry(ThreadPool* threadPool = nullptr);
+
+	GeometryHandle Get(ePrimitiveType type, eVertexFormat format = eVertexFormat::e_Float);
+
+	GeometryHandle Get(const Vertex* vertexArray, unsigned numOfVertices, const GLuint* indexArray, unsigned numOfIndices,
+		eVertexFormat format = eVertexFormat::e_Float);
+
+	// Models are keyed by file name, a file that fails to load returns null. Cooked .mesh files are
+	// uploaded straight from the mapping and keep the vertex format they were cooked with, anything
+	// else is parsed as OBJ
+	GeometryHandle Load(const std::string& fileName, eVertexFormat format = eVertexFormat::e_Float);
+
+	// Runs a model file through the same loading and optimisation as Load and writes the result as
+	// a .mesh file that Load can later upload without any of that work
+	bool Cook(const std::string& sourceFileName, const std::string& cookedFileName, eVertexFormat format = eVertexFormat::e_Float);
+
+	const GeometryStats& GetStats() const;
+
+	GeometryArena& GetArena(eVertexFormat format, GLenum indexType = GL_UNSIGNED_INT);
+
+private:
+	// Geometry made from raw arrays, with the arrays it was made from
+	struct HashedGeometry
+	{
+		eVertexFormat m_format;
+		bool m_indexed;
+		std::vector<Vertex> m_vertices;
+		std::vector<GLuint> m_indices;
+		std::weak_ptr<const Geometry> m_geometry;
+	};
+
+	// Indexed by vertex format then by whether indices are 16 bit
+	std::unique_ptr<GeometryArena> m_arenas[2][2];
+	std::unordered_map<int, std::weak_ptr<const Geometry>> m_primitives;
+	std::unordered_multimap<uint64_t, HashedGeometry> m_hashedGeometry;
+	std::unordered_map<std::string, std::weak_ptr<const Geometry>> m_models;
+	ThreadPool* m_threadPool;
+	GeometryStats m_stats;
+
+	GeometryHandle LoadCooked(std::weak_ptr<const Geometry>& slot, const std::string& fileName);
+
+	GeometryHandle Intern(std::weak_ptr<const Geometry>& slot, eVertexFormat format,
+		const Vertex* vertexArray, unsigned numOfVertices, const GLuint* indexArray, unsigned numOfIndices);
+
+	// Drops hashed geometry nothing holds a handle to any more, and the copies kept with it
+	void PruneHashedGeometry();
+
+	static GLenum ChooseIndexType(unsigned numOfVertices);
+
+	static bool Matches(const HashedGeometry& entry, const Vertex* vertexArray, unsigned numOfVertices, const GLuint* indexArray,
+		unsigned numOfIndices, eVertexFormat format);
+
+	static uint64_t Hash(const Vertex* vertexArray, unsigned numOfVertices, const GLuint* indexArray, unsigned numOfIndices,
+		eVertexFormat format);
+};
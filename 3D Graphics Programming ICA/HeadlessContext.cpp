@@ -0,0 +1,157 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef _WIN32
+HeadlessContext::HeadlessContext(const int glVersionMajor, const int glVersionMinor) :
+	m_window(nullptr)
+{
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::GLFW_INIT_FAILED" << "\n";
+		return;
+	}
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glVersionMajor);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glVersionMinor);
+
+	m_window = glfwCreateWindow(1, 1, "", nullptr, nullptr);
+
+	if (!m_window)
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::WINDOW_INIT_FAILED" << "\n";
+		return;
+	}
+
+	glfwMakeContextCurrent(m_window);
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (m_window)
+	{
+		glfwDestroyWindow(m_window);
+	}
+
+	glfwTerminate();
+}
+
+bool HeadlessContext::IsValid() const
+{
+	return m_window != nullptr;
+}
+
+void HeadlessContext::MakeCurrent() const
+{
+	glfwMakeContextCurrent(m_window);
+}
+
+void HeadlessContext::ReleaseCurrent() const
+{
+	glfwMakeContextCurrent(nullptr);
+}
+#else
+HeadlessContext::HeadlessContext(const int glVersionMajor, const int glVersionMinor) :
+	m_display(EGL_NO_DISPLAY),
+	m_context(EGL_NO_CONTEXT)
+{
+	// The surfaceless platform needs no window system at all, plain default displays usually want X
+	const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	EGLDisplay display = getPlatformDisplay ?
+		getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major = 0;
+	EGLint minor = 0;
+
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::EGL_INIT_FAILED: " << std::hex << eglGetError() << std::dec << "\n";
+		return;
+	}
+
+	m_display = display;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::NO_DESKTOP_GL" << "\n";
+		return;
+	}
+
+	// No surface is ever made, any config that can do desktop GL will do. Without one the
+	// context is made config-less, which surfaceless Mesa supports
+	const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = nullptr;
+	EGLint numOfConfigs = 0;
+	eglChooseConfig(display, configAttributes, &config, 1, &numOfConfigs);
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, glVersionMajor,
+		EGL_CONTEXT_MINOR_VERSION, glVersionMinor,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	const EGLContext context = eglCreateContext(display, numOfConfigs > 0 ? config : static_cast<EGLConfig>(nullptr),
+		EGL_NO_CONTEXT, contextAttributes);
+
+	if (context == EGL_NO_CONTEXT)
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::CONTEXT_INIT_FAILED: " << std::hex << eglGetError() << std::dec << "\n";
+		return;
+	}
+
+	if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::MAKE_CURRENT_FAILED: " << std::hex << eglGetError() << std::dec << "\n";
+		eglDestroyContext(display, context);
+		return;
+	}
+
+	m_context = context;
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	if (m_display == EGL_NO_DISPLAY)
+		return;
+
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (m_context != EGL_NO_CONTEXT)
+	{
+		eglDestroyContext(m_display, m_context);
+	}
+
+	eglTerminate(m_display);
+}
+
+bool HeadlessContext::IsValid() const
+{
+	return m_context != EGL_NO_CONTEXT;
+}
+
+void HeadlessContext::MakeCurrent() const
+{
+	if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+	{
+		std::cout << "ERROR::HEADLESS_CONTEXT::MAKE_CURRENT_FAILED: " << std::hex << eglGetError() << std::dec << "\n";
+	}
+}
+
+void HeadlessContext::ReleaseCurrent() const
+{
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+#ifdef _WIN32
+#include <GLFW/glfw3.h>
+#endif
+
+// An OpenGL core context with nothing on screen, current on the creating thread until moved. Elsewhere it is
+// an EGL surfaceless context on the default device, which Mesa's llvmpipe provides without a GPU
+// or display server. Windows has no EGL in its drivers, so there it is a hidden GLFW window.
+// Either way rendering goes into a RenderTarget, there is no default framebuffer to draw to.
+class HeadlessContext
+{
+public:
+	HeadlessContext(int glVersionMajor, int glVersionMinor);
+
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	bool IsValid() const;
+
+	// A context is current on at most one thread, release it before making it current on another
+	void MakeCurrent() const;
+	void ReleaseCurrent() const;
+
+private:
+#ifdef _WIN32
+	GLFWwindow* m_window;
+#else
+	// EGLDisplay and EGLContext, kept opaque so EGL stays out of the header
+	void* m_display;
+	void* m_context;
+#endif
+};
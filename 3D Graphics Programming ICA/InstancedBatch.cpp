@@ -0,0 +1,138 @@
+#include "InstancedBatch.h"
+
+#include "Profiler.h"
+
+InstancedBatch::InstancedBatch(GeometryHandle geometry, const unsigned instanceCapacity) :
+	m_geometry(std::move(geometry)),
+	m_vao(0),
+	m_instanceVbo(0),
+	m_instanceCapacity(0),
+	m_instancesDirty(false),
+	m_uniformShader(nullptr)
+{
+	m_instances.reserve(instanceCapacity);
+
+	InitialiseBuffers();
+}
+
+InstancedBatch::~InstancedBatch()
+{
+	glDeleteVertexArrays(1, &m_vao);
+
+	glDeleteBuffers(1, &m_instanceVbo);
+}
+
+unsigned InstancedBatch::AddInstance(const glm::mat4& modelMatrix, const glm::vec4& colour, const GLuint materialIndex)
+{
+	m_instances.push_back({ modelMatrix, colour, materialIndex });
+	m_instancesDirty = true;
+
+	return static_cast<unsigned>(m_instances.size() - 1);
+}
+
+void InstancedBatch::SetInstance(const unsigned index, const glm::mat4& modelMatrix)
+{
+	m_instances[index].m_modelMatrix = modelMatrix;
+	m_instancesDirty = true;
+}
+
+void InstancedBatch::SetInstance(const unsigned index, const InstanceData& instance)
+{
+	m_instances[index] = instance;
+	m_instancesDirty = true;
+}
+
+void InstancedBatch::Clear()
+{
+	m_instances.clear();
+	m_instancesDirty = true;
+}
+
+unsigned InstancedBatch::GetInstanceCount() const
+{
+	return static_cast<unsigned>(m_instances.size());
+}
+
+void InstancedBatch::Render(Shader& shader)
+{
+	if (m_instances.empty())
+		return;
+
+	ProfileScope scope("InstancedBatch::Render");
+	GpuProfileScope gpuScope("InstancedBatch::Render");
+
+	if (m_instancesDirty)
+	{
+		UploadInstances();
+	}
+
+	glBindVertexArray(m_vao);
+
+	if (m_uniformShader != &shader)
+	{
+		m_positionScaleUniform = shader.GetUniform<glm::vec4>("position_scale");
+		m_positionBiasUniform = shader.GetUniform<glm::vec4>("position_bias");
+		m_uniformShader = &shader;
+	}
+
+	m_positionScaleUniform.Set(m_geometry->GetPositionScale());
+	m_positionBiasUniform.Set(m_geometry->GetPositionBias());
+
+	shader.Use();
+
+	//Draw every instance in one call
+	m_geometry->DrawInstanced(static_cast<GLsizei>(m_instances.size()));
+
+	shader.Unuse();
+}
+
+void InstancedBatch::InitialiseBuffers()
+{
+	//VAO, reusing the shared geometry buffers for the per-vertex attributes
+	glCreateVertexArrays(1, &m_vao);
+	glBindVertexArray(m_vao);
+
+	m_geometry->SetupVertexAttributes();
+
+	//GEN INSTANCE VBO, FILLED ON THE FIRST RENDER
+	glGenBuffers(1, &m_instanceVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+
+	//Model matrix, one vec4 column per location
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			reinterpret_cast<GLvoid*>(offsetof(InstanceData, m_modelMatrix) + sizeof(glm::vec4) * column));
+		glEnableVertexAttribArray(4 + column);
+		glVertexAttribDivisor(4 + column, 1);
+	}
+	//Instance colour
+	glVertexAttribPointer(8, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+		reinterpret_cast<GLvoid*>(offsetof(InstanceData, m_colour)));
+	glEnableVertexAttribArray(8);
+	glVertexAttribDivisor(8, 1);
+	//Material index
+	glVertexAttribIPointer(9, 1, GL_UNSIGNED_INT, sizeof(InstanceData),
+		reinterpret_cast<GLvoid*>(offsetof(InstanceData, m_materialIndex)));
+	glEnableVertexAttribArray(9);
+	glVertexAttribDivisor(9, 1);
+
+	//BIND VAO 0
+	glBindVertexArray(0);
+}
+
+void InstancedBatch::UploadInstances()
+{
+	const GLsizeiptr size = static_cast<GLsizeiptr>(m_instances.size() * sizeof(InstanceData));
+
+	// Grow geometrically so adding instances one at a time doesn't reallocate every frame
+	if (m_instances.size() > m_instanceCapacity)
+	{
+		m_instanceCapacity = static_cast<unsigned>(m_instances.capacity());
+		glNamedBufferData(m_instanceVbo, m_instanceCapacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glNamedBufferSubData(m_instanceVbo, 0, size, m_instances.data());
+
+	m_instancesDirty = false;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <gl/glew.h>
+#include <glm/vec4.hpp>
+#include <glm/matrix.hpp>
+
+#include "Geometry.h"
+#include "Shader.h"
+
+// Per-instance attributes, laid out to match locations 4-9 in vertex_instanced.glsl
+struct InstanceData
+{
+	glm::mat4 m_modelMatrix;
+	glm::vec4 m_colour;
+	GLuint m_materialIndex;
+};
+
+// Draws many copies of one geometry with a single glDrawElementsInstanced. The geometry buffers are
+// shared, the batch only owns its VAO and instance buffer.
+// Model matrices, colours and material indices advance once per instance.
+class InstancedBatch
+{
+public:
+	InstancedBatch(GeometryHandle geometry, unsigned instanceCapacity = 0);
+
+	~InstancedBatch();
+
+	InstancedBatch(const InstancedBatch&) = delete;
+	InstancedBatch& operator=(const InstancedBatch&) = delete;
+
+	unsigned AddInstance(const glm::mat4& modelMatrix, const glm::vec4& colour = glm::vec4(1.f), GLuint materialIndex = 0);
+
+	void SetInstance(unsigned index, const glm::mat4& modelMatrix);
+
+	void SetInstance(unsigned index, const InstanceData& instance);
+
+	void Clear();
+
+	unsigned GetInstanceCount() const;
+
+	void Render(Shader& shader);
+
+private:
+	GeometryHandle m_geometry;
+	GLuint m_vao;
+	GLuint m_instanceVbo;
+	unsigned m_instanceCapacity;
+	bool m_instancesDirty;
+	std::vector<InstanceData> m_instances;
+
+	// Resolved against the shader last rendered with
+	const Shader* m_uniformShader;
+	UniformHandle<glm::vec4> m_positionScaleUniform;
+	UniformHandle<glm::vec4> m_positionBiasUniform;
+
+	void InitialiseBuffers();
+
+	void UploadInstances();
+};
@@ -0,0 +1,209 @@
+#include "KtxFile.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	const unsigned char k_identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+	constexpr uint32_t k_endianness = 0x04030201;
+	const char k_sourceHashKey[] = "TDS.sourceHash";
+
+	struct KtxHeader
+	{
+		unsigned char m_identifier[12];
+		uint32_t m_endianness;
+		uint32_t m_glType;
+		uint32_t m_glTypeSize;
+		uint32_t m_glFormat;
+		uint32_t m_glInternalFormat;
+		uint32_t m_glBaseInternalFormat;
+		uint32_t m_pixelWidth;
+		uint32_t m_pixelHeight;
+		uint32_t m_pixelDepth;
+		uint32_t m_numberOfArrayElements;
+		uint32_t m_numberOfFaces;
+		uint32_t m_numberOfMipmapLevels;
+		uint32_t m_bytesOfKeyValueData;
+	};
+
+	static_assert(sizeof(KtxHeader) == 64, "KTX header layout");
+
+	GLenum GetBaseInternalFormat(const eTextureCompression compression)
+	{
+		switch (compression)
+		{
+		case eTextureCompression::e_BC1:
+			return GL_RGB;
+		case eTextureCompression::e_BC4:
+			return GL_RED;
+		case eTextureCompression::e_BC5:
+			return GL_RG;
+		default:
+			return GL_RGBA;
+		}
+	}
+
+	eTextureCompression GetCompression(const uint32_t internalFormat)
+	{
+		for (const eTextureCompression compression : { eTextureCompression::e_BC1, eTextureCompression::e_BC3,
+			eTextureCompression::e_BC4, eTextureCompression::e_BC5 })
+		{
+			if (TextureCompressor::GetInternalFormat(compression) == internalFormat)
+				return compression;
+		}
+
+		return eTextureCompression::e_None;
+	}
+
+	uint32_t PadTo4(const uint32_t size)
+	{
+		return (size + 3) & ~3u;
+	}
+}
+
+bool WriteKtx(const std::string& fileName, const CompressedImage& image, const uint64_t sourceHash)
+{
+	if (image.m_levels.empty())
+		return false;
+
+	char hashText[17];
+	for (int digit = 0; digit < 16; ++digit)
+	{
+		hashText[digit] = "0123456789abcdef"[sourceHash >> ((15 - digit) * 4) & 15];
+	}
+	hashText[16] = '\0';
+
+	const uint32_t keyAndValueBytes = sizeof(k_sourceHashKey) + sizeof(hashText);
+
+	KtxHeader header{};
+	std::memcpy(header.m_identifier, k_identifier, sizeof(k_identifier));
+	header.m_endianness = k_endianness;
+	header.m_glTypeSize = 1;
+	header.m_glInternalFormat = TextureCompressor::GetInternalFormat(image.m_compression);
+	header.m_glBaseInternalFormat = GetBaseInternalFormat(image.m_compression);
+	header.m_pixelWidth = static_cast<uint32_t>(image.m_levels[0].m_width);
+	header.m_pixelHeight = static_cast<uint32_t>(image.m_levels[0].m_height);
+	header.m_numberOfFaces = 1;
+	header.m_numberOfMipmapLevels = static_cast<uint32_t>(image.m_levels.size());
+	header.m_bytesOfKeyValueData = sizeof(uint32_t) + PadTo4(keyAndValueBytes);
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::KTX::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	const char padding[4] = {};
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&keyAndValueBytes), sizeof(keyAndValueBytes));
+	file.write(k_sourceHashKey, sizeof(k_sourceHashKey));
+	file.write(hashText, sizeof(hashText));
+	file.write(padding, PadTo4(keyAndValueBytes) - keyAndValueBytes);
+
+	// Block sizes are multiples of 8 bytes, so levels never need mip padding
+	for (const CompressedLevel& level : image.m_levels)
+	{
+		const uint32_t imageSize = static_cast<uint32_t>(level.m_data.size());
+		file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+		file.write(reinterpret_cast<const char*>(level.m_data.data()), imageSize);
+	}
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::KTX::COULD_NOT_WRITE_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool ReadKtx(const std::string& fileName, CompressedImage& image, uint64_t& sourceHash)
+{
+	std::ifstream file(fileName, std::ios::binary);
+
+	if (!file.is_open())
+		return false;
+
+	KtxHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	const eTextureCompression compression = GetCompression(header.m_glInternalFormat);
+
+	if (!file.good() || std::memcmp(header.m_identifier, k_identifier, sizeof(k_identifier)) != 0 ||
+		header.m_endianness != k_endianness || compression == eTextureCompression::e_None ||
+		header.m_numberOfFaces != 1 || header.m_numberOfArrayElements != 0 || header.m_pixelDepth != 0 ||
+		header.m_numberOfMipmapLevels == 0 || header.m_numberOfMipmapLevels > 32)
+	{
+		std::cout << "ERROR::KTX::UNSUPPORTED_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	// Look for the source hash among the key/value pairs
+	std::string keyValueData(header.m_bytesOfKeyValueData, '\0');
+	file.read(&keyValueData[0], static_cast<std::streamsize>(keyValueData.size()));
+
+	sourceHash = 0;
+	size_t offset = 0;
+
+	while (offset + sizeof(uint32_t) <= keyValueData.size())
+	{
+		uint32_t size = 0;
+		std::memcpy(&size, keyValueData.data() + offset, sizeof(size));
+		offset += sizeof(size);
+
+		if (offset + size > keyValueData.size())
+			break;
+
+		const char* pair = keyValueData.data() + offset;
+
+		if (size > sizeof(k_sourceHashKey) && std::memcmp(pair, k_sourceHashKey, sizeof(k_sourceHashKey)) == 0)
+		{
+			sourceHash = std::strtoull(std::string(pair + sizeof(k_sourceHashKey), size - sizeof(k_sourceHashKey)).c_str(), nullptr, 16);
+		}
+
+		offset += PadTo4(size);
+	}
+
+	image.m_compression = compression;
+	image.m_levels.resize(header.m_numberOfMipmapLevels);
+
+	int width = static_cast<int>(header.m_pixelWidth);
+	int height = static_cast<int>(header.m_pixelHeight);
+
+	for (CompressedLevel& level : image.m_levels)
+	{
+		uint32_t imageSize = 0;
+		file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize));
+
+		if (!file.good() || imageSize != TextureCompressor::GetLevelBytes(width, height, compression))
+		{
+			std::cout << "ERROR::KTX::CORRUPT_FILE: " << fileName << "\n";
+			image.m_levels.clear();
+			return false;
+		}
+
+		level.m_width = width;
+		level.m_height = height;
+		level.m_data.resize(imageSize);
+		file.read(reinterpret_cast<char*>(level.m_data.data()), imageSize);
+
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::KTX::CORRUPT_FILE: " << fileName << "\n";
+		image.m_levels.clear();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "TextureCompressor.h"
+
+// KTX 1.1 container for a compressed mip chain, so the cache files open in standard tools. The
+// source hash is kept in a key/value pair
+bool WriteKtx(const std::string& fileName, const CompressedImage& image, uint64_t sourceHash);
+
+// Fails quietly if the file is missing, logs if it is there but can't be used
+bool ReadKtx(const std::string& fileName, CompressedImage& image, uint64_t& sourceHash);
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The OS pages the data in on demand, so parsers can
+// walk it like one big buffer without copying it through stream buffers first.
+class MappedFile
+{
+public:
+	MappedFile();
+
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& fileName);
+
+	void Close();
+
+	bool IsOpen() const;
+
+	const char* GetData() const;
+	size_t GetSize() const;
+
+private:
+	const char* m_data;
+	size_t m_size;
+
+#ifdef _WIN32
+	void* m_file;
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+};
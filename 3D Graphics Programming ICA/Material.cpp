@@ -1,20 +1,84 @@
 ﻿#include "Material.h"
 
+#include "ShaderVariants.h"
+
 Material::Material(const glm::vec3& ambientColour, const glm::vec3& diffuseColour, const glm::vec3& specularColour,
 	const GLint diffuseTexture, const GLint specularTexture) :
 	m_ambientColour(ambientColour),
 	m_diffuseColour(diffuseColour),
 	m_specularColour(specularColour),
 	m_diffuseTexture(diffuseTexture),
-	m_specularTexture(specularTexture)
+	m_specularTexture(specularTexture),
+	m_diffuseLayer(0),
+	m_specularLayer(0)
+{
+}
+
+void Material::SetTextureLayers(const GLint diffuseLayer, const GLint specularLayer)
 {
+	m_diffuseLayer = diffuseLayer;
+	m_specularLayer = specularLayer;
 }
 
 void Material::SendToShader(Shader& program) const
 {
-	program.SetVec3F(m_ambientColour, "material.ambient");
-	program.SetVec3F(m_diffuseColour, "material.diffuse");
-	program.SetVec3F(m_specularColour, "material.specular");
-	program.Set1I(m_diffuseTexture, "material.diffuse_tex");
-	program.Set1I(m_specularTexture, "material.specular_tex");
+	const ProgramUniforms& uniforms = GetProgramUniforms(program);
+
+	uniforms.m_ambient.Set(m_ambientColour);
+	uniforms.m_diffuse.Set(m_diffuseColour);
+	uniforms.m_specular.Set(m_specularColour);
+	uniforms.m_features.Set(static_cast<GLint>(GetShaderFeatures()));
+
+	// Variants without the map don't have the sampler, fallbacks have it but don't read it
+	if (m_diffuseTexture >= 0)
+		uniforms.m_diffuseTexture.Set(m_diffuseTexture);
+
+	if (m_specularTexture >= 0)
+		uniforms.m_specularTexture.Set(m_specularTexture);
+
+	// Only programs sampling texture arrays have these, the handles of the rest are invalid
+	uniforms.m_diffuseLayer.Set(m_diffuseLayer);
+	uniforms.m_specularLayer.Set(m_specularLayer);
+}
+
+unsigned Material::GetShaderFeatures() const
+{
+	unsigned features = 0;
+
+	if (m_diffuseTexture >= 0)
+		features |= eShaderFeature::e_DiffuseMap;
+
+	if (m_specularColour != glm::vec3(0.f))
+	{
+		features |= eShaderFeature::e_Specular;
+
+		if (m_specularTexture >= 0)
+			features |= eShaderFeature::e_SpecularMap;
+	}
+
+	return features;
+}
+
+const Material::ProgramUniforms& Material::GetProgramUniforms(Shader& program) const
+{
+	for (const ProgramUniforms& uniforms : m_programUniforms)
+	{
+		if (uniforms.m_program == &program)
+			return uniforms;
+	}
+
+	ProgramUniforms uniforms;
+	uniforms.m_program = &program;
+	uniforms.m_ambient = program.GetUniform<glm::fvec3>("material.ambient");
+	uniforms.m_diffuse = program.GetUniform<glm::fvec3>("material.diffuse");
+	uniforms.m_specular = program.GetUniform<glm::fvec3>("material.specular");
+	uniforms.m_features = program.GetUniform<GLint>("material.features");
+	uniforms.m_diffuseTexture = program.GetUniform<GLint>("material.diffuse_tex");
+	uniforms.m_specularTexture = program.GetUniform<GLint>("material.specular_tex");
+	uniforms.m_diffuseLayer = program.GetUniform<GLint>("material.diffuse_layer");
+	uniforms.m_specularLayer = program.GetUniform<GLint>("material.specular_layer");
+
+	m_programUniforms.push_back(uniforms);
+
+	return m_programUniforms.back();
 }
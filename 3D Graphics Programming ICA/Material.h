@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include <gl/glew.h>
 #include <glm/vec3.hpp>
 
@@ -7,14 +8,42 @@
 class Material
 {
 public:
+	// Texture units, -1 for a material without that map
 	Material(const glm::vec3& ambientColour, const glm::vec3& diffuseColour, const glm::vec3& specularColour, const GLint diffuseTexture, const GLint specularTexture);
 
+	// Layers to sample when the texture units hold TextureArrayPool arrays
+	void SetTextureLayers(GLint diffuseLayer, GLint specularLayer);
+
 	void SendToShader(Shader& program) const;
 
+	// eShaderFeature bits of the work this material needs, picks its shader variant
+	unsigned GetShaderFeatures() const;
+
 private:
 	glm::vec3 m_ambientColour;
 	glm::vec3 m_diffuseColour;
 	glm::vec3 m_specularColour;
 	GLint m_diffuseTexture;
 	GLint m_specularTexture;
+	GLint m_diffuseLayer;
+	GLint m_specularLayer;
+
+	// Handles into one program the material has been sent to, looked up the first time
+	struct ProgramUniforms
+	{
+		const Shader* m_program;
+		UniformHandle<glm::fvec3> m_ambient;
+		UniformHandle<glm::fvec3> m_diffuse;
+		UniformHandle<glm::fvec3> m_specular;
+		UniformHandle<GLint> m_features;
+		UniformHandle<GLint> m_diffuseTexture;
+		UniformHandle<GLint> m_specularTexture;
+		UniformHandle<GLint> m_diffuseLayer;
+		UniformHandle<GLint> m_specularLayer;
+	};
+
+	// One per shader variant drawn with, only ever a handful
+	mutable std::vector<ProgramUniforms> m_programUniforms;
+
+	const ProgramUniforms& GetProgramUniforms(Shader& program) const;
 };
@@ -1,29 +1,34 @@
 #pragma once
-#include "Vertex.h"
-#include <vector>
 #include <gl/glew.h>
+#include <glm/vec3.hpp>
+#include <glm/matrix.hpp>
 
-
-#include "Primitives.h"
+#include "Geometry.h"
+#include "GeometryRegistry.h"
 #include "Shader.h"
-
-enum class ePrimitiveType
-{
-	e_Quad, e_Triangle, e_Pyramid, e_Cube
-};
+#include "SceneGraph.h"
 
 class Mesh
 {
 public:
-	Mesh(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale,
-		Vertex* vertexArray, const unsigned& numOfVertices,
-		GLuint* indexArray, const unsigned& numOfIndices);
+	Mesh(SceneGraph& sceneGraph, NodeId parent, GeometryHandle geometry,
+		const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+	// Loads a model file, cooked .mesh or OBJ, through the registry. Falls back to a cube if the
+	// file can't be loaded so the scene still has something to draw and cull
+	Mesh(SceneGraph& sceneGraph, NodeId parent, GeometryRegistry& registry, const std::string& fileName,
+		const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
 
-	Mesh(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale, ePrimitiveType type);
-	
 	~Mesh();
 
-	void Render(Shader& shader);
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// Sets the shader's model_matrix, position_scale and position_bias and draws straight away.
+	// Scene meshes go through the RenderQueue instead. This is the per-mesh path batching replaced,
+	// kept for --unbatched so batching can be measured against it. The model matrix is passed in,
+	// copied out of the scene graph on the update thread, so the render thread never reads it
+	void Render(Shader& shader, const glm::mat4& modelMatrix);
 
 	void SetPosition(const glm::vec3& position);
 	void SetRotation(const glm::vec3& rotation);
@@ -33,22 +38,22 @@ public:
 	glm::vec3 GetRotation() const;
 	glm::vec3 GetScale() const;
 
+	const glm::mat4& GetModelMatrix() const;
+
+	NodeId GetNode() const;
+
+	const GeometryHandle& GetGeometry() const;
+
 private:
-	unsigned m_numVertices;
-	unsigned m_numIndices;
-	GLuint m_vao;
-	GLuint m_vbo;
-	GLuint m_ebo;
-	glm::vec3 m_position;
-	glm::vec3 m_rotation;
-	glm::vec3 m_scale;
-	glm::mat4 m_modelMatrix;
-
-	void InitialiseBuffers(Vertex* vertexArray, GLuint* indexArray);
-	
-	void InitialiseBuffers(Primitive& primitive);
-
-	void UpdateUniforms(Shader& shader) const;
-
-	void UpdateModelMatrix();
+	SceneGraph& m_sceneGraph;
+	NodeId m_node;
+	GeometryHandle m_geometry;
+
+	// Resolved against the shader last rendered with
+	const Shader* m_uniformShader;
+	UniformHandle<glm::mat4> m_modelMatrixUniform;
+	UniformHandle<glm::vec4> m_positionScaleUniform;
+	UniformHandle<glm::vec4> m_positionBiasUniform;
+
+	void UpdateUniforms(Shader& shader, const glm::mat4& modelMatrix);
 };
@@ -0,0 +1,212 @@
+#include "MeshFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+	uint64_t AlignUp(const uint64_t value)
+	{
+		return (value + k_meshFileAlignment - 1) & ~static_cast<uint64_t>(k_meshFileAlignment - 1);
+	}
+
+	unsigned GetIndexSize(const GLenum indexType)
+	{
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+	}
+}
+
+bool MeshFile::Write(const std::string& fileName, const MeshFileContents& contents)
+{
+	const uint64_t vertexBytes = static_cast<uint64_t>(contents.m_numOfVertices) * GetVertexStride(contents.m_format);
+	const uint64_t indexBytes = static_cast<uint64_t>(contents.m_numOfIndices) * GetIndexSize(contents.m_indexType);
+	const uint64_t lodBytes = contents.m_lods.size() * sizeof(MeshFileLod);
+
+	MeshFileHeader header{};
+	header.m_magic = k_meshFileMagic;
+	header.m_version = k_meshFileVersion;
+	header.m_headerSize = sizeof(MeshFileHeader);
+	header.m_vertexFormat = static_cast<uint32_t>(contents.m_format);
+	header.m_vertexStride = GetVertexStride(contents.m_format);
+	header.m_indexType = contents.m_indexType;
+	header.m_numOfVertices = contents.m_numOfVertices;
+	header.m_numOfIndices = contents.m_numOfIndices;
+	header.m_numOfLods = static_cast<uint32_t>(contents.m_lods.size());
+	header.m_vertexOffset = AlignUp(sizeof(MeshFileHeader));
+	header.m_indexOffset = AlignUp(header.m_vertexOffset + vertexBytes);
+	header.m_lodOffset = AlignUp(header.m_indexOffset + indexBytes);
+	header.m_fileSize = header.m_lodOffset + lodBytes;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.m_boundsMin[axis] = contents.m_bounds.m_min[axis];
+		header.m_boundsMax[axis] = contents.m_bounds.m_max[axis];
+		header.m_positionScale[axis] = contents.m_dequant.m_scale[axis];
+		header.m_positionBias[axis] = contents.m_dequant.m_bias[axis];
+	}
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::MESH_FILE::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	const char padding[k_meshFileAlignment] = {};
+	uint64_t written = 0;
+
+	const auto write = [&file, &written, &padding](const void* data, const uint64_t size, const uint64_t offset)
+	{
+		file.write(padding, static_cast<std::streamsize>(offset - written));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		written = offset + size;
+	};
+
+	write(&header, sizeof(header), 0);
+	write(contents.m_vertexData, vertexBytes, header.m_vertexOffset);
+	write(contents.m_indexData, indexBytes, header.m_indexOffset);
+	write(contents.m_lods.data(), lodBytes, header.m_lodOffset);
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::MESH_FILE::COULD_NOT_WRITE_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshFile::Open(const std::string& fileName)
+{
+	Close();
+
+	if (!m_file.Open(fileName))
+	{
+		std::cout << "ERROR::MESH_FILE::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	m_header = reinterpret_cast<const MeshFileHeader*>(m_file.GetData());
+
+	if (!Validate(fileName))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshFile::Close()
+{
+	m_file.Close();
+	m_header = nullptr;
+}
+
+const MeshFileHeader& MeshFile::GetHeader() const
+{
+	return *m_header;
+}
+
+eVertexFormat MeshFile::GetFormat() const
+{
+	return static_cast<eVertexFormat>(m_header->m_vertexFormat);
+}
+
+GLenum MeshFile::GetIndexType() const
+{
+	return m_header->m_indexType;
+}
+
+AABB MeshFile::GetBounds() const
+{
+	return {
+		glm::vec3(m_header->m_boundsMin[0], m_header->m_boundsMin[1], m_header->m_boundsMin[2]),
+		glm::vec3(m_header->m_boundsMax[0], m_header->m_boundsMax[1], m_header->m_boundsMax[2])
+	};
+}
+
+PositionDequant MeshFile::GetDequant() const
+{
+	return {
+		glm::vec3(m_header->m_positionScale[0], m_header->m_positionScale[1], m_header->m_positionScale[2]),
+		glm::vec3(m_header->m_positionBias[0], m_header->m_positionBias[1], m_header->m_positionBias[2])
+	};
+}
+
+const void* MeshFile::GetVertexData() const
+{
+	return m_file.GetData() + m_header->m_vertexOffset;
+}
+
+const void* MeshFile::GetIndexData() const
+{
+	return m_file.GetData() + m_header->m_indexOffset;
+}
+
+unsigned MeshFile::GetNumOfLods() const
+{
+	return m_header->m_numOfLods;
+}
+
+const MeshFileLod& MeshFile::GetLod(const unsigned lod) const
+{
+	return reinterpret_cast<const MeshFileLod*>(m_file.GetData() + m_header->m_lodOffset)[lod];
+}
+
+bool MeshFile::Validate(const std::string& fileName) const
+{
+	const uint64_t size = m_file.GetSize();
+
+	if (size < sizeof(MeshFileHeader) || m_header->m_magic != k_meshFileMagic)
+	{
+		std::cout << "ERROR::MESH_FILE::NOT_A_MESH_FILE: " << fileName << "\n";
+		return false;
+	}
+
+	if (m_header->m_version != k_meshFileVersion || m_header->m_headerSize != sizeof(MeshFileHeader))
+	{
+		std::cout << "ERROR::MESH_FILE::VERSION_MISMATCH: " << fileName << " is version " << m_header->m_version
+			<< ", expected " << k_meshFileVersion << "\n";
+		return false;
+	}
+
+	const bool validFormat = m_header->m_vertexFormat <= static_cast<uint32_t>(eVertexFormat::e_Quantized) &&
+		m_header->m_vertexStride == GetVertexStride(static_cast<eVertexFormat>(m_header->m_vertexFormat));
+	const bool validIndexType = m_header->m_indexType == GL_UNSIGNED_SHORT || m_header->m_indexType == GL_UNSIGNED_INT;
+
+	// Every blob has to sit where the header says and be aligned, so the mapping can be used in place
+	const uint64_t vertexBytes = static_cast<uint64_t>(m_header->m_numOfVertices) * m_header->m_vertexStride;
+	const uint64_t indexBytes = static_cast<uint64_t>(m_header->m_numOfIndices) * GetIndexSize(m_header->m_indexType);
+	const uint64_t lodBytes = static_cast<uint64_t>(m_header->m_numOfLods) * sizeof(MeshFileLod);
+
+	const bool validLayout = m_header->m_fileSize == size &&
+		m_header->m_vertexOffset % k_meshFileAlignment == 0 &&
+		m_header->m_indexOffset % k_meshFileAlignment == 0 &&
+		m_header->m_lodOffset % k_meshFileAlignment == 0 &&
+		m_header->m_vertexOffset >= sizeof(MeshFileHeader) &&
+		m_header->m_indexOffset >= m_header->m_vertexOffset + vertexBytes &&
+		m_header->m_lodOffset >= m_header->m_indexOffset + indexBytes &&
+		m_header->m_lodOffset + lodBytes <= size;
+
+	if (!validFormat || !validIndexType || !validLayout || m_header->m_numOfIndices % 3 != 0)
+	{
+		std::cout << "ERROR::MESH_FILE::CORRUPT: " << fileName << "\n";
+		return false;
+	}
+
+	for (unsigned lod = 0; lod < m_header->m_numOfLods; ++lod)
+	{
+		const MeshFileLod& range = GetLod(lod);
+
+		if (static_cast<uint64_t>(range.m_firstIndex) + range.m_numOfIndices > m_header->m_numOfIndices)
+		{
+			std::cout << "ERROR::MESH_FILE::CORRUPT_LOD: " << fileName << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "VertexFormat.h"
+
+// On disk layout of a cooked mesh, little endian:
+//   MeshFileHeader
+//   vertex blob, already in the header's vertex format       (k_meshFileAlignment aligned)
+//   index blob, already in the header's index type           (k_meshFileAlignment aligned)
+//   optional MeshFileLod table, ranges into the index blob   (k_meshFileAlignment aligned)
+// Everything is stored exactly as the GeometryArena wants it, so a mapped file can be uploaded
+// straight from the mapping.
+constexpr uint32_t k_meshFileMagic = 0x48534D54;	// "TMSH"
+constexpr uint32_t k_meshFileVersion = 1;
+constexpr uint32_t k_meshFileAlignment = 64;
+
+struct MeshFileHeader
+{
+	uint32_t m_magic;
+	uint32_t m_version;
+	uint32_t m_headerSize;
+	uint32_t m_vertexFormat;
+	uint32_t m_vertexStride;
+	uint32_t m_indexType;
+	uint32_t m_numOfVertices;
+	uint32_t m_numOfIndices;
+	uint32_t m_numOfLods;
+	uint32_t m_reserved;
+	uint64_t m_vertexOffset;
+	uint64_t m_indexOffset;
+	uint64_t m_lodOffset;
+	uint64_t m_fileSize;
+	float m_boundsMin[3];
+	float m_boundsMax[3];
+	float m_positionScale[3];
+	float m_positionBias[3];
+};
+
+static_assert(sizeof(MeshFileHeader) == 120, "MeshFileHeader layout is part of the file format");
+
+// A level of detail is a range of the shared index blob, LOD 0 being the full mesh. error is the
+// object space deviation from LOD 0 the range was simplified to
+struct MeshFileLod
+{
+	uint32_t m_firstIndex;
+	uint32_t m_numOfIndices;
+	float m_error;
+	uint32_t m_reserved;
+};
+
+static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod layout is part of the file format");
+
+// What the cook step writes. The pointers are only read during Write
+struct MeshFileContents
+{
+	eVertexFormat m_format = eVertexFormat::e_Float;
+	GLenum m_indexType = GL_UNSIGNED_INT;
+	const void* m_vertexData = nullptr;
+	unsigned m_numOfVertices = 0;
+	const void* m_indexData = nullptr;
+	unsigned m_numOfIndices = 0;
+	std::vector<MeshFileLod> m_lods;
+	AABB m_bounds = AABB::Empty();
+	PositionDequant m_dequant = { glm::vec3(1.f), glm::vec3(0.f) };
+};
+
+// A mapped, validated cooked mesh. The data pointers stay valid while the MeshFile is open
+class MeshFile
+{
+public:
+	static bool Write(const std::string& fileName, const MeshFileContents& contents);
+
+	// Logs and returns false if the file is missing, from another version or inconsistent
+	bool Open(const std::string& fileName);
+
+	void Close();
+
+	const MeshFileHeader& GetHeader() const;
+
+	eVertexFormat GetFormat() const;
+	GLenum GetIndexType() const;
+	AABB GetBounds() const;
+	PositionDequant GetDequant() const;
+
+	const void* GetVertexData() const;
+	const void* GetIndexData() const;
+
+	unsigned GetNumOfLods() const;
+	const MeshFileLod& GetLod(unsigned lod) const;
+
+private:
+	MappedFile m_file;
+	const MeshFileHeader* m_header = nullptr;
+
+	bool Validate(const std::string& fileName) const;
+};
@@ -0,0 +1,460 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Forsyth's scoring constants, from "Linear-Speed Vertex Cache Optimisation"
+	constexpr float k_cacheDecayPower = 1.5f;
+	constexpr float k_lastTriangleScore = 0.75f;
+	constexpr float k_valenceBoostScale = 2.f;
+	constexpr float k_valenceBoostPower = 0.5f;
+	constexpr unsigned k_maxScoredValence = 32;
+
+	float ScoreVertex(const int cachePosition, const unsigned remainingTriangles, const unsigned cacheSize)
+	{
+		if (remainingTriangles == 0)
+			return -1.f;
+
+		float score = 0.f;
+
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// The last triangle's vertices get a fixed score so the next triangle doesn't just
+				// reuse the same edge and strip off into a thin line
+				score = k_lastTriangleScore;
+			} else
+			{
+				const float scaler = 1.f / static_cast<float>(cacheSize - 3);
+				score = std::pow(1.f - static_cast<float>(cachePosition - 3) * scaler, k_cacheDecayPower);
+			}
+		}
+
+		// Favour vertices with few triangles left so lone triangles don't get stranded
+		const unsigned valence = std::min(remainingTriangles, k_maxScoredValence);
+		score += k_valenceBoostScale * std::pow(static_cast<float>(valence), -k_valenceBoostPower);
+
+		return score;
+	}
+
+	struct VertexHasher
+	{
+		const Vertex* m_vertices;
+
+		size_t operator()(const unsigned index) const
+		{
+			// FNV-1a over the raw floats
+			uint64_t hash = 14695981039346656037ull;
+			const auto* bytes = reinterpret_cast<const unsigned char*>(&m_vertices[index]);
+			for (size_t i = 0; i < sizeof(Vertex); ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	struct VertexEqual
+	{
+		const Vertex* m_vertices;
+
+		bool operator()(const unsigned a, const unsigned b) const
+		{
+			return std::memcmp(&m_vertices[a], &m_vertices[b], sizeof(Vertex)) == 0;
+		}
+	};
+}
+
+void MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	Weld(vertices, indices);
+	OptimizeVertexCache(indices, static_cast<unsigned>(vertices.size()));
+	OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+}
+
+void MeshOptimizer::Weld(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	const unsigned numOfVertices = static_cast<unsigned>(vertices.size());
+
+	if (indices.empty())
+	{
+		indices.resize(numOfVertices);
+		std::iota(indices.begin(), indices.end(), 0);
+	}
+
+	std::unordered_map<unsigned, unsigned, VertexHasher, VertexEqual> firstOfVertex(
+		numOfVertices, VertexHasher{ vertices.data() }, VertexEqual{ vertices.data() });
+
+	std::vector<GLuint> remap(numOfVertices);
+	std::vector<Vertex> welded;
+	welded.reserve(numOfVertices);
+
+	for (unsigned i = 0; i < numOfVertices; ++i)
+	{
+		const auto inserted = firstOfVertex.emplace(i, static_cast<unsigned>(welded.size()));
+
+		if (inserted.second)
+		{
+			welded.push_back(vertices[i]);
+		}
+
+		remap[i] = inserted.first->second;
+	}
+
+	for (GLuint& index : indices)
+	{
+		index = remap[index];
+	}
+
+	vertices.swap(welded);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<GLuint>& indices, const unsigned numOfVertices)
+{
+	const unsigned numOfTriangles = static_cast<unsigned>(indices.size() / 3);
+
+	if (numOfTriangles == 0)
+		return;
+
+	// Triangle adjacency of every vertex, packed into one array
+	std::vector<unsigned> remaining(numOfVertices, 0);
+	for (const GLuint index : indices)
+	{
+		remaining[index]++;
+	}
+
+	std::vector<unsigned> adjacencyStart(numOfVertices + 1, 0);
+	for (unsigned v = 0; v < numOfVertices; ++v)
+	{
+		adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+	}
+
+	std::vector<unsigned> adjacency(indices.size());
+	std::vector<unsigned> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (unsigned triangle = 0; triangle < numOfTriangles; ++triangle)
+	{
+		for (unsigned corner = 0; corner < 3; ++corner)
+		{
+			adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+		}
+	}
+
+	std::vector<int> cachePosition(numOfVertices, -1);
+	std::vector<float> vertexScore(numOfVertices);
+	for (unsigned v = 0; v < numOfVertices; ++v)
+	{
+		vertexScore[v] = ScoreVertex(-1, remaining[v], k_forsythCacheSize);
+	}
+
+	std::vector<float> triangleScore(numOfTriangles);
+	std::vector<uint8_t> emitted(numOfTriangles, 0);
+	for (unsigned triangle = 0; triangle < numOfTriangles; ++triangle)
+	{
+		triangleScore[triangle] = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] + vertexScore[indices[triangle * 3 + 2]];
+	}
+
+	// LRU cache with room for the three vertices pushed in before the oldest fall out
+	std::vector<GLuint> cache;
+	std::vector<GLuint> nextCache;
+	cache.reserve(k_forsythCacheSize + 3);
+	nextCache.reserve(k_forsythCacheSize + 3);
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+
+	unsigned scanStart = 0;
+	unsigned bestTriangle = ~0u;
+
+	for (unsigned emittedCount = 0; emittedCount < numOfTriangles; ++emittedCount)
+	{
+		if (bestTriangle == ~0u)
+		{
+			// Nothing in the cache has triangles left, fall back to the best remaining one. Scores
+			// of untouched triangles never rise, so the scan start only moves forwards
+			float bestScore = -1.f;
+			while (scanStart < numOfTriangles && emitted[scanStart])
+			{
+				scanStart++;
+			}
+
+			for (unsigned triangle = scanStart; triangle < numOfTriangles; ++triangle)
+			{
+				if (!emitted[triangle] && triangleScore[triangle] > bestScore)
+				{
+					bestScore = triangleScore[triangle];
+					bestTriangle = triangle;
+				}
+			}
+		}
+
+		emitted[bestTriangle] = 1;
+
+		nextCache.clear();
+
+		for (unsigned corner = 0; corner < 3; ++corner)
+		{
+			const GLuint vertex = indices[bestTriangle * 3 + corner];
+			output.push_back(vertex);
+			nextCache.push_back(vertex);
+
+			// Drop the triangle from the vertex's adjacency
+			unsigned* first = &adjacency[adjacencyStart[vertex]];
+			unsigned* last = first + remaining[vertex];
+			*std::find(first, last, bestTriangle) = *(last - 1);
+			remaining[vertex]--;
+		}
+
+		for (const GLuint vertex : cache)
+		{
+			if (vertex != nextCache[0] && vertex != nextCache[1] && vertex != nextCache[2])
+			{
+				nextCache.push_back(vertex);
+			}
+		}
+
+		// Vertices that fell out of the cache lose their cache score
+		for (size_t i = k_forsythCacheSize; i < nextCache.size(); ++i)
+		{
+			cachePosition[nextCache[i]] = -1;
+			vertexScore[nextCache[i]] = ScoreVertex(-1, remaining[nextCache[i]], k_forsythCacheSize);
+		}
+
+		nextCache.resize(std::min<size_t>(nextCache.size(), k_forsythCacheSize));
+		cache.swap(nextCache);
+
+		for (unsigned position = 0; position < cache.size(); ++position)
+		{
+			cachePosition[cache[position]] = static_cast<int>(position);
+			vertexScore[cache[position]] = ScoreVertex(static_cast<int>(position), remaining[cache[position]], k_forsythCacheSize);
+		}
+
+		// Only triangles touching the cache changed score, the best of them goes next
+		bestTriangle = ~0u;
+		float bestScore = -1.f;
+
+		for (const GLuint vertex : cache)
+		{
+			for (unsigned i = adjacencyStart[vertex]; i < adjacencyStart[vertex] + remaining[vertex]; ++i)
+			{
+				const unsigned triangle = adjacency[i];
+				const float score = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] + vertexScore[indices[triangle * 3 + 2]];
+				triangleScore[triangle] = score;
+
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = triangle;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices, const float threshold)
+{
+	const unsigned numOfTriangles = static_cast<unsigned>(indices.size() / 3);
+	const unsigned numOfVertices = static_cast<unsigned>(vertices.size());
+
+	if (numOfTriangles < 2)
+		return;
+
+	// Hard boundaries: every triangle whose three vertices all miss the cache starts a cluster,
+	// the cache has effectively been flushed there so cutting costs nothing
+	std::vector<unsigned> hardClusters;
+	{
+		std::vector<unsigned> timestamps(numOfVertices, 0);
+		unsigned time = k_overdrawCacheSize + 1;
+
+		for (unsigned triangle = 0; triangle < numOfTriangles; ++triangle)
+		{
+			unsigned misses = 0;
+			for (unsigned corner = 0; corner < 3; ++corner)
+			{
+				const GLuint vertex = indices[triangle * 3 + corner];
+				if (time - timestamps[vertex] > k_overdrawCacheSize)
+				{
+					timestamps[vertex] = time++;
+					misses++;
+				}
+			}
+
+			if (triangle == 0 || misses == 3)
+			{
+				hardClusters.push_back(triangle);
+			}
+		}
+	}
+
+	// Soft boundaries: split a hard cluster further wherever the ACMR so far is within threshold
+	// of the whole cluster's, so reordering costs little cache efficiency
+	std::vector<unsigned> clusters;
+	{
+		std::vector<unsigned> timestamps(numOfVertices, 0);
+		unsigned time = 0;
+
+		for (size_t cluster = 0; cluster < hardClusters.size(); ++cluster)
+		{
+			const unsigned start = hardClusters[cluster];
+			const unsigned end = cluster + 1 < hardClusters.size() ? hardClusters[cluster + 1] : numOfTriangles;
+
+			const float clusterAcmr = AnalyzeVertexCache(&indices[start * 3], (end - start) * 3, numOfVertices, k_overdrawCacheSize).m_acmr;
+
+			// Fresh cache for every cluster
+			time += k_overdrawCacheSize + 1;
+			unsigned clusterStart = start;
+			unsigned misses = 0;
+
+			clusters.push_back(start);
+
+			for (unsigned triangle = start; triangle < end; ++triangle)
+			{
+				for (unsigned corner = 0; corner < 3; ++corner)
+				{
+					const GLuint vertex = indices[triangle * 3 + corner];
+					if (time - timestamps[vertex] > k_overdrawCacheSize)
+					{
+						timestamps[vertex] = time++;
+						misses++;
+					}
+				}
+
+				const float acmr = static_cast<float>(misses) / static_cast<float>(triangle - clusterStart + 1);
+
+				if (triangle + 1 < end && acmr <= clusterAcmr * threshold)
+				{
+					clusters.push_back(triangle + 1);
+					clusterStart = triangle + 1;
+					misses = 0;
+					time += k_overdrawCacheSize + 1;
+				}
+			}
+		}
+	}
+
+	// Sort clusters so those facing away from the mesh centre draw first, they tend to occlude
+	// the inward facing ones behind them
+	glm::vec3 meshCentroid(0.f);
+	for (const Vertex& vertex : vertices)
+	{
+		meshCentroid += vertex.m_position;
+	}
+	meshCentroid = meshCentroid / static_cast<float>(std::max(numOfVertices, 1u));
+
+	const unsigned numOfClusters = static_cast<unsigned>(clusters.size());
+	std::vector<float> sortKeys(numOfClusters);
+
+	for (unsigned cluster = 0; cluster < numOfClusters; ++cluster)
+	{
+		const unsigned start = clusters[cluster];
+		const unsigned end = cluster + 1 < numOfClusters ? clusters[cluster + 1] : numOfTriangles;
+
+		glm::vec3 centroid(0.f);
+		glm::vec3 normal(0.f);
+		float area = 0.f;
+
+		for (unsigned triangle = start; triangle < end; ++triangle)
+		{
+			const glm::vec3& a = vertices[indices[triangle * 3]].m_position;
+			const glm::vec3& b = vertices[indices[triangle * 3 + 1]].m_position;
+			const glm::vec3& c = vertices[indices[triangle * 3 + 2]].m_position;
+
+			// Cross product length is twice the area, so summing it area-weights both terms
+			const glm::vec3 faceNormal = glm::cross(b - a, c - a);
+			const float faceArea = glm::length(faceNormal);
+
+			centroid += (a + b + c) * (faceArea / 3.f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		if (area > 0.f)
+		{
+			centroid = centroid / area;
+		}
+
+		const float normalLength = glm::length(normal);
+		sortKeys[cluster] = normalLength > 0.f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.f;
+	}
+
+	std::vector<unsigned> order(numOfClusters);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](const unsigned a, const unsigned b)
+	{
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+
+	for (const unsigned cluster : order)
+	{
+		const unsigned start = clusters[cluster];
+		const unsigned end = cluster + 1 < numOfClusters ? clusters[cluster + 1] : numOfTriangles;
+
+		output.insert(output.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices)
+{
+	std::vector<GLuint> remap(vertices.size(), ~0u);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (GLuint& index : indices)
+	{
+		if (remap[index] == ~0u)
+		{
+			remap[index] = static_cast<GLuint>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const GLuint* indices, const unsigned numOfIndices, const unsigned numOfVertices, const unsigned cacheSize)
+{
+	VertexCacheStats stats;
+
+	if (numOfIndices == 0 || numOfVertices == 0)
+		return stats;
+
+	// A vertex is still cached if fewer than cacheSize misses happened since it was loaded,
+	// which is exactly FIFO without keeping the queue
+	std::vector<unsigned> timestamps(numOfVertices, 0);
+	unsigned time = cacheSize + 1;
+
+	for (unsigned i = 0; i < numOfIndices; ++i)
+	{
+		const GLuint vertex = indices[i];
+
+		if (time - timestamps[vertex] > cacheSize)
+		{
+			timestamps[vertex] = time++;
+			stats.m_vertexTransforms++;
+		}
+	}
+
+	stats.m_acmr = static_cast<float>(stats.m_vertexTransforms) / static_cast<float>(numOfIndices / 3);
+	stats.m_atvr = static_cast<float>(stats.m_vertexTransforms) / static_cast<float>(numOfVertices);
+
+	return stats;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <gl/glew.h>
+
+#include "Vertex.h"
+
+struct VertexCacheStats
+{
+	unsigned m_vertexTransforms = 0;
+	float m_acmr = 0.f;	// Transforms per triangle, 0.5 is the limit for a regular grid
+	float m_atvr = 0.f;	// Transforms per vertex, 1.0 is perfect
+};
+
+// Pre-upload optimisation of triangle lists, run in this order by Optimize():
+//   Weld                -> index buffer with bitwise-identical vertices merged
+//   OptimizeVertexCache -> Forsyth's linear-speed triangle order for the post-transform cache
+//   OptimizeOverdraw    -> reorders cache friendly clusters so outward facing ones draw first
+//   OptimizeVertexFetch -> vertices in first-use order, unreferenced ones dropped
+class MeshOptimizer
+{
+public:
+	static void Optimize(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	// Non-indexed input (empty indices) is treated as 0..n-1
+	static void Weld(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	static void OptimizeVertexCache(std::vector<GLuint>& indices, unsigned numOfVertices);
+
+	// Threshold is how much worse than the input's ACMR the reordered result may get
+	static void OptimizeOverdraw(std::vector<GLuint>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+	static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<GLuint>& indices);
+
+	// Simulates a FIFO post-transform cache
+	static VertexCacheStats AnalyzeVertexCache(const GLuint* indices, unsigned numOfIndices, unsigned numOfVertices, unsigned cacheSize = 16);
+
+private:
+	static constexpr unsigned k_forsythCacheSize = 32;
+	static constexpr unsigned k_overdrawCacheSize = 16;
+};
@@ -0,0 +1,368 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	constexpr float k_pi = 3.14159265358979f;
+
+	// Rows handed to a worker at a time are at least this many texels
+	constexpr unsigned k_texelsPerTask = 1 << 15;
+
+	// Linear to sRGB goes through a table this fine, enough that the darkest codes still get
+	// steps of their own
+	constexpr int k_encodeTableSize = 1 << 14;
+
+	float SrgbToLinear(const float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(const float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+	}
+
+	struct ConversionTables
+	{
+		float m_decode[2][256];	// [srgb][byte]
+		unsigned char m_encode[k_encodeTableSize + 1];
+
+		ConversionTables()
+		{
+			for (int i = 0; i < 256; ++i)
+			{
+				m_decode[0][i] = i / 255.f;
+				m_decode[1][i] = SrgbToLinear(i / 255.f);
+			}
+
+			for (int i = 0; i <= k_encodeTableSize; ++i)
+			{
+				m_encode[i] = static_cast<unsigned char>(LinearToSrgb(static_cast<float>(i) / k_encodeTableSize) * 255.f + 0.5f);
+			}
+		}
+	};
+
+	const ConversionTables& GetTables()
+	{
+		static const ConversionTables tables;
+		return tables;
+	}
+
+	// Modified Bessel function of the first kind, order zero
+	float BesselI0(const float x)
+	{
+		float sum = 1.f;
+		float term = 1.f;
+		const float halfSquared = x * x * 0.25f;
+
+		for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+		{
+			term *= halfSquared / static_cast<float>(k * k);
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	// t is the distance from the destination texel centre, in destination texels
+	float EvaluateFilter(const eMipFilter filter, const float t)
+	{
+		const float distance = std::abs(t);
+
+		if (filter == eMipFilter::e_Box)
+			return distance <= 0.5f ? 1.f : 0.f;
+
+		const float width = MipGenerator::k_kaiserWidth;
+		const float alpha = MipGenerator::k_kaiserAlpha;
+
+		if (distance >= width)
+			return 0.f;
+
+		const float sinc = distance < 1e-5f ? 1.f : std::sin(k_pi * distance) / (k_pi * distance);
+		const float ratio = distance / width;
+
+		return sinc * BesselI0(alpha * std::sqrt(1.f - ratio * ratio)) / BesselI0(alpha);
+	}
+
+	float GetFilterRadius(const eMipFilter filter)
+	{
+		return filter == eMipFilter::e_Box ? 0.5f : MipGenerator::k_kaiserWidth;
+	}
+
+	// Source indices and normalised weights for every destination texel along one axis, all padded
+	// to the same number of taps. Edges clamp, and indices never go down from one tap to the next
+	struct Taps
+	{
+		int m_numOfTaps;
+		std::vector<int> m_indices;
+		std::vector<float> m_weights;
+	};
+
+	Taps MakeTaps(const eMipFilter filter, const int sourceSize, const int destinationSize)
+	{
+		Taps taps;
+
+		if (sourceSize == destinationSize)
+		{
+			taps.m_numOfTaps = 1;
+			taps.m_indices.resize(destinationSize);
+			taps.m_weights.assign(destinationSize, 1.f);
+
+			for (int i = 0; i < destinationSize; ++i)
+			{
+				taps.m_indices[i] = i;
+			}
+
+			return taps;
+		}
+
+		const float scale = static_cast<float>(sourceSize) / destinationSize;
+		const float support = GetFilterRadius(filter) * scale;
+
+		// Only the taps with any weight are kept, the window usually has a zero at one end
+		std::vector<std::vector<std::pair<int, float>>> kept(destinationSize);
+		taps.m_numOfTaps = 1;
+
+		for (int i = 0; i < destinationSize; ++i)
+		{
+			const float centre = (i + 0.5f) * scale;
+			const int first = static_cast<int>(std::floor(centre - support));
+			const int last = static_cast<int>(std::ceil(centre + support));
+			float total = 0.f;
+
+			for (int source = first; source <= last; ++source)
+			{
+				const float weight = EvaluateFilter(filter, (source + 0.5f - centre) / scale);
+
+				if (weight != 0.f)
+				{
+					kept[i].emplace_back(std::min(std::max(source, 0), sourceSize - 1), weight);
+					total += weight;
+				}
+			}
+
+			for (auto& tap : kept[i])
+			{
+				tap.second /= total;
+			}
+
+			taps.m_numOfTaps = std::max(taps.m_numOfTaps, static_cast<int>(kept[i].size()));
+		}
+
+		taps.m_indices.resize(static_cast<size_t>(destinationSize) * taps.m_numOfTaps);
+		taps.m_weights.resize(static_cast<size_t>(destinationSize) * taps.m_numOfTaps);
+
+		for (int i = 0; i < destinationSize; ++i)
+		{
+			int* indices = &taps.m_indices[static_cast<size_t>(i) * taps.m_numOfTaps];
+			float* weights = &taps.m_weights[static_cast<size_t>(i) * taps.m_numOfTaps];
+
+			for (int tap = 0; tap < taps.m_numOfTaps; ++tap)
+			{
+				const bool padding = tap >= static_cast<int>(kept[i].size());
+				indices[tap] = padding ? kept[i].back().first : kept[i][tap].first;
+				weights[tap] = padding ? 0.f : kept[i][tap].second;
+			}
+		}
+
+		return taps;
+	}
+
+	// output = sum of weight * row over the taps, across a whole row of floats. source starts at
+	// row firstRow
+	void FilterVertical(const float* source, const int firstRow, const size_t rowFloats, const int* indices, const float* weights,
+		const int numOfTaps, float* output)
+	{
+		size_t i = 0;
+
+#if defined(__AVX2__)
+		for (; i + 8 <= rowFloats; i += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+
+			for (int tap = 0; tap < numOfTaps; ++tap)
+			{
+				const __m256 row = _mm256_loadu_ps(source + static_cast<size_t>(indices[tap] - firstRow) * rowFloats + i);
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(row, _mm256_set1_ps(weights[tap])));
+			}
+
+			_mm256_storeu_ps(output + i, sum);
+		}
+#endif
+
+		for (; i + 4 <= rowFloats; i += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+
+			for (int tap = 0; tap < numOfTaps; ++tap)
+			{
+				const __m128 row = _mm_loadu_ps(source + static_cast<size_t>(indices[tap] - firstRow) * rowFloats + i);
+				sum = _mm_add_ps(sum, _mm_mul_ps(row, _mm_set1_ps(weights[tap])));
+			}
+
+			_mm_storeu_ps(output + i, sum);
+		}
+	}
+
+	// A texel is four floats, so each tap is one SSE multiply-add. The result is clamped, Kaiser
+	// lobes can overshoot
+	void FilterHorizontal(const float* row, const Taps& taps, const int width, float* output)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.f);
+
+		for (int x = 0; x < width; ++x)
+		{
+			const int* indices = &taps.m_indices[static_cast<size_t>(x) * taps.m_numOfTaps];
+			const float* weights = &taps.m_weights[static_cast<size_t>(x) * taps.m_numOfTaps];
+
+			__m128 sum = _mm_setzero_ps();
+
+			for (int tap = 0; tap < taps.m_numOfTaps; ++tap)
+			{
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + static_cast<size_t>(indices[tap]) * 4), _mm_set1_ps(weights[tap])));
+			}
+
+			_mm_storeu_ps(output + static_cast<size_t>(x) * 4, _mm_min_ps(_mm_max_ps(sum, zero), one));
+		}
+	}
+
+	void Decode(const unsigned char* rgba, const size_t numOfTexels, const bool srgb, float* output)
+	{
+		const ConversionTables& tables = GetTables();
+
+		for (size_t i = 0; i < numOfTexels * 4; i += 4)
+		{
+			output[i] = tables.m_decode[srgb][rgba[i]];
+			output[i + 1] = tables.m_decode[srgb][rgba[i + 1]];
+			output[i + 2] = tables.m_decode[srgb][rgba[i + 2]];
+			output[i + 3] = tables.m_decode[0][rgba[i + 3]];
+		}
+	}
+
+	void Encode(const float* linear, const size_t numOfTexels, const bool srgb, unsigned char* output)
+	{
+		const ConversionTables& tables = GetTables();
+
+		for (size_t i = 0; i < numOfTexels; ++i)
+		{
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				const float value = linear[i * 4 + channel];
+				output[i * 4 + channel] = srgb ?
+					tables.m_encode[static_cast<int>(value * k_encodeTableSize + 0.5f)] :
+					static_cast<unsigned char>(value * 255.f + 0.5f);
+			}
+
+			output[i * 4 + 3] = static_cast<unsigned char>(linear[i * 4 + 3] * 255.f + 0.5f);
+		}
+	}
+
+	// Calls function with strips of at most k_texelsPerTask source texels' worth of rows, spread over
+	// the thread pool when there is more than one
+	void ForEachRowRange(ThreadPool* threadPool, const int numOfRows, const int rowTexels, const std::function<void(unsigned, unsigned)>& function)
+	{
+		const unsigned grain = std::max(1u, k_texelsPerTask / static_cast<unsigned>(std::max(rowTexels, 1)));
+
+		const auto strips = [&](const unsigned begin, const unsigned end)
+		{
+			for (unsigned strip = begin; strip < end; strip += grain)
+			{
+				function(strip, std::min(strip + grain, end));
+			}
+		};
+
+		if (threadPool)
+		{
+			threadPool->ParallelFor(static_cast<unsigned>(numOfRows), grain, strips);
+		} else
+		{
+			strips(0, static_cast<unsigned>(numOfRows));
+		}
+	}
+}
+
+void MipGenerator::Generate(const unsigned char* rgba, int width, int height, const eMipFilter filter, const bool srgb,
+	std::vector<MipLevel>& chain, ThreadPool* threadPool)
+{
+	ProfileScope scope("MipGenerator::Generate");
+
+	chain.clear();
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	chain.reserve(GetNumOfLevels(width, height) - 1);
+
+	const unsigned char* source = rgba;
+
+	while (width > 1 || height > 1)
+	{
+		const int outWidth = std::max(width / 2, 1);
+		const int outHeight = std::max(height / 2, 1);
+
+		const Taps horizontal = MakeTaps(filter, width, outWidth);
+		const Taps vertical = MakeTaps(filter, height, outHeight);
+
+		MipLevel level;
+		level.m_width = outWidth;
+		level.m_height = outHeight;
+		level.m_pixels.resize(static_cast<size_t>(outWidth) * outHeight * 4);
+
+		ForEachRowRange(threadPool, outHeight, width, [&](const unsigned begin, const unsigned end)
+		{
+			// Only the source rows this range reads are decoded, so a level never exists as float
+			// all at once
+			const int firstRow = vertical.m_indices[static_cast<size_t>(begin) * vertical.m_numOfTaps];
+			const int lastRow = vertical.m_indices[static_cast<size_t>(end) * vertical.m_numOfTaps - 1];
+			const size_t rowFloats = static_cast<size_t>(width) * 4;
+
+			std::vector<float> rows(static_cast<size_t>(lastRow - firstRow + 1) * rowFloats);
+			Decode(source + static_cast<size_t>(firstRow) * rowFloats, static_cast<size_t>(lastRow - firstRow + 1) * width, srgb, rows.data());
+
+			std::vector<float> row(rowFloats);
+			std::vector<float> output(static_cast<size_t>(outWidth) * 4);
+
+			for (unsigned y = begin; y < end; ++y)
+			{
+				FilterVertical(rows.data(), firstRow, rowFloats, &vertical.m_indices[static_cast<size_t>(y) * vertical.m_numOfTaps],
+					&vertical.m_weights[static_cast<size_t>(y) * vertical.m_numOfTaps], vertical.m_numOfTaps, row.data());
+
+				FilterHorizontal(row.data(), horizontal, outWidth, output.data());
+				Encode(output.data(), static_cast<size_t>(outWidth), srgb, &level.m_pixels[static_cast<size_t>(y) * outWidth * 4]);
+			}
+		});
+
+		chain.push_back(std::move(level));
+
+		// Moving the level keeps its buffer where it was
+		source = chain.back().m_pixels.data();
+		width = outWidth;
+		height = outHeight;
+	}
+}
+
+int MipGenerator::GetNumOfLevels(const int width, const int height)
+{
+	int levels = 1;
+	int size = std::max(width, height);
+
+	while (size > 1)
+	{
+		size /= 2;
+		levels++;
+	}
+
+	return levels;
+}
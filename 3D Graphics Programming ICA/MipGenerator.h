@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+
+class ThreadPool;
+
+enum class eMipFilter { e_Box, e_Kaiser };
+
+struct MipLevel
+{
+	int m_width;
+	int m_height;
+	std::vector<unsigned char> m_pixels;
+};
+
+// Builds RGBA8 mip chains on the CPU, so the result doesn't depend on the driver and can be made
+// off the render thread or in a cook step. Each level is filtered from the one above with
+// separable kernels whose taps are worked out once per level: a vertical pass across whole rows
+// (8 floats at a time with AVX2), then a horizontal pass a texel at a time. Strips of rows are
+// spread across the thread pool, each decoding just the source rows it reads to float. Colour
+// images are filtered in linear light, so sRGB data gets decoded before and encoded after, alpha
+// is always linear.
+class MipGenerator
+{
+public:
+	// Kaiser windowed sinc, in destination texels
+	static constexpr float k_kaiserWidth = 3.f;
+	static constexpr float k_kaiserAlpha = 4.f;
+
+	// Fills chain with every level below level 0, down to 1x1
+	static void Generate(const unsigned char* rgba, int width, int height, eMipFilter filter, bool srgb,
+		std::vector<MipLevel>& chain, ThreadPool* threadPool = nullptr);
+
+	// Including level 0
+	static int GetNumOfLevels(int width, int height);
+};
@@ -0,0 +1,646 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	constexpr int k_missingIndex = -1;
+
+	enum eRelativeFlags : uint8_t
+	{
+		e_RelativePosition = 1 << 0,
+		e_RelativeTexcoord = 1 << 1,
+		e_RelativeNormal = 1 << 2
+	};
+
+	// Indices as parsed. Absolute ones are already zero based, relative ones are counted from the
+	// start of their chunk and get the chunk's offset added once every chunk has been counted
+	struct ObjCorner
+	{
+		int m_position;
+		int m_texcoord;
+		int m_normal;
+		uint8_t m_relative;
+	};
+
+	struct ObjChunk
+	{
+		const char* m_begin;
+		const char* m_end;
+
+		std::vector<glm::vec3> m_positions;
+		std::vector<glm::vec3> m_colours;
+		std::vector<glm::vec2> m_texcoords;
+		std::vector<glm::vec3> m_normals;
+
+		// Three per triangle
+		std::vector<ObjCorner> m_corners;
+
+		unsigned m_malformedLines = 0;
+	};
+
+	// Exact powers of ten, every one of these is representable in a double
+	constexpr double k_powersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	bool IsDigit(const char c)
+	{
+		return static_cast<unsigned>(c - '0') < 10u;
+	}
+
+	bool IsSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	void SkipSpaces(const char*& cursor, const char* end)
+	{
+		while (cursor < end && IsSpace(*cursor))
+		{
+			++cursor;
+		}
+	}
+
+	void SkipLine(const char*& cursor, const char* end)
+	{
+		while (cursor < end && *cursor != '\n')
+		{
+			++cursor;
+		}
+
+		if (cursor < end)
+		{
+			++cursor;
+		}
+	}
+
+	bool ParseInt(const char*& cursor, const char* end, int& value)
+	{
+		const char* start = cursor;
+		bool negative = false;
+
+		if (cursor < end && (*cursor == '-' || *cursor == '+'))
+		{
+			negative = *cursor == '-';
+			++cursor;
+		}
+
+		if (cursor == end || !IsDigit(*cursor))
+		{
+			cursor = start;
+			return false;
+		}
+
+		int64_t result = 0;
+		while (cursor < end && IsDigit(*cursor))
+		{
+			result = std::min<int64_t>(result * 10 + (*cursor - '0'), INT32_MAX);
+			++cursor;
+		}
+
+		value = static_cast<int>(negative ? -result : result);
+
+		return true;
+	}
+
+	// Reads up to count floats, returns how many there were
+	unsigned ParseFloats(const char*& cursor, const char* end, float* values, const unsigned count)
+	{
+		unsigned parsed = 0;
+
+		while (parsed < count)
+		{
+			SkipSpaces(cursor, end);
+
+			if (!ObjLoader::ParseFloat(cursor, end, values[parsed]))
+				break;
+
+			parsed++;
+		}
+
+		return parsed;
+	}
+
+	// One v/vt/vn corner of a face. Missing texcoords and normals stay k_missingIndex
+	bool ParseCorner(const char*& cursor, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+	{
+		corner = { k_missingIndex, k_missingIndex, k_missingIndex, 0 };
+
+		const auto resolve = [&corner](const int index, const size_t localCount, int& result, const uint8_t relativeFlag)
+		{
+			if (index > 0)
+			{
+				result = index - 1;
+			} else
+			{
+				result = static_cast<int>(localCount) + index;
+				corner.m_relative |= relativeFlag;
+			}
+		};
+
+		int index = 0;
+
+		if (!ParseInt(cursor, end, index) || index == 0)
+			return false;
+
+		resolve(index, chunk.m_positions.size(), corner.m_position, e_RelativePosition);
+
+		if (cursor < end && *cursor == '/')
+		{
+			++cursor;
+
+			// v//vn has no texcoord
+			if (ParseInt(cursor, end, index))
+			{
+				if (index == 0)
+					return false;
+
+				resolve(index, chunk.m_texcoords.size(), corner.m_texcoord, e_RelativeTexcoord);
+			}
+
+			if (cursor < end && *cursor == '/')
+			{
+				++cursor;
+
+				if (!ParseInt(cursor, end, index) || index == 0)
+					return false;
+
+				resolve(index, chunk.m_normals.size(), corner.m_normal, e_RelativeNormal);
+			}
+		}
+
+		return true;
+	}
+
+	void ParseChunk(ObjChunk& chunk)
+	{
+		const char* cursor = chunk.m_begin;
+		const char* end = chunk.m_end;
+
+		float values[6];
+
+		while (cursor < end)
+		{
+			SkipSpaces(cursor, end);
+
+			if (cursor + 1 >= end)
+				break;
+
+			if (cursor[0] == 'v' && IsSpace(cursor[1]))
+			{
+				cursor += 2;
+
+				// x y z [w] or x y z r g b
+				const unsigned count = ParseFloats(cursor, end, values, 6);
+
+				if (count < 3)
+				{
+					chunk.m_malformedLines++;
+				}
+
+				chunk.m_positions.emplace_back(values[0], count > 1 ? values[1] : 0.f, count > 2 ? values[2] : 0.f);
+				chunk.m_colours.push_back(count == 6 ? glm::vec3(values[3], values[4], values[5]) : glm::vec3(1.f));
+			} else if (cursor[0] == 'v' && cursor[1] == 't')
+			{
+				cursor += 2;
+
+				const unsigned count = ParseFloats(cursor, end, values, 2);
+
+				if (count == 0)
+				{
+					chunk.m_malformedLines++;
+				}
+
+				chunk.m_texcoords.emplace_back(count > 0 ? values[0] : 0.f, count > 1 ? values[1] : 0.f);
+			} else if (cursor[0] == 'v' && cursor[1] == 'n')
+			{
+				cursor += 2;
+
+				if (ParseFloats(cursor, end, values, 3) < 3)
+				{
+					chunk.m_malformedLines++;
+					values[0] = values[1] = values[2] = 0.f;
+				}
+
+				chunk.m_normals.emplace_back(values[0], values[1], values[2]);
+			} else if (cursor[0] == 'f' && IsSpace(cursor[1]))
+			{
+				cursor += 2;
+
+				// Fan the polygon out from its first corner
+				ObjCorner first{};
+				ObjCorner previous{};
+				ObjCorner corner{};
+				unsigned numOfCorners = 0;
+				bool malformed = false;
+
+				while (true)
+				{
+					SkipSpaces(cursor, end);
+
+					if (cursor == end || *cursor == '\n' || *cursor == '#')
+						break;
+
+					if (!ParseCorner(cursor, end, chunk, corner))
+					{
+						malformed = true;
+						break;
+					}
+
+					if (numOfCorners == 0)
+					{
+						first = corner;
+					} else if (numOfCorners >= 2)
+					{
+						chunk.m_corners.push_back(first);
+						chunk.m_corners.push_back(previous);
+						chunk.m_corners.push_back(corner);
+					}
+
+					previous = corner;
+					numOfCorners++;
+				}
+
+				if (malformed || numOfCorners < 3)
+				{
+					chunk.m_malformedLines++;
+				}
+			}
+
+			SkipLine(cursor, end);
+		}
+	}
+
+	struct CornerKey
+	{
+		unsigned m_position;
+		unsigned m_texcoord;
+		unsigned m_normal;
+
+		bool operator==(const CornerKey& other) const
+		{
+			return m_position == other.m_position && m_texcoord == other.m_texcoord && m_normal == other.m_normal;
+		}
+	};
+
+	uint64_t HashCorner(const CornerKey& key)
+	{
+		uint64_t hash = key.m_position * 0x9E3779B97F4A7C15ull;
+		hash ^= (key.m_texcoord + 0x632BE59BD9B4E019ull + (hash << 6) + (hash >> 2));
+		hash ^= (key.m_normal * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2));
+		return hash ^ (hash >> 29);
+	}
+}
+
+bool ObjLoader::Load(const std::string& fileName, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+	ThreadPool* pool, ObjLoadStats* stats)
+{
+	MappedFile file;
+
+	if (!file.Open(fileName))
+	{
+		std::cout << "ERROR::OBJ_LOADER::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+		vertices.clear();
+		indices.clear();
+		return false;
+	}
+
+	if (!Parse(file.GetData(), file.GetSize(), vertices, indices, pool, stats))
+	{
+		std::cout << "ERROR::OBJ_LOADER::COULD_NOT_LOAD: " << fileName << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool ObjLoader::Parse(const char* data, const size_t size, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+	ThreadPool* pool, ObjLoadStats* stats)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	vertices.clear();
+	indices.clear();
+
+	// Split into chunks that each start at the beginning of a line
+	const size_t numOfThreads = pool ? pool->GetThreadCount() + 1 : 1;
+	const size_t numOfChunks = std::max<size_t>(1, std::min(numOfThreads * k_chunksPerThread, size / k_minChunkBytes));
+
+	std::vector<ObjChunk> chunks(numOfChunks);
+	const char* end = data + size;
+	const char* chunkStart = data;
+
+	for (size_t i = 0; i < numOfChunks; ++i)
+	{
+		const char* chunkEnd = i + 1 == numOfChunks ? end : std::max(chunkStart, data + size * (i + 1) / numOfChunks);
+
+		while (chunkEnd < end && chunkEnd[-1] != '\n')
+		{
+			++chunkEnd;
+		}
+
+		chunks[i].m_begin = chunkStart;
+		chunks[i].m_end = chunkEnd;
+		chunkStart = chunkEnd;
+	}
+
+	const auto parseChunks = [&chunks](const unsigned begin, const unsigned last)
+	{
+		for (unsigned i = begin; i < last; ++i)
+		{
+			ParseChunk(chunks[i]);
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(static_cast<unsigned>(numOfChunks), 1, parseChunks);
+	} else
+	{
+		parseChunks(0, static_cast<unsigned>(numOfChunks));
+	}
+
+	const auto parsed = std::chrono::high_resolution_clock::now();
+
+	// Where each chunk's attributes and triangles start in the merged arrays
+	std::vector<size_t> positionOffsets(numOfChunks + 1, 0);
+	std::vector<size_t> texcoordOffsets(numOfChunks + 1, 0);
+	std::vector<size_t> normalOffsets(numOfChunks + 1, 0);
+	std::vector<size_t> cornerOffsets(numOfChunks + 1, 0);
+	unsigned malformedLines = 0;
+
+	for (size_t i = 0; i < numOfChunks; ++i)
+	{
+		positionOffsets[i + 1] = positionOffsets[i] + chunks[i].m_positions.size();
+		texcoordOffsets[i + 1] = texcoordOffsets[i] + chunks[i].m_texcoords.size();
+		normalOffsets[i + 1] = normalOffsets[i] + chunks[i].m_normals.size();
+		cornerOffsets[i + 1] = cornerOffsets[i] + chunks[i].m_corners.size();
+		malformedLines += chunks[i].m_malformedLines;
+	}
+
+	const size_t numOfPositions = positionOffsets[numOfChunks];
+	const size_t numOfTexcoords = texcoordOffsets[numOfChunks];
+	const size_t numOfNormals = normalOffsets[numOfChunks];
+	const size_t numOfCorners = cornerOffsets[numOfChunks];
+
+	if (malformedLines > 0)
+	{
+		std::cout << "ERROR::OBJ_LOADER::MALFORMED_LINES: " << malformedLines << "\n";
+	}
+
+	if (numOfCorners == 0 || numOfPositions > UINT32_MAX || numOfCorners > UINT32_MAX)
+		return false;
+
+	std::vector<glm::vec3> positions(numOfPositions);
+	std::vector<glm::vec3> colours(numOfPositions);
+	std::vector<glm::vec2> texcoords(numOfTexcoords);
+	std::vector<glm::vec3> normals(numOfNormals);
+	std::vector<CornerKey> corners(numOfCorners);
+	std::vector<uint8_t> chunkValid(numOfChunks, 1);
+
+	// Gather every chunk into the merged arrays and make every index absolute
+	const auto mergeChunks = [&](const unsigned begin, const unsigned last)
+	{
+		for (unsigned i = begin; i < last; ++i)
+		{
+			ObjChunk& chunk = chunks[i];
+
+			std::copy(chunk.m_positions.begin(), chunk.m_positions.end(), positions.begin() + positionOffsets[i]);
+			std::copy(chunk.m_colours.begin(), chunk.m_colours.end(), colours.begin() + positionOffsets[i]);
+			std::copy(chunk.m_texcoords.begin(), chunk.m_texcoords.end(), texcoords.begin() + texcoordOffsets[i]);
+			std::copy(chunk.m_normals.begin(), chunk.m_normals.end(), normals.begin() + normalOffsets[i]);
+
+			const auto absolute = [](const int index, const bool relative, const size_t offset, const size_t count, unsigned& result)
+			{
+				if (index == k_missingIndex && !relative)
+				{
+					result = ~0u;
+					return true;
+				}
+
+				const int64_t resolved = static_cast<int64_t>(index) + (relative ? static_cast<int64_t>(offset) : 0);
+				result = static_cast<unsigned>(resolved);
+
+				return resolved >= 0 && resolved < static_cast<int64_t>(count);
+			};
+
+			for (size_t c = 0; c < chunk.m_corners.size(); ++c)
+			{
+				const ObjCorner& corner = chunk.m_corners[c];
+				CornerKey& key = corners[cornerOffsets[i] + c];
+
+				const bool valid =
+					absolute(corner.m_position, (corner.m_relative & e_RelativePosition) != 0, positionOffsets[i], numOfPositions, key.m_position) &&
+					absolute(corner.m_texcoord, (corner.m_relative & e_RelativeTexcoord) != 0, texcoordOffsets[i], numOfTexcoords, key.m_texcoord) &&
+					absolute(corner.m_normal, (corner.m_relative & e_RelativeNormal) != 0, normalOffsets[i], numOfNormals, key.m_normal);
+
+				if (!valid)
+				{
+					chunkValid[i] = 0;
+				}
+			}
+
+			// Parsed data isn't needed past here
+			chunk = ObjChunk();
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(static_cast<unsigned>(numOfChunks), 1, mergeChunks);
+	} else
+	{
+		mergeChunks(0, static_cast<unsigned>(numOfChunks));
+	}
+
+	if (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())
+	{
+		std::cout << "ERROR::OBJ_LOADER::INDEX_OUT_OF_RANGE" << "\n";
+		return false;
+	}
+
+	// Corners without a normal share an area weighted normal per position
+	std::vector<glm::vec3> smoothNormals;
+
+	if (std::any_of(corners.begin(), corners.end(), [](const CornerKey& key) { return key.m_normal == ~0u; }))
+	{
+		smoothNormals.assign(numOfPositions, glm::vec3(0.f));
+
+		for (size_t c = 0; c < numOfCorners; c += 3)
+		{
+			const glm::vec3& a = positions[corners[c].m_position];
+			const glm::vec3& b = positions[corners[c + 1].m_position];
+			const glm::vec3& d = positions[corners[c + 2].m_position];
+			const glm::vec3 faceNormal = glm::cross(b - a, d - a);
+
+			for (size_t k = 0; k < 3; ++k)
+			{
+				smoothNormals[corners[c + k].m_position] += faceNormal;
+			}
+		}
+
+		for (glm::vec3& normal : smoothNormals)
+		{
+			const float length = glm::length(normal);
+			normal = length > 0.f ? normal / length : glm::vec3(0.f, 1.f, 0.f);
+		}
+	}
+
+	// Weld corners into vertices through an open addressing table of vertex indices
+	size_t tableSize = 1;
+	while (tableSize < numOfCorners * 2)
+	{
+		tableSize <<= 1;
+	}
+
+	std::vector<GLuint> table(tableSize, ~0u);
+	std::vector<CornerKey> vertexKeys;
+	vertexKeys.reserve(numOfPositions + numOfPositions / 2);
+	vertices.reserve(numOfPositions + numOfPositions / 2);
+	indices.resize(numOfCorners);
+
+	for (size_t c = 0; c < numOfCorners; ++c)
+	{
+		const CornerKey& key = corners[c];
+		size_t slot = static_cast<size_t>(HashCorner(key)) & (tableSize - 1);
+
+		while (table[slot] != ~0u && !(vertexKeys[table[slot]] == key))
+		{
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == ~0u)
+		{
+			table[slot] = static_cast<GLuint>(vertices.size());
+			vertexKeys.push_back(key);
+
+			vertices.emplace_back(
+				positions[key.m_position],
+				colours[key.m_position],
+				key.m_texcoord != ~0u ? texcoords[key.m_texcoord] : glm::vec2(0.f),
+				key.m_normal != ~0u ? normals[key.m_normal] : smoothNormals[key.m_position]
+			);
+		}
+
+		indices[c] = table[slot];
+	}
+
+	const auto finished = std::chrono::high_resolution_clock::now();
+
+	if (stats)
+	{
+		stats->m_bytes = size;
+		stats->m_chunks = static_cast<unsigned>(numOfChunks);
+		stats->m_positions = static_cast<unsigned>(numOfPositions);
+		stats->m_texcoords = static_cast<unsigned>(numOfTexcoords);
+		stats->m_normals = static_cast<unsigned>(numOfNormals);
+		stats->m_triangles = static_cast<unsigned>(numOfCorners / 3);
+		stats->m_vertices = static_cast<unsigned>(vertices.size());
+		stats->m_parseMilliseconds = std::chrono::duration<double, std::milli>(parsed - start).count();
+		stats->m_mergeMilliseconds = std::chrono::duration<double, std::milli>(finished - parsed).count();
+		stats->m_milliseconds = std::chrono::duration<double, std::milli>(finished - start).count();
+	}
+
+	return true;
+}
+
+bool ObjLoader::ParseFloat(const char*& cursor, const char* end, float& value)
+{
+	const char* start = cursor;
+	bool negative = false;
+
+	if (cursor < end && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		++cursor;
+	}
+
+	// Up to 19 significant digits fit a 64 bit mantissa, later ones only move the exponent
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+
+	while (cursor < end && IsDigit(*cursor))
+	{
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+			significantDigits += mantissa != 0 ? 1 : 0;
+		} else
+		{
+			exponent++;
+		}
+
+		anyDigits = true;
+		++cursor;
+	}
+
+	if (cursor < end && *cursor == '.')
+	{
+		++cursor;
+
+		while (cursor < end && IsDigit(*cursor))
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+				significantDigits += mantissa != 0 ? 1 : 0;
+				exponent--;
+			}
+
+			anyDigits = true;
+			++cursor;
+		}
+	}
+
+	if (!anyDigits)
+	{
+		cursor = start;
+		return false;
+	}
+
+	if (cursor < end && (*cursor == 'e' || *cursor == 'E'))
+	{
+		const char* exponentStart = cursor;
+		++cursor;
+
+		int exponentValue = 0;
+		if (ParseInt(cursor, end, exponentValue))
+		{
+			exponent += std::max(-1000, std::min(exponentValue, 1000));
+		} else
+		{
+			cursor = exponentStart;
+		}
+	}
+
+	// Exact mantissa and power of ten give a correctly rounded double for the usual OBJ precision,
+	// rounding that to float is then at most half an ulp off
+	double result = static_cast<double>(mantissa);
+
+	if (mantissa != 0)
+	{
+		if (exponent < 0)
+		{
+			result = -exponent <= 22 ? result / k_powersOfTen[-exponent] : result * std::pow(10.0, exponent);
+		} else if (exponent > 0)
+		{
+			result = exponent <= 22 ? result * k_powersOfTen[exponent] : result * std::pow(10.0, exponent);
+		}
+	}
+
+	value = static_cast<float>(negative ? -result : result);
+
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+
+#include "Vertex.h"
+
+class ThreadPool;
+
+struct ObjLoadStats
+{
+	size_t m_bytes = 0;
+	unsigned m_chunks = 0;
+	unsigned m_positions = 0;
+	unsigned m_texcoords = 0;
+	unsigned m_normals = 0;
+	unsigned m_triangles = 0;
+	unsigned m_vertices = 0;
+	double m_parseMilliseconds = 0.0;
+	double m_mergeMilliseconds = 0.0;
+	double m_milliseconds = 0.0;
+};
+
+// Wavefront OBJ reader producing the Vertex/GLuint layout Geometry takes. The file is memory
+// mapped and split into line aligned chunks that are parsed in parallel, then the chunks are merged
+// and every distinct position/texcoord/normal triple becomes one vertex. Polygons are fanned into
+// triangles, negative (relative) indices are supported and missing normals are smoothed from the
+// faces. Positions with six values are read as position and colour, everything other than v, vt,
+// vn and f is skipped.
+class ObjLoader
+{
+public:
+	// pool may be null to parse on the calling thread. Returns false and logs on failure, leaving
+	// the outputs empty
+	static bool Load(const std::string& fileName, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+		ThreadPool* pool = nullptr, ObjLoadStats* stats = nullptr);
+
+	// Same as Load but over text already in memory
+	static bool Parse(const char* data, size_t size, std::vector<Vertex>& vertices, std::vector<GLuint>& indices,
+		ThreadPool* pool = nullptr, ObjLoadStats* stats = nullptr);
+
+	// Locale independent decimal parser, advances cursor past the number. Leaves cursor where it was
+	// and returns false if there is no number there
+	static bool ParseFloat(const char*& cursor, const char* end, float& value);
+
+private:
+	static constexpr size_t k_minChunkBytes = 256 * 1024;
+	static constexpr unsigned k_chunksPerThread = 4;
+};
@@ -4,6 +4,11 @@
 
 #include "Vertex.h"
 
+enum class ePrimitiveType
+{
+	e_Quad, e_Triangle, e_Pyramid, e_Cube
+};
+
 class Primitive
 {
 public:
@@ -14,14 +19,11 @@ public:
 	void Set(const Vertex* vertices, const unsigned numOfVertices,
 		const GLuint* indices, const unsigned  numOfIndices)
 	{
-		for (unsigned i = 0; i < numOfVertices; ++i)
-		{
-			m_vertices.emplace_back(vertices[i]);
-		}
+		m_vertices.assign(vertices, vertices + numOfVertices);
 
-		for (unsigned i = 0; i < numOfIndices; ++i)
+		if (indices)
 		{
-			m_indices.emplace_back(indices[i]);
+			m_indices.assign(indices, indices + numOfIndices);
 		}
 	}
 
@@ -167,4 +169,22 @@ public:
 
 		Set(vertices, nrOfVertices, indices, nrOfIndices);
 	}
-};
\ No newline at end of file
+};
+
+// Returns nullptr for an unknown type, the caller owns the primitive
+inline Primitive* CreatePrimitive(const ePrimitiveType type)
+{
+	switch (type)
+	{
+		case ePrimitiveType::e_Quad:
+			return new Quad();
+		case ePrimitiveType::e_Triangle:
+			return new Triangle();
+		case ePrimitiveType::e_Pyramid:
+			return new Pyramid();
+		case ePrimitiveType::e_Cube:
+			return new Cube();
+		default:
+			return nullptr;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,463 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	struct CpuEvent
+	{
+		const char* m_name;
+		uint64_t m_startNs;
+		uint64_t m_endNs;
+	};
+
+	// Written only by its own thread and read only by BeginFrame. m_write and m_read only ever
+	// grow, the slot is the count masked by the ring size
+	struct ThreadRing
+	{
+		CpuEvent m_events[Profiler::k_ringSize];
+		std::atomic<uint32_t> m_write{ 0 };
+		std::atomic<uint32_t> m_read{ 0 };
+		std::atomic<uint32_t> m_dropped{ 0 };
+		unsigned m_threadId = 0;
+		std::string m_name;
+	};
+
+	enum class eEventKind { e_Cpu, e_Gpu, e_Counter };
+
+	struct CapturedEvent
+	{
+		const char* m_name;
+		eEventKind m_kind;
+		unsigned m_threadId;
+		uint64_t m_startNs;
+		uint64_t m_endNs;
+		double m_value;
+	};
+
+	struct GpuEvent
+	{
+		const char* m_name;
+		GLuint m_begin;
+		GLuint m_end;
+	};
+
+	// Everything the GPU scopes of one frame used, read back when the slot comes round again
+	struct GpuFrame
+	{
+		std::vector<GpuEvent> m_events;
+		std::vector<GLuint> m_queries;
+		unsigned m_usedQueries = 0;
+		uint64_t m_cpuSyncNs = 0;
+		GLint64 m_gpuSyncNs = 0;
+	};
+
+	constexpr unsigned k_gpuFrames = 2;
+
+	// Trace thread id the GPU events are shown on
+	constexpr unsigned k_gpuThreadId = 0xffff;
+
+	std::mutex s_ringsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> s_rings;
+	thread_local ThreadRing* t_ring = nullptr;
+
+	std::atomic<bool> s_capturing{ false };
+	std::vector<CapturedEvent> s_captured;
+
+	GpuFrame s_gpuFrames[k_gpuFrames];
+	unsigned s_frameNumber = 0;
+	uint64_t s_frameStartNs = 0;
+
+	double s_cpuFrameMs[Profiler::k_frameWindow];
+	double s_gpuFrameMs[Profiler::k_frameWindow];
+	unsigned s_cpuFrameCount = 0;
+	unsigned s_gpuFrameCount = 0;
+
+	ProfilerStats s_stats;
+
+	const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+	ThreadRing& GetThreadRing()
+	{
+		// Only a thread's first event takes the lock
+		if (!t_ring)
+		{
+			std::lock_guard<std::mutex> lock(s_ringsMutex);
+
+			s_rings.push_back(std::unique_ptr<ThreadRing>(new ThreadRing()));
+			t_ring = s_rings.back().get();
+			t_ring->m_threadId = static_cast<unsigned>(s_rings.size() - 1);
+			t_ring->m_name = "Thread " + std::to_string(t_ring->m_threadId);
+		}
+
+		return *t_ring;
+	}
+
+	void Capture(const CapturedEvent& event)
+	{
+		if (!s_capturing.load(std::memory_order_relaxed))
+			return;
+
+		if (s_captured.size() >= Profiler::k_maxCapturedEvents)
+		{
+			s_stats.m_captureFull = true;
+			return;
+		}
+
+		s_captured.push_back(event);
+	}
+
+	void DrainRings()
+	{
+		std::lock_guard<std::mutex> lock(s_ringsMutex);
+
+		for (const auto& ring : s_rings)
+		{
+			const uint32_t read = ring->m_read.load(std::memory_order_relaxed);
+			const uint32_t write = ring->m_write.load(std::memory_order_acquire);
+
+			for (uint32_t i = read; i != write; ++i)
+			{
+				const CpuEvent& event = ring->m_events[i & (Profiler::k_ringSize - 1)];
+				Capture({ event.m_name, eEventKind::e_Cpu, ring->m_threadId, event.m_startNs, event.m_endNs, 0.0 });
+			}
+
+			ring->m_read.store(write, std::memory_order_release);
+			s_stats.m_droppedEvents += ring->m_dropped.exchange(0, std::memory_order_relaxed);
+		}
+	}
+
+	GLuint AcquireQuery(GpuFrame& frame)
+	{
+		if (frame.m_usedQueries == frame.m_queries.size())
+		{
+			GLuint query = 0;
+			glGenQueries(1, &query);
+			frame.m_queries.push_back(query);
+		}
+
+		return frame.m_queries[frame.m_usedQueries++];
+	}
+
+	void PushFrameTime(double* window, unsigned& count, const double milliseconds)
+	{
+		window[count % Profiler::k_frameWindow] = milliseconds;
+		count++;
+	}
+
+	std::vector<double> SortWindow(const double* window, const unsigned count)
+	{
+		const unsigned size = count < Profiler::k_frameWindow ? count : Profiler::k_frameWindow;
+
+		std::vector<double> sorted(window, window + size);
+		std::sort(sorted.begin(), sorted.end());
+
+		return sorted;
+	}
+
+	void ReadBackGpuFrame(GpuFrame& frame)
+	{
+		if (frame.m_usedQueries > 0)
+		{
+			// Timestamps land in order, so the last query issued being ready means they all are
+			GLuint available = GL_FALSE;
+			glGetQueryObjectuiv(frame.m_queries[frame.m_usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (!available)
+			{
+				s_stats.m_droppedGpuFrames++;
+			} else
+			{
+				uint64_t first = UINT64_MAX;
+				uint64_t last = 0;
+
+				for (const GpuEvent& event : frame.m_events)
+				{
+					if (event.m_end == 0)
+						continue;
+
+					GLuint64 begin = 0;
+					GLuint64 end = 0;
+					glGetQueryObjectui64v(event.m_begin, GL_QUERY_RESULT, &begin);
+					glGetQueryObjectui64v(event.m_end, GL_QUERY_RESULT, &end);
+
+					first = std::min(first, static_cast<uint64_t>(begin));
+					last = std::max(last, static_cast<uint64_t>(end));
+
+					// Onto the CPU timeline through the pair of clocks sampled when the frame began
+					const auto toCpu = [&frame](const GLuint64 gpuNs)
+					{
+						return static_cast<uint64_t>(static_cast<int64_t>(frame.m_cpuSyncNs) + static_cast<int64_t>(gpuNs) - frame.m_gpuSyncNs);
+					};
+
+					Capture({ event.m_name, eEventKind::e_Gpu, k_gpuThreadId, toCpu(begin), toCpu(end), 0.0 });
+				}
+
+				if (last > first)
+				{
+					PushFrameTime(s_gpuFrameMs, s_gpuFrameCount, static_cast<double>(last - first) / 1e6);
+				}
+			}
+		}
+
+		frame.m_events.clear();
+		frame.m_usedQueries = 0;
+	}
+
+	void WriteEscaped(std::ofstream& file, const char* text)
+	{
+		for (; *text; ++text)
+		{
+			if (*text == '"' || *text == '\\')
+			{
+				file << '\\';
+			}
+
+			file << *text;
+		}
+	}
+}
+
+void Profiler::BeginFrame()
+{
+	const uint64_t now = Now();
+	ThreadRing& ring = GetThreadRing();
+
+	if (s_frameNumber > 0)
+	{
+		PushFrameTime(s_cpuFrameMs, s_cpuFrameCount, static_cast<double>(now - s_frameStartNs) / 1e6);
+		Capture({ "Frame", eEventKind::e_Cpu, ring.m_threadId, s_frameStartNs, now, 0.0 });
+	}
+
+	DrainRings();
+
+	s_frameNumber++;
+	s_frameStartNs = now;
+
+	// The slot about to be reused was filled k_gpuFrames frames ago
+	GpuFrame& frame = s_gpuFrames[s_frameNumber % k_gpuFrames];
+	ReadBackGpuFrame(frame);
+
+	glGetInteger64v(GL_TIMESTAMP, &frame.m_gpuSyncNs);
+	frame.m_cpuSyncNs = Now();
+
+	s_stats.m_capturedEvents = static_cast<unsigned>(s_captured.size());
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadRing& ring = GetThreadRing();
+
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+	ring.m_name = name;
+}
+
+void Profiler::StartCapture()
+{
+	s_capturing.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::StopCapture()
+{
+	s_capturing.store(false, std::memory_order_relaxed);
+}
+
+bool Profiler::IsCapturing()
+{
+	return s_capturing.load(std::memory_order_relaxed);
+}
+
+void Profiler::RecordCounter(const char* name, const double value)
+{
+	const uint64_t now = Now();
+	Capture({ name, eEventKind::e_Counter, GetThreadRing().m_threadId, now, now, value });
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path)
+{
+	DrainRings();
+
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::PROFILER::COULD_NOT_OPEN_FILE: " << path << "\n";
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << k_gpuThreadId << ",\"args\":{\"name\":\"GPU\"}}";
+
+	{
+		std::lock_guard<std::mutex> lock(s_ringsMutex);
+
+		for (const auto& ring : s_rings)
+		{
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->m_threadId << ",\"args\":{\"name\":\"";
+			WriteEscaped(file, ring->m_name.c_str());
+			file << "\"}}";
+		}
+	}
+
+	// Trace timestamps are in microseconds
+	for (const CapturedEvent& event : s_captured)
+	{
+		file << ",\n{\"name\":\"";
+		WriteEscaped(file, event.m_name);
+		file << "\",\"pid\":1,\"tid\":" << event.m_threadId << ",\"ts\":" << static_cast<double>(event.m_startNs) / 1e3;
+
+		if (event.m_kind == eEventKind::e_Counter)
+		{
+			file << ",\"ph\":\"C\",\"args\":{\"value\":" << event.m_value << "}}";
+		} else
+		{
+			file << ",\"ph\":\"X\",\"dur\":" << static_cast<double>(event.m_endNs - event.m_startNs) / 1e3;
+
+			if (event.m_kind == eEventKind::e_Gpu)
+			{
+				file << ",\"cat\":\"gpu\"";
+			}
+
+			file << "}";
+		}
+	}
+
+	file << "\n]}\n";
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::PROFILER::COULD_NOT_WRITE_FILE: " << path << "\n";
+		return false;
+	}
+
+	s_captured.clear();
+	s_stats.m_capturedEvents = 0;
+	s_stats.m_captureFull = false;
+
+	return true;
+}
+
+FrameTimeSummary Profiler::GetFrameSummary()
+{
+	FrameTimeSummary summary;
+
+	std::vector<double> cpu = SortWindow(s_cpuFrameMs, s_cpuFrameCount);
+	std::vector<double> gpu = SortWindow(s_gpuFrameMs, s_gpuFrameCount);
+
+	summary.m_frames = static_cast<unsigned>(cpu.size());
+	summary.m_cpuP50Ms = GetPercentile(cpu, 0.50);
+	summary.m_cpuP95Ms = GetPercentile(cpu, 0.95);
+	summary.m_cpuP99Ms = GetPercentile(cpu, 0.99);
+	summary.m_gpuP50Ms = GetPercentile(gpu, 0.50);
+	summary.m_gpuP95Ms = GetPercentile(gpu, 0.95);
+	summary.m_gpuP99Ms = GetPercentile(gpu, 0.99);
+
+	return summary;
+}
+
+double Profiler::GetPercentile(const std::vector<double>& sorted, const double percentile)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	// Nearest rank, so p99 of fewer than 100 frames is the worst of them
+	const auto rank = static_cast<size_t>(std::ceil(percentile * static_cast<double>(sorted.size())));
+	return sorted[std::min(std::max(rank, static_cast<size_t>(1)), sorted.size()) - 1];
+}
+
+const ProfilerStats& Profiler::GetStats()
+{
+	return s_stats;
+}
+
+void Profiler::ReleaseGpuQueries()
+{
+	for (GpuFrame& frame : s_gpuFrames)
+	{
+		if (!frame.m_queries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.m_queries.size()), frame.m_queries.data());
+		}
+
+		frame = GpuFrame();
+	}
+
+	s_gpuFrameCount = 0;
+}
+
+void Profiler::RecordCpuEvent(const char* name, const uint64_t startNs, const uint64_t endNs)
+{
+	ThreadRing& ring = GetThreadRing();
+
+	const uint32_t write = ring.m_write.load(std::memory_order_relaxed);
+
+	if (write - ring.m_read.load(std::memory_order_acquire) >= k_ringSize)
+	{
+		ring.m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ring.m_events[write & (k_ringSize - 1)] = { name, startNs, endNs };
+	ring.m_write.store(write + 1, std::memory_order_release);
+}
+
+unsigned Profiler::BeginGpuEvent(const char* name)
+{
+	GpuFrame& frame = s_gpuFrames[s_frameNumber % k_gpuFrames];
+
+	const GLuint query = AcquireQuery(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.m_events.push_back({ name, query, 0 });
+
+	return static_cast<unsigned>(frame.m_events.size() - 1);
+}
+
+void Profiler::EndGpuEvent(const unsigned event)
+{
+	GpuFrame& frame = s_gpuFrames[s_frameNumber % k_gpuFrames];
+
+	const GLuint query = AcquireQuery(frame);
+	glQueryCounter(query, GL_TIMESTAMP);
+	frame.m_events[event].m_end = query;
+}
+
+uint64_t Profiler::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count());
+}
+
+ProfileScope::ProfileScope(const char* name) :
+	m_name(name),
+	m_recording(Profiler::IsCapturing()),
+	m_start(m_recording ? Profiler::Now() : 0)
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+	// Scopes are only recorded while capturing, nothing else reads them
+	if (m_recording)
+	{
+		Profiler::RecordCpuEvent(m_name, m_start, Profiler::Now());
+	}
+}
+
+GpuProfileScope::GpuProfileScope(const char* name) :
+	m_event(Profiler::BeginGpuEvent(name))
+{
+}
+
+GpuProfileScope::~GpuProfileScope()
+{
+	Profiler::EndGpuEvent(m_event);
+}
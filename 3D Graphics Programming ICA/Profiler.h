@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+
+struct FrameTimeSummary
+{
+	unsigned m_frames = 0;		// Frames in the window the percentiles are taken over
+	double m_cpuP50Ms = 0.0;
+	double m_cpuP95Ms = 0.0;
+	double m_cpuP99Ms = 0.0;
+	double m_gpuP50Ms = 0.0;	// First GPU scope begin to last end, 0 without GPU scopes
+	double m_gpuP95Ms = 0.0;
+	double m_gpuP99Ms = 0.0;
+};
+
+struct ProfilerStats
+{
+	unsigned m_droppedEvents = 0;		// CPU scopes that found their thread's ring full
+	unsigned m_droppedGpuFrames = 0;	// GPU frames still unfinished when their queries came round again
+	unsigned m_capturedEvents = 0;
+	bool m_captureFull = false;
+};
+
+// Frame profiler. CPU scopes are timed on whichever thread they run on and pushed into a ring
+// owned by that thread, so recording never takes a lock: only the first event of a thread
+// registers its ring. Whichever thread calls BeginFrame drains every ring.
+//
+// GPU scopes put a GL_TIMESTAMP query either side of the work. Queries are double buffered by
+// frame and read back two frames later, a frame that still isn't finished by then is dropped
+// rather than waited on. Timestamps rather than GL_TIME_ELAPSED so GPU scopes can nest.
+//
+// While capturing, every event is kept for WriteChromeTrace, which writes the Trace Event
+// Format read by chrome://tracing and Perfetto.
+class Profiler
+{
+public:
+	// Events each thread can have waiting between two BeginFrame calls
+	static constexpr unsigned k_ringSize = 1 << 12;
+
+	// Frames the percentiles are taken over
+	static constexpr unsigned k_frameWindow = 512;
+
+	// Capturing stops once this many events are held
+	static constexpr unsigned k_maxCapturedEvents = 1 << 19;
+
+	// Closes the previous frame and starts the next. Call once per frame from the thread that owns
+	// the GL context, before any GPU scope of the frame
+	static void BeginFrame();
+
+	// Shows up as the thread's name in the trace
+	static void SetThreadName(const char* name);
+
+	// Captured events are kept until the trace is written
+	static void StartCapture();
+	static void StopCapture();
+	static bool IsCapturing();
+
+	// A per-frame value such as a draw or GL call count, only kept while capturing. BeginFrame's thread only
+	static void RecordCounter(const char* name, double value);
+
+	// Writes and then clears the captured events
+	static bool WriteChromeTrace(const std::string& path);
+
+	static FrameTimeSummary GetFrameSummary();
+
+	// Nearest rank percentile, 0.99 for p99, of samples sorted ascending. 0 when there are none
+	static double GetPercentile(const std::vector<double>& sorted, double percentile);
+
+	static const ProfilerStats& GetStats();
+
+	// Deletes the GPU scopes' queries along with any frames not yet read back. Call before the
+	// context goes away, GPU scopes under a later context start afresh
+	static void ReleaseGpuQueries();
+
+	// Scope names must outlive the profiler, string literals in practice
+	static void RecordCpuEvent(const char* name, uint64_t startNs, uint64_t endNs);
+	static unsigned BeginGpuEvent(const char* name);
+	static void EndGpuEvent(unsigned event);
+
+	// Nanoseconds since the profiler's epoch on the steady clock
+	static uint64_t Now();
+};
+
+// Times the enclosing scope on the calling thread
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	bool m_recording;
+	uint64_t m_start;
+};
+
+// Times the GL commands issued in the enclosing scope. Only on the thread that owns the context
+class GpuProfileScope
+{
+public:
+	explicit GpuProfileScope(const char* name);
+	~GpuProfileScope();
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	unsigned m_event;
+};
@@ -0,0 +1,218 @@
+#include "ProgramCache.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "Profiler.h"
+
+namespace
+{
+	constexpr uint32_t k_programFileMagic = 0x47525054;	// "TPRG"
+
+	struct ProgramFileHeader
+	{
+		uint32_t m_magic;
+		uint32_t m_version;
+		uint32_t m_binaryFormat;
+		uint32_t m_binarySize;
+		uint64_t m_key;
+		double m_compileMs;
+	};
+
+	static_assert(sizeof(ProgramFileHeader) == 32, "ProgramFileHeader layout is part of the file format");
+
+	const char* GetString(const GLenum name)
+	{
+		const auto* string = reinterpret_cast<const char*>(glGetString(name));
+		return string ? string : "";
+	}
+
+	void MakeDirectory(const char* path)
+	{
+		// Already being there is fine, failing just means nothing gets stored
+#ifdef _WIN32
+		_mkdir(path);
+#else
+		mkdir(path, 0755);
+#endif
+	}
+}
+
+const char* const ProgramCache::k_cacheDirectory = "ShaderCache";
+
+ProgramCacheStats ProgramCache::s_stats;
+
+bool ProgramCache::IsSupported()
+{
+	GLint numOfFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numOfFormats);
+
+	return numOfFormats > 0;
+}
+
+uint64_t ProgramCache::MakeKey(const std::vector<std::string>& sources)
+{
+	// FNV-1a, each string's length mixed in first so text can't slide from one stage to the next
+	uint64_t hash = 14695981039346656037ull;
+
+	const auto mix = [&hash](const std::string& text)
+	{
+		const uint64_t length = text.size();
+		const auto* lengthBytes = reinterpret_cast<const unsigned char*>(&length);
+
+		for (size_t i = 0; i < sizeof(length); ++i)
+		{
+			hash ^= lengthBytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		for (const char character : text)
+		{
+			hash ^= static_cast<unsigned char>(character);
+			hash *= 1099511628211ull;
+		}
+	};
+
+	mix(GetString(GL_VENDOR));
+	mix(GetString(GL_RENDERER));
+	mix(GetString(GL_VERSION));
+
+	for (const std::string& source : sources)
+	{
+		mix(source);
+	}
+
+	return hash;
+}
+
+GLuint ProgramCache::Load(const uint64_t key)
+{
+	ProfileScope scope("ProgramCache::Load");
+
+	std::ifstream file(GetCachePath(key), std::ios::binary);
+
+	if (!file.is_open())
+	{
+		s_stats.m_misses++;
+		return 0;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+
+	ProgramFileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file.good() || header.m_magic != k_programFileMagic || header.m_version != k_fileVersion || header.m_key != key ||
+		header.m_binarySize == 0)
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::UNSUPPORTED_FILE: " << GetCachePath(key) << "\n";
+		s_stats.m_misses++;
+		return 0;
+	}
+
+	std::vector<char> binary(header.m_binarySize);
+	file.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::CORRUPT_FILE: " << GetCachePath(key) << "\n";
+		s_stats.m_misses++;
+		return 0;
+	}
+
+	const GLuint program = glCreateProgram();
+	glProgramBinary(program, header.m_binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+	// Drivers may refuse binaries from another build of themselves even with matching strings
+	if (!success)
+	{
+		glDeleteProgram(program);
+		s_stats.m_misses++;
+		s_stats.m_rejected++;
+		return 0;
+	}
+
+	const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	s_stats.m_hits++;
+	s_stats.m_loadMs += loadMs;
+	s_stats.m_savedMs += header.m_compileMs - loadMs;
+
+	return program;
+}
+
+void ProgramCache::Store(const uint64_t key, const GLuint program, const double compileMs)
+{
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+
+	if (binarySize <= 0)
+		return;
+
+	std::vector<char> binary(static_cast<size_t>(binarySize));
+	GLenum binaryFormat = 0;
+	GLsizei length = 0;
+	glGetProgramBinary(program, binarySize, &length, &binaryFormat, binary.data());
+
+	if (length <= 0)
+		return;
+
+	MakeDirectory(k_cacheDirectory);
+
+	const std::string path = GetCachePath(key);
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::COULD_NOT_OPEN_FILE: " << path << "\n";
+		return;
+	}
+
+	ProgramFileHeader header{};
+	header.m_magic = k_programFileMagic;
+	header.m_version = k_fileVersion;
+	header.m_binaryFormat = binaryFormat;
+	header.m_binarySize = static_cast<uint32_t>(length);
+	header.m_key = key;
+	header.m_compileMs = compileMs;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), length);
+
+	if (!file.good())
+	{
+		std::cout << "ERROR::PROGRAM_CACHE::COULD_NOT_WRITE_FILE: " << path << "\n";
+	}
+}
+
+void ProgramCache::RecordCompile(const double compileMs)
+{
+	s_stats.m_compileMs += compileMs;
+}
+
+std::string ProgramCache::GetCachePath(const uint64_t key)
+{
+	char name[17];
+	for (int digit = 0; digit < 16; ++digit)
+	{
+		name[digit] = "0123456789abcdef"[key >> ((15 - digit) * 4) & 15];
+	}
+	name[16] = '\0';
+
+	return std::string(k_cacheDirectory) + "/" + name + ".bin";
+}
+
+const ProgramCacheStats& ProgramCache::GetStats()
+{
+	return s_stats;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+
+struct ProgramCacheStats
+{
+	unsigned m_hits = 0;
+	unsigned m_misses = 0;
+	unsigned m_rejected = 0;	// Binaries the driver refused, compiled from source instead
+	double m_compileMs = 0.0;	// Compiling and linking on misses, overlapping when the driver compiles in parallel
+	double m_loadMs = 0.0;		// Handing binaries back to the driver on hits
+	double m_savedMs = 0.0;		// What the hits took to compile when they were stored, less m_loadMs
+};
+
+// Keeps linked programs on disk as glGetProgramBinary blobs, one file per program under
+// k_cacheDirectory. The key hashes every stage's source together with the GL vendor, renderer and
+// version strings, so a driver update or an edited shader just misses. Binaries the driver turns
+// down are counted and the program is compiled from source as usual, then stored again.
+class ProgramCache
+{
+public:
+	// Bumped whenever the file layout changes
+	static constexpr uint32_t k_fileVersion = 1;
+
+	static const char* const k_cacheDirectory;
+
+	// False when the driver has no binary formats, nothing is loaded or stored then
+	static bool IsSupported();
+
+	static uint64_t MakeKey(const std::vector<std::string>& sources);
+
+	// A linked program, or 0 on a miss or rejected binary
+	static GLuint Load(uint64_t key);
+
+	// compileMs is what building the program from source took, reported as saved on later hits
+	static void Store(uint64_t key, GLuint program, double compileMs);
+
+	// Adds to the time spent building programs from source
+	static void RecordCompile(double compileMs);
+
+	static std::string GetCachePath(uint64_t key);
+
+	static const ProgramCacheStats& GetStats();
+
+private:
+	static ProgramCacheStats s_stats;
+};
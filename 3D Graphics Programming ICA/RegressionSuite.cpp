@@ -0,0 +1,460 @@
+#include "RegressionSuite.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <SOIL2/SOIL2.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "Game.h"
+#include "Profiler.h"
+
+namespace
+{
+	struct RegressionScene
+	{
+		const char* m_name;
+		SyntheticSceneSettings m_scene;
+	};
+
+	struct Metric
+	{
+		const char* m_name;
+		double m_value;
+		bool m_timing;		// Held to the time threshold, anything else fails on going up at all
+	};
+
+	struct Lab
+	{
+		float m_l;
+		float m_a;
+		float m_b;
+	};
+
+	// Per-frame averages that come out the same every run, this much over is already a change
+	constexpr double k_countSlack = 0.01;
+
+	std::vector<RegressionScene> MakeScenes()
+	{
+		std::vector<RegressionScene> scenes;
+
+		// The scene a windowed run opens on
+		scenes.push_back({ "cube", SyntheticSceneSettings() });
+
+		// Culling, the queue and batching under load
+		SyntheticSceneSettings manyObjects;
+		manyObjects.m_meshes = 4000;
+		manyObjects.m_instances = 4000;
+		manyObjects.m_depth = 4;
+		manyObjects.m_extent = 30.f;
+		scenes.push_back({ "many_objects", manyObjects });
+
+		// Every light the shader takes, close enough together that they all reach the screen
+		SyntheticSceneSettings manyLights;
+		manyLights.m_meshes = 200;
+		manyLights.m_lights = constants::k_maxLights - 1;
+		manyLights.m_extent = 8.f;
+		scenes.push_back({ "many_lights", manyLights });
+
+		return scenes;
+	}
+
+	void MakeDirectory(const char* path)
+	{
+		// Already being there is fine, failing shows up when the first file won't open
+#ifdef _WIN32
+		_mkdir(path);
+#else
+		mkdir(path, 0755);
+#endif
+	}
+
+	std::vector<Metric> MakeMetrics(const HeadlessResult& result)
+	{
+		std::vector<double> frameMs = result.m_frameMs;
+		std::vector<double> cpuMs = result.m_cpuMs;
+		std::sort(frameMs.begin(), frameMs.end());
+		std::sort(cpuMs.begin(), cpuMs.end());
+
+		// Medians only, the tail moves too much from run to run on a shared machine to hold to a threshold
+		return {
+			{ "frame_p50_ms", Profiler::GetPercentile(frameMs, 0.50), true },
+			{ "cpu_p50_ms", Profiler::GetPercentile(cpuMs, 0.50), true },
+			{ "visible_meshes", result.m_visibleMeshes, false },
+			{ "draw_calls", result.m_drawCalls, false },
+			{ "uniform_gl_calls", result.m_uniformGlCalls, false },
+			{ "texture_binds", result.m_textureBinds, false }
+		};
+	}
+
+	// Either the timings or the counts, which live in separate files
+	bool SaveBaseline(const std::string& fileName, const std::vector<Metric>& metrics, const bool timings)
+	{
+		std::ofstream file(fileName, std::ios::trunc);
+
+		if (!file.is_open())
+		{
+			std::cout << "ERROR::REGRESSION::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+			return false;
+		}
+
+		file << (timings ? "# metric value, this machine's timings\n" : "# metric value, written by --update-golden\n");
+		file << std::fixed << std::setprecision(4);
+
+		for (const Metric& metric : metrics)
+		{
+			if (metric.m_timing == timings)
+			{
+				file << metric.m_name << " " << metric.m_value << "\n";
+			}
+		}
+
+		return file.good();
+	}
+
+	bool LoadBaseline(const std::string& fileName, std::map<std::string, double>& baseline)
+	{
+		std::ifstream file(fileName);
+
+		if (!file.is_open())
+			return false;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			std::istringstream stream(line);
+			std::string name;
+			double value = 0.0;
+
+			if (!(stream >> name >> value))
+			{
+				std::cout << "ERROR::REGRESSION::BAD_BASELINE: " << line << "\n";
+				return false;
+			}
+
+			baseline[name] = value;
+		}
+
+		return true;
+	}
+
+	// Readback comes bottom row first, image files are top row first
+	std::vector<unsigned char> FlipRows(const std::vector<unsigned char>& rgba, const int width, const int height)
+	{
+		const size_t rowSize = static_cast<size_t>(width) * 4;
+		std::vector<unsigned char> flipped(rgba.size());
+
+		for (int y = 0; y < height; ++y)
+		{
+			std::copy_n(rgba.begin() + y * rowSize, rowSize, flipped.begin() + (height - 1 - y) * rowSize);
+		}
+
+		return flipped;
+	}
+
+	bool SaveImage(const std::string& fileName, const std::vector<unsigned char>& rgba, const int width, const int height)
+	{
+		if (!SOIL_save_image(fileName.c_str(), SOIL_SAVE_TYPE_PNG, width, height, 4, rgba.data()))
+		{
+			std::cout << "ERROR::REGRESSION::COULD_NOT_WRITE_IMAGE: " << fileName << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// sRGB to CIELAB under D65, alpha is ignored
+	std::vector<Lab> ToLab(const std::vector<unsigned char>& rgba)
+	{
+		float linear[256];
+		for (int i = 0; i < 256; ++i)
+		{
+			const float c = static_cast<float>(i) / 255.f;
+			linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		const auto f = [](const float t)
+		{
+			constexpr float delta = 6.f / 29.f;
+			return t > delta * delta * delta ? std::cbrt(t) : t / (3.f * delta * delta) + 4.f / 29.f;
+		};
+
+		std::vector<Lab> lab(rgba.size() / 4);
+
+		for (size_t i = 0; i < lab.size(); ++i)
+		{
+			const float r = linear[rgba[i * 4 + 0]];
+			const float g = linear[rgba[i * 4 + 1]];
+			const float b = linear[rgba[i * 4 + 2]];
+
+			const float x = f((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+			const float y = f(0.2126f * r + 0.7152f * g + 0.0722f * b);
+			const float z = f((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+
+			lab[i] = { 116.f * y - 16.f, 500.f * (x - y), 200.f * (y - z) };
+		}
+
+		return lab;
+	}
+
+	// Fails when too many pixels differ visibly from the golden image, writing what was rendered
+	// and where it differs alongside it
+	bool CheckImage(const std::string& name, const HeadlessResult& result, const RunSettings& settings)
+	{
+		const std::string goldenFile = settings.m_goldenDir + "/" + name + ".png";
+
+		int width = 0;
+		int height = 0;
+		unsigned char* golden = SOIL_load_image(goldenFile.c_str(), &width, &height, nullptr, SOIL_LOAD_RGBA);
+
+		if (!golden)
+		{
+			std::cout << "ERROR::REGRESSION::NO_GOLDEN_IMAGE: " << goldenFile << ", make one with --update-golden\n";
+			return false;
+		}
+
+		std::vector<unsigned char> expected(golden, golden + static_cast<size_t>(width) * height * 4);
+		SOIL_free_image_data(golden);
+
+		const std::vector<unsigned char> actual = FlipRows(result.m_image, result.m_width, result.m_height);
+
+		if (width != result.m_width || height != result.m_height)
+		{
+			std::cout << "ERROR::REGRESSION::IMAGE_SIZE_MISMATCH: " << name << " is " << result.m_width << "x" << result.m_height
+				<< ", golden " << width << "x" << height << "\n";
+			return false;
+		}
+
+		const std::vector<Lab> actualLab = ToLab(actual);
+		const std::vector<Lab> expectedLab = ToLab(expected);
+
+		std::vector<unsigned char> diff(actual.size());
+		unsigned differingPixels = 0;
+		double worstDifference = 0.0;
+
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const size_t pixel = static_cast<size_t>(y) * width + x;
+				const Lab& colour = actualLab[pixel];
+				float closest = FLT_MAX;
+
+				for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1); ++ny)
+				{
+					for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); ++nx)
+					{
+						const Lab& other = expectedLab[static_cast<size_t>(ny) * width + nx];
+						const float dl = colour.m_l - other.m_l;
+						const float da = colour.m_a - other.m_a;
+						const float db = colour.m_b - other.m_b;
+
+						closest = std::min(closest, dl * dl + da * da + db * db);
+					}
+				}
+
+				const double difference = std::sqrt(static_cast<double>(closest));
+				worstDifference = std::max(worstDifference, difference);
+
+				// The golden image dimmed, with differing pixels in red as bright as they are far off
+				const unsigned char grey = static_cast<unsigned char>(expectedLab[pixel].m_l * 1.6f);
+				const bool differs = difference > RegressionSuite::k_justNoticeableDifference;
+
+				diff[pixel * 4 + 0] = differs ? static_cast<unsigned char>(std::min(128.0 + difference * 4.0, 255.0)) : grey;
+				diff[pixel * 4 + 1] = differs ? 0 : grey;
+				diff[pixel * 4 + 2] = differs ? 0 : grey;
+				diff[pixel * 4 + 3] = 255;
+
+				if (differs)
+				{
+					differingPixels++;
+				}
+			}
+		}
+
+		const double differingPercent = 100.0 * differingPixels / (static_cast<double>(width) * height);
+
+		std::cout << "REGRESSION::IMAGE: " << name << " " << differingPixels << " pixels (" << differingPercent
+			<< "%) differ, worst delta E " << worstDifference << "\n";
+
+		if (differingPercent > settings.m_imageTolerance)
+		{
+			std::cout << "ERROR::REGRESSION::IMAGE_MISMATCH: " << name << " " << differingPercent << "% of pixels differ, "
+				<< settings.m_imageTolerance << "% allowed, see " << name << ".actual.png and " << name << ".diff.png\n";
+
+			SaveImage(settings.m_goldenDir + "/" + name + ".actual.png", actual, width, height);
+			SaveImage(settings.m_goldenDir + "/" + name + ".diff.png", diff, width, height);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool CheckBaseline(const std::string& name, const std::vector<Metric>& metrics, const RunSettings& settings)
+	{
+		const std::string baselineFile = settings.m_goldenDir + "/" + name + ".txt";
+		const std::string timingFile = settings.m_goldenDir + "/" + name + ".timing.txt";
+		std::map<std::string, double> baseline;
+
+		if (!LoadBaseline(baselineFile, baseline))
+		{
+			std::cout << "ERROR::REGRESSION::NO_BASELINE: " << baselineFile << ", make one with --update-golden\n";
+			return false;
+		}
+
+		// Timings are only kept per machine, the first run on one records them rather than checks them
+		const bool checkTimings = std::ifstream(timingFile).is_open();
+		bool passed = true;
+
+		if (checkTimings)
+		{
+			if (!LoadBaseline(timingFile, baseline))
+				return false;
+		} else
+		{
+			std::cout << "REGRESSION::NEW_TIMING_BASELINE: " << timingFile << ", timings are checked from the next run on\n";
+			passed = SaveBaseline(timingFile, metrics, true);
+		}
+
+		for (const Metric& metric : metrics)
+		{
+			if (metric.m_timing && !checkTimings)
+				continue;
+
+			const auto expected = baseline.find(metric.m_name);
+
+			if (expected == baseline.end())
+			{
+				std::cout << "ERROR::REGRESSION::NO_BASELINE_METRIC: " << name << " " << metric.m_name << "\n";
+				passed = false;
+				continue;
+			}
+
+			const double limit = metric.m_timing ?
+				expected->second * (1.0 + settings.m_timeThreshold / 100.0) : expected->second + k_countSlack;
+			const bool within = metric.m_value <= limit;
+
+			std::cout << "REGRESSION::METRIC: " << name << " " << metric.m_name << " " << metric.m_value
+				<< " (baseline " << expected->second << ")" << (within ? "" : " OVER") << "\n";
+
+			if (!within)
+			{
+				std::cout << "ERROR::REGRESSION::" << (metric.m_timing ? "SLOWER" : "MORE_WORK") << ": " << name << " "
+					<< metric.m_name << " " << metric.m_value << " over its limit of " << limit << "\n";
+				passed = false;
+			}
+		}
+
+		return passed;
+	}
+}
+
+int RegressionSuite::Run(const RunSettings& settings)
+{
+	const std::vector<RegressionScene> scenes = MakeScenes();
+	std::vector<std::string> failed;
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	if (settings.m_updateGolden)
+	{
+		MakeDirectory(settings.m_goldenDir.c_str());
+	}
+
+	for (const RegressionScene& scene : scenes)
+	{
+		// Only the scene changes between runs, every other setting is fixed so the references stay
+		// comparable. Threading carries over, both ways must draw the same images
+		RunSettings sceneSettings;
+		sceneSettings.m_mode = eRunMode::e_Headless;
+		sceneSettings.m_renderThread = settings.m_renderThread;
+		sceneSettings.m_width = k_width;
+		sceneSettings.m_height = k_height;
+		sceneSettings.m_frames = k_frames;
+		sceneSettings.m_warmupFrames = k_warmupFrames;
+		sceneSettings.m_statsFile.clear();
+		sceneSettings.m_scene = scene.m_scene;
+
+		std::cout << "REGRESSION::SCENE: " << scene.m_name << "\n";
+
+		HeadlessResult result;
+		bool ran = false;
+
+		// Each scene gets a context of its own, gone again before the next starts
+		{
+			Game game(std::string("Regression ") + scene.m_name, k_width, k_height, 4, 5, false, sceneSettings);
+			ran = game.RunHeadless(&result);
+		}
+
+		if (!ran || result.m_image.empty())
+		{
+			std::cout << "ERROR::REGRESSION::RUN_FAILED: " << scene.m_name << "\n";
+			failed.push_back(scene.m_name);
+			continue;
+		}
+
+		const std::vector<Metric> metrics = MakeMetrics(result);
+
+		if (settings.m_updateGolden)
+		{
+			const std::string base = settings.m_goldenDir + "/" + scene.m_name;
+			const bool saved = SaveImage(base + ".png", FlipRows(result.m_image, result.m_width, result.m_height), result.m_width, result.m_height) &&
+				SaveBaseline(base + ".txt", metrics, false) && SaveBaseline(base + ".timing.txt", metrics, true);
+
+			if (!saved)
+			{
+				failed.push_back(scene.m_name);
+				continue;
+			}
+
+			std::cout << "REGRESSION::UPDATED: " << scene.m_name << " frame p50 " << metrics[0].m_value << "ms, references in " << settings.m_goldenDir << "\n";
+			continue;
+		}
+
+		// Both checks run whatever the first says, so one run reports everything that changed
+		const bool imagePassed = CheckImage(scene.m_name, result, settings);
+		const bool baselinePassed = CheckBaseline(scene.m_name, metrics, settings);
+
+		if (imagePassed && baselinePassed)
+		{
+			std::cout << "REGRESSION::PASS: " << scene.m_name << "\n";
+		} else
+		{
+			std::cout << "REGRESSION::FAIL: " << scene.m_name << "\n";
+			failed.push_back(scene.m_name);
+		}
+	}
+
+	if (failed.empty())
+	{
+		std::cout << "REGRESSION: " << (settings.m_updateGolden ? "updated " : "passed ") << scenes.size() << " scenes\n";
+		return 0;
+	}
+
+	std::cout << "\n========================================\n";
+	std::cout << (settings.m_updateGolden ? "REGRESSION UPDATE FAILED: " : "REGRESSION FAILED: ")
+		<< failed.size() << " of " << scenes.size() << " scenes\n";
+
+	for (const std::string& name : failed)
+	{
+		std::cout << "  " << name << "\n";
+	}
+
+	std::cout << "========================================\n";
+	return 1;
+}
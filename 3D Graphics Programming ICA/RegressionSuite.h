@@ -0,0 +1,27 @@
+#pragma once
+#include "RunSettings.h"
+
+// Renders a fixed set of scenes headless, each along the default orbit, and checks every one
+// against references in the golden directory: its last frame against a golden image and its frame
+// times and per-frame counts against a baseline. The images and counts are committed, made under
+// Mesa llvmpipe with --update-golden. Timings only mean something on the machine and driver that
+// made them, so they live in <scene>.timing.txt, which isn't committed. The first run on a machine
+// records them and later runs check them.
+//
+// Images are compared perceptually. Each pixel is taken to CIELAB and matched against the closest
+// golden pixel within one pixel of it, which forgives rasterisation moving an edge over by one.
+// Anything still further apart than the eye can tell counts as a differing pixel.
+class RegressionSuite
+{
+public:
+	// CIE76 distance below which two colours look the same
+	static constexpr double k_justNoticeableDifference = 2.3;
+
+	static constexpr int k_width = 320;
+	static constexpr int k_height = 240;
+	static constexpr unsigned k_frames = 300;
+	static constexpr unsigned k_warmupFrames = 30;
+
+	// 0 if every scene passed, or its references were updated, 1 otherwise
+	static int Run(const RunSettings& settings);
+};
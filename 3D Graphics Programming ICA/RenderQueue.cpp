@@ -0,0 +1,469 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Constants.h"
+#include "Profiler.h"
+
+RenderQueue::RenderQueue(const std::vector<Shader*>& shaders, const std::vector<Material*>& materials) :
+	m_shaders(shaders),
+	m_materials(materials),
+	m_commandBuffer(0),
+	m_drawDataBuffer(0),
+	m_drawDataAlignment(1),
+	m_boundTextures(),
+	m_currentShader(~0u),
+	m_currentVao(0),
+	m_keyOverflows(0),
+	m_loggedKeyOverflows(0)
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+	if (m_commandBuffer == 0)
+		return;
+
+	glDeleteBuffers(1, &m_commandBuffer);
+	glDeleteBuffers(1, &m_drawDataBuffer);
+}
+
+void RenderQueue::SetIndirectShader(const unsigned shaderId)
+{
+	if (m_indirectShaders.size() <= shaderId)
+	{
+		m_indirectShaders.resize(shaderId + 1, 0);
+	}
+
+	m_indirectShaders[shaderId] = 1;
+}
+
+unsigned RenderQueue::RegisterTextureSet(const std::vector<const Texture*>& textures)
+{
+	if (textures.size() > k_maxTextureUnits)
+	{
+		std::cout << "ERROR::RENDERQUEUE::TOO_MANY_TEXTURES_IN_SET" << "\n";
+	}
+
+	std::vector<TextureSetEntry> textureSet;
+	for (size_t unit = 0; unit < std::min<size_t>(textures.size(), k_maxTextureUnits); ++unit)
+	{
+		textureSet.push_back({ textures[unit], nullptr, 0 });
+	}
+
+	m_textureSets.push_back(std::move(textureSet));
+
+	return static_cast<unsigned>(m_textureSets.size() - 1);
+}
+
+unsigned RenderQueue::RegisterArrayTextureSet(const TextureArrayPool& pool, const std::vector<unsigned>& arrays)
+{
+	if (arrays.size() > k_maxTextureUnits)
+	{
+		std::cout << "ERROR::RENDERQUEUE::TOO_MANY_TEXTURES_IN_SET" << "\n";
+	}
+
+	std::vector<TextureSetEntry> textureSet;
+	for (size_t unit = 0; unit < std::min<size_t>(arrays.size(), k_maxTextureUnits); ++unit)
+	{
+		textureSet.push_back({ nullptr, &pool, arrays[unit] });
+	}
+
+	m_textureSets.push_back(std::move(textureSet));
+
+	return static_cast<unsigned>(m_textureSets.size() - 1);
+}
+
+void RenderQueue::Submit(const eRenderPass pass, const unsigned shaderId, const unsigned materialId, const unsigned textureSetId,
+	const Geometry& geometry, const glm::mat4& modelMatrix, const float depth)
+{
+	const unsigned packet = static_cast<unsigned>(m_packets.size());
+
+	m_packets.push_back({ &geometry, modelMatrix, shaderId, materialId, textureSetId });
+	m_entries.push_back({ MakeKey(pass, shaderId, materialId, textureSetId, GetVaoId(geometry.GetVertexArray()), GetGeometryId(&geometry), depth),
+		packet });
+}
+
+void RenderQueue::Flush()
+{
+	ProfileScope scope("RenderQueue::Flush");
+	GpuProfileScope gpuScope("RenderQueue::Flush");
+
+	m_stats = RenderStats();
+	m_stats.m_packets = static_cast<unsigned>(m_packets.size());
+	m_stats.m_keyOverflows = m_keyOverflows;
+	m_keyOverflows = 0;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+	SortEntries();
+	m_stats.m_sortMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	if (m_drawUniforms.size() < m_shaders.size())
+	{
+		m_drawUniforms.resize(m_shaders.size());
+	}
+
+	BuildRuns();
+	UploadIndirectData();
+
+	// Material uniforms live in the program, so the last material is tracked per shader
+	m_materialOfShader.assign(m_shaders.size(), ~0u);
+	std::fill(std::begin(m_boundTextures), std::end(m_boundTextures), 0);
+	m_currentShader = ~0u;
+	m_currentVao = 0;
+
+	for (const DrawRun& run : m_runs)
+	{
+		const DrawPacket& first = m_packets[m_entries[run.m_firstEntry].m_packet];
+
+		ApplyState(first);
+
+		if (!run.m_indirect)
+		{
+			Shader& shader = *m_shaders[first.m_shaderId];
+			DrawUniforms& uniforms = m_drawUniforms[first.m_shaderId];
+
+			if (!uniforms.m_cached)
+			{
+				uniforms.m_modelMatrix = shader.GetUniform<glm::mat4>("model_matrix");
+				uniforms.m_positionScale = shader.GetUniform<glm::vec4>("position_scale");
+				uniforms.m_positionBias = shader.GetUniform<glm::vec4>("position_bias");
+				uniforms.m_cached = true;
+			}
+
+			uniforms.m_modelMatrix.Set(first.m_modelMatrix);
+			uniforms.m_positionScale.Set(first.m_geometry->GetPositionScale());
+			uniforms.m_positionBias.Set(first.m_geometry->GetPositionBias());
+
+			first.m_geometry->Draw();
+			m_stats.m_drawCalls++;
+
+			continue;
+		}
+
+		// The rest of the run shares the first packet's state by construction
+		for (unsigned i = 1; i < run.m_numOfEntries; ++i)
+		{
+			SkipState(m_packets[m_entries[run.m_firstEntry + i].m_packet]);
+		}
+
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, constants::k_drawDataBinding, m_drawDataBuffer,
+			static_cast<GLintptr>(run.m_firstDrawData) * sizeof(DrawData),
+			static_cast<GLsizeiptr>(run.m_numOfEntries) * sizeof(DrawData));
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, m_packets[m_entries[run.m_firstEntry].m_packet].m_geometry->GetIndexType(),
+			reinterpret_cast<const GLvoid*>(run.m_firstCommand * sizeof(DrawElementsIndirectCommand)),
+			static_cast<GLsizei>(run.m_numOfEntries), 0);
+
+		m_stats.m_drawCalls++;
+		m_stats.m_multiDrawCalls++;
+	}
+
+	if (m_currentShader != ~0u)
+	{
+		m_shaders[m_currentShader]->Unuse();
+	}
+
+	m_packets.clear();
+	m_entries.clear();
+	m_geometryIds.clear();
+	m_vaoIds.clear();
+}
+
+const RenderStats& RenderQueue::GetFrameStats() const
+{
+	return m_stats;
+}
+
+uint64_t RenderQueue::MakeKey(const eRenderPass pass, const unsigned shaderId, const unsigned materialId, const unsigned textureSetId,
+	const unsigned vaoId, const unsigned geometryId, const float depth)
+{
+	const float clampedDepth = std::min(std::max(depth, 0.f), 1.f);
+
+	const uint64_t passBits = static_cast<uint64_t>(pass) & 0xf;
+	const uint64_t shaderBits = ClampKeyField(shaderId, k_maxShaderKey, 0, "SHADER");
+	const uint64_t materialBits = ClampKeyField(materialId, k_maxMaterialKey, 1, "MATERIAL");
+	const uint64_t textureSetBits = ClampKeyField(textureSetId, k_maxTextureSetKey, 2, "TEXTURE_SET");
+	const uint64_t geometryBits = ClampKeyField(geometryId, k_maxGeometryKey, 3, "GEOMETRY");
+
+	if (pass == eRenderPass::e_Transparent)
+	{
+		const uint64_t depthBucket = static_cast<uint64_t>(clampedDepth * 65535.f);
+		return passBits << 60 | (0xffff - depthBucket) << 44 | shaderBits << 36 | materialBits << 24 | textureSetBits << 12 | geometryBits;
+	}
+
+	// Opaque depth gives up 4 bits to the VAO, it only orders draws within a run
+	const uint64_t vaoBits = ClampKeyField(vaoId, k_maxVaoKey, 4, "VAO");
+	const uint64_t depthBucket = static_cast<uint64_t>(clampedDepth * 4095.f);
+
+	return passBits << 60 | shaderBits << 52 | materialBits << 40 | textureSetBits << 28 | vaoBits << 24 | depthBucket << 12 | geometryBits;
+}
+
+unsigned RenderQueue::ClampKeyField(const unsigned id, const unsigned maximum, const unsigned field, const char* name)
+{
+	if (id <= maximum)
+		return id;
+
+	m_keyOverflows++;
+
+	if (!(m_loggedKeyOverflows & (1u << field)))
+	{
+		m_loggedKeyOverflows |= 1u << field;
+		std::cout << "ERROR::RENDERQUEUE::SORT_KEY_OVERFLOW: " << name << " id " << id << " past " << maximum
+			<< ", these packets will stop grouping by state" << "\n";
+	}
+
+	return maximum;
+}
+
+bool RenderQueue::IsIndirect(const unsigned shaderId) const
+{
+	return shaderId < m_indirectShaders.size() && m_indirectShaders[shaderId];
+}
+
+unsigned RenderQueue::GetGeometryId(const Geometry* geometry)
+{
+	const auto it = m_geometryIds.find(geometry);
+
+	if (it != m_geometryIds.end())
+		return it->second;
+
+	const unsigned id = static_cast<unsigned>(m_geometryIds.size());
+	m_geometryIds.emplace(geometry, id);
+
+	return id;
+}
+
+unsigned RenderQueue::GetVaoId(const GLuint vao)
+{
+	const auto it = m_vaoIds.find(vao);
+
+	if (it != m_vaoIds.end())
+		return it->second;
+
+	const unsigned id = static_cast<unsigned>(m_vaoIds.size());
+	m_vaoIds.emplace(vao, id);
+
+	return id;
+}
+
+void RenderQueue::SortEntries()
+{
+	const size_t count = m_entries.size();
+
+	if (count < 2)
+		return;
+
+	m_sortScratch.resize(count);
+
+	// LSD radix sort a byte at a time, stable so equal keys keep submission order. Bytes that
+	// are the same in every key (unused passes, a single shader...) are skipped entirely
+	unsigned histograms[8][256] = {};
+
+	for (const SortEntry& entry : m_entries)
+	{
+		for (int byte = 0; byte < 8; ++byte)
+		{
+			histograms[byte][(entry.m_key >> (byte * 8)) & 0xff]++;
+		}
+	}
+
+	SortEntry* source = m_entries.data();
+	SortEntry* destination = m_sortScratch.data();
+
+	for (int byte = 0; byte < 8; ++byte)
+	{
+		unsigned* histogram = histograms[byte];
+
+		if (histogram[(source[0].m_key >> (byte * 8)) & 0xff] == count)
+			continue;
+
+		unsigned offset = 0;
+		for (int bucket = 0; bucket < 256; ++bucket)
+		{
+			const unsigned bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			destination[histogram[(source[i].m_key >> (byte * 8)) & 0xff]++] = source[i];
+		}
+
+		std::swap(source, destination);
+	}
+
+	if (source != m_entries.data())
+	{
+		std::copy(source, source + count, m_entries.data());
+	}
+}
+
+void RenderQueue::BuildRuns()
+{
+	m_runs.clear();
+	m_commands.clear();
+	m_drawData.clear();
+
+	const unsigned numOfEntries = static_cast<unsigned>(m_entries.size());
+	unsigned entry = 0;
+
+	while (entry < numOfEntries)
+	{
+		const DrawPacket& first = m_packets[m_entries[entry].m_packet];
+
+		DrawRun run{};
+		run.m_firstEntry = entry;
+		run.m_numOfEntries = 1;
+		run.m_indirect = IsIndirect(first.m_shaderId);
+
+		if (run.m_indirect)
+		{
+			// Each run binds its own slice of the draw data, which has to start on an aligned offset
+			while (m_drawData.size() % m_drawDataAlignment != 0)
+			{
+				m_drawData.push_back(DrawData());
+			}
+
+			run.m_firstCommand = static_cast<unsigned>(m_commands.size());
+			run.m_firstDrawData = static_cast<unsigned>(m_drawData.size());
+
+			m_commands.push_back(first.m_geometry->GetDrawCommand());
+			m_drawData.push_back(MakeDrawData(first));
+
+			while (entry + run.m_numOfEntries < numOfEntries)
+			{
+				const DrawPacket& next = m_packets[m_entries[entry + run.m_numOfEntries].m_packet];
+
+				if (next.m_shaderId != first.m_shaderId ||
+					next.m_materialId != first.m_materialId ||
+					next.m_textureSetId != first.m_textureSetId ||
+					next.m_geometry->GetVertexArray() != first.m_geometry->GetVertexArray())
+					break;
+
+				m_commands.push_back(next.m_geometry->GetDrawCommand());
+				m_drawData.push_back(MakeDrawData(next));
+				run.m_numOfEntries++;
+			}
+		}
+
+		m_runs.push_back(run);
+		entry += run.m_numOfEntries;
+	}
+}
+
+void RenderQueue::UploadIndirectData()
+{
+	if (m_commands.empty())
+		return;
+
+	if (m_commandBuffer == 0)
+	{
+		glCreateBuffers(1, &m_commandBuffer);
+		glCreateBuffers(1, &m_drawDataBuffer);
+
+		// Smallest number of DrawData entries whose size is a multiple of the offset alignment
+		GLint alignment = 0;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_drawDataAlignment = 1;
+		while (alignment > 0 && (m_drawDataAlignment * sizeof(DrawData)) % static_cast<unsigned>(alignment) != 0)
+		{
+			m_drawDataAlignment++;
+		}
+
+		// The first frame's runs were padded before the alignment was known
+		BuildRuns();
+	}
+
+	// Orphan and refill, the driver hands back fresh storage instead of waiting on last frame
+	const GLsizeiptr commandBytes = static_cast<GLsizeiptr>(m_commands.size() * sizeof(DrawElementsIndirectCommand));
+	glNamedBufferData(m_commandBuffer, commandBytes, nullptr, GL_STREAM_DRAW);
+	glNamedBufferSubData(m_commandBuffer, 0, commandBytes, m_commands.data());
+
+	const GLsizeiptr drawDataBytes = static_cast<GLsizeiptr>(m_drawData.size() * sizeof(DrawData));
+	glNamedBufferData(m_drawDataBuffer, drawDataBytes, nullptr, GL_STREAM_DRAW);
+	glNamedBufferSubData(m_drawDataBuffer, 0, drawDataBytes, m_drawData.data());
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+}
+
+void RenderQueue::ApplyState(const DrawPacket& packet)
+{
+	Shader& shader = *m_shaders[packet.m_shaderId];
+
+	if (packet.m_shaderId != m_currentShader)
+	{
+		shader.Use();
+		m_currentShader = packet.m_shaderId;
+		m_stats.m_programChanges++;
+	} else
+	{
+		m_stats.m_programChangesAvoided++;
+	}
+
+	if (m_materialOfShader[packet.m_shaderId] != packet.m_materialId)
+	{
+		m_materials[packet.m_materialId]->SendToShader(shader);
+		m_materialOfShader[packet.m_shaderId] = packet.m_materialId;
+		m_stats.m_materialChanges++;
+	} else
+	{
+		m_stats.m_materialChangesAvoided++;
+	}
+
+	const std::vector<TextureSetEntry>& textureSet = m_textureSets[packet.m_textureSetId];
+	for (unsigned unit = 0; unit < textureSet.size(); ++unit)
+	{
+		const TextureSetEntry& entry = textureSet[unit];
+		const GLuint id = entry.GetID();
+
+		if (m_boundTextures[unit] != id)
+		{
+			if (entry.m_texture)
+			{
+				entry.m_texture->Bind(static_cast<GLint>(unit));
+			} else
+			{
+				entry.m_pool->Bind(entry.m_array, static_cast<GLint>(unit));
+			}
+
+			m_boundTextures[unit] = id;
+			m_stats.m_textureBinds++;
+		} else
+		{
+			m_stats.m_textureBindsAvoided++;
+		}
+	}
+
+	const GLuint vao = packet.m_geometry->GetVertexArray();
+	if (vao != m_currentVao)
+	{
+		packet.m_geometry->Bind();
+		m_currentVao = vao;
+		m_stats.m_vaoChanges++;
+	} else
+	{
+		m_stats.m_vaoChangesAvoided++;
+	}
+}
+
+void RenderQueue::SkipState(const DrawPacket& packet)
+{
+	m_stats.m_programChangesAvoided++;
+	m_stats.m_materialChangesAvoided++;
+	m_stats.m_textureBindsAvoided += static_cast<unsigned>(m_textureSets[packet.m_textureSetId].size());
+	m_stats.m_vaoChangesAvoided++;
+}
+
+GLuint RenderQueue::TextureSetEntry::GetID() const
+{
+	return m_texture ? m_texture->GetID() : m_pool->GetArrayID(m_array);
+}
+
+RenderQueue::DrawData RenderQueue::MakeDrawData(const DrawPacket& packet)
+{
+	return { packet.m_modelMatrix, packet.m_geometry->GetPositionScale(), packet.m_geometry->GetPositionBias() };
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/matrix.hpp>
+
+#include "Geometry.h"
+#include "Material.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "TextureArrayPool.h"
+
+enum class eRenderPass { e_Opaque = 0, e_Transparent };
+
+struct RenderStats
+{
+	unsigned m_packets = 0;
+	unsigned m_drawCalls = 0;
+	unsigned m_multiDrawCalls = 0;
+	unsigned m_programChanges = 0;
+	unsigned m_programChangesAvoided = 0;
+	unsigned m_vaoChanges = 0;
+	unsigned m_vaoChangesAvoided = 0;
+	unsigned m_textureBinds = 0;
+	unsigned m_textureBindsAvoided = 0;
+	unsigned m_materialChanges = 0;
+	unsigned m_materialChangesAvoided = 0;
+	// Packets with an id too wide for its key field, see RenderQueue
+	unsigned m_keyOverflows = 0;
+	double m_sortMilliseconds = 0.0;
+};
+
+// Collects every draw of a frame as a packet with a 64-bit sort key, radix sorts the keys and
+// submits in that order so packets sharing a program, material, texture set and VAO end up
+// next to each other. Each piece of state is only touched when it differs from the last packet.
+//
+// Key, most significant first:
+//   opaque:      pass(4) shader(8) material(12) texture set(12) VAO(4) depth(12) geometry(12)
+//   transparent: pass(4) inverted depth(16) shader(8) material(12) texture set(12) geometry(12)
+// Opaque draws group by state and go front to back within it. The VAO, one per GeometryArena,
+// sits above depth so each arena's packets stay together and merge into one indirect run.
+// Transparent ones are strictly back to front. An id wider than its field is clamped to the field's top value and logged once
+// per field. Those packets still draw correctly, as runs and state changes compare the real ids,
+// they just no longer group with each other.
+//
+// Packets drawn with an indirect shader are merged: each run sharing program, material and
+// texture set becomes one glMultiDrawElementsIndirect over the GeometryArena, with the model
+// matrices in a shader storage buffer indexed by gl_DrawIDARB.
+class RenderQueue
+{
+public:
+	// Shader and material ids passed to Submit() index these, the vectors must outlive the queue
+	RenderQueue(const std::vector<Shader*>& shaders, const std::vector<Material*>& materials);
+
+	~RenderQueue();
+
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// The shader must read its model matrix from the draw data block rather than a uniform
+	void SetIndirectShader(unsigned shaderId);
+
+	// Textures are bound to units 0..n-1 in the order given
+	unsigned RegisterTextureSet(const std::vector<const Texture*>& textures);
+
+	// Same, with arrays of the pool. Materials pick their layers, so every material drawn with
+	// this set shares one binding per array
+	unsigned RegisterArrayTextureSet(const TextureArrayPool& pool, const std::vector<unsigned>& arrays);
+
+	// Depth is the view distance normalised to [0, 1], anything outside is clamped
+	void Submit(eRenderPass pass, unsigned shaderId, unsigned materialId, unsigned textureSetId,
+		const Geometry& geometry, const glm::mat4& modelMatrix, float depth);
+
+	// Sorts, draws and empties the queue
+	void Flush();
+
+	const RenderStats& GetFrameStats() const;
+
+private:
+	static constexpr unsigned k_maxTextureUnits = 8;
+
+	// Top value of each key field
+	static constexpr unsigned k_maxShaderKey = 0xff;
+	static constexpr unsigned k_maxMaterialKey = 0xfff;
+	static constexpr unsigned k_maxTextureSetKey = 0xfff;
+	static constexpr unsigned k_maxVaoKey = 0xf;
+	static constexpr unsigned k_maxGeometryKey = 0xfff;
+
+	struct DrawPacket
+	{
+		const Geometry* m_geometry;
+		glm::mat4 m_modelMatrix;
+		unsigned m_shaderId;
+		unsigned m_materialId;
+		unsigned m_textureSetId;
+	};
+
+	struct SortEntry
+	{
+		uint64_t m_key;
+		unsigned m_packet;
+	};
+
+	struct DrawRun
+	{
+		unsigned m_firstEntry;
+		unsigned m_numOfEntries;
+		unsigned m_firstCommand;
+		unsigned m_firstDrawData;
+		bool m_indirect;
+	};
+
+	const std::vector<Shader*>& m_shaders;
+	// One unit of a texture set, the GL name is looked up at bind time as streaming and array
+	// growth both replace texture objects
+	struct TextureSetEntry
+	{
+		const Texture* m_texture;
+		const TextureArrayPool* m_pool;
+		unsigned m_array;
+
+		GLuint GetID() const;
+	};
+
+	const std::vector<Material*>& m_materials;
+	std::vector<std::vector<TextureSetEntry>> m_textureSets;
+
+	std::vector<DrawPacket> m_packets;
+	std::vector<SortEntry> m_entries;
+	std::vector<SortEntry> m_sortScratch;
+
+	// Geometry and VAO ids only need to be stable for a frame to keep equal ones adjacent
+	std::unordered_map<const Geometry*, unsigned> m_geometryIds;
+	std::unordered_map<GLuint, unsigned> m_vaoIds;
+
+	// Per-draw uniforms of a non-indirect shader, looked up the first time the shader is drawn with
+	struct DrawUniforms
+	{
+		UniformHandle<glm::mat4> m_modelMatrix;
+		UniformHandle<glm::vec4> m_positionScale;
+		UniformHandle<glm::vec4> m_positionBias;
+		bool m_cached = false;
+	};
+
+	// Matches DrawData in vertex_indirect.glsl
+	struct DrawData
+	{
+		glm::mat4 m_modelMatrix;
+		glm::vec4 m_positionScale;
+		glm::vec4 m_positionBias;
+	};
+
+	std::vector<DrawUniforms> m_drawUniforms;
+	std::vector<uint8_t> m_indirectShaders;
+
+	std::vector<DrawRun> m_runs;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+	std::vector<DrawData> m_drawData;
+	GLuint m_commandBuffer;
+	GLuint m_drawDataBuffer;
+	unsigned m_drawDataAlignment;
+
+	// GL state as left by the previous packet of the current Flush()
+	std::vector<unsigned> m_materialOfShader;
+	GLuint m_boundTextures[k_maxTextureUnits];
+	unsigned m_currentShader;
+	GLuint m_currentVao;
+
+	RenderStats m_stats;
+	// Since the last Flush(), and one bit per field already logged
+	unsigned m_keyOverflows;
+	unsigned m_loggedKeyOverflows;
+
+	uint64_t MakeKey(eRenderPass pass, unsigned shaderId, unsigned materialId, unsigned textureSetId,
+		unsigned vaoId, unsigned geometryId, float depth);
+
+	unsigned ClampKeyField(unsigned id, unsigned maximum, unsigned field, const char* name);
+
+	unsigned GetGeometryId(const Geometry* geometry);
+
+	unsigned GetVaoId(GLuint vao);
+
+	bool IsIndirect(unsigned shaderId) const;
+
+	void SortEntries();
+
+	void BuildRuns();
+
+	void UploadIndirectData();
+
+	// Sets whatever state the packet needs that the previous one didn't leave behind
+	void ApplyState(const DrawPacket& packet);
+
+	void SkipState(const DrawPacket& packet);
+
+	static DrawData MakeDrawData(const DrawPacket& packet);
+};
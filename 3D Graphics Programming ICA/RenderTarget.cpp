@@ -0,0 +1,67 @@
+#include "RenderTarget.h"
+
+#include <iostream>
+
+RenderTarget::RenderTarget(const int width, const int height) :
+	m_ID(0),
+	m_colour(0),
+	m_depthStencil(0),
+	m_width(width),
+	m_height(height)
+{
+	glCreateRenderbuffers(1, &m_colour);
+	glNamedRenderbufferStorage(m_colour, GL_RGBA8, m_width, m_height);
+
+	glCreateRenderbuffers(1, &m_depthStencil);
+	glNamedRenderbufferStorage(m_depthStencil, GL_DEPTH24_STENCIL8, m_width, m_height);
+
+	glCreateFramebuffers(1, &m_ID);
+	glNamedFramebufferRenderbuffer(m_ID, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colour);
+	glNamedFramebufferRenderbuffer(m_ID, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+
+	if (!IsComplete())
+	{
+		std::cout << "ERROR::RENDER_TARGET::INCOMPLETE: " << std::hex << glCheckNamedFramebufferStatus(m_ID, GL_FRAMEBUFFER) << std::dec << "\n";
+	}
+}
+
+RenderTarget::~RenderTarget()
+{
+	glDeleteFramebuffers(1, &m_ID);
+	glDeleteRenderbuffers(1, &m_colour);
+	glDeleteRenderbuffers(1, &m_depthStencil);
+}
+
+bool RenderTarget::IsComplete() const
+{
+	return glCheckNamedFramebufferStatus(m_ID, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void RenderTarget::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_ID);
+	glViewport(0, 0, m_width, m_height);
+}
+
+void RenderTarget::ReadPixels(std::vector<unsigned char>& rgba) const
+{
+	rgba.resize(static_cast<size_t>(m_width) * m_height * 4);
+
+	// Rows are whole multiples of 4 bytes already, but whatever the streamer left set mustn't apply
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	glNamedFramebufferReadBuffer(m_ID, GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_ID);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+}
+
+int RenderTarget::GetWidth() const
+{
+	return m_width;
+}
+
+int RenderTarget::GetHeight() const
+{
+	return m_height;
+}
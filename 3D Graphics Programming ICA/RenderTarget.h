@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <gl/glew.h>
+
+// An RGBA8 colour buffer with a depth/stencil buffer behind it, for rendering with no window
+class RenderTarget
+{
+public:
+	RenderTarget(int width, int height);
+
+	~RenderTarget();
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	bool IsComplete() const;
+
+	// Binds it for drawing and sets the viewport to cover it
+	void Bind() const;
+
+	// Copies the colour buffer out, tightly packed RGBA8 rows starting from the bottom
+	void ReadPixels(std::vector<unsigned char>& rgba) const;
+
+	int GetWidth() const;
+	int GetHeight() const;
+
+private:
+	GLuint m_ID;
+	GLuint m_colour;
+	GLuint m_depthStencil;
+	const int m_width;
+	const int m_height;
+};
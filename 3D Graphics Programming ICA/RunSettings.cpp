@@ -0,0 +1,202 @@
+#include "RunSettings.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	// Takes the value following argument i, false when there isn't one or it isn't a number
+	bool ReadUnsigned(const int argc, char* argv[], int& i, unsigned& value)
+	{
+		if (i + 1 >= argc)
+			return false;
+
+		char* end = nullptr;
+		const unsigned long number = std::strtoul(argv[++i], &end, 10);
+
+		if (*end != '\0' || argv[i][0] == '-')
+			return false;
+
+		value = static_cast<unsigned>(number);
+		return true;
+	}
+
+	bool ReadFloat(const int argc, char* argv[], int& i, float& value)
+	{
+		if (i + 1 >= argc)
+			return false;
+
+		char* end = nullptr;
+		value = std::strtof(argv[++i], &end);
+
+		return *end == '\0';
+	}
+
+	bool ReadString(const int argc, char* argv[], int& i, std::string& value)
+	{
+		if (i + 1 >= argc)
+			return false;
+
+		value = argv[++i];
+		return true;
+	}
+}
+
+bool RunSettings::Parse(const int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* argument = argv[i];
+		unsigned number = 0;
+		bool valid = true;
+
+		if (std::strcmp(argument, "--headless") == 0)
+		{
+			m_mode = eRunMode::e_Headless;
+		} else if (std::strcmp(argument, "--single-thread") == 0)
+		{
+			m_renderThread = false;
+		} else if (std::strcmp(argument, "--no-multidraw") == 0)
+		{
+			m_multiDraw = false;
+		} else if (std::strcmp(argument, "--no-texture-arrays") == 0)
+		{
+			m_textureArrays = false;
+		} else if (std::strcmp(argument, "--regress") == 0)
+		{
+			m_mode = eRunMode::e_Regress;
+		} else if (std::strcmp(argument, "--update-golden") == 0)
+		{
+			m_mode = eRunMode::e_Regress;
+			m_updateGolden = true;
+		} else if (std::strcmp(argument, "--selftest") == 0)
+		{
+			m_mode = eRunMode::e_SelfTest;
+
+			// The name is optional, anything that looks like an option isn't one
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+			{
+				m_selfTest = argv[++i];
+			}
+		} else if (std::strcmp(argument, "--cook") == 0)
+		{
+			m_mode = eRunMode::e_Cook;
+			valid = ReadString(argc, argv, i, m_cookSource) && ReadString(argc, argv, i, m_cookDestination);
+		} else if (std::strcmp(argument, "--golden-dir") == 0)
+		{
+			valid = ReadString(argc, argv, i, m_goldenDir);
+		} else if (std::strcmp(argument, "--time-threshold") == 0)
+		{
+			valid = ReadFloat(argc, argv, i, m_timeThreshold) && m_timeThreshold >= 0.f;
+		} else if (std::strcmp(argument, "--image-tolerance") == 0)
+		{
+			valid = ReadFloat(argc, argv, i, m_imageTolerance) && m_imageTolerance >= 0.f;
+		} else if (std::strcmp(argument, "--width") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, number) && number > 0;
+			m_width = static_cast<int>(number);
+		} else if (std::strcmp(argument, "--height") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, number) && number > 0;
+			m_height = static_cast<int>(number);
+		} else if (std::strcmp(argument, "--frames") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_frames) && m_frames > 0;
+		} else if (std::strcmp(argument, "--warmup") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_warmupFrames);
+		} else if (std::strcmp(argument, "--camera-path") == 0)
+		{
+			valid = ReadString(argc, argv, i, m_cameraFile);
+		} else if (std::strcmp(argument, "--record-camera") == 0)
+		{
+			valid = ReadString(argc, argv, i, m_recordCameraFile);
+		} else if (std::strcmp(argument, "--stats") == 0)
+		{
+			valid = ReadString(argc, argv, i, m_statsFile);
+		} else if (std::strcmp(argument, "--trace") == 0)
+		{
+			valid = ReadString(argc, argv, i, m_traceFile);
+		} else if (std::strcmp(argument, "--meshes") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_meshes);
+		} else if (std::strcmp(argument, "--instances") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_instances);
+		} else if (std::strcmp(argument, "--lights") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_lights);
+		} else if (std::strcmp(argument, "--materials") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_materials);
+		} else if (std::strcmp(argument, "--material-size") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_materialTextureSize) && m_scene.m_materialTextureSize > 0;
+		} else if (std::strcmp(argument, "--stream-materials") == 0)
+		{
+			m_scene.m_streamMaterials = true;
+		} else if (std::strcmp(argument, "--animate") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_animated);
+		} else if (std::strcmp(argument, "--depth") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_depth) && m_scene.m_depth > 0;
+		} else if (std::strcmp(argument, "--seed") == 0)
+		{
+			valid = ReadUnsigned(argc, argv, i, m_scene.m_seed);
+		} else if (std::strcmp(argument, "--unbatched") == 0)
+		{
+			m_scene.m_unbatched = true;
+		} else if (std::strcmp(argument, "--extent") == 0)
+		{
+			valid = ReadFloat(argc, argv, i, m_scene.m_extent) && m_scene.m_extent > 0.f;
+		} else
+		{
+			std::cout << "ERROR::RUN_SETTINGS::UNKNOWN_ARGUMENT: " << argument << "\n";
+			return false;
+		}
+
+		if (!valid)
+		{
+			std::cout << "ERROR::RUN_SETTINGS::BAD_VALUE: " << argument << "\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RunSettings::PrintUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		<< "  --headless              render offscreen and write frame statistics instead of opening a window\n"
+		<< "  --width N, --height N   framebuffer size\n"
+		<< "  --frames N              timed headless frames (600)\n"
+		<< "  --warmup N              untimed frames once textures and shaders are ready (60)\n"
+		<< "  --camera-path FILE      follow a recorded camera path, an orbit by default\n"
+		<< "  --record-camera FILE    save the camera's path on exit from a windowed run\n"
+		<< "  --stats FILE            frame statistics JSON (frame_stats.json)\n"
+		<< "  --trace FILE            Chrome trace of the headless run\n"
+		<< "  --single-thread         update and draw on the main thread rather than handing frames to a render thread\n"
+		<< "  --no-multidraw          draw meshes one call each even where multi-draw indirect is available\n"
+		<< "  --no-texture-arrays     bind each material's own textures rather than copying them into texture arrays\n"
+		<< "  --meshes N              synthetic meshes added to the scene, culled and queued one by one\n"
+		<< "  --instances N           synthetic cubes added to the scene as instanced batches\n"
+		<< "  --unbatched             synthetic cubes are drawn one Mesh at a time instead, as before batching\n"
+		<< "  --lights N              synthetic point lights added to the scene, 15 at most are shaded\n"
+		<< "  --materials N           synthetic meshes take turns with this many materials, each with its own textures\n"
+		<< "  --material-size N       width and height of each synthetic material's textures (32)\n"
+		<< "  --stream-materials      synthetic material textures stream in after the first frame instead of before it\n"
+		<< "  --animate N             synthetic meshes that spin every frame, update thread load\n"
+		<< "  --depth N               synthetic meshes are parented in chains this long (1)\n"
+		<< "  --seed N                synthetic scene seed (1)\n"
+		<< "  --extent F              half size of the box the synthetic scene fills (50)\n"
+		<< "  --regress               render the regression scenes and check them against their references\n"
+		<< "  --update-golden         render the regression scenes and make this run their references\n"
+		<< "  --golden-dir DIR        where the golden images and baselines live (Regression)\n"
+		<< "  --time-threshold PCT    how far over its baseline a timing may go (10)\n"
+		<< "  --image-tolerance PCT   share of pixels that may visibly differ from the golden image (0.5)\n"
+		<< "  --selftest [NAME]       run the named self test, or all of them, and print what they measure\n"
+		<< "  --cook SRC DST          load and optimise the model SRC and write it to DST as a .mesh file\n";
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+
+#include "Constants.h"
+#include "SyntheticScene.h"
+
+enum class eRunMode { e_Windowed, e_Headless, e_Regress, e_SelfTest, e_Cook };
+
+// How main runs the game, filled in from the command line. With no arguments it is the usual
+// window driven by keyboard and mouse.
+struct RunSettings
+{
+	eRunMode m_mode = eRunMode::e_Windowed;
+	int m_width = constants::k_screenWidth;
+	int m_height = constants::k_screenHeight;
+
+	// Headless runs render m_frames timed frames once textures and shaders have settled and
+	// m_warmupFrames more have gone by
+	unsigned m_frames = 600;
+	unsigned m_warmupFrames = 60;
+
+	// A path saved with m_recordCameraFile, an orbit of the scene when empty
+	std::string m_cameraFile;
+	// Windowed runs save the camera's path here on exit
+	std::string m_recordCameraFile;
+
+	std::string m_statsFile = "frame_stats.json";
+	// A Chrome trace of the headless run, none when empty
+	std::string m_traceFile;
+
+	// Draw on a thread of its own, which owns the GL context while the main thread updates
+	bool m_renderThread = true;
+	// Merge mesh runs into multi-draw calls where the driver allows, off to measure what it saves
+	bool m_multiDraw = true;
+	// Copy textures into array layers once streamed in, off to bind each material's own textures
+	bool m_textureArrays = true;
+
+	SyntheticSceneSettings m_scene;
+
+	// Regression runs check against references in m_goldenDir, or rewrite them when updating.
+	// A scene fails if any timing is more than m_timeThreshold percent over its baseline, or more
+	// than m_imageTolerance percent of its pixels visibly differ from the golden image
+	bool m_updateGolden = false;
+	std::string m_goldenDir = "Regression";
+	float m_timeThreshold = 10.f;
+	float m_imageTolerance = 0.5f;
+
+	// Self tests to run, every one when empty
+	std::string m_selfTest;
+
+	// Model file cooked into a .mesh file, in the quantized format the scene draws with
+	std::string m_cookSource;
+	std::string m_cookDestination;
+
+	// False on anything it doesn't understand, after saying what
+	bool Parse(int argc, char* argv[]);
+
+	static void PrintUsage(const char* program);
+};
@@ -0,0 +1,287 @@
+#include "SceneGraph.h"
+
+SceneGraph::SceneGraph(ThreadPool* threadPool) :
+	m_threadPool(threadPool),
+	m_orderDirty(false)
+{
+}
+
+NodeId SceneGraph::CreateNode(const NodeId parent, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+	const NodeId node = m_locals.Create(position, rotation, scale);
+
+	if (node >= m_parents.size())
+	{
+		m_parents.resize(node + 1, k_invalidNode);
+		m_alive.resize(node + 1, 0);
+		m_slotOfNode.resize(node + 1, 0);
+	}
+
+	m_parents[node] = parent;
+	m_alive[node] = 1;
+	m_orderDirty = true;
+
+	return node;
+}
+
+void SceneGraph::DestroyNode(const NodeId node)
+{
+	// The id stays reserved until the next rebuild has moved its children up to the parent
+	m_alive[node] = 0;
+	m_pendingRelease.push_back(node);
+	m_orderDirty = true;
+}
+
+void SceneGraph::SetParent(const NodeId node, const NodeId parent)
+{
+	m_parents[node] = parent;
+	m_orderDirty = true;
+}
+
+void SceneGraph::SetPosition(const NodeId node, const glm::vec3& position)
+{
+	m_locals.SetPosition(node, position);
+}
+
+void SceneGraph::SetRotation(const NodeId node, const glm::vec3& rotation)
+{
+	m_locals.SetRotation(node, rotation);
+}
+
+void SceneGraph::SetScale(const NodeId node, const glm::vec3& scale)
+{
+	m_locals.SetScale(node, scale);
+}
+
+glm::vec3 SceneGraph::GetPosition(const NodeId node) const
+{
+	return m_locals.GetPosition(node);
+}
+
+glm::vec3 SceneGraph::GetRotation(const NodeId node) const
+{
+	return m_locals.GetRotation(node);
+}
+
+glm::vec3 SceneGraph::GetScale(const NodeId node) const
+{
+	return m_locals.GetScale(node);
+}
+
+NodeId SceneGraph::GetParent(const NodeId node) const
+{
+	return m_parents[node];
+}
+
+const glm::mat4& SceneGraph::GetLocalMatrix(const NodeId node) const
+{
+	return m_locals.GetMatrix(node);
+}
+
+const glm::mat4& SceneGraph::GetWorldMatrix(const NodeId node) const
+{
+	return m_worldMatrices[m_slotOfNode[node]];
+}
+
+unsigned SceneGraph::Update()
+{
+	if (m_orderDirty)
+	{
+		RebuildOrder();
+	}
+
+	// Seed each level with the nodes whose own transform changed
+	for (const TransformId node : m_locals.GetDirtyList())
+	{
+		if (m_alive[node])
+		{
+			QueueSlot(m_slotOfNode[node]);
+		}
+	}
+
+	m_locals.UpdateDirty();
+	m_updatedNodes.clear();
+
+	unsigned numUpdated = 0;
+
+	for (size_t level = 0; level < m_dirtyLevels.size(); ++level)
+	{
+		std::vector<unsigned>& slots = m_dirtyLevels[level];
+
+		if (slots.empty())
+			continue;
+
+		UpdateLevel(slots);
+		numUpdated += static_cast<unsigned>(slots.size());
+
+		// A changed world matrix invalidates every child, clean branches are never visited
+		for (const unsigned slot : slots)
+		{
+			const unsigned firstChild = m_firstChildSlot[slot];
+			for (unsigned child = firstChild; child < firstChild + m_childCount[slot]; ++child)
+			{
+				QueueSlot(child);
+			}
+
+			m_queued[slot] = 0;
+			m_updatedNodes.push_back(m_nodeOfSlot[slot]);
+		}
+
+		slots.clear();
+	}
+
+	return numUpdated;
+}
+
+const std::vector<NodeId>& SceneGraph::GetUpdatedNodes() const
+{
+	return m_updatedNodes;
+}
+
+unsigned SceneGraph::GetNodeCount() const
+{
+	return static_cast<unsigned>(m_nodeOfSlot.size());
+}
+
+unsigned SceneGraph::GetLevelCount() const
+{
+	return static_cast<unsigned>(m_dirtyLevels.size());
+}
+
+void SceneGraph::RebuildOrder()
+{
+	const NodeId numOfNodes = static_cast<NodeId>(m_parents.size());
+
+	// Skip over destroyed ancestors before their ids are handed back out
+	for (NodeId node = 0; node < numOfNodes; ++node)
+	{
+		NodeId parent = m_parents[node];
+		while (parent != k_invalidNode && !m_alive[parent])
+		{
+			parent = m_parents[parent];
+		}
+		m_parents[node] = parent;
+	}
+
+	for (const NodeId node : m_pendingRelease)
+	{
+		m_parents[node] = k_invalidNode;
+		m_locals.Release(node);
+	}
+
+	m_pendingRelease.clear();
+
+	// Bucket children by parent, roots go under k_invalidNode
+	std::vector<unsigned> childStart(numOfNodes + 2, 0);
+	for (NodeId node = 0; node < numOfNodes; ++node)
+	{
+		if (m_alive[node])
+		{
+			const NodeId parent = m_parents[node];
+			childStart[(parent == k_invalidNode ? numOfNodes : parent) + 1]++;
+		}
+	}
+
+	for (size_t i = 1; i < childStart.size(); ++i)
+	{
+		childStart[i] += childStart[i - 1];
+	}
+
+	std::vector<NodeId> children(childStart.back());
+	std::vector<unsigned> fill(childStart.begin(), childStart.end() - 1);
+	for (NodeId node = 0; node < numOfNodes; ++node)
+	{
+		if (m_alive[node])
+		{
+			const NodeId parent = m_parents[node];
+			children[fill[parent == k_invalidNode ? numOfNodes : parent]++] = node;
+		}
+	}
+
+	m_nodeOfSlot.clear();
+	m_parentSlot.clear();
+	m_levelOfSlot.clear();
+
+	for (unsigned i = childStart[numOfNodes]; i < childStart[numOfNodes + 1]; ++i)
+	{
+		m_nodeOfSlot.push_back(children[i]);
+		m_parentSlot.push_back(~0u);
+		m_levelOfSlot.push_back(0);
+	}
+
+	// Breadth-first: appending each slot's children in slot order keeps siblings contiguous
+	m_firstChildSlot.assign(m_nodeOfSlot.size(), 0);
+	m_childCount.assign(m_nodeOfSlot.size(), 0);
+
+	for (unsigned slot = 0; slot < m_nodeOfSlot.size(); ++slot)
+	{
+		const NodeId node = m_nodeOfSlot[slot];
+		m_slotOfNode[node] = slot;
+		m_firstChildSlot[slot] = static_cast<unsigned>(m_nodeOfSlot.size());
+		m_childCount[slot] = childStart[node + 1] - childStart[node];
+
+		for (unsigned i = childStart[node]; i < childStart[node + 1]; ++i)
+		{
+			m_nodeOfSlot.push_back(children[i]);
+			m_parentSlot.push_back(slot);
+			m_levelOfSlot.push_back(m_levelOfSlot[slot] + 1);
+			m_firstChildSlot.push_back(0);
+			m_childCount.push_back(0);
+		}
+	}
+
+	const unsigned numOfLevels = m_nodeOfSlot.empty() ? 0 : m_levelOfSlot.back() + 1;
+
+	m_worldMatrices.assign(m_nodeOfSlot.size(), glm::mat4(1.f));
+	m_queued.assign(m_nodeOfSlot.size(), 0);
+	m_dirtyLevels.resize(numOfLevels);
+
+	for (auto& level : m_dirtyLevels)
+	{
+		level.clear();
+	}
+
+	// The slots all moved, so every world matrix is rebuilt starting from the roots
+	for (unsigned slot = 0; slot < m_nodeOfSlot.size() && m_levelOfSlot[slot] == 0; ++slot)
+	{
+		QueueSlot(slot);
+	}
+
+	m_orderDirty = false;
+}
+
+void SceneGraph::QueueSlot(const unsigned slot)
+{
+	if (m_queued[slot])
+		return;
+
+	m_queued[slot] = 1;
+	m_dirtyLevels[m_levelOfSlot[slot]].push_back(slot);
+}
+
+void SceneGraph::UpdateLevel(const std::vector<unsigned>& slots)
+{
+	// Parents all belong to the previous level, which is already final, so slots in one level
+	// are independent of each other
+	const auto updateRange = [this, &slots](const unsigned begin, const unsigned end)
+	{
+		for (unsigned i = begin; i < end; ++i)
+		{
+			const unsigned slot = slots[i];
+			const glm::mat4& local = m_locals.GetMatrix(m_nodeOfSlot[slot]);
+			const unsigned parentSlot = m_parentSlot[slot];
+
+			m_worldMatrices[slot] = parentSlot == ~0u ? local : m_worldMatrices[parentSlot] * local;
+		}
+	};
+
+	const unsigned count = static_cast<unsigned>(slots.size());
+
+	if (m_threadPool && count > k_parallelGrainSize)
+	{
+		m_threadPool->ParallelFor(count, k_parallelGrainSize, updateRange);
+	} else
+	{
+		updateRange(0, count);
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/matrix.hpp>
+
+#include "ThreadPool.h"
+#include "TransformStore.h"
+
+using NodeId = TransformId;
+constexpr NodeId k_invalidNode = ~0u;
+
+// Parent/child transform hierarchy. Local transforms live in a TransformStore indexed by NodeId,
+// world matrices are kept in breadth-first order so every parent comes before its children and
+// each parent's children are contiguous. Update() walks the levels top down, only visiting nodes
+// whose local transform or an ancestor changed, and splits each level across the thread pool.
+class SceneGraph
+{
+public:
+	explicit SceneGraph(ThreadPool* threadPool = nullptr);
+
+	NodeId CreateNode(NodeId parent, const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+	// Children of a destroyed node are moved up to its parent
+	void DestroyNode(NodeId node);
+
+	void SetParent(NodeId node, NodeId parent);
+
+	void SetPosition(NodeId node, const glm::vec3& position);
+	void SetRotation(NodeId node, const glm::vec3& rotation);
+	void SetScale(NodeId node, const glm::vec3& scale);
+
+	glm::vec3 GetPosition(NodeId node) const;
+	glm::vec3 GetRotation(NodeId node) const;
+	glm::vec3 GetScale(NodeId node) const;
+
+	NodeId GetParent(NodeId node) const;
+
+	const glm::mat4& GetLocalMatrix(NodeId node) const;
+	const glm::mat4& GetWorldMatrix(NodeId node) const;
+
+	// Returns the number of world matrices recomputed
+	unsigned Update();
+
+	// Nodes whose world matrix was recomputed by the last Update()
+	const std::vector<NodeId>& GetUpdatedNodes() const;
+
+	unsigned GetNodeCount() const;
+	unsigned GetLevelCount() const;
+
+private:
+	static constexpr unsigned k_parallelGrainSize = 2048;
+
+	ThreadPool* m_threadPool;
+	TransformStore m_locals;
+
+	// Indexed by NodeId
+	std::vector<NodeId> m_parents;
+	std::vector<uint8_t> m_alive;
+	std::vector<unsigned> m_slotOfNode;
+	std::vector<NodeId> m_pendingRelease;
+
+	// Indexed by breadth-first slot
+	std::vector<NodeId> m_nodeOfSlot;
+	std::vector<unsigned> m_parentSlot;
+	std::vector<unsigned> m_levelOfSlot;
+	std::vector<unsigned> m_firstChildSlot;
+	std::vector<unsigned> m_childCount;
+	std::vector<glm::mat4> m_worldMatrices;
+	std::vector<uint8_t> m_queued;
+
+	std::vector<std::vector<unsigned>> m_dirtyLevels;
+	std::vector<NodeId> m_updatedNodes;
+	bool m_orderDirty;
+
+	void RebuildOrder();
+
+	void QueueSlot(unsigned slot);
+
+	void UpdateLevel(const std::vector<unsigned>& slots);
+};
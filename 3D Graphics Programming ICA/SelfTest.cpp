@@ -0,0 +1,2015 @@
+#include "SelfTest.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Bounds.h"
+#include "Bvh.h"
+#include "Frustum.h"
+#include "Game.h"
+#include "GeometryRegistry.h"
+#include "HeadlessContext.h"
+#include "MeshOptimizer.h"
+#include "MipGenerator.h"
+#include "ObjLoader.h"
+#include "SceneGraph.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include "TransformStore.h"
+#include "VertexFormat.h"
+
+namespace
+{
+	struct SelfTestEntry
+	{
+		const char* m_name;
+		bool (*m_run)(const RunSettings& settings);
+	};
+
+	// Timed runs of each CPU benchmark, the fastest is reported as the least disturbed
+	constexpr unsigned k_timedRuns = 5;
+
+	// Floats from the raw engine output, the same on every standard library
+	float NextFloat(std::mt19937& engine, const float min, const float max)
+	{
+		return min + (max - min) * static_cast<float>(engine() >> 8) * (1.f / 16777216.f);
+	}
+
+	glm::vec3 NextVec3(std::mt19937& engine, const float min, const float max)
+	{
+		glm::vec3 value;
+		value.x = NextFloat(engine, min, max);
+		value.y = NextFloat(engine, min, max);
+		value.z = NextFloat(engine, min, max);
+
+		return value;
+	}
+
+	template <typename Work>
+	double BestMs(Work work)
+	{
+		double best = 0.0;
+
+		for (unsigned run = 0; run < k_timedRuns; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			work();
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+			best = run == 0 ? ms : std::min(best, ms);
+		}
+
+		return best;
+	}
+
+	double Median(std::vector<double> values)
+	{
+		if (values.empty())
+			return 0.0;
+
+		const auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+		std::nth_element(values.begin(), middle, values.end());
+
+		return *middle;
+	}
+
+	// A synthetic scene along the default orbit, in a context of its own that is gone again on return
+	bool RunScene(const std::string& name, const SyntheticSceneSettings& scene, const bool renderThread, const bool multiDraw,
+		const bool textureArrays, HeadlessResult& result)
+	{
+		RunSettings sceneSettings;
+		sceneSettings.m_mode = eRunMode::e_Headless;
+		sceneSettings.m_renderThread = renderThread;
+		sceneSettings.m_multiDraw = multiDraw;
+		sceneSettings.m_textureArrays = textureArrays;
+		sceneSettings.m_width = SelfTest::k_width;
+		sceneSettings.m_height = SelfTest::k_height;
+		sceneSettings.m_frames = SelfTest::k_frames;
+		sceneSettings.m_warmupFrames = SelfTest::k_warmupFrames;
+		sceneSettings.m_statsFile.clear();
+		sceneSettings.m_scene = scene;
+
+		Game game("Self test " + name, SelfTest::k_width, SelfTest::k_height, 4, 5, false, sceneSettings);
+
+		if (!game.RunHeadless(&result))
+		{
+			std::cout << "ERROR::SELFTEST::RUN_FAILED: " << name << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// GLEW loaded on a bare headless context, for tests that upload geometry without a whole Game
+	bool InitTestContext(const HeadlessContext& context)
+	{
+		if (!context.IsValid())
+		{
+			std::cout << "ERROR::SELFTEST::NO_CONTEXT" << "\n";
+			return false;
+		}
+
+		glewExperimental = GL_TRUE;
+		const GLenum result = glewInit();
+
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		// As in Game::InitGLEW, GLEW built for GLX finds no display under EGL but its entry points are fine
+		const bool initialised = result == GLEW_OK || result == GLEW_ERROR_NO_GLX_DISPLAY;
+#else
+		const bool initialised = result == GLEW_OK;
+#endif
+
+		if (!initialised)
+		{
+			std::cout << "ERROR::SELFTEST::GLEW_INIT_FAILED" << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	void PrintScene(const std::string& name, const HeadlessResult& result)
+	{
+		std::cout << "SELFTEST::SCENE: " << name << " frame p50 " << Median(result.m_frameMs) << "ms, cpu p50 " << Median(result.m_cpuMs)
+			<< "ms (update " << Median(result.m_updateMs) << "ms, render " << Median(result.m_renderMs) << "ms), "
+			<< result.m_drawCalls << " draw calls, " << result.m_uniformGlCalls << " uniform GL calls per frame" << "\n";
+	}
+
+	// The cubes of the instanced batches drawn as batches and as a Mesh each, the way they were
+	// drawn before batching
+	bool TestInstancing(const RunSettings& settings)
+	{
+		SyntheticSceneSettings scene;
+		scene.m_instances = 10000;
+		scene.m_extent = 30.f;
+
+		HeadlessResult batched;
+		HeadlessResult unbatched;
+
+		if (!RunScene("batched", scene, settings.m_renderThread, true, true, batched))
+			return false;
+
+		scene.m_unbatched = true;
+
+		if (!RunScene("unbatched", scene, settings.m_renderThread, true, true, unbatched))
+			return false;
+
+		PrintScene("batched", batched);
+		PrintScene("unbatched", unbatched);
+
+		const double batchedMs = std::max(Median(batched.m_renderMs), 1e-3);
+		std::cout << "SELFTEST::INSTANCING: " << scene.m_instances << " cubes, rendering " << Median(unbatched.m_renderMs) / batchedMs
+			<< "x faster batched, whole frame " << Median(unbatched.m_frameMs) / std::max(Median(batched.m_frameMs), 1e-3) << "x" << "\n";
+
+		// One call per cube against one per batch, the rest of the scene draws the same
+		const unsigned perBatch = SyntheticScene::k_instancesPerBatch;
+		const double batches = (scene.m_instances + perBatch - 1) / perBatch;
+		if (unbatched.m_drawCalls - batched.m_drawCalls != scene.m_instances - batches)
+		{
+			std::cout << "ERROR::SELFTEST::INSTANCING_DRAW_CALLS: batched " << batched.m_drawCalls << ", unbatched " << unbatched.m_drawCalls << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// Meshes culled and queued one by one, drawn as multi-draw runs over the geometry arena and as
+	// a call each, the way they were drawn before the arena
+	bool TestMultiDraw(const RunSettings& settings)
+	{
+		SyntheticSceneSettings scene;
+		scene.m_meshes = 5000;
+		scene.m_extent = 30.f;
+
+		HeadlessResult merged;
+		HeadlessResult separate;
+
+		if (!RunScene("multi-draw", scene, settings.m_renderThread, true, true, merged))
+			return false;
+
+		if (!RunScene("draw per mesh", scene, settings.m_renderThread, false, true, separate))
+			return false;
+
+		PrintScene("multi-draw", merged);
+		PrintScene("draw per mesh", separate);
+
+		if (!GLEW_ARB_shader_draw_parameters)
+		{
+			std::cout << "SELFTEST::MULTIDRAW: no ARB_shader_draw_parameters, both runs drew a call per mesh" << "\n";
+			return true;
+		}
+
+		std::cout << "SELFTEST::MULTIDRAW: " << scene.m_meshes << " meshes, " << merged.m_visibleMeshes << " visible per frame, rendering "
+			<< Median(separate.m_renderMs) / std::max(Median(merged.m_renderMs), 1e-3) << "x faster merged, cpu "
+			<< Median(separate.m_cpuMs) / std::max(Median(merged.m_cpuMs), 1e-3) << "x, whole frame "
+			<< Median(separate.m_frameMs) / std::max(Median(merged.m_frameMs), 1e-3) << "x" << "\n";
+
+		// Both follow the same orbit, so they see the same meshes and only the calls may differ
+		if (merged.m_visibleMeshes != separate.m_visibleMeshes || merged.m_drawCalls >= separate.m_drawCalls)
+		{
+			std::cout << "ERROR::SELFTEST::MULTIDRAW_NOT_MERGED: " << merged.m_drawCalls << " draw calls merged, " << separate.m_drawCalls << " separate" << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// Meshes taking turns with a few hundred materials, each with textures of its own, drawn with
+	// every material's textures bound one by one and with them copied into array layers. Every
+	// material texture is the same size and format, so the arrays path should bind each array
+	// once on each unit it is used on, a frame
+	bool TestMaterials(const RunSettings& settings)
+	{
+		SyntheticSceneSettings scene;
+		scene.m_meshes = 3000;
+		scene.m_materials = 300;
+		scene.m_extent = 30.f;
+
+		HeadlessResult arrays;
+		HeadlessResult separate;
+
+		if (!RunScene("texture arrays", scene, settings.m_renderThread, true, true, arrays))
+			return false;
+
+		if (!RunScene("texture per material", scene, settings.m_renderThread, true, false, separate))
+			return false;
+
+		PrintScene("texture arrays", arrays);
+		PrintScene("texture per material", separate);
+
+		// Every set has a diffuse and a specular map
+		const unsigned numOfUnits = 2;
+
+		std::cout << "SELFTEST::MATERIALS: " << scene.m_materials << " materials, " << arrays.m_visibleMeshes << " visible meshes per frame, "
+			<< separate.m_textureBinds << " texture binds per frame separate, " << arrays.m_textureBinds << " with " << arrays.m_textureArrays
+			<< " arrays (" << arrays.m_textureArrayBinds << " of them arrays), rendering "
+			<< Median(separate.m_renderMs) / std::max(Median(arrays.m_renderMs), 1e-3) << "x faster with arrays" << "\n";
+
+		if (arrays.m_textureArrays == 0 || arrays.m_textureArrayBinds > arrays.m_textureArrays * numOfUnits ||
+			arrays.m_textureBinds >= separate.m_textureBinds)
+		{
+			std::cout << "ERROR::SELFTEST::MATERIALS_TEXTURE_BINDS: " << arrays.m_textureArrayBinds << " array binds for " << arrays.m_textureArrays
+				<< " arrays, " << arrays.m_textureBinds << " binds with arrays, " << separate.m_textureBinds << " without" << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// A hundred generated textures, the maps of fifty materials, uploaded before the first frame and
+	// then streamed in behind it. Streaming should get the first frame out sooner, and once every
+	// texture is in draw the same picture as uploading them up front
+	bool TestStreaming(const RunSettings& settings)
+	{
+		SyntheticSceneSettings scene;
+		scene.m_meshes = 1000;
+		scene.m_materials = 50;
+		scene.m_materialTextureSize = 512;
+		scene.m_extent = 30.f;
+
+		HeadlessResult uploaded;
+		HeadlessResult streamed;
+
+		if (!RunScene("textures uploaded", scene, settings.m_renderThread, true, true, uploaded))
+			return false;
+
+		scene.m_streamMaterials = true;
+
+		if (!RunScene("textures streamed", scene, settings.m_renderThread, true, true, streamed))
+			return false;
+
+		PrintScene("textures uploaded", uploaded);
+		PrintScene("textures streamed", streamed);
+
+		// The scene's own textures stream in both runs
+		const unsigned numOfTextures = scene.m_materials * 2;
+		const unsigned texturesStreamed = streamed.m_texturesStreamed - uploaded.m_texturesStreamed;
+
+		std::cout << "SELFTEST::STREAMING: " << texturesStreamed << " textures of " << scene.m_materialTextureSize << "x" << scene.m_materialTextureSize
+			<< ", first frame after " << streamed.m_firstFrameMs << "ms streamed, " << uploaded.m_firstFrameMs << "ms uploaded up front" << "\n";
+		std::cout << "SELFTEST::STREAMING: streamed in over " << streamed.m_streamingMs << "ms after the first frame, worst frame "
+			<< streamed.m_streamingWorstFrameMs << "ms" << "\n";
+
+		if (texturesStreamed != numOfTextures)
+		{
+			std::cout << "ERROR::SELFTEST::STREAMING_TEXTURES: " << texturesStreamed << " streamed, expected " << numOfTextures << "\n";
+			return false;
+		}
+
+		if (streamed.m_image != uploaded.m_image)
+		{
+			size_t differing = 0;
+
+			for (size_t i = 0; i < std::min(streamed.m_image.size(), uploaded.m_image.size()); ++i)
+			{
+				differing += streamed.m_image[i] != uploaded.m_image[i] ? 1 : 0;
+			}
+
+			std::cout << "ERROR::SELFTEST::STREAMING_IMAGE_DIFFERS: " << differing << " bytes of " << uploaded.m_image.size() << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// Every synthetic mesh spinning in chains, so updating the scene graph and culling cost about as
+	// much as drawing. Run with and without the render thread, throughput is frames per second of
+	// wall time. Overlap can only show on a machine with a core for each thread
+	bool TestThreading(const RunSettings&)
+	{
+		SyntheticSceneSettings scene;
+		scene.m_meshes = 20000;
+		scene.m_animated = 20000;
+		scene.m_depth = 4;
+		scene.m_extent = 40.f;
+
+		HeadlessResult serial;
+		HeadlessResult threaded;
+
+		if (!RunScene("single thread", scene, false, true, true, serial))
+			return false;
+
+		if (!RunScene("render thread", scene, true, true, true, threaded))
+			return false;
+
+		PrintScene("single thread", serial);
+		PrintScene("render thread", threaded);
+
+		const auto framesPerSecond = [](const HeadlessResult& result)
+		{
+			const double totalMs = std::accumulate(result.m_frameMs.begin(), result.m_frameMs.end(), 0.0);
+			return result.m_frameMs.size() * 1000.0 / std::max(totalMs, 1e-3);
+		};
+
+		// What perfect overlap would give, the slower of the two threads setting the pace
+		const double updateMs = Median(serial.m_updateMs);
+		const double renderMs = Median(serial.m_renderMs);
+		const double idealRatio = (updateMs + renderMs) / std::max(std::max(updateMs, renderMs), 1e-3);
+
+		std::cout << "SELFTEST::THREADING: " << std::thread::hardware_concurrency() << " hardware threads, " << scene.m_animated
+			<< " animated meshes in chains of " << scene.m_depth << ", single thread " << framesPerSecond(serial) << " frames/s, render thread "
+			<< framesPerSecond(threaded) << " frames/s, " << framesPerSecond(threaded) / framesPerSecond(serial)
+			<< "x the throughput (" << idealRatio << "x with perfect overlap)" << "\n";
+
+		if (std::thread::hardware_concurrency() < 2)
+		{
+			std::cout << "SELFTEST::THREADING: one hardware thread, the two threads take turns and cannot overlap" << "\n";
+		}
+
+		return true;
+	}
+
+	// Every transform of the store rebuilt at once against the glm calls Mesh made per mesh
+	bool TestTransforms(const RunSettings&)
+	{
+		const unsigned count = 100000;
+
+		std::mt19937 engine(1);
+		std::vector<glm::vec3> positions(count);
+		std::vector<glm::vec3> rotations(count);
+		std::vector<glm::vec3> scales(count);
+
+		TransformStore store;
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			positions[i] = NextVec3(engine, -50.f, 50.f);
+			rotations[i] = NextVec3(engine, -360.f, 360.f);
+			scales[i] = NextVec3(engine, 0.25f, 1.5f);
+			store.Create(positions[i], rotations[i], scales[i]);
+		}
+
+		std::vector<glm::mat4> perMesh(count);
+
+		const double perMeshMs = BestMs([&]()
+		{
+			for (unsigned i = 0; i < count; ++i)
+			{
+				glm::mat4 matrix = glm::translate(glm::mat4(1.f), positions[i]);
+				matrix = glm::rotate(matrix, glm::radians(rotations[i].x), glm::vec3(1.f, 0.f, 0.f));
+				matrix = glm::rotate(matrix, glm::radians(rotations[i].y), glm::vec3(0.f, 1.f, 0.f));
+				matrix = glm::rotate(matrix, glm::radians(rotations[i].z), glm::vec3(0.f, 0.f, 1.f));
+				perMesh[i] = glm::scale(matrix, scales[i]);
+			}
+		});
+
+		// Setting the rotation is what marks a transform dirty, so it is timed with the rebuild
+		const double storeMs = BestMs([&]()
+		{
+			for (unsigned i = 0; i < count; ++i)
+			{
+				store.SetRotation(i, rotations[i]);
+			}
+
+			store.UpdateDirty();
+		});
+
+		float worstError = 0.f;
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			const glm::mat4& matrix = store.GetMatrix(i);
+
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 4; ++row)
+				{
+					worstError = std::max(worstError, std::fabs(matrix[column][row] - perMesh[i][column][row]));
+				}
+			}
+		}
+
+		std::cout << "SELFTEST::TRANSFORMS: " << count << " transforms, per mesh glm " << count / perMeshMs / 1000.0
+			<< " M matrices/s, store " << count / storeMs / 1000.0 << " M matrices/s, " << perMeshMs / std::max(storeMs, 1e-6)
+			<< "x faster, worst element difference " << std::scientific << worstError << std::fixed << "\n";
+
+		if (worstError > 1e-4f)
+		{
+			std::cout << "ERROR::SELFTEST::TRANSFORMS_DIFFER: " << worstError << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// A 100k node hierarchy updated by the scene graph, with and without the pool, against walking
+	// every node single threaded each frame
+	bool TestSceneGraph(const RunSettings&)
+	{
+		const unsigned count = 100000;
+		const unsigned roots = 100;
+		const unsigned animated = count / 100;
+
+		ThreadPool threadPool;
+		SceneGraph pooled(&threadPool);
+		SceneGraph serial;
+
+		// Every node hangs off a random earlier one, which gives trees a dozen or so levels deep
+		std::mt19937 engine(1);
+		std::vector<NodeId> parents(count, k_invalidNode);
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			parents[i] = i < roots ? k_invalidNode : engine() % i;
+
+			const glm::vec3 position = i < roots ? NextVec3(engine, -50.f, 50.f) : NextVec3(engine, -2.f, 2.f);
+			const glm::vec3 rotation = NextVec3(engine, 0.f, 360.f);
+			const glm::vec3 scale(NextFloat(engine, 0.9f, 1.1f));
+
+			pooled.CreateNode(parents[i], position, rotation, scale);
+			serial.CreateNode(parents[i], position, rotation, scale);
+		}
+
+		pooled.Update();
+		serial.Update();
+
+		std::vector<NodeId> animatedNodes(animated);
+		for (NodeId& node : animatedNodes)
+		{
+			node = engine() % count;
+		}
+
+		// Each run turns the nodes a little further so every one of them really is dirty
+		float angle = 0.f;
+
+		const auto updateAll = [&](SceneGraph& graph)
+		{
+			angle += 1.f;
+
+			for (NodeId root = 0; root < roots; ++root)
+			{
+				graph.SetRotation(root, glm::vec3(angle, 0.f, 0.f));
+			}
+
+			graph.Update();
+		};
+
+		const auto updateAnimated = [&](SceneGraph& graph)
+		{
+			angle += 1.f;
+
+			for (const NodeId node : animatedNodes)
+			{
+				graph.SetRotation(node, glm::vec3(0.f, angle, 0.f));
+			}
+
+			graph.Update();
+		};
+
+		const double allPooledMs = BestMs([&]() { updateAll(pooled); });
+		const double allSerialMs = BestMs([&]() { updateAll(serial); });
+		const double animatedPooledMs = BestMs([&]() { updateAnimated(pooled); });
+		const double animatedSerialMs = BestMs([&]() { updateAnimated(serial); });
+
+		// Parents always come before their children here, so one pass in id order is a full walk
+		std::vector<glm::mat4> walked(count);
+
+		const double walkMs = BestMs([&]()
+		{
+			for (NodeId node = 0; node < count; ++node)
+			{
+				walked[node] = parents[node] == k_invalidNode ? pooled.GetLocalMatrix(node) : walked[parents[node]] * pooled.GetLocalMatrix(node);
+			}
+		});
+
+		float worstError = 0.f;
+
+		for (NodeId node = 0; node < count; ++node)
+		{
+			const glm::mat4& world = pooled.GetWorldMatrix(node);
+
+			for (int column = 0; column < 4; ++column)
+			{
+				for (int row = 0; row < 4; ++row)
+				{
+					const float expected = walked[node][column][row];
+					worstError = std::max(worstError, std::fabs(world[column][row] - expected) / (1.f + std::fabs(expected)));
+				}
+			}
+		}
+
+		std::cout << "SELFTEST::SCENEGRAPH: " << count << " nodes in " << pooled.GetLevelCount() << " levels, "
+			<< threadPool.GetThreadCount() << " worker threads" << "\n";
+		std::cout << "SELFTEST::SCENEGRAPH: every node, pool " << allPooledMs << "ms, no pool " << allSerialMs << "ms, "
+			<< animated << " animated nodes, pool " << animatedPooledMs << "ms, no pool " << animatedSerialMs << "ms, "
+			<< "walking every node " << walkMs << "ms (" << walkMs / std::max(animatedPooledMs, 1e-6) << "x the animated update)" << "\n";
+		std::cout << "SELFTEST::SCENEGRAPH: worst relative difference from the walk " << std::scientific << worstError << std::fixed << "\n";
+
+		if (worstError > 1e-4f)
+		{
+			std::cout << "ERROR::SELFTEST::SCENEGRAPH_DIFFERS: " << worstError << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	AABB MakeBox(const glm::vec3& centre, const float halfSize)
+	{
+		return { centre - glm::vec3(halfSize), centre + glm::vec3(halfSize) };
+	}
+
+	// How far inside the plane that most nearly rejects the box it is, negative when outside
+	float FrustumMargin(const Frustum& frustum, const AABB& bounds)
+	{
+		const glm::vec3 centre = bounds.GetCentre();
+		const glm::vec3 extents = bounds.GetExtents();
+		float margin = FLT_MAX;
+
+		for (int i = 0; i < 6; ++i)
+		{
+			const glm::vec4& plane = frustum.GetPlane(i);
+			const float distance = plane.x * centre.x + plane.y * centre.y + plane.z * centre.z + plane.w;
+			const float radius = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+
+			margin = std::min(margin, distance + radius);
+		}
+
+		return margin;
+	}
+
+	// Boxes around a camera at the origin looking down -z with a 90 degree, square frustum, so the
+	// side planes are the diagonals x = +-z and y = +-z. Then a million random boxes through the
+	// SIMD test, which has to agree with the scalar one
+	bool TestFrustum(const RunSettings&)
+	{
+		const glm::mat4 projection = glm::perspective(glm::radians(90.f), 1.f, 0.1f, 100.f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+		const Frustum frustum(projection * view);
+
+		struct KnownBox
+		{
+			const char* m_name;
+			AABB m_bounds;
+			bool m_visible;
+		};
+
+		const KnownBox known[] =
+		{
+			{ "ahead", MakeBox(glm::vec3(0.f, 0.f, -10.f), 1.f), true },
+			{ "off centre", MakeBox(glm::vec3(5.f, -5.f, -10.f), 1.f), true },
+			{ "across the right plane", MakeBox(glm::vec3(10.5f, 0.f, -10.f), 1.f), true },
+			{ "around the camera", MakeBox(glm::vec3(0.f), 1.f), true },
+			{ "across the far plane", MakeBox(glm::vec3(0.f, 0.f, -100.5f), 1.f), true },
+			{ "containing the frustum", MakeBox(glm::vec3(0.f), 500.f), true },
+			{ "behind", MakeBox(glm::vec3(0.f, 0.f, 10.f), 1.f), false },
+			{ "past the far plane", MakeBox(glm::vec3(0.f, 0.f, -110.f), 1.f), false },
+			{ "left", MakeBox(glm::vec3(-13.f, 0.f, -10.f), 1.f), false },
+			{ "right", MakeBox(glm::vec3(13.f, 0.f, -10.f), 1.f), false },
+			{ "above", MakeBox(glm::vec3(0.f, 13.f, -10.f), 1.f), false },
+			{ "below", MakeBox(glm::vec3(0.f, -13.f, -10.f), 1.f), false },
+		};
+
+		const unsigned numOfKnown = static_cast<unsigned>(sizeof(known) / sizeof(known[0]));
+		bool passed = true;
+
+		BoundsSoA knownBounds;
+		knownBounds.Resize(numOfKnown);
+
+		for (unsigned i = 0; i < numOfKnown; ++i)
+		{
+			knownBounds.Set(i, known[i].m_bounds);
+		}
+
+		std::vector<unsigned> visible;
+		frustum.Cull(knownBounds, visible);
+
+		for (unsigned i = 0; i < numOfKnown; ++i)
+		{
+			const bool culledVisible = std::find(visible.begin(), visible.end(), i) != visible.end();
+
+			if (frustum.IsVisible(known[i].m_bounds) != known[i].m_visible || culledVisible != known[i].m_visible)
+			{
+				std::cout << "ERROR::SELFTEST::FRUSTUM_WRONG: " << known[i].m_name << " should be " << (known[i].m_visible ? "visible" : "culled") << "\n";
+				passed = false;
+			}
+		}
+
+		// An odd count leaves padding lanes in the last group, none of which may come back
+		const unsigned count = 1000003;
+
+		std::mt19937 engine(1);
+		std::vector<AABB> boxes(count);
+		BoundsSoA bounds;
+		bounds.Resize(count);
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			boxes[i] = MakeBox(NextVec3(engine, -120.f, 120.f), NextFloat(engine, 0.1f, 2.f));
+			bounds.Set(i, boxes[i]);
+		}
+
+		std::vector<unsigned> culled;
+		culled.reserve(count);
+
+		const double cullMs = BestMs([&]()
+		{
+			culled.clear();
+			frustum.Cull(bounds, culled);
+		});
+
+		std::vector<unsigned> scalar;
+		scalar.reserve(count);
+
+		const double scalarMs = BestMs([&]()
+		{
+			scalar.clear();
+
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (frustum.IsVisible(boxes[i]))
+				{
+					scalar.push_back(i);
+				}
+			}
+		});
+
+		// Both are ascending, any box only one of them kept has to be within rounding of a plane
+		std::vector<unsigned> differing;
+		std::set_symmetric_difference(culled.begin(), culled.end(), scalar.begin(), scalar.end(), std::back_inserter(differing));
+
+		for (const unsigned box : differing)
+		{
+			if (box >= count || std::fabs(FrustumMargin(frustum, boxes[box])) > 1e-3f)
+			{
+				std::cout << "ERROR::SELFTEST::FRUSTUM_SIMD_DISAGREES: box " << box << "\n";
+				passed = false;
+				break;
+			}
+		}
+
+		std::cout << "SELFTEST::FRUSTUM: " << numOfKnown << " known boxes, " << count << " random boxes, " << culled.size() << " visible, "
+			<< differing.size() << " on a plane either way" << "\n";
+		std::cout << "SELFTEST::FRUSTUM: SIMD " << count / cullMs / 1000.0 << " M boxes/s, scalar " << count / scalarMs / 1000.0
+			<< " M boxes/s, " << scalarMs / std::max(cullMs, 1e-6) << "x faster" << "\n";
+
+		return passed;
+	}
+
+	// The same slab test Bvh::Raycast does, entry distance or FLT_MAX on a miss
+	float RayEntry(const glm::vec3& origin, const glm::vec3& inverseDirection, const AABB& box, const float closest)
+	{
+		const glm::vec3 t0 = (box.m_min - origin) * inverseDirection;
+		const glm::vec3 t1 = (box.m_max - origin) * inverseDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+
+		const float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+		return entry <= exit && entry < closest ? entry : FLT_MAX;
+	}
+
+	// Build and refit timed, then frustum, overlap and ray queries against testing every box, which
+	// they have to agree with both on the built tree and on the refitted one
+	bool TestBvh(const RunSettings&)
+	{
+		const unsigned count = 100000;
+		const unsigned moved = count / 100;
+		const unsigned numOfOverlaps = 1000;
+		const unsigned numOfRays = 200;
+
+		std::mt19937 engine(1);
+		std::vector<AABB> boxes(count);
+
+		for (AABB& box : boxes)
+		{
+			box = MakeBox(NextVec3(engine, -200.f, 200.f), NextFloat(engine, 0.1f, 2.f));
+		}
+
+		std::vector<unsigned> movedObjects(moved);
+		for (unsigned& object : movedObjects)
+		{
+			object = engine() % count;
+		}
+
+		std::vector<AABB> overlaps(numOfOverlaps);
+		for (AABB& overlap : overlaps)
+		{
+			overlap = MakeBox(NextVec3(engine, -200.f, 200.f), NextFloat(engine, 1.f, 10.f));
+		}
+
+		std::vector<glm::vec3> rayOrigins(numOfRays);
+		std::vector<glm::vec3> rayDirections(numOfRays);
+
+		for (unsigned i = 0; i < numOfRays; ++i)
+		{
+			rayOrigins[i] = NextVec3(engine, -200.f, 200.f);
+			rayDirections[i] = glm::normalize(NextVec3(engine, -1.f, 1.f));
+		}
+
+		const glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 150.f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.f, 20.f, 60.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+		const Frustum frustum(projection * view);
+
+		ThreadPool threadPool;
+		Bvh pooled(&threadPool);
+		Bvh serial;
+
+		const double buildPooledMs = BestMs([&]() { pooled.Build(boxes); });
+		const double buildSerialMs = BestMs([&]() { serial.Build(boxes); });
+
+		bool passed = true;
+		std::vector<unsigned> results;
+		std::vector<unsigned> expected;
+
+		// Runs every query both ways, reports any disagreement, then times both
+		const auto check = [&](const char* tree)
+		{
+			std::vector<unsigned> visible;
+			std::vector<unsigned> bruteVisible;
+			pooled.QueryFrustum(frustum, visible);
+
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (frustum.IsVisible(boxes[i]))
+				{
+					bruteVisible.push_back(i);
+				}
+			}
+
+			std::sort(visible.begin(), visible.end());
+			std::vector<unsigned> differing;
+			std::set_symmetric_difference(visible.begin(), visible.end(), bruteVisible.begin(), bruteVisible.end(), std::back_inserter(differing));
+
+			// A node wholly inside a plane skips its objects' test, so only boxes on a plane may differ
+			for (const unsigned box : differing)
+			{
+				if (std::fabs(FrustumMargin(frustum, boxes[box])) > 1e-3f)
+				{
+					std::cout << "ERROR::SELFTEST::BVH_FRUSTUM_DIFFERS: " << tree << " box " << box << "\n";
+					passed = false;
+					break;
+				}
+			}
+
+			for (const AABB& overlap : overlaps)
+			{
+				results.clear();
+				expected.clear();
+				pooled.QueryOverlap(overlap, results);
+
+				for (unsigned i = 0; i < count; ++i)
+				{
+					if (boxes[i].Overlaps(overlap))
+					{
+						expected.push_back(i);
+					}
+				}
+
+				std::sort(results.begin(), results.end());
+
+				if (results != expected)
+				{
+					std::cout << "ERROR::SELFTEST::BVH_OVERLAP_DIFFERS: " << tree << " " << results.size() << " found, " << expected.size() << " overlap" << "\n";
+					passed = false;
+					break;
+				}
+			}
+
+			for (unsigned ray = 0; ray < numOfRays; ++ray)
+			{
+				const glm::vec3 inverseDirection(1.f / rayDirections[ray].x, 1.f / rayDirections[ray].y, 1.f / rayDirections[ray].z);
+				float closest = FLT_MAX;
+
+				for (unsigned i = 0; i < count; ++i)
+				{
+					closest = std::min(closest, RayEntry(rayOrigins[ray], inverseDirection, boxes[i], closest));
+				}
+
+				unsigned hitObject = 0;
+				float hitDistance = FLT_MAX;
+				const bool hit = pooled.Raycast(rayOrigins[ray], rayDirections[ray], FLT_MAX, hitObject, hitDistance);
+
+				// Ties may pick either box, the distance is what has to match
+				if (hit != (closest != FLT_MAX) || (hit && hitDistance != closest))
+				{
+					std::cout << "ERROR::SELFTEST::BVH_RAY_DIFFERS: " << tree << " ray " << ray << "\n";
+					passed = false;
+					break;
+				}
+			}
+
+			const double bvhMs = BestMs([&]()
+			{
+				results.clear();
+				pooled.QueryFrustum(frustum, results);
+
+				for (const AABB& overlap : overlaps)
+				{
+					pooled.QueryOverlap(overlap, results);
+				}
+
+				for (unsigned ray = 0; ray < numOfRays; ++ray)
+				{
+					unsigned hitObject;
+					float hitDistance;
+					pooled.Raycast(rayOrigins[ray], rayDirections[ray], FLT_MAX, hitObject, hitDistance);
+				}
+			});
+
+			const double bruteMs = BestMs([&]()
+			{
+				results.clear();
+
+				for (unsigned i = 0; i < count; ++i)
+				{
+					if (frustum.IsVisible(boxes[i]))
+					{
+						results.push_back(i);
+					}
+				}
+
+				for (const AABB& overlap : overlaps)
+				{
+					for (unsigned i = 0; i < count; ++i)
+					{
+						if (boxes[i].Overlaps(overlap))
+						{
+							results.push_back(i);
+						}
+					}
+				}
+
+				for (unsigned ray = 0; ray < numOfRays; ++ray)
+				{
+					const glm::vec3 inverseDirection(1.f / rayDirections[ray].x, 1.f / rayDirections[ray].y, 1.f / rayDirections[ray].z);
+					float closest = FLT_MAX;
+
+					for (unsigned i = 0; i < count; ++i)
+					{
+						closest = std::min(closest, RayEntry(rayOrigins[ray], inverseDirection, boxes[i], closest));
+					}
+				}
+			});
+
+			std::cout << "SELFTEST::BVH: " << tree << " tree, 1 frustum, " << numOfOverlaps << " box and " << numOfRays << " ray queries, bvh "
+				<< bvhMs << "ms, every box " << bruteMs << "ms, " << bruteMs / std::max(bvhMs, 1e-6) << "x faster, "
+				<< bruteVisible.size() << " visible" << "\n";
+		};
+
+		check("built");
+
+		// Each run pushes the same boxes a little further, so every refit has real work to do
+		const double refitMs = BestMs([&]()
+		{
+			for (const unsigned object : movedObjects)
+			{
+				const glm::vec3 offset = NextVec3(engine, -3.f, 3.f);
+				boxes[object].m_min += offset;
+				boxes[object].m_max += offset;
+			}
+
+			pooled.Refit(movedObjects, boxes);
+		});
+
+		check("refitted");
+
+		std::cout << "SELFTEST::BVH: " << count << " boxes, " << threadPool.GetThreadCount() << " worker threads, build pool "
+			<< buildPooledMs << "ms, no pool " << buildSerialMs << "ms, refitting " << moved << " moved boxes " << refitMs
+			<< "ms (" << buildPooledMs / std::max(refitMs, 1e-6) << "x faster than a build), cost " << pooled.GetCost()
+			<< (pooled.NeedsRebuild() ? ", due a rebuild" : "") << "\n";
+
+		return passed;
+	}
+
+	struct NaiveCorner
+	{
+		int m_position;
+		int m_texcoord;
+		int m_normal;
+	};
+
+	// What loading an OBJ looks like without the loader, a line at a time through the streams.
+	// Only absolute v/vt/vn indices, which is all the test file has
+	bool NaiveObjLoad(const std::string& fileName, std::vector<glm::vec3>& positions, std::vector<glm::vec2>& texcoords,
+		std::vector<glm::vec3>& normals, std::vector<NaiveCorner>& corners)
+	{
+		std::ifstream file(fileName);
+
+		if (!file)
+			return false;
+
+		std::string line;
+		std::string type;
+		std::string token;
+
+		while (std::getline(file, line))
+		{
+			std::istringstream stream(line);
+			stream >> type;
+
+			if (type == "v")
+			{
+				glm::vec3 position;
+				stream >> position.x >> position.y >> position.z;
+				positions.push_back(position);
+			} else if (type == "vt")
+			{
+				glm::vec2 texcoord;
+				stream >> texcoord.x >> texcoord.y;
+				texcoords.push_back(texcoord);
+			} else if (type == "vn")
+			{
+				glm::vec3 normal;
+				stream >> normal.x >> normal.y >> normal.z;
+				normals.push_back(normal);
+			} else if (type == "f")
+			{
+				std::vector<NaiveCorner> polygon;
+
+				while (stream >> token)
+				{
+					NaiveCorner corner = { -1, -1, -1 };
+					std::sscanf(token.c_str(), "%d/%d/%d", &corner.m_position, &corner.m_texcoord, &corner.m_normal);
+					polygon.push_back({ corner.m_position - 1, corner.m_texcoord - 1, corner.m_normal - 1 });
+				}
+
+				for (size_t i = 2; i < polygon.size(); ++i)
+				{
+					corners.push_back(polygon[0]);
+					corners.push_back(polygon[i - 1]);
+					corners.push_back(polygon[i]);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// A wavy grid of quads written out as an OBJ with positions, texcoords and normals, loaded with
+	// and without the pool and by the naive parser. Every triangle corner has to come back the same
+	// A size by size grid of quads over a gentle wave, with texcoords and normals on every corner
+	bool WriteGridObj(const std::string& fileName, const unsigned size)
+	{
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+
+		if (!file)
+		{
+			std::cout << "ERROR::SELFTEST::COULD_NOT_OPEN_FILE: " << fileName << "\n";
+			return false;
+		}
+
+		char line[128];
+
+		for (unsigned z = 0; z <= size; ++z)
+		{
+			for (unsigned x = 0; x <= size; ++x)
+			{
+				const float height = std::sin(x * 0.05f) * std::cos(z * 0.07f);
+				std::snprintf(line, sizeof(line), "v %.4f %.4f %.4f\nvt %.5f %.5f\nvn %.4f %.4f %.4f\n",
+					x * 0.1f, height, z * 0.1f, static_cast<float>(x) / size, static_cast<float>(z) / size,
+					-0.05f * std::cos(x * 0.05f) * std::cos(z * 0.07f), 1.f, 0.07f * std::sin(x * 0.05f) * std::sin(z * 0.07f));
+				file << line;
+			}
+		}
+
+		for (unsigned z = 0; z < size; ++z)
+		{
+			for (unsigned x = 0; x < size; ++x)
+			{
+				const unsigned a = z * (size + 1) + x + 1;
+				const unsigned b = a + 1;
+				const unsigned c = b + size + 1;
+				const unsigned d = a + size + 1;
+				std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d);
+				file << line;
+			}
+		}
+
+		return static_cast<bool>(file);
+	}
+
+	bool TestObjLoader(const RunSettings&)
+	{
+		const unsigned size = 1024;
+		const std::string fileName = "selftest_grid.obj";
+
+		if (!WriteGridObj(fileName, size))
+			return false;
+
+		ThreadPool threadPool;
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+		ObjLoadStats pooledStats;
+		ObjLoadStats serialStats;
+
+		const bool serialLoaded = ObjLoader::Load(fileName, vertices, indices, nullptr, &serialStats);
+		vertices.clear();
+		indices.clear();
+		const bool pooledLoaded = ObjLoader::Load(fileName, vertices, indices, &threadPool, &pooledStats);
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> texcoords;
+		std::vector<glm::vec3> normals;
+		std::vector<NaiveCorner> corners;
+
+		const auto naiveStart = std::chrono::steady_clock::now();
+		const bool naiveLoaded = NaiveObjLoad(fileName, positions, texcoords, normals, corners);
+		const double naiveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - naiveStart).count();
+
+		std::remove(fileName.c_str());
+
+		if (!serialLoaded || !pooledLoaded || !naiveLoaded)
+		{
+			std::cout << "ERROR::SELFTEST::OBJ_NOT_LOADED: " << fileName << "\n";
+			return false;
+		}
+
+		const double megabytes = pooledStats.m_bytes / (1024.0 * 1024.0);
+		const double triangles = corners.size() / 3.0;
+
+		std::cout << "SELFTEST::OBJLOADER: " << megabytes << " MB, " << pooledStats.m_triangles << " triangles, " << pooledStats.m_vertices
+			<< " vertices, " << threadPool.GetThreadCount() << " worker threads, " << pooledStats.m_chunks << " chunks" << "\n";
+		std::cout << "SELFTEST::OBJLOADER: pool " << megabytes / pooledStats.m_milliseconds * 1000.0 << " MB/s, "
+			<< triangles / pooledStats.m_milliseconds / 1000.0 << " M triangles/s, no pool " << megabytes / serialStats.m_milliseconds * 1000.0
+			<< " MB/s, " << triangles / serialStats.m_milliseconds / 1000.0 << " M triangles/s, ifstream "
+			<< megabytes / naiveMs * 1000.0 << " MB/s, " << triangles / naiveMs / 1000.0 << " M triangles/s, "
+			<< naiveMs / std::max(pooledStats.m_milliseconds, 1e-6) << "x faster" << "\n";
+
+		if (indices.size() != corners.size())
+		{
+			std::cout << "ERROR::SELFTEST::OBJ_TRIANGLES_DIFFER: " << indices.size() / 3 << " loaded, " << corners.size() / 3 << " parsed" << "\n";
+			return false;
+		}
+
+		float worstError = 0.f;
+
+		for (size_t c = 0; c < corners.size(); ++c)
+		{
+			const Vertex& vertex = vertices[indices[c]];
+			const glm::vec3 position = positions[corners[c].m_position] - vertex.m_position;
+			const glm::vec2 texcoord = texcoords[corners[c].m_texcoord] - vertex.m_texcoord;
+			const glm::vec3 normal = normals[corners[c].m_normal] - vertex.m_normal;
+
+			worstError = std::max(worstError, std::max(std::fabs(position.x), std::max(std::fabs(position.y), std::fabs(position.z))));
+			worstError = std::max(worstError, std::max(std::fabs(texcoord.x), std::fabs(texcoord.y)));
+			worstError = std::max(worstError, std::max(std::fabs(normal.x), std::max(std::fabs(normal.y), std::fabs(normal.z))));
+		}
+
+		std::cout << "SELFTEST::OBJLOADER: worst difference from the ifstream parser " << std::scientific << worstError << std::fixed << "\n";
+
+		if (worstError > 1e-5f)
+		{
+			std::cout << "ERROR::SELFTEST::OBJ_CORNERS_DIFFER: " << worstError << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// A fixed image through every format on the CPU, decoded again and held to a PSNR floor over
+	// the channels that format stores. Gradients, a soft pattern, hard edged boxes and a little noise
+	// The same OBJ through the registry as text and cooked. Each load gets a registry of its own so
+	// none of them comes from its cache, the first of each is reported apart from the best of the
+	// repeats. The cooked file was just written, so the OS may have it cached even the first time.
+	bool TestCook(const RunSettings&)
+	{
+		const unsigned size = 400;
+		const std::string objFileName = "selftest_cook.obj";
+		const std::string meshFileName = "selftest_cook.mesh";
+
+		if (!WriteGridObj(objFileName, size))
+			return false;
+
+		HeadlessContext context(4, 5);
+
+		if (!InitTestContext(context))
+		{
+			std::remove(objFileName.c_str());
+			return false;
+		}
+
+		ThreadPool threadPool;
+		bool passed = true;
+
+		for (const eVertexFormat format : { eVertexFormat::e_Quantized, eVertexFormat::e_Float })
+		{
+			const char* formatName = format == eVertexFormat::e_Quantized ? "quantized" : "float";
+
+			const auto cookStart = std::chrono::steady_clock::now();
+			const bool cooked = GeometryRegistry(&threadPool).Cook(objFileName, meshFileName, format);
+			const double cookMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cookStart).count();
+
+			if (!cooked)
+			{
+				std::cout << "ERROR::SELFTEST::COOK_FAILED: " << objFileName << " " << formatName << "\n";
+				passed = false;
+				continue;
+			}
+
+			// Timed up to the upload being done, the registry is torn down outside the timing
+			// Index 0 is the .obj, 1 the .mesh
+			double firstMs[2] = {};
+			double bestMs[2] = {};
+
+			for (unsigned run = 0; run <= k_timedRuns; ++run)
+			{
+				for (unsigned source = 0; source < 2; ++source)
+				{
+					GeometryRegistry registry(&threadPool);
+
+					const auto start = std::chrono::steady_clock::now();
+					const GeometryHandle geometry = source == 1 ? registry.Load(meshFileName) : registry.Load(objFileName, format);
+					glFinish();
+					const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+					if (run == 0)
+						firstMs[source] = ms;
+					else
+						bestMs[source] = run == 1 ? ms : std::min(bestMs[source], ms);
+				}
+			}
+
+			GeometryRegistry objRegistry(&threadPool);
+			GeometryRegistry meshRegistry(&threadPool);
+			const GeometryHandle fromObj = objRegistry.Load(objFileName, format);
+			const GeometryHandle fromMesh = meshRegistry.Load(meshFileName);
+
+			if (!fromObj || !fromMesh)
+			{
+				std::cout << "ERROR::SELFTEST::COOK_NOT_LOADED: " << formatName << "\n";
+				passed = false;
+				continue;
+			}
+
+			std::vector<unsigned char> objVertices;
+			std::vector<unsigned char> objIndices;
+			std::vector<unsigned char> meshVertices;
+			std::vector<unsigned char> meshIndices;
+			fromObj->ReadBack(objVertices, objIndices);
+			fromMesh->ReadBack(meshVertices, meshIndices);
+
+			std::cout << "SELFTEST::COOK: " << formatName << ", " << fromMesh->GetNumVertices() << " vertices, " << fromMesh->GetNumIndices() / 3
+				<< " triangles, " << (fromMesh->GetIndexType() == GL_UNSIGNED_SHORT ? 16 : 32) << " bit indices, cooked in " << cookMs << "ms" << "\n";
+			std::cout << "SELFTEST::COOK: " << formatName << " .obj first " << firstMs[0] << "ms best " << bestMs[0] << "ms, .mesh first "
+				<< firstMs[1] << "ms best " << bestMs[1] << "ms, " << bestMs[0] / std::max(bestMs[1], 1e-6) << "x faster cooked" << "\n";
+
+			if (fromObj->GetFormat() != fromMesh->GetFormat() || fromObj->GetIndexType() != fromMesh->GetIndexType())
+			{
+				std::cout << "ERROR::SELFTEST::COOK_LAYOUT_DIFFERS: " << formatName << "\n";
+				passed = false;
+			}
+
+			if (objVertices != meshVertices || objIndices != meshIndices)
+			{
+				std::cout << "ERROR::SELFTEST::COOK_BLOBS_DIFFER: " << formatName << " " << objVertices.size() << "/" << meshVertices.size()
+					<< " vertex bytes, " << objIndices.size() << "/" << meshIndices.size() << " index bytes" << "\n";
+				passed = false;
+			}
+
+			if (fromObj->GetPositionScale() != fromMesh->GetPositionScale() || fromObj->GetPositionBias() != fromMesh->GetPositionBias())
+			{
+				std::cout << "ERROR::SELFTEST::COOK_DEQUANT_DIFFERS: " << formatName << "\n";
+				passed = false;
+			}
+		}
+
+		std::remove(objFileName.c_str());
+		std::remove(meshFileName.c_str());
+
+		return passed;
+	}
+
+	// A large scene's worth of meshes built from a few distinct shapes, the way props repeat. Every
+	// request passes its own copy of the arrays, so each is hashed and compared byte for byte
+	bool TestRegistry(const RunSettings&)
+	{
+		const unsigned requests = 100000;
+		const unsigned shapes = 100;
+		const unsigned side = 8;
+
+		HeadlessContext context(4, 5);
+
+		if (!InitTestContext(context))
+			return false;
+
+		std::vector<GLuint> indices;
+
+		for (unsigned z = 0; z + 1 < side; ++z)
+		{
+			for (unsigned x = 0; x + 1 < side; ++x)
+			{
+				const GLuint a = z * side + x;
+				indices.insert(indices.end(), { a, a + side, a + 1, a + 1, a + side, a + side + 1 });
+			}
+		}
+
+		// Height fields, each shape with its own wave
+		std::vector<std::vector<Vertex>> shapeVertices(shapes);
+
+		for (unsigned shape = 0; shape < shapes; ++shape)
+		{
+			for (unsigned z = 0; z < side; ++z)
+			{
+				for (unsigned x = 0; x < side; ++x)
+				{
+					const float height = std::sin(x * 0.5f + shape) * std::cos(z * 0.3f + shape * 0.1f);
+					shapeVertices[shape].emplace_back(glm::vec3(static_cast<float>(x), height, static_cast<float>(z)), glm::vec3(1.f),
+						glm::vec2(static_cast<float>(x) / side, static_cast<float>(z) / side), glm::vec3(0.f, 1.f, 0.f));
+				}
+			}
+		}
+
+		GeometryRegistry registry;
+		std::vector<GeometryHandle> meshes;
+		std::vector<Vertex> vertices;
+		meshes.reserve(requests);
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for (unsigned i = 0; i < requests; ++i)
+		{
+			vertices = shapeVertices[i % shapes];
+			meshes.push_back(registry.Get(vertices.data(), static_cast<unsigned>(vertices.size()),
+				indices.data(), static_cast<unsigned>(indices.size())));
+		}
+
+		const double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// The first request for a shape uploads it, every later one has to get that same geometry
+		std::vector<const Geometry*> uploaded(shapes, nullptr);
+		size_t expectedBytesSaved = 0;
+		unsigned wrong = 0;
+
+		for (unsigned i = 0; i < requests; ++i)
+		{
+			const Geometry* geometry = meshes[i].get();
+			const Geometry*& first = uploaded[i % shapes];
+
+			if (!geometry)
+			{
+				wrong++;
+			} else if (!first)
+			{
+				first = geometry;
+			} else if (first != geometry)
+			{
+				wrong++;
+			} else
+			{
+				expectedBytesSaved += geometry->GetGpuBytes();
+			}
+		}
+
+		std::sort(uploaded.begin(), uploaded.end());
+		const size_t distinct = static_cast<size_t>(std::unique(uploaded.begin(), uploaded.end()) - uploaded.begin());
+
+		const GeometryStats& stats = registry.GetStats();
+		const double megabytes = 1024.0 * 1024.0;
+
+		std::cout << "SELFTEST::REGISTRY: " << stats.m_requests << " requests, " << stats.m_uploads << " uploads, " << stats.m_hits << " hits, "
+			<< stats.m_bytesUploaded / megabytes << " MB uploaded, " << stats.m_bytesSaved / megabytes << " MB saved ("
+			<< static_cast<double>(stats.m_bytesUploaded + stats.m_bytesSaved) / std::max<size_t>(stats.m_bytesUploaded, 1) << "x without interning)" << "\n";
+		std::cout << "SELFTEST::REGISTRY: " << stats.m_milliseconds << "ms building, " << stats.m_milliseconds * 1e6 / requests
+			<< "ns per request, " << wallMs << "ms with the copies" << "\n";
+
+		if (wrong > 0 || distinct != shapes)
+		{
+			std::cout << "ERROR::SELFTEST::REGISTRY_NOT_SHARED: " << wrong << " requests got other geometry, " << distinct << " distinct of " << shapes << "\n";
+			return false;
+		}
+
+		if (stats.m_uploads != shapes || stats.m_hits != requests - shapes || stats.m_bytesSaved != expectedBytesSaved)
+		{
+			std::cout << "ERROR::SELFTEST::REGISTRY_STATS: " << stats.m_uploads << " uploads, " << stats.m_hits << " hits, "
+				<< stats.m_bytesSaved << " bytes saved, expected " << shapes << ", " << requests - shapes << ", " << expectedBytesSaved << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	bool TestTextureCompression(const RunSettings&)
+	{
+		const int width = 512;
+		const int height = 512;
+		const size_t numOfTexels = static_cast<size_t>(width) * height;
+
+		std::mt19937 engine(1);
+		std::vector<unsigned char> image(numOfTexels * 4);
+
+		for (int y = 0; y < height; ++y)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const bool inBox = (x / 64 + y / 64) % 3 == 0 && x % 64 > 16 && y % 64 > 24;
+				const float wave = 0.5f + 0.5f * std::sin(x * 0.031f) * std::cos(y * 0.047f);
+				const float radius = std::sqrt(static_cast<float>((x - width / 2) * (x - width / 2) + (y - height / 2) * (y - height / 2)));
+
+				const float channels[4] =
+				{
+					inBox ? 230.f : 255.f * x / width,
+					inBox ? 40.f : 255.f * y / height,
+					255.f * wave,
+					255.f * std::max(0.f, 1.f - radius / (width * 0.6f))
+				};
+
+				unsigned char* texel = image.data() + (static_cast<size_t>(y) * width + x) * 4;
+
+				for (int c = 0; c < 4; ++c)
+				{
+					const float noise = NextFloat(engine, -6.f, 6.f);
+					texel[c] = static_cast<unsigned char>(std::min(255.f, std::max(0.f, channels[c] + noise)) + 0.5f);
+				}
+			}
+		}
+
+		struct FormatFloor
+		{
+			const char* m_name;
+			eTextureCompression m_compression;
+			float m_minimumPsnr;
+		};
+
+		const FormatFloor formats[] =
+		{
+			{ "BC1", eTextureCompression::e_BC1, 36.f },
+			{ "BC3", eTextureCompression::e_BC3, 37.f },
+			{ "BC4", eTextureCompression::e_BC4, 46.f },
+			{ "BC5", eTextureCompression::e_BC5, 46.f },
+		};
+
+		ThreadPool threadPool;
+		std::vector<unsigned char> decoded(numOfTexels * 4);
+		bool passed = true;
+
+		std::cout << "SELFTEST::TEXTURECOMPRESSION: " << width << "x" << height << " image, " << threadPool.GetThreadCount() << " worker threads" << "\n";
+
+		for (const FormatFloor& format : formats)
+		{
+			CompressedLevel level;
+			level.m_width = width;
+			level.m_height = height;
+			level.m_data.resize(TextureCompressor::GetLevelBytes(width, height, format.m_compression));
+
+			const double pooledMs = BestMs([&]()
+			{
+				TextureCompressor::CompressLevel(image.data(), width, height, format.m_compression, level.m_data.data(), &threadPool);
+			});
+
+			const double serialMs = BestMs([&]()
+			{
+				TextureCompressor::CompressLevel(image.data(), width, height, format.m_compression, level.m_data.data());
+			});
+
+			TextureCompressor::Decompress(level, format.m_compression, decoded.data());
+			const float psnr = TextureCompressor::ComputePsnr(image.data(), decoded.data(), numOfTexels, format.m_compression);
+
+			std::cout << "SELFTEST::TEXTURECOMPRESSION: " << format.m_name << " " << psnr << " dB (floor " << format.m_minimumPsnr << "), pool "
+				<< numOfTexels / pooledMs / 1000.0 << " MPix/s, no pool " << numOfTexels / serialMs / 1000.0 << " MPix/s, "
+				<< level.m_data.size() / 1024 << " KB from " << numOfTexels * 4 / 1024 << " KB" << "\n";
+
+			if (!(psnr >= format.m_minimumPsnr))
+			{
+				std::cout << "ERROR::SELFTEST::TEXTURE_QUALITY: " << format.m_name << " " << psnr << " dB" << "\n";
+				passed = false;
+			}
+		}
+
+		return passed;
+	}
+
+	// A full chain from a 4096 square of noise, box and Kaiser, in sRGB and linear. Then a one pixel
+	// black and white checker, which every level has to turn into grey: the middle of the light,
+	// 188 once it is encoded back to sRGB, or half of 255 when filtered as stored
+	bool TestMips(const RunSettings&)
+	{
+		const int size = 4096;
+		const size_t numOfTexels = static_cast<size_t>(size) * size;
+
+		std::mt19937 engine(1);
+		std::vector<unsigned char> noise(numOfTexels * 4);
+
+		for (unsigned char& value : noise)
+		{
+			value = static_cast<unsigned char>(engine() >> 24);
+		}
+
+		struct MipCase
+		{
+			const char* m_name;
+			eMipFilter m_filter;
+			bool m_srgb;
+		};
+
+		const MipCase cases[] =
+		{
+			{ "box linear", eMipFilter::e_Box, false },
+			{ "box sRGB", eMipFilter::e_Box, true },
+			{ "Kaiser linear", eMipFilter::e_Kaiser, false },
+			{ "Kaiser sRGB", eMipFilter::e_Kaiser, true },
+		};
+
+		const int checkerSize = 256;
+		std::vector<unsigned char> checker(static_cast<size_t>(checkerSize) * checkerSize * 4);
+
+		for (int y = 0; y < checkerSize; ++y)
+		{
+			for (int x = 0; x < checkerSize; ++x)
+			{
+				unsigned char* texel = checker.data() + (static_cast<size_t>(y) * checkerSize + x) * 4;
+				texel[0] = texel[1] = texel[2] = (x + y) % 2 == 0 ? 0 : 255;
+				texel[3] = 255;
+			}
+		}
+
+		ThreadPool threadPool;
+		std::vector<MipLevel> chain;
+		bool passed = true;
+
+		std::cout << "SELFTEST::MIPS: " << size << "x" << size << " noise, " << MipGenerator::GetNumOfLevels(size, size) << " levels, "
+			<< threadPool.GetThreadCount() << " worker threads" << "\n";
+
+		for (const MipCase& test : cases)
+		{
+			const double ms = BestMs([&]()
+			{
+				MipGenerator::Generate(noise.data(), size, size, test.m_filter, test.m_srgb, chain, &threadPool);
+			});
+
+			MipGenerator::Generate(checker.data(), checkerSize, checkerSize, test.m_filter, test.m_srgb, chain, &threadPool);
+
+			// Half the light, or half the stored value which can round either way. The edges clamp,
+			// so Kaiser lobes that reach past them see one colour twice and are only right on average.
+			// Away from them, on the first level, every texel has to be
+			const int lowest = test.m_srgb ? 188 : 127;
+			const int highest = test.m_srgb ? 188 : 128;
+			const int border = static_cast<int>(MipGenerator::k_kaiserWidth) + 1;
+			double worstAverage = test.m_srgb ? 188.0 : 127.5;
+			int interiorLow = 255;
+			int interiorHigh = 0;
+
+			for (size_t l = 0; l < chain.size(); ++l)
+			{
+				const MipLevel& level = chain[l];
+				double total = 0.0;
+
+				for (int y = 0; y < level.m_height; ++y)
+				{
+					for (int x = 0; x < level.m_width; ++x)
+					{
+						const unsigned char* texel = &level.m_pixels[(static_cast<size_t>(y) * level.m_width + x) * 4];
+						const bool interior = l == 0 && x >= border && y >= border && x < level.m_width - border && y < level.m_height - border;
+
+						for (int channel = 0; channel < 3; ++channel)
+						{
+							total += texel[channel];
+
+							if (interior)
+							{
+								interiorLow = std::min(interiorLow, static_cast<int>(texel[channel]));
+								interiorHigh = std::max(interiorHigh, static_cast<int>(texel[channel]));
+							}
+						}
+					}
+				}
+
+				const double average = total / (static_cast<double>(level.m_width) * level.m_height * 3);
+
+				if (std::fabs(average - (lowest + highest) * 0.5) > std::fabs(worstAverage - (lowest + highest) * 0.5))
+				{
+					worstAverage = average;
+				}
+			}
+
+			std::cout << "SELFTEST::MIPS: " << test.m_name << " " << ms << "ms, " << numOfTexels / ms / 1000.0 << " MPix/s, checker first level "
+				<< interiorLow << " to " << interiorHigh << ", worst level average " << worstAverage << "\n";
+
+			if (interiorLow < lowest || interiorHigh > highest || worstAverage < lowest - 0.5 || worstAverage > highest + 0.5)
+			{
+				std::cout << "ERROR::SELFTEST::MIPS_CHECKER: " << test.m_name << " " << interiorLow << " to " << interiorHigh << ", average "
+					<< worstAverage << ", should be " << lowest << " to " << highest << "\n";
+				passed = false;
+			}
+		}
+
+		return passed;
+	}
+
+	// Worst error of a round trip through EncodeVertices, held to GetQuantizationErrorBounds
+	bool CheckQuantization(const char* name, const std::vector<Vertex>& vertices, std::vector<QuantizedVertex>& quantized,
+		PositionDequant& dequant)
+	{
+		AABB bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		float maxTexcoord = 0.f;
+
+		for (const Vertex& vertex : vertices)
+		{
+			bounds.m_min = glm::min(bounds.m_min, vertex.m_position);
+			bounds.m_max = glm::max(bounds.m_max, vertex.m_position);
+			maxTexcoord = std::max(maxTexcoord, std::max(std::fabs(vertex.m_texcoord.x), std::fabs(vertex.m_texcoord.y)));
+		}
+
+		const unsigned count = static_cast<unsigned>(vertices.size());
+		dequant = ComputePositionDequant(bounds);
+
+		quantized.resize(count);
+		EncodeVertices(vertices.data(), count, dequant, quantized.data());
+
+		const QuantizationError error = MeasureQuantizationError(vertices.data(), quantized.data(), count, dequant);
+		const QuantizationError limit = GetQuantizationErrorBounds(dequant, maxTexcoord);
+
+		std::cout << "SELFTEST::QUANTIZATION: " << name << ", " << count << " vertices, position " << std::scientific << error.m_position
+			<< " (bound " << limit.m_position << "), normal " << error.m_normalDegrees << " degrees (" << limit.m_normalDegrees << "), texcoord "
+			<< error.m_texcoord << " (" << limit.m_texcoord << "), colour " << error.m_colour << " (" << limit.m_colour << ")" << std::fixed << "\n";
+
+		if (error.m_position > limit.m_position || error.m_normalDegrees > limit.m_normalDegrees ||
+			error.m_texcoord > limit.m_texcoord || error.m_colour > limit.m_colour)
+		{
+			std::cout << "ERROR::SELFTEST::QUANTIZATION_OUT_OF_BOUNDS: " << name << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// Random vertices round tripped through the quantized format, then the cases the SSE encoder
+	// treats specially: normals below the xy plane, which fold over the octahedron, zero normals,
+	// flat geometry and counts that leave lanes of the last group of four empty. Texcoords go
+	// through F16C in builds that have it, which has to give the same bits as FloatToHalf
+	bool TestQuantization(const RunSettings&)
+	{
+		std::mt19937 engine(1);
+		std::vector<QuantizedVertex> quantized;
+		PositionDequant dequant;
+		bool passed = true;
+
+		// Normals anywhere on the sphere, colours a little outside [0, 1] to be clamped
+		const auto randomVertex = [&](const float extent)
+		{
+			glm::vec3 normal;
+			do
+			{
+				normal = NextVec3(engine, -1.f, 1.f);
+			} while (glm::length(normal) < 0.1f);
+
+			const glm::vec3 position = NextVec3(engine, -extent, extent);
+			const glm::vec3 colour = NextVec3(engine, -0.1f, 1.1f);
+			const glm::vec2 texcoord(NextFloat(engine, -4.f, 4.f), NextFloat(engine, -4.f, 4.f));
+
+			return Vertex(position, colour, texcoord, NextFloat(engine, 0.5f, 2.f) * normal);
+		};
+
+		const unsigned count = 100003;
+		std::vector<Vertex> vertices;
+
+		for (unsigned i = 0; i < count; ++i)
+		{
+			vertices.push_back(randomVertex(50.f));
+		}
+
+		const double encodeMs = BestMs([&]()
+		{
+			quantized.resize(count);
+			EncodeVertices(vertices.data(), count, ComputePositionDequant({ glm::vec3(-50.f), glm::vec3(50.f) }), quantized.data());
+		});
+
+		std::cout << "SELFTEST::QUANTIZATION: encoding " << count / encodeMs / 1000.0 << " M vertices/s, "
+			<< count * sizeof(Vertex) / 1024 << " KB to " << count * sizeof(QuantizedVertex) / 1024 << " KB" << "\n";
+
+		passed = CheckQuantization("random", vertices, quantized, dequant) && passed;
+
+		// Every normal below the plane, the poles and the edges of the fold included
+		std::vector<Vertex> lower;
+
+		for (unsigned i = 0; i < 10000; ++i)
+		{
+			Vertex vertex = randomVertex(1.f);
+			vertex.m_normal.z = -std::fabs(vertex.m_normal.z) - 1e-3f;
+			lower.push_back(vertex);
+		}
+
+		const glm::vec3 edges[] =
+		{
+			glm::vec3(0.f, 0.f, -1.f), glm::vec3(1.f, 0.f, -1e-4f), glm::vec3(-1.f, 0.f, -1e-4f),
+			glm::vec3(0.f, 1.f, -1e-4f), glm::vec3(0.f, -1.f, -1e-4f), glm::vec3(1.f, 1.f, -1.f), glm::vec3(-1.f, -1.f, -1.f)
+		};
+
+		for (const glm::vec3& normal : edges)
+		{
+			lower.push_back(Vertex(glm::vec3(0.f), glm::vec3(1.f), glm::vec2(0.f), normal));
+		}
+
+		passed = CheckQuantization("lower hemisphere", lower, quantized, dequant) && passed;
+
+		// A plane in y, its axis gets the smallest scale rather than a division by zero
+		std::vector<Vertex> flat;
+
+		for (unsigned i = 0; i < 1001; ++i)
+		{
+			Vertex vertex = randomVertex(10.f);
+			vertex.m_position.y = 3.f;
+			flat.push_back(vertex);
+		}
+
+		passed = CheckQuantization("flat in y", flat, quantized, dequant) && passed;
+
+		for (size_t i = 0; i < quantized.size(); ++i)
+		{
+			if (!(dequant.m_scale.y > 0.f) || DecodeVertex(quantized[i], dequant).m_position.y != 3.f)
+			{
+				std::cout << "ERROR::SELFTEST::QUANTIZATION_FLAT_AXIS: vertex " << i << "\n";
+				passed = false;
+				break;
+			}
+		}
+
+		// Zero normals aren't measured above, they have no direction to be off from. They encode
+		// as straight up
+		std::vector<Vertex> zero = { Vertex(glm::vec3(1.f), glm::vec3(1.f), glm::vec2(0.f), glm::vec3(0.f)) };
+		quantized.resize(1);
+		EncodeVertices(zero.data(), 1, ComputePositionDequant({ glm::vec3(0.f), glm::vec3(2.f) }), quantized.data());
+
+		const glm::vec3 up = DecodeVertex(quantized[0], ComputePositionDequant({ glm::vec3(0.f), glm::vec3(2.f) })).m_normal;
+
+		if (!(std::fabs(up.x) < 1e-4f && std::fabs(up.y) < 1e-4f && up.z > 0.9999f))
+		{
+			std::cout << "ERROR::SELFTEST::QUANTIZATION_ZERO_NORMAL: decoded as " << up.x << " " << up.y << " " << up.z << "\n";
+			passed = false;
+		}
+
+		// Every count short of a whole group has to match the same vertices encoded as part of a
+		// longer run, and leave what comes after them alone
+		const PositionDequant tailDequant = ComputePositionDequant({ glm::vec3(-50.f), glm::vec3(50.f) });
+		std::vector<QuantizedVertex> whole(8);
+		EncodeVertices(vertices.data(), 8, tailDequant, whole.data());
+
+		for (unsigned tail = 1; tail <= 7; ++tail)
+		{
+			std::vector<QuantizedVertex> part(8);
+			std::memset(part.data(), 0xcd, part.size() * sizeof(QuantizedVertex));
+			EncodeVertices(vertices.data(), tail, tailDequant, part.data());
+
+			const bool encoded = std::memcmp(part.data(), whole.data(), tail * sizeof(QuantizedVertex)) == 0;
+			const bool untouched = std::all_of(reinterpret_cast<const unsigned char*>(part.data() + tail),
+				reinterpret_cast<const unsigned char*>(part.data() + part.size()), [](const unsigned char byte) { return byte == 0xcd; });
+
+			if (!encoded || !untouched)
+			{
+				std::cout << "ERROR::SELFTEST::QUANTIZATION_TAIL: " << tail << " vertices, " << (encoded ? "wrote past the end" : "differ") << "\n";
+				passed = false;
+			}
+		}
+
+		// Halves across the whole float range, rounding ties, subnormals and overflow included
+		std::vector<Vertex> halves;
+		std::vector<float> values = { 0.f, -0.f, 1.f, 1.f + 1.f / 2048.f, 1.f + 3.f / 2048.f, 65504.f, 65519.f, 65520.f, 1e6f,
+			5.9604645e-8f, 2.9802322e-8f, 8.9406967e-8f, 6.097555e-5f, 6.1035156e-5f };
+
+		for (uint32_t bits = 0; bits < 0x7f800000u; bits += 0x1001u)
+		{
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			values.push_back(value);
+		}
+
+		for (const float value : values)
+		{
+			halves.push_back(Vertex(glm::vec3(0.f), glm::vec3(0.f), glm::vec2(value, -value), glm::vec3(0.f, 0.f, 1.f)));
+		}
+
+		quantized.resize(halves.size());
+		EncodeVertices(halves.data(), static_cast<unsigned>(halves.size()), ComputePositionDequant({ glm::vec3(-1.f), glm::vec3(1.f) }), quantized.data());
+
+		unsigned differing = 0;
+
+		for (size_t i = 0; i < halves.size(); ++i)
+		{
+			if (quantized[i].m_texcoord[0] != FloatToHalf(halves[i].m_texcoord.x) || quantized[i].m_texcoord[1] != FloatToHalf(halves[i].m_texcoord.y))
+			{
+				if (differing == 0)
+				{
+					std::cout << "ERROR::SELFTEST::QUANTIZATION_HALF_DIFFERS: " << std::scientific << halves[i].m_texcoord.x << std::fixed << "\n";
+				}
+
+				differing++;
+			}
+		}
+
+#if defined(__AVX2__) || defined(__F16C__)
+		const char* halfPath = "F16C";
+#else
+		const char* halfPath = "FloatToHalf";
+#endif
+
+		std::cout << "SELFTEST::QUANTIZATION: " << halves.size() * 2 << " halves through " << halfPath << ", " << differing
+			<< " differ from FloatToHalf" << "\n";
+
+		return passed && differing == 0;
+	}
+
+	// A triangle as its three vertices' bytes, turned so the smallest comes first. Winding is
+	// kept, so two lists hold the same triangles exactly when their sorted keys match
+	struct TriangleKey
+	{
+		unsigned char m_bytes[3 * sizeof(Vertex)];
+
+		bool operator<(const TriangleKey& other) const { return std::memcmp(m_bytes, other.m_bytes, sizeof(m_bytes)) < 0; }
+		bool operator==(const TriangleKey& other) const { return std::memcmp(m_bytes, other.m_bytes, sizeof(m_bytes)) == 0; }
+	};
+
+	std::vector<TriangleKey> MakeTriangleKeys(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices)
+	{
+		std::vector<TriangleKey> keys(indices.size() / 3);
+
+		for (size_t triangle = 0; triangle < keys.size(); ++triangle)
+		{
+			const Vertex* corners[3] = { &vertices[indices[triangle * 3]], &vertices[indices[triangle * 3 + 1]], &vertices[indices[triangle * 3 + 2]] };
+
+			int first = 0;
+			for (int corner = 1; corner < 3; ++corner)
+			{
+				if (std::memcmp(corners[corner], corners[first], sizeof(Vertex)) < 0)
+				{
+					first = corner;
+				}
+			}
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				std::memcpy(keys[triangle].m_bytes + corner * sizeof(Vertex), corners[(first + corner) % 3], sizeof(Vertex));
+			}
+		}
+
+		std::sort(keys.begin(), keys.end());
+
+		return keys;
+	}
+
+	// Optimises a shuffled mesh, which has to come out with the same triangles, the expected number
+	// of vertices and an ACMR under the limit. Without indices it is measured as 0..n-1
+	bool CheckMeshOptimizer(const char* name, std::vector<Vertex> vertices, std::vector<GLuint> indices, const unsigned expectedVertices,
+		const float maximumAcmr)
+	{
+		std::vector<GLuint> sourceIndices = indices;
+
+		if (sourceIndices.empty())
+		{
+			sourceIndices.resize(vertices.size());
+			std::iota(sourceIndices.begin(), sourceIndices.end(), 0);
+		}
+
+		const std::vector<TriangleKey> before = MakeTriangleKeys(vertices, sourceIndices);
+		const VertexCacheStats cacheBefore = MeshOptimizer::AnalyzeVertexCache(sourceIndices.data(), static_cast<unsigned>(sourceIndices.size()),
+			static_cast<unsigned>(vertices.size()));
+		const size_t verticesBefore = vertices.size();
+
+		const auto start = std::chrono::steady_clock::now();
+		MeshOptimizer::Optimize(vertices, indices);
+		const double optimizeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const VertexCacheStats cacheAfter = MeshOptimizer::AnalyzeVertexCache(indices.data(), static_cast<unsigned>(indices.size()),
+			static_cast<unsigned>(vertices.size()));
+		const bool sameTriangles = MakeTriangleKeys(vertices, indices) == before;
+
+		std::cout << "SELFTEST::MESHOPTIMIZER: " << name << ", " << before.size() << " triangles, " << verticesBefore << " -> " << vertices.size()
+			<< " vertices, ACMR " << cacheBefore.m_acmr << " -> " << cacheAfter.m_acmr << " (limit " << maximumAcmr << "), ATVR "
+			<< cacheBefore.m_atvr << " -> " << cacheAfter.m_atvr << ", " << optimizeMs << "ms" << "\n";
+
+		if (!sameTriangles)
+		{
+			std::cout << "ERROR::SELFTEST::MESHOPTIMIZER_TRIANGLES_CHANGED: " << name << "\n";
+			return false;
+		}
+
+		if (vertices.size() != expectedVertices || !(cacheAfter.m_acmr < maximumAcmr))
+		{
+			std::cout << "ERROR::SELFTEST::MESHOPTIMIZER_NOT_OPTIMISED: " << name << " " << vertices.size() << " vertices, ACMR " << cacheAfter.m_acmr << "\n";
+			return false;
+		}
+
+		return true;
+	}
+
+	// A 300x300 grid of quads with its triangles shuffled, then a 256x256 sphere as a shuffled
+	// triangle soup which only welding turns back into shared vertices. A 16 entry FIFO can't
+	// get a grid much under 0.6 transforms a triangle
+	bool TestMeshOptimizer(const RunSettings&)
+	{
+		const float k_pi = 3.14159265f;
+		std::mt19937 engine(1);
+		bool passed = true;
+
+		const auto shuffleTriangles = [&](std::vector<GLuint>& indices)
+		{
+			for (size_t triangle = indices.size() / 3; triangle > 1; --triangle)
+			{
+				const size_t other = engine() % triangle;
+				std::swap_ranges(indices.begin() + (triangle - 1) * 3, indices.begin() + triangle * 3, indices.begin() + other * 3);
+			}
+		};
+
+		{
+			const unsigned size = 300;
+			std::vector<Vertex> vertices;
+			std::vector<GLuint> indices;
+
+			for (unsigned z = 0; z <= size; ++z)
+			{
+				for (unsigned x = 0; x <= size; ++x)
+				{
+					const glm::vec2 texcoord(static_cast<float>(x) / size, static_cast<float>(z) / size);
+					vertices.push_back(Vertex(glm::vec3(x * 0.1f, 0.f, z * 0.1f), glm::vec3(1.f), texcoord, glm::vec3(0.f, 1.f, 0.f)));
+				}
+			}
+
+			for (unsigned z = 0; z < size; ++z)
+			{
+				for (unsigned x = 0; x < size; ++x)
+				{
+					const GLuint a = z * (size + 1) + x;
+					const GLuint b = a + 1;
+					const GLuint c = b + size + 1;
+					const GLuint d = a + size + 1;
+					indices.insert(indices.end(), { a, d, c, a, c, b });
+				}
+			}
+
+			shuffleTriangles(indices);
+			const unsigned numOfVertices = static_cast<unsigned>(vertices.size());
+			passed = CheckMeshOptimizer("shuffled grid", std::move(vertices), std::move(indices), numOfVertices, 0.75f) && passed;
+		}
+
+		{
+			const unsigned rings = 256;
+			const unsigned segments = 256;
+			std::vector<Vertex> grid;
+
+			for (unsigned ring = 0; ring <= rings; ++ring)
+			{
+				for (unsigned segment = 0; segment <= segments; ++segment)
+				{
+					const float theta = k_pi * ring / rings;
+					const float phi = 2.f * k_pi * segment / segments;
+					const glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+					const glm::vec2 texcoord(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+					grid.push_back(Vertex(normal, glm::vec3(1.f), texcoord, normal));
+				}
+			}
+
+			// Every triangle gets copies of its corners, as a file without indices would give
+			std::vector<GLuint> triangles;
+
+			for (unsigned ring = 0; ring < rings; ++ring)
+			{
+				for (unsigned segment = 0; segment < segments; ++segment)
+				{
+					const GLuint a = ring * (segments + 1) + segment;
+					const GLuint b = a + 1;
+					const GLuint c = b + segments + 1;
+					const GLuint d = a + segments + 1;
+					triangles.insert(triangles.end(), { a, b, c, a, c, d });
+				}
+			}
+
+			shuffleTriangles(triangles);
+
+			std::vector<Vertex> soup;
+			soup.reserve(triangles.size());
+
+			for (const GLuint corner : triangles)
+			{
+				soup.push_back(grid[corner]);
+			}
+
+			const unsigned numOfVertices = static_cast<unsigned>(grid.size());
+			passed = CheckMeshOptimizer("welded sphere", std::move(soup), std::vector<GLuint>(), numOfVertices, 0.75f) && passed;
+		}
+
+		return passed;
+	}
+
+	const SelfTestEntry k_tests[] =
+	{
+		{ "transforms", TestTransforms },
+		{ "scenegraph", TestSceneGraph },
+		{ "frustum", TestFrustum },
+		{ "bvh", TestBvh },
+		{ "objloader", TestObjLoader },
+		{ "cook", TestCook },
+		{ "registry", TestRegistry },
+		{ "texturecompression", TestTextureCompression },
+		{ "mips", TestMips },
+		{ "quantization", TestQuantization },
+		{ "meshoptimizer", TestMeshOptimizer },
+		{ "instancing", TestInstancing },
+		{ "multidraw", TestMultiDraw },
+		{ "materials", TestMaterials },
+		{ "streaming", TestStreaming },
+		{ "threading", TestThreading },
+	};
+}
+
+int SelfTest::Run(const RunSettings& settings)
+{
+	const bool runAll = settings.m_selfTest.empty() || settings.m_selfTest == "all";
+	std::vector<std::string> failed;
+	unsigned ran = 0;
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (const SelfTestEntry& test : k_tests)
+	{
+		if (!runAll && settings.m_selfTest != test.m_name)
+			continue;
+
+		std::cout << "SELFTEST::RUN: " << test.m_name << "\n";
+		ran++;
+
+		if (test.m_run(settings))
+		{
+			std::cout << "SELFTEST::PASS: " << test.m_name << "\n";
+		} else
+		{
+			std::cout << "SELFTEST::FAIL: " << test.m_name << "\n";
+			failed.push_back(test.m_name);
+		}
+	}
+
+	if (ran == 0)
+	{
+		std::cout << "ERROR::SELFTEST::UNKNOWN_TEST: " << settings.m_selfTest << ", one of:";
+
+		for (const SelfTestEntry& test : k_tests)
+		{
+			std::cout << " " << test.m_name;
+		}
+
+		std::cout << "\n";
+		return 1;
+	}
+
+	if (failed.empty())
+	{
+		std::cout << "SELFTEST: passed " << ran << " tests\n";
+		return 0;
+	}
+
+	std::cout << "\n========================================\n";
+	std::cout << "SELFTEST FAILED: " << failed.size() << " of " << ran << " tests\n";
+
+	for (const std::string& name : failed)
+	{
+		std::cout << "  " << name << "\n";
+	}
+
+	std::cout << "========================================\n";
+	return 1;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "RunSettings.h"
+
+// Checks and benchmarks of the engine's parts, run with --selftest. The CPU tests need no context,
+// they check their results against known answers or a simpler way of getting them, then time
+// both. The GL tests render the same synthetic scene headless down each path being compared.
+// Timings only mean something on the machine that made them, so they are printed, never checked.
+class SelfTest
+{
+public:
+	static constexpr int k_width = 320;
+	static constexpr int k_height = 240;
+	static constexpr unsigned k_frames = 120;
+	static constexpr unsigned k_warmupFrames = 20;
+
+	// Runs the test named in the settings, or all of them. 0 if every check passed, 1 otherwise
+	static int Run(const RunSettings& settings);
+};
@@ -1,25 +1,138 @@
 #include "Shader.h"
+
+#include <algorithm>
+
+#include "Profiler.h"
+#include "ProgramCache.h"
+
+UniformStats Shader::s_frameStats;
+
+template <>
+void UniformHandle<GLint>::Set(const GLint& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniform1i(m_program, m_location, value);
+	Shader::RecordUpload();
+}
+
+template <>
+void UniformHandle<GLfloat>::Set(const GLfloat& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniform1f(m_program, m_location, value);
+	Shader::RecordUpload();
+}
+
+template <>
+void UniformHandle<glm::fvec2>::Set(const glm::fvec2& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniform2fv(m_program, m_location, 1, glm::value_ptr(value));
+	Shader::RecordUpload();
+}
+
+template <>
+void UniformHandle<glm::fvec3>::Set(const glm::fvec3& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniform3fv(m_program, m_location, 1, glm::value_ptr(value));
+	Shader::RecordUpload();
+}
+
+template <>
+void UniformHandle<glm::fvec4>::Set(const glm::fvec4& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniform4fv(m_program, m_location, 1, glm::value_ptr(value));
+	Shader::RecordUpload();
+}
+
+template <>
+void UniformHandle<glm::mat3>::Set(const glm::mat3& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniformMatrix3fv(m_program, m_location, 1, GL_FALSE, glm::value_ptr(value));
+	Shader::RecordUpload();
+}
+
+template <>
+void UniformHandle<glm::mat4>::Set(const glm::mat4& value) const
+{
+	if (m_location < 0)
+		return;
+
+	glProgramUniformMatrix4fv(m_program, m_location, 1, GL_FALSE, glm::value_ptr(value));
+	Shader::RecordUpload();
+}
+
 Shader::Shader(const int glVersionMajor, const int glVersionMinor,
-	const std::string& vertexFile, const std::string& fragmentFile, const std::string& geometryFile)
+	const std::string& vertexFile, const std::string& fragmentFile, const std::string& geometryFile,
+	const std::vector<std::string>& defines)
 	:
+	m_ID(0),
 	m_glVersionMajor(glVersionMajor),
-	m_glVersionMinor(glVersionMinor)
+	m_glVersionMinor(glVersionMinor),
+	m_pending(false),
+	m_linked(false),
+	m_useCache(ProgramCache::IsSupported()),
+	m_cacheKey(0)
 {
+	ProfileScope scope("Shader::Shader");
+
+	const std::string vertexSource = LoadShaderSource(vertexFile, defines);
+	const std::string geometrySource = geometryFile.empty() ? std::string() : LoadShaderSource(geometryFile, defines);
+	const std::string fragmentSource = LoadShaderSource(fragmentFile, defines);
+
+	if (m_useCache)
+	{
+		m_cacheKey = ProgramCache::MakeKey({ vertexSource, geometrySource, fragmentSource });
+		m_ID = ProgramCache::Load(m_cacheKey);
+	}
+
+	if (m_ID)
+	{
+		m_linked = true;
+		CacheUniformLocations();
+		return;
+	}
+
+	//Submit every stage and the link without reading any status back, so a driver compiling in
+	//the background can work on this while the next program is submitted
+	m_submitTime = std::chrono::steady_clock::now();
+	m_pending = true;
+
 	GLuint geometryShader = 0;
 
-	const GLuint vertexShader = LoadShader(GL_VERTEX_SHADER, vertexFile);
+	const GLuint vertexShader = LoadShader(GL_VERTEX_SHADER, vertexSource);
+	m_pendingStages.push_back({ vertexShader, vertexFile });
 
 	if (!geometryFile.empty())
-		geometryShader = LoadShader(GL_GEOMETRY_SHADER, geometryFile);
+	{
+		geometryShader = LoadShader(GL_GEOMETRY_SHADER, geometrySource);
+		m_pendingStages.push_back({ geometryShader, geometryFile });
+	}
 
-	const GLuint fragmentShader = LoadShader(GL_FRAGMENT_SHADER, fragmentFile);
+	const GLuint fragmentShader = LoadShader(GL_FRAGMENT_SHADER, fragmentSource);
+	m_pendingStages.push_back({ fragmentShader, fragmentFile });
 
-	LinkProgram(vertexShader, geometryShader, fragmentShader);
+	LinkProgram(vertexShader, geometryShader, fragmentShader, m_useCache);
 
-	//End
-	glDeleteShader(vertexShader);
-	glDeleteShader(geometryShader);
-	glDeleteShader(fragmentShader);
+	if (!HasParallelCompile())
+	{
+		Finish();
+	}
 }
 
 Shader::~Shader()
@@ -29,6 +142,8 @@ Shader::~Shader()
 
 void Shader::Use()
 {
+	Finish();
+
 	glUseProgram(m_ID);
 }
 
@@ -37,120 +152,208 @@ void Shader::Unuse()
 	glUseProgram(0);
 }
 
-void Shader::Set1I(const GLint value, const std::string& name)
+bool Shader::IsReady()
 {
-	Use();
+	if (!m_pending)
+		return true;
+
+	GLint complete = GL_FALSE;
+	glGetProgramiv(m_ID, GL_COMPLETION_STATUS_KHR, &complete);
+
+	if (!complete)
+		return false;
 
-	glUniform1i(glGetUniformLocation(m_ID, name.c_str()), value);
+	Finish();
 
-	Unuse();
+	return true;
 }
 
-void Shader::Set1F(const GLfloat value, const std::string& name)
+bool Shader::IsLinked()
 {
-	Use();
+	Finish();
+
+	return m_linked;
+}
 
-	glUniform1f(glGetUniformLocation(m_ID, name.c_str()), value);
+void Shader::Set1I(const GLint value, const std::string& name)
+{
+	s_frameStats.m_lookups++;
 
-	Unuse();
+	GetUniform<GLint>(name).Set(value);
 }
 
-void Shader::SetVec2F(glm::fvec2 value, const std::string& name)
+void Shader::Set1F(const GLfloat value, const std::string& name)
 {
-	Use();
+	s_frameStats.m_lookups++;
+
+	GetUniform<GLfloat>(name).Set(value);
+}
 
-	glUniform2fv(glGetUniformLocation(m_ID, name.c_str()), 1, glm::value_ptr(value));
+void Shader::SetVec2F(const glm::fvec2 value, const std::string& name)
+{
+	s_frameStats.m_lookups++;
 
-	Unuse();
+	GetUniform<glm::fvec2>(name).Set(value);
 }
 
-void Shader::SetVec3F(glm::fvec3 value, const std::string& name)
+void Shader::SetVec3F(const glm::fvec3 value, const std::string& name)
 {
-	Use();
+	s_frameStats.m_lookups++;
+
+	GetUniform<glm::fvec3>(name).Set(value);
+}
 
-	glUniform3fv(glGetUniformLocation(m_ID, name.c_str()), 1, glm::value_ptr(value));
+void Shader::SetVec4F(const glm::fvec4 value, const std::string& name)
+{
+	s_frameStats.m_lookups++;
 
-	Unuse();
+	GetUniform<glm::fvec4>(name).Set(value);
 }
 
-void Shader::SetVec4F(glm::fvec4 value, const std::string& name)
+void Shader::SetMat3Fv(const glm::mat3 value, const std::string& name, const GLboolean transpose)
 {
-	Use();
+	s_frameStats.m_lookups++;
 
-	glUniform4fv(glGetUniformLocation(m_ID, name.c_str()), 1, glm::value_ptr(value));
+	const UniformHandle<glm::mat3> handle = GetUniform<glm::mat3>(name);
 
-	Unuse();
+	handle.Set(transpose ? glm::transpose(value) : value);
 }
 
-void Shader::SetMat3Fv(glm::mat3 value, const std::string& name, const GLboolean transpose)
+void Shader::SetMat4Fv(const glm::mat4 value, const std::string& name, const GLboolean transpose)
 {
-	Use();
+	s_frameStats.m_lookups++;
 
-	glUniformMatrix3fv(glGetUniformLocation(m_ID, name.c_str()), 1, transpose, glm::value_ptr(value));
+	const UniformHandle<glm::mat4> handle = GetUniform<glm::mat4>(name);
 
-	Unuse();
+	handle.Set(transpose ? glm::transpose(value) : value);
 }
 
-void Shader::SetMat4Fv(glm::mat4 value, const std::string& name, const GLboolean transpose)
+const UniformStats& Shader::GetFrameStats()
 {
-	Use();
+	return s_frameStats;
+}
+
+void Shader::ResetFrameStats()
+{
+	s_frameStats = UniformStats();
+}
 
-	glUniformMatrix4fv(glGetUniformLocation(m_ID, name.c_str()), 1, transpose, glm::value_ptr(value));
+void Shader::RecordUpload()
+{
+	s_frameStats.m_uploads++;
+	s_frameStats.m_glCalls++;
+	s_frameStats.m_glCallsSaved += k_uncachedUploadGlCalls - 1;
+}
 
-	Unuse();
+bool Shader::HasParallelCompile()
+{
+	return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
 }
 
-std::string Shader::LoadShaderSource(const std::string& fileName) const
+std::string Shader::LoadShaderSource(const std::string& fileName, const std::vector<std::string>& defines) const
 {
-	std::ifstream inFile;
+	std::vector<std::string> included;
+	std::string src = ExpandIncludes(fileName, included);
 
-	//Vertex
-	inFile.open(fileName);
+	if (defines.empty())
+		return src;
+
+	//#version has to come first, so the defines go on the line after it. #line puts the
+	//numbering back for compiler messages
+	const size_t version = src.find("#version");
+	const size_t insertAt = version == std::string::npos ? 0 : std::min(src.find('\n', version), src.size() - 1) + 1;
+	const long nextLine = std::count(src.begin(), src.begin() + static_cast<std::ptrdiff_t>(insertAt), '\n') + 1;
+
+	std::string block;
+	for (const std::string& define : defines)
+	{
+		block += "#define " + define + "\n";
+	}
+	block += "#line " + std::to_string(nextLine) + "\n";
+
+	src.insert(insertAt, block);
+
+	return src;
+}
+
+std::string Shader::ExpandIncludes(const std::string& fileName, std::vector<std::string>& included) const
+{
+	//Read in one go, sized up front
+	std::ifstream inFile(fileName, std::ios::binary | std::ios::ate);
 
-	std::string temp;
 	std::string src;
 
 	if (inFile.is_open())
 	{
-		while (std::getline(inFile, temp))
-			src += temp + "\n";
+		src.resize(static_cast<size_t>(inFile.tellg()));
+		inFile.seekg(0);
+		inFile.read(&src[0], static_cast<std::streamsize>(src.size()));
 	} else
 	{
 		std::cout << "ERROR::SHADER::COULD_NOT_OPEN_FILE: " << fileName << "\n";
 	}
 
-	inFile.close();
+	if (src.find("#include") == std::string::npos)
+		return src;
 
-	return src;
+	std::string expanded;
+	expanded.reserve(src.size());
+
+	size_t lineStart = 0;
+	int lineNumber = 1;
+
+	while (lineStart < src.size())
+	{
+		const size_t lineEnd = std::min(src.find('\n', lineStart), src.size());
+		const size_t first = src.find_first_not_of(" \t", lineStart);
+
+		if (first < lineEnd && src.compare(first, 8, "#include") == 0)
+		{
+			const size_t open = src.find('"', first);
+			const size_t close = open < lineEnd ? src.find('"', open + 1) : std::string::npos;
+
+			if (close < lineEnd)
+			{
+				const std::string includeFile = src.substr(open + 1, close - open - 1);
+
+				//Each file goes in once, which also stops include loops
+				if (std::find(included.begin(), included.end(), includeFile) == included.end())
+				{
+					included.push_back(includeFile);
+					expanded += ExpandIncludes(includeFile, included);
+					expanded += "\n";
+				}
+
+				expanded += "#line " + std::to_string(lineNumber + 1) + "\n";
+			} else
+			{
+				std::cout << "ERROR::SHADER::BAD_INCLUDE: " << fileName << ":" << lineNumber << "\n";
+			}
+		} else
+		{
+			expanded.append(src, lineStart, lineEnd - lineStart);
+			expanded += "\n";
+		}
+
+		lineStart = lineEnd + 1;
+		lineNumber++;
+	}
+
+	return expanded;
 }
 
-GLuint Shader::LoadShader(const GLenum type, const std::string& fileName) const
+GLuint Shader::LoadShader(const GLenum type, const std::string& source) const
 {
-	char infoLog[512];
-	GLint success;
-
 	const GLuint      shader = glCreateShader(type);
-	const std::string source = LoadShaderSource(fileName);
 	const GLchar* src = source.c_str();
 	glShaderSource(shader, 1, &src, nullptr);
 	glCompileShader(shader);
 
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-		std::cout << "ERROR::SHADER::COULD_NOT_COMPILE_SHADER: " << fileName << "\n";
-		std::cout << infoLog << "\n";
-	}
-
 	return shader;
 }
 
-void Shader::LinkProgram(const GLuint vertexShader, const GLuint geometryShader, const GLuint fragmentShader)
+void Shader::LinkProgram(const GLuint vertexShader, const GLuint geometryShader, const GLuint fragmentShader, const bool retrievable)
 {
-	char infoLog[512];
-	GLint success;
-
 	m_ID = glCreateProgram();
 
 	glAttachShader(m_ID, vertexShader);
@@ -160,7 +363,39 @@ void Shader::LinkProgram(const GLuint vertexShader, const GLuint geometryShader,
 
 	glAttachShader(m_ID, fragmentShader);
 
+	if (retrievable)
+		glProgramParameteri(m_ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	glLinkProgram(m_ID);
+}
+
+void Shader::Finish()
+{
+	if (!m_pending)
+		return;
+
+	ProfileScope scope("Shader::Finish");
+
+	m_pending = false;
+
+	char infoLog[512];
+	GLint success;
+
+	for (const PendingStage& stage : m_pendingStages)
+	{
+		glGetShaderiv(stage.m_shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(stage.m_shader, 512, nullptr, infoLog);
+			std::cout << "ERROR::SHADER::COULD_NOT_COMPILE_SHADER: " << stage.m_fileName << "\n";
+			std::cout << infoLog << "\n";
+		}
+
+		//End
+		glDeleteShader(stage.m_shader);
+	}
+
+	m_pendingStages.clear();
 
 	glGetProgramiv(m_ID, GL_LINK_STATUS, &success);
 	if (!success)
@@ -170,5 +405,76 @@ void Shader::LinkProgram(const GLuint vertexShader, const GLuint geometryShader,
 		std::cout << infoLog << "\n";
 	}
 
-	glUseProgram(0);
+	m_linked = success == GL_TRUE;
+
+	//From submitting to now, so with parallel compiling it overlaps other programs
+	const double compileMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_submitTime).count();
+	ProgramCache::RecordCompile(compileMs);
+
+	if (m_useCache && m_linked)
+		ProgramCache::Store(m_cacheKey, m_ID, compileMs);
+
+	CacheUniformLocations();
+}
+
+void Shader::CacheUniformLocations()
+{
+	GLint numOfUniforms = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_ID, GL_ACTIVE_UNIFORMS, &numOfUniforms);
+	glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name(static_cast<size_t>(maxNameLength), '\0');
+
+	m_uniforms.clear();
+	m_uniforms.reserve(numOfUniforms);
+
+	for (GLint i = 0; i < numOfUniforms; ++i)
+	{
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(m_ID, static_cast<GLuint>(i), maxNameLength, &nameLength, &size, &type, &name[0]);
+
+		const std::string uniformName = name.substr(0, nameLength);
+		const GLint location = glGetUniformLocation(m_ID, uniformName.c_str());
+
+		// Uniforms inside a block have no location, they are fed through buffers instead
+		if (location < 0)
+			continue;
+
+		m_uniforms[uniformName] = { location, type };
+
+		// Arrays are reported as "name[0]", let them be looked up by their plain name too
+		const size_t arraySuffix = uniformName.rfind("[0]");
+		if (arraySuffix != std::string::npos && arraySuffix + 3 == uniformName.size())
+		{
+			m_uniforms[uniformName.substr(0, arraySuffix)] = { location, type };
+		}
+	}
+}
+
+GLint Shader::GetUniformLocation(const std::string& name, const GLenum expectedType) const
+{
+	const auto it = m_uniforms.find(name);
+
+	if (it == m_uniforms.end())
+		return -1;
+
+	const GLenum actualType = it->second.m_type;
+
+	// Samplers and bools are set through the integer path
+	const bool isIntegerCompatible = expectedType == GL_INT &&
+		(actualType == GL_BOOL ||
+		actualType == GL_SAMPLER_2D ||
+		actualType == GL_SAMPLER_2D_ARRAY ||
+		actualType == GL_SAMPLER_CUBE);
+
+	if (actualType != expectedType && !isIntegerCompatible)
+	{
+		std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name << "\n";
+		return -1;
+	}
+
+	return it->second.m_location;
 }
\ No newline at end of file
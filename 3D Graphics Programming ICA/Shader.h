@@ -1,12 +1,70 @@
 #pragma once
+#include<chrono>
+#include<cstdint>
 #include<fstream>
 #include<iostream>
 #include<string>
+#include<unordered_map>
+#include<vector>
 
 #include <gl/glew.h>
 #include <glm/fwd.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Per-frame counters for uniform uploads. Before locations were cached every upload cost four GL
+// calls (glUseProgram, glGetUniformLocation, glUniform*, glUseProgram(0)), now each costs one.
+// Uploads by name still look the location up in the program's table, a UniformHandle kept by the
+// caller doesn't.
+struct UniformStats
+{
+	unsigned m_uploads = 0;
+	unsigned m_glCalls = 0;
+	unsigned m_glCallsSaved = 0;
+	unsigned m_lookups = 0;
+};
+
+// A uniform location resolved once after linking. Uploads go through glProgramUniform* so the
+// program never needs to be bound to change a value.
+template <typename T>
+class UniformHandle
+{
+public:
+	UniformHandle() :
+		m_program(0),
+		m_location(-1)
+	{
+	}
+
+	UniformHandle(const GLuint program, const GLint location) :
+		m_program(program),
+		m_location(location)
+	{
+	}
+
+	bool IsValid() const
+	{
+		return m_location >= 0;
+	}
+
+	void Set(const T& value) const;
+
+private:
+	GLuint m_program;
+	GLint m_location;
+};
+
+template <> void UniformHandle<GLint>::Set(const GLint& value) const;
+template <> void UniformHandle<GLfloat>::Set(const GLfloat& value) const;
+template <> void UniformHandle<glm::fvec2>::Set(const glm::fvec2& value) const;
+template <> void UniformHandle<glm::fvec3>::Set(const glm::fvec3& value) const;
+template <> void UniformHandle<glm::fvec4>::Set(const glm::fvec4& value) const;
+template <> void UniformHandle<glm::mat3>::Set(const glm::mat3& value) const;
+template <> void UniformHandle<glm::mat4>::Set(const glm::mat4& value) const;
+
+// Sources go through a small preprocessor first: #include "file" lines are replaced by the file
+// (once per program), and each of defines becomes a #define straight after #version. When the
+// driver compiles in the background (GL_KHR_parallel_shader_compile) the program is only submitted
+// by the constructor; IsReady polls it, anything else that needs it waits for it.
 class Shader
 {
 public:
@@ -14,7 +72,8 @@ public:
 		const int glVersionMinor, 
 		const std::string& vertexFile, 
 		const std::string& fragmentFile, 
-		const std::string& geometryFile = ""
+		const std::string& geometryFile = "",
+		const std::vector<std::string>& defines = std::vector<std::string>()
 	);
 
 	~Shader();
@@ -23,6 +82,15 @@ public:
 
 	void Unuse();
 
+	// Never waits on a parallel compile. Once true the program has linked, or failed to
+	bool IsReady();
+
+	// Waits for the program if it is still compiling
+	bool IsLinked();
+
+	template <typename T>
+	UniformHandle<T> GetUniform(const std::string& name);
+
 	void Set1I(GLint value, const std::string& name);
 
 	void Set1F(GLfloat value, const std::string& name);
@@ -37,12 +105,71 @@ public:
 
 	void SetMat4Fv(glm::mat4 value, const std::string& name, GLboolean transpose = GL_FALSE);
 
+	static const UniformStats& GetFrameStats();
+
+	static void ResetFrameStats();
+
+	static void RecordUpload();
+
+	// GL calls the upload path made before locations were cached
+	static constexpr unsigned k_uncachedUploadGlCalls = 4;
+
+	static bool HasParallelCompile();
+
 private:
+	struct UniformInfo
+	{
+		GLint m_location;
+		GLenum m_type;
+	};
+
+	// A stage handed to the driver whose status hasn't been read yet
+	struct PendingStage
+	{
+		GLuint m_shader;
+		std::string m_fileName;
+	};
+
 	GLuint m_ID;
 	const int m_glVersionMajor;
 	const int m_glVersionMinor;
+	std::unordered_map<std::string, UniformInfo> m_uniforms;
+
+	std::vector<PendingStage> m_pendingStages;
+	bool m_pending;
+	bool m_linked;
+	bool m_useCache;
+	uint64_t m_cacheKey;
+	std::chrono::steady_clock::time_point m_submitTime;
+
+	static UniformStats s_frameStats;
+
+	std::string LoadShaderSource(const std::string& fileName, const std::vector<std::string>& defines) const;
+	std::string ExpandIncludes(const std::string& fileName, std::vector<std::string>& included) const;
+	GLuint LoadShader(GLenum type, const std::string& source) const;
+	void LinkProgram(GLuint vertexShader, GLuint geometryShader, GLuint fragmentShader, bool retrievable);
+
+	// Reads back compile and link status of a submitted program and sets it up for use
+	void Finish();
+	void CacheUniformLocations();
+	GLint GetUniformLocation(const std::string& name, GLenum expectedType) const;
+
+	template <typename T>
+	static GLenum GetUniformType();
+};
+
+template <> inline GLenum Shader::GetUniformType<GLint>() { return GL_INT; }
+template <> inline GLenum Shader::GetUniformType<GLfloat>() { return GL_FLOAT; }
+template <> inline GLenum Shader::GetUniformType<glm::fvec2>() { return GL_FLOAT_VEC2; }
+template <> inline GLenum Shader::GetUniformType<glm::fvec3>() { return GL_FLOAT_VEC3; }
+template <> inline GLenum Shader::GetUniformType<glm::fvec4>() { return GL_FLOAT_VEC4; }
+template <> inline GLenum Shader::GetUniformType<glm::mat3>() { return GL_FLOAT_MAT3; }
+template <> inline GLenum Shader::GetUniformType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+template <typename T>
+UniformHandle<T> Shader::GetUniform(const std::string& name)
+{
+	Finish();
 
-	std::string LoadShaderSource(const std::string& fileName) const;
-	GLuint LoadShader(GLenum type, const std::string& fileName) const;
-	void LinkProgram(GLuint vertexShader, GLuint geometryShader, GLuint fragmentShader);
-};
\ No newline at end of file
+	return UniformHandle<T>(m_ID, GetUniformLocation(name, GetUniformType<T>()));
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "ShaderVariants.h"
+
+namespace
+{
+	struct FeatureDefine
+	{
+		eShaderFeature m_feature;
+		const char* m_name;
+	};
+
+	const FeatureDefine k_featureDefines[] =
+	{
+		{ eShaderFeature::e_DiffuseMap, "DIFFUSE_MAP" },
+		{ eShaderFeature::e_SpecularMap, "SPECULAR_MAP" },
+		{ eShaderFeature::e_Specular, "SPECULAR" },
+		{ eShaderFeature::e_TextureArray, "TEXTURE_ARRAY" }
+	};
+}
+
+ShaderVariants::ShaderVariants(std::vector<Shader*>& shaders, const int glVersionMajor, const int glVersionMinor) :
+	m_shaders(shaders),
+	m_glVersionMajor(glVersionMajor),
+	m_glVersionMinor(glVersionMinor)
+{
+}
+
+unsigned ShaderVariants::AddFamily(const std::string& vertexFile, const std::string& fragmentFile, const unsigned baseFeatures)
+{
+	// As many driver threads as it likes
+	if (m_families.empty() && GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	} else if (m_families.empty() && GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+
+	Family family;
+	family.m_vertexFile = vertexFile;
+	family.m_fragmentFile = fragmentFile;
+	family.m_baseFeatures = baseFeatures & ~k_materialFeatures;
+	family.m_fallback = Submit(family, family.m_baseFeatures | k_materialFeatures, true);
+
+	m_families.push_back(family);
+
+	return family.m_fallback;
+}
+
+unsigned ShaderVariants::Request(const unsigned family, const unsigned materialFeatures)
+{
+	const unsigned features = materialFeatures & k_materialFeatures;
+
+	for (const Variant& variant : m_variants)
+	{
+		if (variant.m_family == family && variant.m_materialFeatures == features)
+			return variant.m_shader;
+	}
+
+	const Family* owner = FindFamily(family);
+
+	if (!owner)
+		return family;
+
+	Variant variant;
+	variant.m_family = family;
+	variant.m_materialFeatures = features;
+	variant.m_shader = Submit(*owner, owner->m_baseFeatures | features, false);
+	variant.m_state = eVariantState::e_Compiling;
+	variant.m_used = false;
+
+	m_variants.push_back(variant);
+	m_stats.m_variants++;
+
+	return variant.m_shader;
+}
+
+unsigned ShaderVariants::Resolve(const unsigned family, const unsigned materialFeatures)
+{
+	const unsigned features = materialFeatures & k_materialFeatures;
+
+	Variant* found = nullptr;
+
+	for (Variant& variant : m_variants)
+	{
+		if (variant.m_family == family && variant.m_materialFeatures == features)
+		{
+			found = &variant;
+			break;
+		}
+	}
+
+	// Never requested, so never submitted either
+	if (!found)
+		return family;
+
+	found->m_used = true;
+
+	if (found->m_state == eVariantState::e_Compiling && m_shaders[found->m_shader]->IsReady())
+	{
+		found->m_state = m_shaders[found->m_shader]->IsLinked() ? eVariantState::e_Ready : eVariantState::e_Failed;
+
+		if (found->m_state == eVariantState::e_Ready)
+		{
+			m_stats.m_ready++;
+		} else
+		{
+			m_stats.m_failed++;
+		}
+
+		if (IsSettled())
+		{
+			m_stats.m_allReadyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_firstSubmit).count();
+		}
+	}
+
+	switch (found->m_state)
+	{
+	case eVariantState::e_Ready:
+		return found->m_shader;
+	case eVariantState::e_Compiling:
+		m_stats.m_fallbackResolves++;
+		return family;
+	default:
+		return family;
+	}
+}
+
+bool ShaderVariants::IsSettled() const
+{
+	for (const Variant& variant : m_variants)
+	{
+		if (variant.m_used && variant.m_state == eVariantState::e_Compiling)
+			return false;
+	}
+
+	return true;
+}
+
+const ShaderVariantStats& ShaderVariants::GetStats() const
+{
+	return m_stats;
+}
+
+std::vector<std::string> ShaderVariants::MakeDefines(const unsigned features, const bool fallback)
+{
+	std::vector<std::string> defines;
+
+	for (const FeatureDefine& define : k_featureDefines)
+	{
+		const unsigned bit = static_cast<unsigned>(define.m_feature);
+
+		// Material features are only tested in if statements, a constant condition compiles the
+		// branch out. The rest pick declarations, so they are for #if
+		if (!(bit & k_materialFeatures))
+		{
+			defines.push_back(std::string(define.m_name) + ((features & bit) ? " 1" : " 0"));
+		} else if (fallback)
+		{
+			defines.push_back(std::string(define.m_name) + " ((material.features & " + std::to_string(bit) + ") != 0)");
+		} else
+		{
+			defines.push_back(std::string(define.m_name) + ((features & bit) ? " true" : " false"));
+		}
+	}
+
+	return defines;
+}
+
+const ShaderVariants::Family* ShaderVariants::FindFamily(const unsigned family) const
+{
+	for (const Family& candidate : m_families)
+	{
+		if (candidate.m_fallback == family)
+			return &candidate;
+	}
+
+	return nullptr;
+}
+
+unsigned ShaderVariants::Submit(const Family& family, const unsigned features, const bool fallback)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	if (m_families.empty() && m_variants.empty())
+	{
+		m_firstSubmit = start;
+	}
+
+	m_shaders.push_back(new Shader(m_glVersionMajor, m_glVersionMinor, family.m_vertexFile, family.m_fragmentFile, "",
+		MakeDefines(features, fallback)));
+
+	m_stats.m_submitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return static_cast<unsigned>(m_shaders.size() - 1);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+
+// Bits of a variant's feature mask, each one a define in the generated source. The material
+// features can be left out of a variant to strip that work, texture arrays change the bindings
+// and so are fixed per family
+enum class eShaderFeature : unsigned
+{
+	e_DiffuseMap = 1 << 0,	// Diffuse colour scaled by material.diffuse_tex
+	e_SpecularMap = 1 << 1,	// Specular term scaled by material.specular_tex
+	e_Specular = 1 << 2,	// Any specular term at all
+	e_TextureArray = 1 << 3	// Material textures are TextureArrayPool layers
+};
+
+constexpr unsigned operator|(const eShaderFeature a, const eShaderFeature b)
+{
+	return static_cast<unsigned>(a) | static_cast<unsigned>(b);
+}
+
+constexpr unsigned operator|(const unsigned mask, const eShaderFeature feature)
+{
+	return mask | static_cast<unsigned>(feature);
+}
+
+inline unsigned& operator|=(unsigned& mask, const eShaderFeature feature)
+{
+	return mask |= static_cast<unsigned>(feature);
+}
+
+inline bool HasFeature(const unsigned mask, const eShaderFeature feature)
+{
+	return (mask & static_cast<unsigned>(feature)) != 0;
+}
+
+struct ShaderVariantStats
+{
+	unsigned m_variants = 0;			// Specialised variants, fallbacks not included
+	unsigned m_ready = 0;
+	unsigned m_failed = 0;				// Didn't link, their fallback is used for good
+	unsigned m_fallbackResolves = 0;	// Resolves answered with a fallback while the variant compiled
+	double m_submitMs = 0.0;			// Handing every program to the driver
+	double m_allReadyMs = 0.0;			// From the first submit until the last variant drawn with was ready
+};
+
+// Families of programs built from one vertex/fragment pair. Each family has a fallback with every
+// material feature compiled in and switched by the material.features uniform, and specialised
+// variants with the features a material doesn't use compiled out. Variants are submitted without
+// waiting, so with GL_KHR_parallel_shader_compile the driver builds them all at once in the
+// background. Resolve only polls a variant once something wants to draw with it, and hands back
+// the fallback until it is ready.
+class ShaderVariants
+{
+public:
+	static constexpr unsigned k_materialFeatures = eShaderFeature::e_DiffuseMap | eShaderFeature::e_SpecularMap | eShaderFeature::e_Specular;
+
+	// Shaders are added to the vector, whose owner deletes them
+	ShaderVariants(std::vector<Shader*>& shaders, int glVersionMajor, int glVersionMinor);
+
+	ShaderVariants(const ShaderVariants&) = delete;
+	ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+	// Submits the family's fallback. Returns its index in the shader vector, which is also the
+	// family id
+	unsigned AddFamily(const std::string& vertexFile, const std::string& fragmentFile, unsigned baseFeatures = 0);
+
+	// Submits a specialised variant if it isn't already, and returns its index in the shader vector
+	unsigned Request(unsigned family, unsigned materialFeatures);
+
+	// The index of the shader to draw with now. Variants that were never requested get the fallback
+	unsigned Resolve(unsigned family, unsigned materialFeatures);
+
+	// True once no variant that has been resolved is still compiling
+	bool IsSettled() const;
+
+	const ShaderVariantStats& GetStats() const;
+
+	// Defines for a feature mask. The fallback reads the material features from the uniform
+	static std::vector<std::string> MakeDefines(unsigned features, bool fallback);
+
+private:
+	enum class eVariantState { e_Compiling, e_Ready, e_Failed };
+
+	struct Family
+	{
+		std::string m_vertexFile;
+		std::string m_fragmentFile;
+		unsigned m_baseFeatures;
+		unsigned m_fallback;
+	};
+
+	struct Variant
+	{
+		unsigned m_family;
+		unsigned m_materialFeatures;
+		unsigned m_shader;
+		eVariantState m_state;
+		bool m_used;	// Resolved at least once, only then is it polled
+	};
+
+	std::vector<Shader*>& m_shaders;
+	const int m_glVersionMajor;
+	const int m_glVersionMinor;
+
+	std::vector<Family> m_families;
+	std::vector<Variant> m_variants;
+
+	std::chrono::steady_clock::time_point m_firstSubmit;
+
+	ShaderVariantStats m_stats;
+
+	const Family* FindFamily(unsigned family) const;
+
+	unsigned Submit(const Family& family, unsigned features, bool fallback);
+};
@@ -0,0 +1,135 @@
+#include "SyntheticScene.h"
+
+#include <algorithm>
+#include <random>
+#include <glm/ext/matrix_transform.hpp>
+
+namespace
+{
+	// std::mt19937's sequence is fixed by the standard, the distributions aren't, so floats are
+	// made from the raw output
+	class SceneRandom
+	{
+	public:
+		explicit SceneRandom(const uint32_t seed) :
+			m_engine(seed)
+		{
+		}
+
+		float Next(const float min, const float max)
+		{
+			return min + (max - min) * static_cast<float>(m_engine() >> 8) * (1.f / 16777216.f);
+		}
+
+		// Components are drawn one statement at a time, argument order would differ by compiler
+		glm::vec3 NextVec3(const float min, const float max)
+		{
+			glm::vec3 value;
+			value.x = Next(min, max);
+			value.y = Next(min, max);
+			value.z = Next(min, max);
+
+			return value;
+		}
+
+		unsigned Next(const unsigned count)
+		{
+			return m_engine() % count;
+		}
+
+	private:
+		std::mt19937 m_engine;
+	};
+
+	const ePrimitiveType k_meshTypes[] = { ePrimitiveType::e_Cube, ePrimitiveType::e_Pyramid, ePrimitiveType::e_Quad };
+}
+
+void SyntheticScene::Generate(const SyntheticSceneSettings& settings, SceneGraph& sceneGraph, GeometryRegistry& registry,
+	std::vector<Mesh*>& meshes, std::vector<InstancedBatch*>& batches, std::vector<Mesh*>& unbatchedMeshes,
+	std::vector<glm::vec3*>& lights)
+{
+	SceneRandom random(settings.m_seed);
+	const float extent = settings.m_extent;
+
+	for (unsigned i = 0; i < settings.m_meshes; ++i)
+	{
+		const ePrimitiveType type = k_meshTypes[random.Next(static_cast<unsigned>(sizeof(k_meshTypes) / sizeof(k_meshTypes[0])))];
+		const glm::vec3 rotation = random.NextVec3(0.f, 360.f);
+		const glm::vec3 scale(random.Next(0.25f, 1.5f));
+
+		// Each chain hangs off the mesh before it, children sit a short way from their parent and
+		// roots anywhere in the box
+		const bool child = i % settings.m_depth != 0;
+		const glm::vec3 position = child ? random.NextVec3(-2.f, 2.f) : random.NextVec3(-extent, extent);
+
+		meshes.push_back(new Mesh(sceneGraph, child ? meshes.back()->GetNode() : k_invalidNode,
+			registry.Get(type, eVertexFormat::e_Quantized), position, rotation, scale));
+	}
+
+	InstancedBatch* batch = nullptr;
+
+	for (unsigned i = 0; i < settings.m_instances; ++i)
+	{
+		const glm::vec3 position = random.NextVec3(-extent, extent);
+		const glm::vec3 rotation = random.NextVec3(0.f, 360.f);
+		const glm::vec3 scale(random.Next(0.25f, 1.f));
+
+		// Either way the cube ends up with the matrix its scene node would have
+		if (settings.m_unbatched)
+		{
+			unbatchedMeshes.push_back(new Mesh(sceneGraph, k_invalidNode, registry.Get(ePrimitiveType::e_Cube), position, rotation, scale));
+			continue;
+		}
+
+		if (i % k_instancesPerBatch == 0)
+		{
+			const unsigned remaining = settings.m_instances - i;
+			const unsigned capacity = remaining < k_instancesPerBatch ? remaining : k_instancesPerBatch;
+			batch = new InstancedBatch(registry.Get(ePrimitiveType::e_Cube), capacity);
+			batches.push_back(batch);
+		}
+
+		glm::mat4 modelMatrix = glm::translate(glm::mat4(1.f), position);
+		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.x), glm::vec3(1.f, 0.f, 0.f));
+		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.y), glm::vec3(0.f, 1.f, 0.f));
+		modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation.z), glm::vec3(0.f, 0.f, 1.f));
+		modelMatrix = glm::scale(modelMatrix, scale);
+
+		batch->AddInstance(modelMatrix);
+	}
+
+	for (unsigned i = 0; i < settings.m_lights; ++i)
+	{
+		lights.push_back(new glm::vec3(random.NextVec3(-extent, extent)));
+	}
+}
+
+void SyntheticScene::MakeMaterialImages(const unsigned material, const int size, std::vector<unsigned char>& diffuse,
+	std::vector<unsigned char>& specular)
+{
+	diffuse.resize(static_cast<size_t>(size) * size * 4);
+	specular.resize(static_cast<size_t>(size) * size * 4);
+
+	// Stripes in a colour and at an angle of the material's own, specular strength steps with it
+	SceneRandom random(material + 1);
+	const glm::vec3 colour = random.NextVec3(0.2f, 1.f);
+	const unsigned slope = 1 + random.Next(7u);
+	const unsigned char shine = static_cast<unsigned char>(64 + material % 192);
+
+	for (int y = 0; y < size; ++y)
+	{
+		for (int x = 0; x < size; ++x)
+		{
+			const size_t texel = (static_cast<size_t>(y) * size + x) * 4;
+			const float stripe = ((x + y * slope) / 4) % 2 == 0 ? 1.f : 0.6f;
+
+			diffuse[texel] = static_cast<unsigned char>(colour.x * stripe * 255.f);
+			diffuse[texel + 1] = static_cast<unsigned char>(colour.y * stripe * 255.f);
+			diffuse[texel + 2] = static_cast<unsigned char>(colour.z * stripe * 255.f);
+			diffuse[texel + 3] = 255;
+
+			specular[texel] = specular[texel + 1] = specular[texel + 2] = shine;
+			specular[texel + 3] = 255;
+		}
+	}
+}
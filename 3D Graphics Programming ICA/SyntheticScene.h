@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "GeometryRegistry.h"
+#include "InstancedBatch.h"
+#include "Mesh.h"
+#include "SceneGraph.h"
+
+struct SyntheticSceneSettings
+{
+	unsigned m_meshes = 0;		// Each its own scene node, culled and queued one by one
+	unsigned m_instances = 0;	// Cubes drawn through instanced batches
+	bool m_unbatched = false;	// The cubes are Meshes instead, each drawing itself as before batching
+	unsigned m_animated = 0;	// Of the meshes, how many the game spins every frame
+	unsigned m_lights = 0;		// Point lights on top of the scene's own, the shader takes the first 16
+	unsigned m_materials = 0;	// The meshes take turns with this many materials, each with textures of its own
+	unsigned m_materialTextureSize = 32;	// Width and height of each material's RGBA8 maps
+	bool m_streamMaterials = false;	// Material maps stream in behind the first frames instead of uploading before them
+	unsigned m_depth = 1;		// Meshes are parented in chains this long, 1 for no hierarchy
+	uint32_t m_seed = 1;
+	float m_extent = 50.f;		// Half size of the box everything is scattered through
+};
+
+// Scatters generated content through a box around the origin so the render path can be
+// measured at any scale. The same settings always give the same scene, on any compiler.
+class SyntheticScene
+{
+public:
+	// Instances are split over batches of this many, as a scene of many instanced props would be
+	static constexpr unsigned k_instancesPerBatch = 1024;
+
+	// Meshes, batches and lights are added to the vectors, whose owner deletes them. Unbatched
+	// cubes go to their own vector, they are drawn one by one rather than culled and queued
+	static void Generate(const SyntheticSceneSettings& settings, SceneGraph& sceneGraph, GeometryRegistry& registry,
+		std::vector<Mesh*>& meshes, std::vector<InstancedBatch*>& batches, std::vector<Mesh*>& unbatchedMeshes,
+		std::vector<glm::vec3*>& lights);
+
+	// A diffuse and a specular map, RGBA8 squares this size, that differ from every other material's
+	static void MakeMaterialImages(unsigned material, int size, std::vector<unsigned char>& diffuse, std::vector<unsigned char>& specular);
+};
@@ -1,38 +1,61 @@
 #include "Texture.h"
 
+#include <algorithm>
 #include <iostream>
 #include <SOIL2/SOIL2.h>
 
-Texture::Texture(const std::string& fileName, const GLenum type) :
+#include "MipGenerator.h"
+
+unsigned Texture::s_frameBinds = 0;
+
+Texture::Texture(const std::string& fileName, const GLenum type, const eTextureCompression compression) :
 	m_ID(0),
 	m_width(0),
 	m_height(0),
-	m_type(type)
+	m_type(type),
+	m_placeholder(false)
 {
-	unsigned char* image = SOIL_load_image(fileName.c_str(), &m_width, &m_height, nullptr, SOIL_LOAD_RGBA);
+	CompressedImage compressed;
 
-	glGenTextures(1, &m_ID);
-	glBindTexture(type, m_ID);
+	if (compression != eTextureCompression::e_None && TextureCompressor::LoadOrCompress(fileName, compression, compressed))
+	{
+		UploadCompressed(compressed);
+		return;
+	}
 
-	glTexParameteri(type, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(type, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	unsigned char* image = SOIL_load_image(fileName.c_str(), &m_width, &m_height, nullptr, SOIL_LOAD_RGBA);
 
 	if (image)
 	{
-		glTexImage2D(type, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		glGenerateMipmap(type);
+		UploadImage(image, m_width, m_height);
 	} else
 	{
 		std::cout << "ERROR::TEXTURE::TEXTURE_LOADING_FAILED: " << fileName << "\n";
+		glGenTextures(1, &m_ID);
 	}
 
-	glActiveTexture(0);
-	glBindTexture(type, 0);
 	SOIL_free_image_data(image);
 }
 
+Texture::Texture(const GLenum type) :
+	m_ID(0),
+	m_width(1),
+	m_height(1),
+	m_type(type),
+	m_placeholder(true)
+{
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+
+	glGenTextures(1, &m_ID);
+	glBindTexture(type, m_ID);
+
+	glTexParameteri(type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(type, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexImage2D(type, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+
+	glBindTexture(type, 0);
+}
+
 Texture::~Texture()
 {
 	glDeleteTextures(1, &m_ID);
@@ -47,6 +70,8 @@ void Texture::Bind(const GLint textureUnit) const
 {
 	glActiveTexture(GL_TEXTURE0 + textureUnit);
 	glBindTexture(m_type, m_ID);
+
+	s_frameBinds++;
 }
 
 void Texture::Unbind() const
@@ -57,31 +82,249 @@ void Texture::Unbind() const
 
 void Texture::LoadFromFile(const std::string& fileName)
 {
+	int width = 0;
+	int height = 0;
+	unsigned char* image = SOIL_load_image(fileName.c_str(), &width, &height, nullptr, SOIL_LOAD_RGBA);
+
+	if (image)
+	{
+		UploadImage(image, width, height);
+	} else
+	{
+		std::cout << "ERROR::TEXTURE::LOADFROMFILE::TEXTURE_LOADING_FAILED: " << fileName << "\n";
+	}
+
+	SOIL_free_image_data(image);
+}
+
+void Texture::UploadCompressed(const CompressedImage& image)
+{
+	if (image.m_levels.empty())
+		return;
+
 	if (m_ID)
 	{
 		glDeleteTextures(1, &m_ID);
 	}
 
-	unsigned char* image = SOIL_load_image(fileName.c_str(), &m_width, &m_height, nullptr, SOIL_LOAD_RGBA);
+	const GLenum internalFormat = TextureCompressor::GetInternalFormat(image.m_compression);
+
+	m_width = image.m_levels[0].m_width;
+	m_height = image.m_levels[0].m_height;
 
 	glGenTextures(1, &m_ID);
 	glBindTexture(m_type, m_ID);
+	glTexStorage2D(m_type, static_cast<GLsizei>(image.m_levels.size()), internalFormat, m_width, m_height);
 
-	glTexParameteri(m_type, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(m_type, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	SetSampling(TextureSampling());
 
-	if (image)
+	if (image.m_compression == eTextureCompression::e_BC4)
 	{
-		glTexImage2D(m_type, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		glGenerateMipmap(m_type);
-	} else
+		// Single channel data reads back as grey, like the RGBA image it came from
+		const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+		glTexParameteriv(m_type, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+
+	for (size_t level = 0; level < image.m_levels.size(); ++level)
 	{
-		std::cout << "ERROR::TEXTURE::LOADFROMFILE::TEXTURE_LOADING_FAILED: " << fileName << "\n";
+		const CompressedLevel& mip = image.m_levels[level];
+
+		glCompressedTexSubImage2D(m_type, static_cast<GLint>(level), 0, 0, mip.m_width, mip.m_height, internalFormat,
+			static_cast<GLsizei>(mip.m_data.size()), mip.m_data.data());
 	}
 
-	glActiveTexture(0);
 	glBindTexture(m_type, 0);
-	SOIL_free_image_data(image);
+
+	m_placeholder = false;
+}
+
+void Texture::UploadImage(const unsigned char* rgba, const int width, const int height)
+{
+	if (m_ID)
+	{
+		glDeleteTextures(1, &m_ID);
+	}
+
+	m_width = width;
+	m_height = height;
+
+	std::vector<MipLevel> chain;
+	MipGenerator::Generate(rgba, width, height, eMipFilter::e_Kaiser, true, chain);
+
+	glGenTextures(1, &m_ID);
+	glBindTexture(m_type, m_ID);
+	glTexStorage2D(m_type, static_cast<GLsizei>(chain.size() + 1), GL_RGBA8, width, height);
+
+	SetSampling(TextureSampling());
+
+	glTexSubImage2D(m_type, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+
+	for (size_t level = 0; level < chain.size(); ++level)
+	{
+		const MipLevel& mip = chain[level];
+
+		glTexSubImage2D(m_type, static_cast<GLint>(level + 1), 0, 0, mip.m_width, mip.m_height, GL_RGBA, GL_UNSIGNED_BYTE,
+			mip.m_pixels.data());
+	}
+
+	glBindTexture(m_type, 0);
+
+	m_placeholder = false;
+}
+
+void Texture::Adopt(const GLuint id, const int width, const int height)
+{
+	if (m_ID)
+	{
+		glDeleteTextures(1, &m_ID);
+	}
+
+	m_ID = id;
+	m_width = width;
+	m_height = height;
+	m_placeholder = false;
+}
+
+void Texture::SetSampling(const TextureSampling& sampling)
+{
+	glTextureParameteri(m_ID, GL_TEXTURE_WRAP_S, sampling.m_wrapS);
+	glTextureParameteri(m_ID, GL_TEXTURE_WRAP_T, sampling.m_wrapT);
+	glTextureParameteri(m_ID, GL_TEXTURE_MIN_FILTER, sampling.m_minFilter);
+	glTextureParameteri(m_ID, GL_TEXTURE_MAG_FILTER, sampling.m_magFilter);
+}
+
+bool Texture::IsPlaceholder() const
+{
+	return m_placeholder;
+}
+
+int Texture::GetNumOfLevels() const
+{
+	// Streamed textures are immutable and know their level count, the rest have as many levels
+	// as have an image, up to GL_TEXTURE_MAX_LEVEL
+	GLint levels = 0;
+	glGetTextureParameteriv(m_ID, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+
+	if (levels > 0)
+		return levels;
+
+	GLint maxLevel = 0;
+	glGetTextureParameteriv(m_ID, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+
+	for (GLint level = 0; level <= maxLevel; ++level)
+	{
+		GLint width = 0;
+		glGetTextureLevelParameteriv(m_ID, level, GL_TEXTURE_WIDTH, &width);
+
+		if (width == 0)
+			return level;
+
+		levels = level + 1;
+
+		// The chain ends at 1x1
+		GLint height = 0;
+		glGetTextureLevelParameteriv(m_ID, level, GL_TEXTURE_HEIGHT, &height);
+		if (width == 1 && height == 1)
+			break;
+	}
+
+	return levels;
+}
+
+size_t Texture::GetGpuBytes() const
+{
+	const int levels = GetNumOfLevels();
+	size_t bytes = 0;
+
+	for (int level = 0; level < levels; ++level)
+	{
+		GLint compressed = GL_FALSE;
+		glGetTextureLevelParameteriv(m_ID, level, GL_TEXTURE_COMPRESSED, &compressed);
+
+		if (compressed)
+		{
+			GLint levelBytes = 0;
+			glGetTextureLevelParameteriv(m_ID, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelBytes);
+			bytes += static_cast<size_t>(levelBytes);
+			continue;
+		}
+
+		GLint width = 0;
+		GLint height = 0;
+		glGetTextureLevelParameteriv(m_ID, level, GL_TEXTURE_WIDTH, &width);
+		glGetTextureLevelParameteriv(m_ID, level, GL_TEXTURE_HEIGHT, &height);
+
+		GLint bits = 0;
+		for (const GLenum channel : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE, GL_TEXTURE_DEPTH_SIZE })
+		{
+			GLint channelBits = 0;
+			glGetTextureLevelParameteriv(m_ID, level, channel, &channelBits);
+			bits += channelBits;
+		}
+
+		bytes += static_cast<size_t>(width) * height * ((bits + 7) / 8);
+	}
+
+	return bytes;
+}
+
+bool Texture::DropTopMip()
+{
+	const int levels = GetNumOfLevels();
+
+	if (m_type != GL_TEXTURE_2D || levels < 2)
+		return false;
+
+	GLint width = 0;
+	GLint height = 0;
+	GLint internalFormat = 0;
+	glGetTextureLevelParameteriv(m_ID, 1, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(m_ID, 1, GL_TEXTURE_HEIGHT, &height);
+	glGetTextureLevelParameteriv(m_ID, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+	GLuint id = 0;
+	glCreateTextures(m_type, 1, &id);
+	glTextureStorage2D(id, levels - 1, static_cast<GLenum>(internalFormat), width, height);
+
+	for (int level = 1; level < levels; ++level)
+	{
+		glCopyImageSubData(m_ID, m_type, level, 0, 0, 0, id, m_type, level - 1, 0, 0, 0,
+			std::max(width >> (level - 1), 1), std::max(height >> (level - 1), 1), 1);
+	}
+
+	// The copy samples the same way
+	for (const GLenum parameter : { GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T, GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER })
+	{
+		GLint value = 0;
+		glGetTextureParameteriv(m_ID, parameter, &value);
+		glTextureParameteri(id, parameter, value);
+	}
+
+	GLint swizzle[4] = {};
+	glGetTextureParameteriv(m_ID, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	glTextureParameteriv(id, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+
+	Adopt(id, width, height);
+
+	return true;
+}
+
+int Texture::GetWidth() const
+{
+	return m_width;
+}
+
+int Texture::GetHeight() const
+{
+	return m_height;
+}
+
+unsigned Texture::GetFrameBinds()
+{
+	return s_frameBinds;
+}
+
+void Texture::ResetFrameBinds()
+{
+	s_frameBinds = 0;
 }
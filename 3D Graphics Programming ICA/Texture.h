@@ -2,14 +2,29 @@
 #include<string>
 #include <gl/glew.h>
 
+#include "TextureCompressor.h"
+
+// Sampler state a texture is made with, part of what TextureCache keys on
+struct TextureSampling
+{
+	GLint m_wrapS = GL_REPEAT;
+	GLint m_wrapT = GL_REPEAT;
+	GLint m_minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint m_magFilter = GL_LINEAR;
+};
+
 class Texture
 {
 public:
-	Texture(const std::string& fileName, const GLenum type);
+	// Compressed textures come from the KTX cache next to the file, encoded on a miss
+	Texture(const std::string& fileName, const GLenum type, eTextureCompression compression = eTextureCompression::e_Auto);
+
+	// 1x1 grey placeholder, for textures that are still streaming in
+	explicit Texture(GLenum type);
 
 	~Texture();
 
-	inline GLuint GetID() const;
+	GLuint GetID() const;
 
 	void Bind(GLint textureUnit) const;
 
@@ -17,9 +32,43 @@ public:
 
 	void LoadFromFile(const std::string& fileName);
 
+	// Replaces the texture with a whole compressed mip chain
+	void UploadCompressed(const CompressedImage& image);
+
+	// Replaces the texture with immutable RGBA8 storage, its mips filtered on the CPU
+	void UploadImage(const unsigned char* rgba, int width, int height);
+
+	// Takes ownership of a finished texture object, the previous one is deleted
+	void Adopt(GLuint id, int width, int height);
+
+	void SetSampling(const TextureSampling& sampling);
+
+	// Still the grey stand-in a TextureStreamer hands out
+	bool IsPlaceholder() const;
+
+	int GetNumOfLevels() const;
+
+	// What the driver holds for every mip level, read back from the texture object
+	size_t GetGpuBytes() const;
+
+	// Swaps in a copy without the largest mip, for when GPU memory runs short. False if only one
+	// level is left
+	bool DropTopMip();
+
+	int GetWidth() const;
+	int GetHeight() const;
+
+	// Every Bind() since the last reset
+	static unsigned GetFrameBinds();
+
+	static void ResetFrameBinds();
+
 private:
 	GLuint m_ID;
 	int m_width;
 	int m_height;
 	unsigned int m_type;
+	bool m_placeholder;
+
+	static unsigned s_frameBinds;
 };
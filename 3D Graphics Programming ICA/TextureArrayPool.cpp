@@ -0,0 +1,181 @@
+#include "TextureArrayPool.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Constants.h"
+
+TextureArrayPool::~TextureArrayPool()
+{
+	for (const TextureArray& array : m_arrays)
+	{
+		glDeleteTextures(1, &array.m_id);
+	}
+}
+
+TextureArrayHandle TextureArrayPool::Add(const Texture& texture)
+{
+	const GLuint source = texture.GetID();
+
+	GLint width = 0;
+	GLint height = 0;
+	GLint internalFormat = 0;
+	glGetTextureLevelParameteriv(source, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(source, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTextureLevelParameteriv(source, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+	if (width == 0 || height == 0)
+	{
+		std::cout << "ERROR::TEXTURE_ARRAY_POOL::TEXTURE_HAS_NO_IMAGE" << "\n";
+		return TextureArrayHandle();
+	}
+
+	const GLint levels = texture.GetNumOfLevels();
+
+	GLint swizzle[4] = {};
+	glGetTextureParameteriv(source, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+
+	const size_t layerBytes = texture.GetGpuBytes();
+
+	const unsigned arrayIndex = FindOrCreateArray(width, height, static_cast<GLenum>(internalFormat), levels, swizzle, layerBytes);
+	TextureArray& array = m_arrays[arrayIndex];
+
+	unsigned layer;
+	if (!array.m_freeLayers.empty())
+	{
+		layer = array.m_freeLayers.back();
+		array.m_freeLayers.pop_back();
+	} else
+	{
+		if (array.m_numOfLayers == array.m_capacity)
+		{
+			Grow(array);
+		}
+
+		layer = array.m_numOfLayers++;
+	}
+
+	for (GLint level = 0; level < levels; ++level)
+	{
+		glCopyImageSubData(source, GL_TEXTURE_2D, level, 0, 0, 0,
+			array.m_id, GL_TEXTURE_2D_ARRAY, level, 0, 0, static_cast<GLint>(layer),
+			std::max(width >> level, 1), std::max(height >> level, 1), 1);
+	}
+
+	TextureArrayHandle handle;
+	handle.m_array = arrayIndex;
+	handle.m_layer = layer;
+
+	return handle;
+}
+
+void TextureArrayPool::Remove(const TextureArrayHandle& handle)
+{
+	if (!handle.IsValid() || handle.m_array >= m_arrays.size())
+		return;
+
+	m_arrays[handle.m_array].m_freeLayers.push_back(handle.m_layer);
+}
+
+GLuint TextureArrayPool::GetArrayID(const unsigned array) const
+{
+	return array < m_arrays.size() ? m_arrays[array].m_id : 0;
+}
+
+unsigned TextureArrayPool::GetNumOfArrays() const
+{
+	return static_cast<unsigned>(m_arrays.size());
+}
+
+void TextureArrayPool::Bind(const unsigned array, const GLint textureUnit) const
+{
+	glBindTextureUnit(static_cast<GLuint>(textureUnit), GetArrayID(array));
+	m_frameBinds++;
+}
+
+unsigned TextureArrayPool::GetFrameBinds() const
+{
+	return m_frameBinds;
+}
+
+void TextureArrayPool::ResetFrameBinds()
+{
+	m_frameBinds = 0;
+}
+
+TextureArrayStats TextureArrayPool::GetStats() const
+{
+	TextureArrayStats stats;
+	stats.m_arrays = static_cast<unsigned>(m_arrays.size());
+	stats.m_regrows = m_regrows;
+
+	for (const TextureArray& array : m_arrays)
+	{
+		stats.m_layers += array.m_numOfLayers - static_cast<unsigned>(array.m_freeLayers.size());
+		stats.m_layerCapacity += array.m_capacity;
+		stats.m_bytes += array.m_layerBytes * array.m_capacity;
+	}
+
+	return stats;
+}
+
+unsigned TextureArrayPool::FindOrCreateArray(const int width, const int height, const GLenum internalFormat, const int levels,
+	const GLint* swizzle, const size_t layerBytes)
+{
+	for (unsigned i = 0; i < m_arrays.size(); ++i)
+	{
+		const TextureArray& array = m_arrays[i];
+
+		if (array.m_width == width && array.m_height == height && array.m_internalFormat == internalFormat &&
+			array.m_levels == levels && std::equal(swizzle, swizzle + 4, array.m_swizzle))
+			return i;
+	}
+
+	TextureArray array;
+	array.m_width = width;
+	array.m_height = height;
+	array.m_internalFormat = internalFormat;
+	array.m_levels = levels;
+	std::copy(swizzle, swizzle + 4, array.m_swizzle);
+	array.m_layerBytes = layerBytes;
+	array.m_capacity = constants::k_textureArrayLayers;
+	array.m_numOfLayers = 0;
+	array.m_id = CreateStorage(array, array.m_capacity);
+
+	m_arrays.push_back(array);
+
+	return static_cast<unsigned>(m_arrays.size() - 1);
+}
+
+GLuint TextureArrayPool::CreateStorage(const TextureArray& array, const unsigned capacity)
+{
+	GLuint id = 0;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id);
+	glTextureStorage3D(id, array.m_levels, array.m_internalFormat, array.m_width, array.m_height, static_cast<GLsizei>(capacity));
+
+	glTextureParameteri(id, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(id, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteriv(id, GL_TEXTURE_SWIZZLE_RGBA, array.m_swizzle);
+
+	return id;
+}
+
+void TextureArrayPool::Grow(TextureArray& array)
+{
+	const unsigned newCapacity = array.m_capacity * 2;
+	const GLuint id = CreateStorage(array, newCapacity);
+
+	for (int level = 0; level < array.m_levels; ++level)
+	{
+		glCopyImageSubData(array.m_id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(array.m_width >> level, 1), std::max(array.m_height >> level, 1), static_cast<GLsizei>(array.m_numOfLayers));
+	}
+
+	glDeleteTextures(1, &array.m_id);
+	array.m_id = id;
+	array.m_capacity = newCapacity;
+	m_regrows++;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <gl/glew.h>
+
+#include "Texture.h"
+
+// Where a texture lives inside the pool, the array index stays valid when its array grows
+struct TextureArrayHandle
+{
+	static constexpr unsigned k_invalidArray = ~0u;
+
+	unsigned m_array = k_invalidArray;
+	unsigned m_layer = 0;
+
+	bool IsValid() const { return m_array != k_invalidArray; }
+};
+
+struct TextureArrayStats
+{
+	unsigned m_arrays = 0;
+	unsigned m_layers = 0;
+	unsigned m_layerCapacity = 0;
+	unsigned m_regrows = 0;
+	mutable unsigned m_frameBinds = 0;
+	size_t m_bytes = 0;
+};
+
+// Packs textures of the same size, internal format, mip count and swizzle into the layers of a
+// GL_TEXTURE_2D_ARRAY, so materials that differ only in their textures share one binding and can
+// be drawn in the same multi-draw run. The shader picks the layer from the material. Layers are
+// copied on the GPU with glCopyImageSubData, compressed textures stay compressed. An array
+// doubles its layer count whenever it is full.
+class TextureArrayPool
+{
+public:
+	TextureArrayPool() = default;
+
+	~TextureArrayPool();
+
+	TextureArrayPool(const TextureArrayPool&) = delete;
+	TextureArrayPool& operator=(const TextureArrayPool&) = delete;
+
+	// Copies every mip of a finished texture into a layer, the source can be deleted afterwards
+	TextureArrayHandle Add(const Texture& texture);
+
+	// The layer is reused by the next Add that matches its array
+	void Remove(const TextureArrayHandle& handle);
+
+	GLuint GetArrayID(unsigned array) const;
+	unsigned GetNumOfArrays() const;
+
+	void Bind(unsigned array, GLint textureUnit) const;
+
+	// Every Bind() since the last reset
+	unsigned GetFrameBinds() const;
+
+	void ResetFrameBinds();
+
+	TextureArrayStats GetStats() const;
+
+private:
+	struct TextureArray
+	{
+		GLuint m_id;
+		int m_width;
+		int m_height;
+		GLenum m_internalFormat;
+		int m_levels;
+		GLint m_swizzle[4];
+		size_t m_layerBytes;
+		unsigned m_capacity;
+		unsigned m_numOfLayers;
+		std::vector<unsigned> m_freeLayers;
+	};
+
+	std::vector<TextureArray> m_arrays;
+	unsigned m_regrows = 0;
+	mutable unsigned m_frameBinds = 0;
+
+	unsigned FindOrCreateArray(int width, int height, GLenum internalFormat, int levels, const GLint* swizzle, size_t layerBytes);
+
+	static GLuint CreateStorage(const TextureArray& array, unsigned capacity);
+
+	void Grow(TextureArray& array);
+};
@@ -0,0 +1,160 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <vector>
+
+TextureCache::TextureCache(TextureStreamer& streamer, const size_t budgetBytes) :
+	m_streamer(streamer),
+	m_frame(0)
+{
+	m_stats.m_budgetBytes = budgetBytes;
+}
+
+std::shared_ptr<Texture> TextureCache::Acquire(const std::string& fileName, const GLenum type, const eTextureCompression compression,
+	const TextureSampling& sampling)
+{
+	const std::string key = MakeKey(fileName, type, compression, sampling);
+	const auto it = m_entries.find(key);
+
+	if (it != m_entries.end())
+	{
+		it->second.m_lastUsedFrame = m_frame;
+		m_stats.m_hits++;
+
+		return it->second.m_texture;
+	}
+
+	Entry& entry = m_entries[key];
+	entry.m_texture = std::shared_ptr<Texture>(m_streamer.Load(fileName, type, compression, sampling));
+	entry.m_lastUsedFrame = m_frame;
+	m_entryOfTexture[entry.m_texture.get()] = &entry;
+
+	m_stats.m_misses++;
+	m_stats.m_textures = static_cast<unsigned>(m_entries.size());
+
+	return entry.m_texture;
+}
+
+void TextureCache::Touch(const Texture* texture)
+{
+	const auto it = m_entryOfTexture.find(texture);
+
+	if (it != m_entryOfTexture.end())
+	{
+		it->second->m_lastUsedFrame = m_frame;
+	}
+}
+
+void TextureCache::Update()
+{
+	m_frame++;
+
+	m_stats.m_residentBytes = 0;
+
+	for (auto& keyAndEntry : m_entries)
+	{
+		Measure(keyAndEntry.second);
+		m_stats.m_residentBytes += keyAndEntry.second.m_bytes;
+	}
+
+	if (m_stats.m_residentBytes > m_stats.m_budgetBytes)
+	{
+		EnforceBudget();
+	}
+
+	m_stats.m_textures = static_cast<unsigned>(m_entries.size());
+}
+
+void TextureCache::SetBudget(const size_t budgetBytes)
+{
+	m_stats.m_budgetBytes = budgetBytes;
+}
+
+const TextureCacheStats& TextureCache::GetStats() const
+{
+	return m_stats;
+}
+
+std::string TextureCache::MakeKey(const std::string& fileName, const GLenum type, const eTextureCompression compression,
+	const TextureSampling& sampling)
+{
+	return fileName + "#" + std::to_string(type) + "#" + std::to_string(static_cast<int>(compression)) + "#" +
+		std::to_string(sampling.m_wrapS) + "#" + std::to_string(sampling.m_wrapT) + "#" +
+		std::to_string(sampling.m_minFilter) + "#" + std::to_string(sampling.m_magFilter);
+}
+
+void TextureCache::Measure(Entry& entry)
+{
+	// Reading sizes back is a round trip to the driver, so only when the texture object changed
+	const Texture& texture = *entry.m_texture;
+
+	if (texture.IsPlaceholder() || texture.GetID() == entry.m_measuredId)
+		return;
+
+	entry.m_bytes = texture.GetGpuBytes();
+	entry.m_measuredId = texture.GetID();
+}
+
+void TextureCache::EnforceBudget()
+{
+	std::vector<std::unordered_map<std::string, Entry>::iterator> leastRecentlyUsed;
+	leastRecentlyUsed.reserve(m_entries.size());
+
+	for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		// Still streaming, the streamer writes into it until it arrives
+		if (!it->second.m_texture->IsPlaceholder())
+		{
+			leastRecentlyUsed.push_back(it);
+		}
+	}
+
+	std::sort(leastRecentlyUsed.begin(), leastRecentlyUsed.end(), [](const auto& a, const auto& b)
+	{
+		return a->second.m_lastUsedFrame < b->second.m_lastUsedFrame;
+	});
+
+	// Each pass evicts or halves textures oldest first. Demoted textures get another go on the
+	// next pass if that wasn't enough, until nothing can shrink
+	bool progress = true;
+
+	while (m_stats.m_residentBytes > m_stats.m_budgetBytes && progress)
+	{
+		progress = false;
+
+		for (auto& it : leastRecentlyUsed)
+		{
+			if (m_stats.m_residentBytes <= m_stats.m_budgetBytes)
+				break;
+
+			if (it == m_entries.end())
+				continue;
+
+			Entry& entry = it->second;
+
+			if (entry.m_texture.use_count() == 1)
+			{
+				m_stats.m_residentBytes -= entry.m_bytes;
+				m_stats.m_evictions++;
+
+				m_entryOfTexture.erase(entry.m_texture.get());
+				m_entries.erase(it);
+				it = m_entries.end();
+
+				progress = true;
+				continue;
+			}
+
+			const size_t bytes = entry.m_bytes;
+
+			if (entry.m_texture->DropTopMip())
+			{
+				Measure(entry);
+				m_stats.m_residentBytes = m_stats.m_residentBytes - bytes + entry.m_bytes;
+				m_stats.m_demotions++;
+
+				progress = true;
+			}
+		}
+	}
+}
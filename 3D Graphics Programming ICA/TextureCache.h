@@ -0,0 +1,70 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <gl/glew.h>
+
+#include "Constants.h"
+#include "Texture.h"
+#include "TextureStreamer.h"
+
+struct TextureCacheStats
+{
+	unsigned m_hits = 0;
+	unsigned m_misses = 0;
+	unsigned m_evictions = 0;	// Textures nobody held any more, deleted to get under budget
+	unsigned m_demotions = 0;	// Top mips dropped from textures still in use
+	unsigned m_textures = 0;
+	size_t m_residentBytes = 0;
+	size_t m_budgetBytes = 0;
+};
+
+// Hands out shared textures keyed by path, compression and sampling, so asking for the same file
+// twice gives the same GPU copy. Misses stream in through the TextureStreamer. Every texture's
+// GPU size, mips included, is measured once it has arrived, and Update keeps the total under the
+// budget by going through textures least recently used first: ones only the cache still holds
+// are deleted, ones still in use lose their largest mip.
+class TextureCache
+{
+public:
+	explicit TextureCache(TextureStreamer& streamer, size_t budgetBytes = constants::k_textureBudgetBytes);
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	// Counts as a use
+	std::shared_ptr<Texture> Acquire(const std::string& fileName, GLenum type,
+		eTextureCompression compression = eTextureCompression::e_Auto, const TextureSampling& sampling = TextureSampling());
+
+	// Marks a texture as used this frame, call for whatever gets drawn with
+	void Touch(const Texture* texture);
+
+	// Once a frame, after TextureStreamer::Update
+	void Update();
+
+	void SetBudget(size_t budgetBytes);
+
+	const TextureCacheStats& GetStats() const;
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Texture> m_texture;
+		size_t m_bytes = 0;
+		GLuint m_measuredId = 0;	// The texture object m_bytes was read from
+		unsigned m_lastUsedFrame = 0;
+	};
+
+	TextureStreamer& m_streamer;
+	std::unordered_map<std::string, Entry> m_entries;
+	std::unordered_map<const Texture*, Entry*> m_entryOfTexture;
+	unsigned m_frame;
+
+	TextureCacheStats m_stats;
+
+	static std::string MakeKey(const std::string& fileName, GLenum type, eTextureCompression compression, const TextureSampling& sampling);
+
+	void Measure(Entry& entry);
+
+	void EnforceBudget();
+};
@@ -0,0 +1,710 @@
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <emmintrin.h>
+#include <SOIL2/SOIL2.h>
+
+#include "KtxFile.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	// Block rows handed to each ParallelFor chunk
+	constexpr unsigned k_blockRowsPerTask = 4;
+
+	struct Colour
+	{
+		float r, g, b;
+	};
+
+	uint16_t PackRgb565(const Colour& colour)
+	{
+		const int r = static_cast<int>(std::lround(std::min(std::max(colour.r, 0.f), 255.f) * 31.f / 255.f));
+		const int g = static_cast<int>(std::lround(std::min(std::max(colour.g, 0.f), 255.f) * 63.f / 255.f));
+		const int b = static_cast<int>(std::lround(std::min(std::max(colour.b, 0.f), 255.f) * 31.f / 255.f));
+
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	// Expanded exactly as the hardware does, by replicating the top bits
+	void UnpackRgb565(const uint16_t packed, int* rgb)
+	{
+		const int r = packed >> 11 & 31;
+		const int g = packed >> 5 & 63;
+		const int b = packed & 31;
+
+		rgb[0] = r << 3 | r >> 2;
+		rgb[1] = g << 2 | g >> 4;
+		rgb[2] = b << 3 | b >> 2;
+	}
+
+	void BuildBC1Palette(const uint16_t c0, const uint16_t c1, const bool fourColour, int palette[4][3])
+	{
+		UnpackRgb565(c0, palette[0]);
+		UnpackRgb565(c1, palette[1]);
+
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			if (fourColour)
+			{
+				palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+				palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+			} else
+			{
+				palette[2][channel] = (palette[0][channel] + palette[1][channel]) / 2;
+				palette[3][channel] = 0;
+			}
+		}
+	}
+
+	// Picks the nearest palette entry for every texel, four texels per SSE iteration. Returns the
+	// summed squared error
+	float SelectBC1Indices(const float* r, const float* g, const float* b, const int palette[4][3], uint32_t& indices)
+	{
+		__m128 totalError = _mm_setzero_ps();
+		indices = 0;
+
+		for (int texel = 0; texel < 16; texel += 4)
+		{
+			const __m128 red = _mm_loadu_ps(r + texel);
+			const __m128 green = _mm_loadu_ps(g + texel);
+			const __m128 blue = _mm_loadu_ps(b + texel);
+
+			__m128 bestError = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128i bestIndex = _mm_setzero_si128();
+
+			for (int entry = 0; entry < 4; ++entry)
+			{
+				const __m128 dr = _mm_sub_ps(red, _mm_set1_ps(static_cast<float>(palette[entry][0])));
+				const __m128 dg = _mm_sub_ps(green, _mm_set1_ps(static_cast<float>(palette[entry][1])));
+				const __m128 db = _mm_sub_ps(blue, _mm_set1_ps(static_cast<float>(palette[entry][2])));
+				const __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				const __m128 better = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(_mm_castps_si128(better), bestIndex),
+					_mm_and_si128(_mm_castps_si128(better), _mm_set1_epi32(entry)));
+			}
+
+			totalError = _mm_add_ps(totalError, bestError);
+
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+
+			for (int lane = 0; lane < 4; ++lane)
+			{
+				indices |= static_cast<uint32_t>(lanes[lane]) << ((texel + lane) * 2);
+			}
+		}
+
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, totalError);
+
+		return sums[0] + sums[1] + sums[2] + sums[3];
+	}
+
+	float EncodeEndpoints(const float* r, const float* g, const float* b, Colour start, Colour end, uint16_t& c0, uint16_t& c1, uint32_t& indices)
+	{
+		c0 = PackRgb565(start);
+		c1 = PackRgb565(end);
+
+		// c0 > c1 selects the four colour mode
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+		}
+
+		int palette[4][3];
+		BuildBC1Palette(c0, c1, true, palette);
+
+		if (c0 == c1)
+		{
+			// Only the first entry is meaningful, every texel uses it
+			indices = 0;
+			float error = 0.f;
+
+			for (int texel = 0; texel < 16; ++texel)
+			{
+				const float dr = r[texel] - palette[0][0];
+				const float dg = g[texel] - palette[0][1];
+				const float db = b[texel] - palette[0][2];
+				error += dr * dr + dg * dg + db * db;
+			}
+
+			return error;
+		}
+
+		return SelectBC1Indices(r, g, b, palette, indices);
+	}
+
+	// 16 RGBA texels in, one 8 byte BC1 block out
+	void EncodeBC1Block(const unsigned char* texels, unsigned char* output)
+	{
+		alignas(16) float r[16], g[16], b[16];
+		Colour mean = { 0.f, 0.f, 0.f };
+
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			r[texel] = texels[texel * 4];
+			g[texel] = texels[texel * 4 + 1];
+			b[texel] = texels[texel * 4 + 2];
+			mean.r += r[texel];
+			mean.g += g[texel];
+			mean.b += b[texel];
+		}
+
+		mean = { mean.r / 16.f, mean.g / 16.f, mean.b / 16.f };
+
+		// Principal axis of the block's colours, by power iteration on the covariance
+		float covariance[6] = {};
+
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			const float dr = r[texel] - mean.r;
+			const float dg = g[texel] - mean.g;
+			const float db = b[texel] - mean.b;
+			covariance[0] += dr * dr;
+			covariance[1] += dr * dg;
+			covariance[2] += dr * db;
+			covariance[3] += dg * dg;
+			covariance[4] += dg * db;
+			covariance[5] += db * db;
+		}
+
+		Colour axis = { 1.f, 1.f, 1.f };
+
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			const Colour next = {
+				covariance[0] * axis.r + covariance[1] * axis.g + covariance[2] * axis.b,
+				covariance[1] * axis.r + covariance[3] * axis.g + covariance[4] * axis.b,
+				covariance[2] * axis.r + covariance[4] * axis.g + covariance[5] * axis.b
+			};
+
+			const float length = std::max({ std::abs(next.r), std::abs(next.g), std::abs(next.b) });
+
+			if (length < 1e-6f)
+				break;
+
+			axis = { next.r / length, next.g / length, next.b / length };
+		}
+
+		float minProjection = std::numeric_limits<float>::max();
+		float maxProjection = -std::numeric_limits<float>::max();
+
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			const float projection = (r[texel] - mean.r) * axis.r + (g[texel] - mean.g) * axis.g + (b[texel] - mean.b) * axis.b;
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		// Inset the ends slightly, the extremes are rarely worth a whole palette entry each
+		const float inset = (maxProjection - minProjection) / 16.f;
+		maxProjection -= inset;
+		minProjection += inset;
+
+		const auto along = [&mean, &axis](const float t)
+		{
+			return Colour{ mean.r + axis.r * t, mean.g + axis.g * t, mean.b + axis.b * t };
+		};
+
+		uint16_t c0 = 0, c1 = 0;
+		uint32_t indices = 0;
+		float error = EncodeEndpoints(r, g, b, along(maxProjection), along(minProjection), c0, c1, indices);
+
+		// Least squares refit of the endpoints to the chosen indices
+		static const float k_weights[4] = { 1.f, 0.f, 2.f / 3.f, 1.f / 3.f };
+
+		for (int iteration = 0; iteration < 2 && error > 0.f && c0 != c1; ++iteration)
+		{
+			float aa = 0.f, bb = 0.f, ab = 0.f;
+			Colour ax = { 0.f, 0.f, 0.f };
+			Colour bx = { 0.f, 0.f, 0.f };
+
+			for (int texel = 0; texel < 16; ++texel)
+			{
+				const float alpha = k_weights[indices >> (texel * 2) & 3];
+				const float beta = 1.f - alpha;
+
+				aa += alpha * alpha;
+				bb += beta * beta;
+				ab += alpha * beta;
+				ax = { ax.r + alpha * r[texel], ax.g + alpha * g[texel], ax.b + alpha * b[texel] };
+				bx = { bx.r + beta * r[texel], bx.g + beta * g[texel], bx.b + beta * b[texel] };
+			}
+
+			const float determinant = aa * bb - ab * ab;
+
+			if (std::abs(determinant) < 1e-6f)
+				break;
+
+			const float inverse = 1.f / determinant;
+			const Colour start = {
+				(ax.r * bb - bx.r * ab) * inverse, (ax.g * bb - bx.g * ab) * inverse, (ax.b * bb - bx.b * ab) * inverse
+			};
+			const Colour end = {
+				(bx.r * aa - ax.r * ab) * inverse, (bx.g * aa - ax.g * ab) * inverse, (bx.b * aa - ax.b * ab) * inverse
+			};
+
+			uint16_t refitC0 = 0, refitC1 = 0;
+			uint32_t refitIndices = 0;
+			const float refitError = EncodeEndpoints(r, g, b, start, end, refitC0, refitC1, refitIndices);
+
+			if (refitError >= error)
+				break;
+
+			error = refitError;
+			c0 = refitC0;
+			c1 = refitC1;
+			indices = refitIndices;
+		}
+
+		std::memcpy(output, &c0, 2);
+		std::memcpy(output + 2, &c1, 2);
+		std::memcpy(output + 4, &indices, 4);
+	}
+
+	// 16 single channel values, stride bytes apart, into one 8 byte BC4 block
+	void EncodeBC4Block(const unsigned char* values, const int stride, unsigned char* output)
+	{
+		alignas(16) float channel[16];
+		int minValue = 255;
+		int maxValue = 0;
+
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			const int value = values[texel * stride];
+			channel[texel] = static_cast<float>(value);
+			minValue = std::min(minValue, value);
+			maxValue = std::max(maxValue, value);
+		}
+
+		output[0] = static_cast<unsigned char>(maxValue);
+		output[1] = static_cast<unsigned char>(minValue);
+
+		uint64_t indices = 0;
+
+		if (maxValue > minValue)
+		{
+			// Sevenths of the way from min to max, rounded, four texels at a time
+			const __m128 minimum = _mm_set1_ps(static_cast<float>(minValue));
+			const __m128 scale = _mm_set1_ps(7.f / static_cast<float>(maxValue - minValue));
+
+			// Step 7 is the max endpoint (index 0), step 0 the min (index 1), the rest interpolate
+			static const uint64_t k_indexOfStep[8] = { 1, 7, 6, 5, 4, 3, 2, 0 };
+
+			for (int texel = 0; texel < 16; texel += 4)
+			{
+				const __m128i steps = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(channel + texel), minimum), scale));
+
+				alignas(16) int32_t lanes[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes), steps);
+
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					indices |= k_indexOfStep[std::min(std::max(lanes[lane], 0), 7)] << ((texel + lane) * 3);
+				}
+			}
+		}
+
+		for (int byte = 0; byte < 6; ++byte)
+		{
+			output[2 + byte] = static_cast<unsigned char>(indices >> (byte * 8));
+		}
+	}
+
+	void DecodeBC1Block(const unsigned char* block, unsigned char* texels, const bool forceFourColour)
+	{
+		uint16_t c0, c1;
+		uint32_t indices;
+		std::memcpy(&c0, block, 2);
+		std::memcpy(&c1, block + 2, 2);
+		std::memcpy(&indices, block + 4, 4);
+
+		const bool fourColour = forceFourColour || c0 > c1;
+
+		int palette[4][3];
+		BuildBC1Palette(c0, c1, fourColour, palette);
+
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			const int index = indices >> (texel * 2) & 3;
+
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				texels[texel * 4 + channel] = static_cast<unsigned char>(palette[index][channel]);
+			}
+
+			texels[texel * 4 + 3] = !fourColour && index == 3 ? 0 : 255;
+		}
+	}
+
+	void DecodeBC4Block(const unsigned char* block, unsigned char* values, const int stride)
+	{
+		const int e0 = block[0];
+		const int e1 = block[1];
+
+		int palette[8] = { e0, e1 };
+
+		for (int i = 2; i < 8; ++i)
+		{
+			palette[i] = e0 > e1 ? ((8 - i) * e0 + (i - 1) * e1) / 7 :
+				i < 6 ? ((6 - i) * e0 + (i - 1) * e1) / 5 : (i == 6 ? 0 : 255);
+		}
+
+		uint64_t indices = 0;
+		for (int byte = 0; byte < 6; ++byte)
+		{
+			indices |= static_cast<uint64_t>(block[2 + byte]) << (byte * 8);
+		}
+
+		for (int texel = 0; texel < 16; ++texel)
+		{
+			values[texel * stride] = static_cast<unsigned char>(palette[indices >> (texel * 3) & 7]);
+		}
+	}
+
+
+	uint64_t HashBytes(const unsigned char* data, const size_t size, uint64_t hash)
+	{
+		// FNV-1a, eight bytes at a time. Only used to notice that a source image changed
+		size_t i = 0;
+
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, data + i, 8);
+			hash ^= word;
+			hash *= 1099511628211ull;
+		}
+
+		for (; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+}
+
+size_t CompressedImage::GetBytes() const
+{
+	size_t bytes = 0;
+
+	for (const CompressedLevel& level : m_levels)
+	{
+		bytes += level.m_data.size();
+	}
+
+	return bytes;
+}
+
+size_t CompressedImage::GetUncompressedBytes() const
+{
+	size_t bytes = 0;
+
+	for (const CompressedLevel& level : m_levels)
+	{
+		bytes += static_cast<size_t>(level.m_width) * level.m_height * 4;
+	}
+
+	return bytes;
+}
+
+bool TextureCompressor::LoadOrCompress(const std::string& fileName, const eTextureCompression compression, CompressedImage& image,
+	ThreadPool* threadPool, bool* cacheHit)
+{
+	if (cacheHit)
+	{
+		*cacheHit = false;
+	}
+
+	MappedFile source;
+
+	if (!source.Open(fileName) || source.GetSize() == 0)
+		return false;
+
+	const auto* bytes = reinterpret_cast<const unsigned char*>(source.GetData());
+
+	// The encoder version and requested format are part of the key, changing either rebuilds
+	const uint32_t version = k_encoderVersion;
+	uint64_t hash = 14695981039346656037ull;
+	hash = HashBytes(reinterpret_cast<const unsigned char*>(&version), sizeof(version), hash);
+	hash = HashBytes(reinterpret_cast<const unsigned char*>(&compression), sizeof(compression), hash);
+	hash = HashBytes(bytes, source.GetSize(), hash);
+
+	const std::string cachePath = GetCachePath(fileName);
+	uint64_t cachedHash = 0;
+
+	if (ReadKtx(cachePath, image, cachedHash) && cachedHash == hash)
+	{
+		if (cacheHit)
+		{
+			*cacheHit = true;
+		}
+
+		return true;
+	}
+
+	int width = 0;
+	int height = 0;
+	unsigned char* rgba = SOIL_load_image_from_memory(bytes, static_cast<int>(source.GetSize()), &width, &height, nullptr, SOIL_LOAD_RGBA);
+
+	if (!rgba)
+		return false;
+
+	Compress(rgba, width, height, compression == eTextureCompression::e_Auto ? Choose(rgba, width, height) : compression, image, threadPool);
+	SOIL_free_image_data(rgba);
+
+	// A read-only data folder just means encoding again next time
+	WriteKtx(cachePath, image, hash);
+
+	return true;
+}
+
+eTextureCompression TextureCompressor::Choose(const unsigned char* rgba, const int width, const int height)
+{
+	bool greyscale = true;
+	bool opaque = true;
+
+	for (size_t texel = 0; texel < static_cast<size_t>(width) * height; ++texel)
+	{
+		const unsigned char* pixel = rgba + texel * 4;
+		greyscale = greyscale && pixel[0] == pixel[1] && pixel[0] == pixel[2];
+		opaque = opaque && pixel[3] == 255;
+	}
+
+	// Greyscale images are data like specular maps that are read through .r or .rgb, their alpha
+	// is dropped
+	if (greyscale)
+		return eTextureCompression::e_BC4;
+
+	return opaque ? eTextureCompression::e_BC1 : eTextureCompression::e_BC3;
+}
+
+void TextureCompressor::Compress(const unsigned char* rgba, int width, int height, const eTextureCompression compression,
+	CompressedImage& image, ThreadPool* threadPool)
+{
+	ProfileScope scope("TextureCompressor::Compress");
+
+	image.m_compression = compression;
+	image.m_levels.clear();
+
+	// BC4/BC5 hold data such as specular or normals rather than colour, so they filter as is
+	const bool srgb = compression != eTextureCompression::e_BC4 && compression != eTextureCompression::e_BC5;
+
+	std::vector<MipLevel> chain;
+	MipGenerator::Generate(rgba, width, height, eMipFilter::e_Kaiser, srgb, chain, threadPool);
+
+	for (int level = 0; level <= static_cast<int>(chain.size()); ++level)
+	{
+		const unsigned char* pixels = level == 0 ? rgba : chain[level - 1].m_pixels.data();
+		const int levelWidth = level == 0 ? width : chain[level - 1].m_width;
+		const int levelHeight = level == 0 ? height : chain[level - 1].m_height;
+
+		CompressedLevel compressed;
+		compressed.m_width = levelWidth;
+		compressed.m_height = levelHeight;
+		compressed.m_data.resize(GetLevelBytes(levelWidth, levelHeight, compression));
+
+		CompressLevel(pixels, levelWidth, levelHeight, compression, compressed.m_data.data(), threadPool);
+		image.m_levels.push_back(std::move(compressed));
+	}
+}
+
+void TextureCompressor::CompressLevel(const unsigned char* rgba, const int width, const int height, const eTextureCompression compression,
+	unsigned char* output, ThreadPool* threadPool)
+{
+	const int blocksWide = (width + 3) / 4;
+	const int blocksHigh = (height + 3) / 4;
+	const unsigned blockBytes = GetBlockBytes(compression);
+
+	const auto encodeRows = [=](const unsigned firstRow, const unsigned lastRow)
+	{
+		unsigned char texels[64];
+
+		for (unsigned blockY = firstRow; blockY < lastRow; ++blockY)
+		{
+			for (int blockX = 0; blockX < blocksWide; ++blockX)
+			{
+				// Blocks hanging off the edge repeat the last row and column
+				for (int y = 0; y < 4; ++y)
+				{
+					const int sourceY = std::min(static_cast<int>(blockY) * 4 + y, height - 1);
+
+					for (int x = 0; x < 4; ++x)
+					{
+						const int sourceX = std::min(blockX * 4 + x, width - 1);
+						std::memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+					}
+				}
+
+				unsigned char* block = output + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+
+				switch (compression)
+				{
+				case eTextureCompression::e_BC1:
+					EncodeBC1Block(texels, block);
+					break;
+				case eTextureCompression::e_BC3:
+					EncodeBC4Block(texels + 3, 4, block);
+					EncodeBC1Block(texels, block + 8);
+					break;
+				case eTextureCompression::e_BC4:
+					EncodeBC4Block(texels, 4, block);
+					break;
+				case eTextureCompression::e_BC5:
+					EncodeBC4Block(texels, 4, block);
+					EncodeBC4Block(texels + 1, 4, block + 8);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+	};
+
+	if (threadPool)
+	{
+		threadPool->ParallelFor(static_cast<unsigned>(blocksHigh), k_blockRowsPerTask, encodeRows);
+	} else
+	{
+		encodeRows(0, static_cast<unsigned>(blocksHigh));
+	}
+}
+
+void TextureCompressor::Decompress(const CompressedLevel& level, const eTextureCompression compression, unsigned char* rgba)
+{
+	const int blocksWide = (level.m_width + 3) / 4;
+	const int blocksHigh = (level.m_height + 3) / 4;
+	const unsigned blockBytes = GetBlockBytes(compression);
+
+	unsigned char texels[64];
+
+	for (int blockY = 0; blockY < blocksHigh; ++blockY)
+	{
+		for (int blockX = 0; blockX < blocksWide; ++blockX)
+		{
+			const unsigned char* block = level.m_data.data() + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+
+			switch (compression)
+			{
+			case eTextureCompression::e_BC1:
+				DecodeBC1Block(block, texels, false);
+				break;
+			case eTextureCompression::e_BC3:
+				DecodeBC1Block(block + 8, texels, true);
+				DecodeBC4Block(block, texels + 3, 4);
+				break;
+			case eTextureCompression::e_BC4:
+				// As sampled through the RRR1 swizzle
+				DecodeBC4Block(block, texels, 4);
+				for (int texel = 0; texel < 16; ++texel)
+				{
+					texels[texel * 4 + 1] = texels[texel * 4 + 2] = texels[texel * 4];
+					texels[texel * 4 + 3] = 255;
+				}
+				break;
+			case eTextureCompression::e_BC5:
+				DecodeBC4Block(block, texels, 4);
+				DecodeBC4Block(block + 8, texels + 1, 4);
+				for (int texel = 0; texel < 16; ++texel)
+				{
+					texels[texel * 4 + 2] = 0;
+					texels[texel * 4 + 3] = 255;
+				}
+				break;
+			default:
+				std::memset(texels, 0, sizeof(texels));
+				break;
+			}
+
+			for (int y = 0; y < 4 && blockY * 4 + y < level.m_height; ++y)
+			{
+				for (int x = 0; x < 4 && blockX * 4 + x < level.m_width; ++x)
+				{
+					std::memcpy(rgba + ((static_cast<size_t>(blockY) * 4 + y) * level.m_width + blockX * 4 + x) * 4, texels + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+float TextureCompressor::ComputePsnr(const unsigned char* a, const unsigned char* b, const size_t numOfTexels, const eTextureCompression compression)
+{
+	int numOfChannels = 4;
+
+	switch (compression)
+	{
+	case eTextureCompression::e_BC1:
+		numOfChannels = 3;
+		break;
+	case eTextureCompression::e_BC4:
+		numOfChannels = 1;
+		break;
+	case eTextureCompression::e_BC5:
+		numOfChannels = 2;
+		break;
+	default:
+		break;
+	}
+
+	double squaredError = 0.0;
+
+	for (size_t texel = 0; texel < numOfTexels; ++texel)
+	{
+		for (int c = 0; c < numOfChannels; ++c)
+		{
+			const double difference = static_cast<double>(a[texel * 4 + c]) - b[texel * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	if (squaredError == 0.0)
+		return std::numeric_limits<float>::infinity();
+
+	const double meanSquaredError = squaredError / (static_cast<double>(numOfTexels) * numOfChannels);
+
+	return static_cast<float>(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+}
+
+GLenum TextureCompressor::GetInternalFormat(const eTextureCompression compression)
+{
+	switch (compression)
+	{
+	case eTextureCompression::e_BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case eTextureCompression::e_BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case eTextureCompression::e_BC4:
+		return GL_COMPRESSED_RED_RGTC1;
+	case eTextureCompression::e_BC5:
+		return GL_COMPRESSED_RG_RGTC2;
+	default:
+		return GL_RGBA8;
+	}
+}
+
+unsigned TextureCompressor::GetBlockBytes(const eTextureCompression compression)
+{
+	return compression == eTextureCompression::e_BC1 || compression == eTextureCompression::e_BC4 ? 8 : 16;
+}
+
+size_t TextureCompressor::GetLevelBytes(const int width, const int height, const eTextureCompression compression)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(compression);
+}
+
+std::string TextureCompressor::GetCachePath(const std::string& fileName)
+{
+	return fileName + ".ktx";
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+
+class ThreadPool;
+
+enum class eTextureCompression
+{
+	e_None,
+	e_Auto,	// BC4 for greyscale, BC3 when alpha is used, BC1 otherwise
+	e_BC1,	// RGB, 8 bytes per 4x4 block
+	e_BC3,	// RGBA, BC4 coded alpha then a BC1 colour block, 16 bytes
+	e_BC4,	// Single channel, 8 bytes. Sampled through a RRR1 swizzle
+	e_BC5	// Two channel, two BC4 blocks, 16 bytes
+};
+
+struct CompressedLevel
+{
+	int m_width;
+	int m_height;
+	std::vector<unsigned char> m_data;
+};
+
+// A whole mip chain in one block compressed format
+struct CompressedImage
+{
+	eTextureCompression m_compression = eTextureCompression::e_None;
+	std::vector<CompressedLevel> m_levels;
+
+	size_t GetBytes() const;
+
+	// The same chain as uncompressed RGBA8
+	size_t GetUncompressedBytes() const;
+};
+
+// CPU BCn encoder. Colour endpoints come from the principal axis of each block, refined by a least
+// squares fit, and palette indices are picked four texels at a time with SSE. Block rows are spread
+// over the thread pool. LoadOrCompress keeps a KTX file next to each source image, holding the
+// compressed mip chain and the hash of the source bytes it was made from, so images are only ever
+// encoded again when they change.
+class TextureCompressor
+{
+public:
+	// Bumped whenever encoder output changes, so old cache files get rebuilt
+	static constexpr uint32_t k_encoderVersion = 2;
+
+	static bool LoadOrCompress(const std::string& fileName, eTextureCompression compression, CompressedImage& image,
+		ThreadPool* threadPool = nullptr, bool* cacheHit = nullptr);
+
+	static eTextureCompression Choose(const unsigned char* rgba, int width, int height);
+
+	// Builds a Kaiser filtered mip chain down to 1x1 and compresses every level
+	static void Compress(const unsigned char* rgba, int width, int height, eTextureCompression compression,
+		CompressedImage& image, ThreadPool* threadPool = nullptr);
+
+	static void CompressLevel(const unsigned char* rgba, int width, int height, eTextureCompression compression,
+		unsigned char* output, ThreadPool* threadPool = nullptr);
+
+	// Back to RGBA8, for measuring quality
+	static void Decompress(const CompressedLevel& level, eTextureCompression compression, unsigned char* rgba);
+
+	// Over the channels the format stores, infinity if identical
+	static float ComputePsnr(const unsigned char* a, const unsigned char* b, size_t numOfTexels, eTextureCompression compression);
+
+	static GLenum GetInternalFormat(eTextureCompression compression);
+	static unsigned GetBlockBytes(eTextureCompression compression);
+	static size_t GetLevelBytes(int width, int height, eTextureCompression compression);
+
+	static std::string GetCachePath(const std::string& fileName);
+};
@@ -0,0 +1,360 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <SOIL2/SOIL2.h>
+
+#include "Profiler.h"
+
+TextureStreamer::TextureStreamer(ThreadPool& threadPool, const size_t frameBudgetBytes) :
+	m_threadPool(threadPool),
+	m_frameBudget(frameBudgetBytes),
+	m_pendingDecodes(0),
+	m_ring(0),
+	m_ringMemory(nullptr),
+	m_fences(),
+	m_slot(0)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	// Workers write into jobs this owns, let them finish first
+	for (auto& decode : m_decodes)
+	{
+		decode.wait();
+	}
+
+	for (auto& job : m_decoded)
+	{
+		m_uploads.push_back(job);
+	}
+
+	for (auto& job : m_uploads)
+	{
+		FreePixels(*job);
+
+		if (job->m_staging)
+		{
+			glDeleteTextures(1, &job->m_staging);
+		}
+	}
+
+	for (GLsync fence : m_fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (m_ring)
+	{
+		glUnmapNamedBuffer(m_ring);
+		glDeleteBuffers(1, &m_ring);
+	}
+}
+
+Texture* TextureStreamer::Load(const std::string& fileName, const GLenum type, const eTextureCompression compression,
+	const TextureSampling& sampling)
+{
+	auto job = std::make_shared<Job>();
+	job->m_fileName = fileName;
+	job->m_type = type;
+	job->m_compression = compression;
+	job->m_sampling = sampling;
+
+	return Submit(job);
+}
+
+Texture* TextureStreamer::Load(const std::string& name, std::vector<unsigned char> rgba, const int width, const int height, const GLenum type,
+	const TextureSampling& sampling)
+{
+	auto job = std::make_shared<Job>();
+	job->m_fileName = name;
+	job->m_type = type;
+	job->m_sampling = sampling;
+	job->m_image = std::move(rgba);
+	job->m_width = width;
+	job->m_height = height;
+
+	return Submit(job);
+}
+
+Texture* TextureStreamer::Submit(const std::shared_ptr<Job>& job)
+{
+	if (m_ring == 0)
+	{
+		InitialiseRing();
+	}
+
+	auto* texture = new Texture(job->m_type);
+	job->m_texture = texture;
+
+	m_stats.m_requested++;
+	m_pendingDecodes++;
+
+	m_decodes.push_back(m_threadPool.Submit([this, job]()
+	{
+		ProfileScope scope("TextureStreamer::Decode");
+		const auto start = std::chrono::high_resolution_clock::now();
+
+		if (!job->m_image.empty())
+		{
+			// Generated, there is nothing to decode
+			job->m_pixels = job->m_image.data();
+		} else if (job->m_compression == eTextureCompression::e_None ||
+			!TextureCompressor::LoadOrCompress(job->m_fileName, job->m_compression, job->m_compressed, &m_threadPool, &job->m_cacheHit))
+		{
+			// Compressed images fall back to plain RGBA if they can't be had
+			job->m_compressed.m_levels.clear();
+			job->m_pixels = SOIL_load_image(job->m_fileName.c_str(), &job->m_width, &job->m_height, nullptr, SOIL_LOAD_RGBA);
+		}
+
+		if (job->m_pixels)
+		{
+			MipGenerator::Generate(job->m_pixels, job->m_width, job->m_height, eMipFilter::e_Kaiser, true, job->m_mips, &m_threadPool);
+		}
+
+		job->m_decodeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decoded.push_back(job);
+	}));
+
+	return texture;
+}
+
+void TextureStreamer::Update()
+{
+	ProfileScope scope("TextureStreamer::Update");
+	GpuProfileScope gpuScope("TextureStreamer::Update");
+
+	m_stats.m_frameBytes = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto& job : m_decoded)
+		{
+			m_stats.m_decodeMilliseconds += job->m_decodeMilliseconds;
+			m_uploads.push_back(std::move(job));
+			m_pendingDecodes--;
+		}
+
+		m_decoded.clear();
+	}
+
+	m_decodes.erase(std::remove_if(m_decodes.begin(), m_decodes.end(), [](const std::future<void>& decode)
+	{
+		return decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}), m_decodes.end());
+
+	size_t budget = m_frameBudget;
+
+	while (!m_uploads.empty())
+	{
+		Job& job = *m_uploads.front();
+
+		const bool compressed = IsCompressed(job);
+		const UploadLevel level = GetUploadLevel(job);
+
+		if ((!compressed && !job.m_pixels) || level.m_rowBytes > constants::k_textureUploadSlotBytes)
+		{
+			// The placeholder stays
+			std::cout << "ERROR::TEXTURE_STREAMER::TEXTURE_LOADING_FAILED: " << job.m_fileName << "\n";
+			FreePixels(job);
+			m_stats.m_failed++;
+			m_uploads.pop_front();
+			continue;
+		}
+
+		// At least one row a frame, so a budget smaller than a row still makes progress
+		const size_t rowsInBudget = std::max<size_t>(budget / level.m_rowBytes, m_stats.m_frameBytes == 0 ? 1 : 0);
+		const size_t rows = std::min({ rowsInBudget, constants::k_textureUploadSlotBytes / level.m_rowBytes,
+			static_cast<size_t>(level.m_numOfRows - job.m_rowsUploaded) });
+
+		if (rows == 0 || !AcquireSlot())
+			break;
+
+		if (job.m_staging == 0)
+		{
+			glCreateTextures(job.m_type, 1, &job.m_staging);
+			glTextureStorage2D(job.m_staging, static_cast<GLsizei>(GetNumOfLevels(job)),
+				compressed ? TextureCompressor::GetInternalFormat(job.m_compressed.m_compression) : GL_RGBA8, level.m_width, level.m_height);
+		}
+
+		const size_t slotOffset = static_cast<size_t>(m_slot) * constants::k_textureUploadSlotBytes;
+		const size_t bytes = rows * level.m_rowBytes;
+
+		std::memcpy(m_ringMemory + slotOffset, level.m_data + job.m_rowsUploaded * level.m_rowBytes, bytes);
+
+		// Block rows can run past the bottom of the level, the upload stops at the edge
+		const int y = job.m_rowsUploaded * level.m_texelsPerRow;
+		const int height = std::min(static_cast<int>(rows) * level.m_texelsPerRow, level.m_height - y);
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring);
+
+		if (compressed)
+		{
+			glCompressedTextureSubImage2D(job.m_staging, static_cast<GLint>(job.m_level), 0, y, level.m_width, height,
+				TextureCompressor::GetInternalFormat(job.m_compressed.m_compression), static_cast<GLsizei>(bytes),
+				reinterpret_cast<const GLvoid*>(slotOffset));
+		} else
+		{
+			glTextureSubImage2D(job.m_staging, static_cast<GLint>(job.m_level), 0, y, level.m_width, height,
+				GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<const GLvoid*>(slotOffset));
+		}
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		// The slot can be written again once the GPU has read it
+		m_fences[m_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_slot = (m_slot + 1) % constants::k_textureUploadSlots;
+
+		job.m_rowsUploaded += static_cast<int>(rows);
+		budget -= std::min(budget, bytes);
+		m_stats.m_frameBytes += bytes;
+		m_stats.m_bytesUploaded += bytes;
+
+		if (job.m_rowsUploaded == level.m_numOfRows)
+		{
+			job.m_rowsUploaded = 0;
+			job.m_level++;
+
+			if (job.m_level == GetNumOfLevels(job))
+			{
+				Finish(job);
+				m_uploads.pop_front();
+			}
+		}
+	}
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	return m_pendingDecodes == 0 && m_uploads.empty();
+}
+
+const TextureStreamStats& TextureStreamer::GetStats() const
+{
+	return m_stats;
+}
+
+void TextureStreamer::InitialiseRing()
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	const GLsizeiptr size = static_cast<GLsizeiptr>(constants::k_textureUploadSlots) * constants::k_textureUploadSlotBytes;
+
+	glCreateBuffers(1, &m_ring);
+	glNamedBufferStorage(m_ring, size, nullptr, flags);
+	m_ringMemory = static_cast<unsigned char*>(glMapNamedBufferRange(m_ring, 0, size, flags));
+}
+
+bool TextureStreamer::AcquireSlot()
+{
+	GLsync& fence = m_fences[m_slot];
+
+	if (!fence)
+		return true;
+
+	const GLenum status = glClientWaitSync(fence, 0, 0);
+
+	if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+	{
+		m_stats.m_fenceWaits++;
+		return false;
+	}
+
+	glDeleteSync(fence);
+	fence = nullptr;
+
+	return true;
+}
+
+bool TextureStreamer::IsCompressed(const Job& job)
+{
+	return !job.m_compressed.m_levels.empty();
+}
+
+unsigned TextureStreamer::GetNumOfLevels(const Job& job)
+{
+	if (IsCompressed(job))
+		return static_cast<unsigned>(job.m_compressed.m_levels.size());
+
+	return static_cast<unsigned>(job.m_mips.size()) + 1;
+}
+
+TextureStreamer::UploadLevel TextureStreamer::GetUploadLevel(const Job& job)
+{
+	if (!IsCompressed(job))
+	{
+		if (job.m_level == 0)
+			return { job.m_width, job.m_height, job.m_pixels, static_cast<size_t>(job.m_width) * 4, job.m_height, 1 };
+
+		const MipLevel& mip = job.m_mips[job.m_level - 1];
+		return { mip.m_width, mip.m_height, mip.m_pixels.data(), static_cast<size_t>(mip.m_width) * 4, mip.m_height, 1 };
+	}
+
+	const CompressedLevel& level = job.m_compressed.m_levels[job.m_level];
+	const eTextureCompression compression = job.m_compressed.m_compression;
+
+	return {
+		level.m_width, level.m_height, level.m_data.data(),
+		TextureCompressor::GetLevelBytes(level.m_width, 4, compression), (level.m_height + 3) / 4, 4
+	};
+}
+
+void TextureStreamer::FreePixels(Job& job)
+{
+	// Only decoded pixels are SOIL's, generated ones go with the job's image
+	if (job.m_image.empty())
+	{
+		SOIL_free_image_data(job.m_pixels);
+	}
+
+	job.m_pixels = nullptr;
+	std::vector<unsigned char>().swap(job.m_image);
+}
+
+void TextureStreamer::Finish(Job& job)
+{
+	glTextureParameteri(job.m_staging, GL_TEXTURE_WRAP_S, job.m_sampling.m_wrapS);
+	glTextureParameteri(job.m_staging, GL_TEXTURE_WRAP_T, job.m_sampling.m_wrapT);
+	glTextureParameteri(job.m_staging, GL_TEXTURE_MIN_FILTER, job.m_sampling.m_minFilter);
+	glTextureParameteri(job.m_staging, GL_TEXTURE_MAG_FILTER, job.m_sampling.m_magFilter);
+
+	int width = job.m_width;
+	int height = job.m_height;
+
+	if (IsCompressed(job))
+	{
+		const CompressedImage& image = job.m_compressed;
+		width = image.m_levels[0].m_width;
+		height = image.m_levels[0].m_height;
+
+		if (image.m_compression == eTextureCompression::e_BC4)
+		{
+			// Single channel data reads back as grey, like the RGBA image it came from
+			const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+			glTextureParameteriv(job.m_staging, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+
+		m_stats.m_compressedBytes += image.GetBytes();
+		m_stats.m_uncompressedBytes += image.GetUncompressedBytes();
+		m_stats.m_compressedCacheHits += job.m_cacheHit ? 1 : 0;
+
+		job.m_compressed.m_levels.clear();
+	} else
+	{
+		FreePixels(job);
+		job.m_mips.clear();
+	}
+
+	job.m_texture->Adopt(job.m_staging, width, height);
+	job.m_staging = 0;
+
+	m_stats.m_completed++;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <gl/glew.h>
+
+#include "Constants.h"
+#include "MipGenerator.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+
+struct TextureStreamStats
+{
+	unsigned m_requested = 0;
+	unsigned m_completed = 0;
+	unsigned m_failed = 0;
+	size_t m_bytesUploaded = 0;
+	size_t m_frameBytes = 0;	// Uploaded during the last Update
+	unsigned m_fenceWaits = 0;	// Frames an upload waited for the GPU to release a ring slot
+	double m_decodeMilliseconds = 0.0;	// Summed over every worker, includes compressing on a cache miss
+	unsigned m_compressedCacheHits = 0;
+	size_t m_compressedBytes = 0;	// GPU bytes of the compressed textures, mips included
+	size_t m_uncompressedBytes = 0;	// What those textures would take as RGBA8
+};
+
+// Loads textures without blocking the render thread. Load hands back a placeholder straight away
+// and decodes the image and builds its mip chain on the thread pool, or fetches the compressed
+// chain from the TextureCompressor cache. Update, called once a frame on the GL thread, copies rows
+// (block rows when compressed) into a persistently mapped ring of pixel unpack buffers and uploads
+// them into a staging texture, no more than the byte budget per frame. Once every level is in, the
+// placeholder adopts the staging texture, so a Texture is never seen half uploaded.
+class TextureStreamer
+{
+public:
+	explicit TextureStreamer(ThreadPool& threadPool, size_t frameBudgetBytes = constants::k_textureUploadBudget);
+
+	~TextureStreamer();
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	// The caller owns the returned texture and must keep it alive until IsIdle
+	Texture* Load(const std::string& fileName, GLenum type, eTextureCompression compression = eTextureCompression::e_Auto,
+		const TextureSampling& sampling = TextureSampling());
+
+	// An image made in memory rather than read from a file, only its mip chain is built on the
+	// pool. The name is for messages
+	Texture* Load(const std::string& name, std::vector<unsigned char> rgba, int width, int height, GLenum type,
+		const TextureSampling& sampling = TextureSampling());
+
+	void Update();
+
+	bool IsIdle() const;
+
+	const TextureStreamStats& GetStats() const;
+
+private:
+	struct Job
+	{
+		std::string m_fileName;
+		Texture* m_texture = nullptr;
+		GLenum m_type = GL_TEXTURE_2D;
+		eTextureCompression m_compression = eTextureCompression::e_None;
+		TextureSampling m_sampling;
+		double m_decodeMilliseconds = 0.0;
+		bool m_cacheHit = false;
+
+		// Pixels of a generated image, m_pixels points into them rather than at SOIL's
+		std::vector<unsigned char> m_image;
+
+		// One of these is filled by the worker
+		unsigned char* m_pixels = nullptr;
+		int m_width = 0;
+		int m_height = 0;
+		std::vector<MipLevel> m_mips;
+		CompressedImage m_compressed;
+
+		GLuint m_staging = 0;
+		unsigned m_level = 0;
+		int m_rowsUploaded = 0;
+	};
+
+	// Where the next upload of a job comes from. Compressed rows are rows of 4x4 blocks
+	struct UploadLevel
+	{
+		int m_width;
+		int m_height;
+		const unsigned char* m_data;
+		size_t m_rowBytes;
+		int m_numOfRows;
+		int m_texelsPerRow;
+	};
+
+	ThreadPool& m_threadPool;
+	size_t m_frameBudget;
+
+	// Filled by the workers
+	std::mutex m_mutex;
+	std::vector<std::shared_ptr<Job>> m_decoded;
+
+	// GL thread only
+	unsigned m_pendingDecodes;	// Until Update has picked the decoded job up
+	std::vector<std::future<void>> m_decodes;
+	std::deque<std::shared_ptr<Job>> m_uploads;
+	GLuint m_ring;
+	unsigned char* m_ringMemory;
+	GLsync m_fences[constants::k_textureUploadSlots];
+	unsigned m_slot;
+
+	TextureStreamStats m_stats;
+
+	void InitialiseRing();
+
+	// Hands the job to the pool to decode, or just build mips for, and returns its placeholder
+	Texture* Submit(const std::shared_ptr<Job>& job);
+
+	// Returns false if the current ring slot is still being read by the GPU
+	bool AcquireSlot();
+
+	static bool IsCompressed(const Job& job);
+	static unsigned GetNumOfLevels(const Job& job);
+	static UploadLevel GetUploadLevel(const Job& job);
+	static void FreePixels(Job& job);
+
+	void Finish(Job& job);
+};
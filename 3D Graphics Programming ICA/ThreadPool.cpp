@@ -0,0 +1,142 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "Profiler.h"
+
+ThreadPool::ThreadPool(unsigned numOfThreads) :
+	m_stopping(false)
+{
+	if (numOfThreads == 0)
+	{
+		const unsigned hardwareThreads = std::thread::hardware_concurrency();
+		numOfThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	m_workers.reserve(numOfThreads);
+
+	for (unsigned i = 0; i < numOfThreads; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_condition.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+unsigned ThreadPool::GetThreadCount() const
+{
+	return static_cast<unsigned>(m_workers.size());
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task)
+{
+	std::packaged_task<void()> packagedTask(std::move(task));
+	std::future<void> future = packagedTask.get_future();
+
+	// With no workers the task runs inline, there is nobody else to pick it up
+	if (m_workers.empty())
+	{
+		packagedTask();
+		return future;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(packagedTask));
+	}
+
+	m_condition.notify_one();
+
+	return future;
+}
+
+void ThreadPool::ParallelFor(const unsigned count, const unsigned grainSize, const std::function<void(unsigned, unsigned)>& function)
+{
+	if (count == 0)
+		return;
+
+	const unsigned chunkSize = std::max(grainSize, 1u);
+	const unsigned numOfChunks = (count + chunkSize - 1) / chunkSize;
+
+	if (numOfChunks == 1 || m_workers.empty())
+	{
+		function(0, count);
+		return;
+	}
+
+	// Shared so helpers that start after the loop has finished don't touch a dead stack frame
+	struct State
+	{
+		std::atomic<unsigned> m_nextChunk{ 0 };
+		std::atomic<unsigned> m_finishedChunks{ 0 };
+	};
+
+	auto state = std::make_shared<State>();
+
+	auto runChunks = [state, count, chunkSize, numOfChunks, &function]()
+	{
+		for (unsigned chunk = state->m_nextChunk++; chunk < numOfChunks; chunk = state->m_nextChunk++)
+		{
+			const unsigned begin = chunk * chunkSize;
+			function(begin, std::min(begin + chunkSize, count));
+			state->m_finishedChunks++;
+		}
+	};
+
+	const unsigned numOfHelpers = std::min(numOfChunks - 1, GetThreadCount());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (unsigned i = 0; i < numOfHelpers; ++i)
+		{
+			m_tasks.emplace_back(runChunks);
+		}
+	}
+
+	m_condition.notify_all();
+
+	runChunks();
+
+	while (state->m_finishedChunks.load() < numOfChunks)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	Profiler::SetThreadName("Worker");
+
+	for (;;)
+	{
+		std::packaged_task<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+			if (m_stopping && m_tasks.empty())
+				return;
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from one queue. ParallelFor splits a range into chunks and
+// the calling thread works on chunks too, so a pool with zero workers still makes progress.
+class ThreadPool
+{
+public:
+	// 0 picks one worker per hardware thread, minus the calling thread
+	explicit ThreadPool(unsigned numOfThreads = 0);
+
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned GetThreadCount() const;
+
+	std::future<void> Submit(std::function<void()> task);
+
+	// Calls function(begin, end) over [0, count) in chunks of at least grainSize and returns once
+	// every chunk has finished
+	void ParallelFor(unsigned count, unsigned grainSize, const std::function<void(unsigned, unsigned)>& function);
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<std::packaged_task<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping;
+
+	void WorkerLoop();
+};
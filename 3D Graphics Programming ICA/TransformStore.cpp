@@ -0,0 +1,269 @@
+#include "TransformStore.h"
+
+#include <emmintrin.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+namespace
+{
+	constexpr float k_degreesToRadians = 0.01745329251994329577f;
+
+	// Four-wide sine and cosine. The argument is reduced to [-pi/4, pi/4] around the nearest
+	// multiple of pi/2, evaluated with the Cephes single precision polynomials, then the
+	// quadrant picks which result goes where and flips the signs. Accurate to ~1e-7 for the
+	// angle ranges transforms use.
+	void SinCos4(const __m128 x, __m128& sinOut, __m128& cosOut)
+	{
+		const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772367581343f)));
+		const __m128 quadrantF = _mm_cvtepi32_ps(quadrant);
+
+		// Cody-Waite reduction, pi/2 split into three parts so the subtraction stays exact
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(quadrantF, _mm_set1_ps(1.5703125f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(quadrantF, _mm_set1_ps(4.837512969970703125e-4f)));
+		r = _mm_sub_ps(r, _mm_mul_ps(quadrantF, _mm_set1_ps(7.549789948768648e-8f)));
+
+		const __m128 r2 = _mm_mul_ps(r, r);
+
+		__m128 sinR = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+		sinR = _mm_add_ps(_mm_mul_ps(sinR, r2), _mm_set1_ps(-1.6666654611e-1f));
+		sinR = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinR, r2), r), r);
+
+		__m128 cosR = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+		cosR = _mm_add_ps(_mm_mul_ps(cosR, r2), _mm_set1_ps(4.166664568298827e-2f));
+		cosR = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cosR, r2), r2), _mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))));
+
+		// Odd quadrants swap sine and cosine
+		const __m128i one = _mm_set1_epi32(1);
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+		const __m128 sinPick = _mm_or_ps(_mm_and_ps(swap, cosR), _mm_andnot_ps(swap, sinR));
+		const __m128 cosPick = _mm_or_ps(_mm_and_ps(swap, sinR), _mm_andnot_ps(swap, cosR));
+
+		// sin is negative in quadrants 2 and 3, cos in quadrants 1 and 2
+		const __m128i two = _mm_set1_epi32(2);
+		const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+		const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+		sinOut = _mm_xor_ps(sinPick, sinSign);
+		cosOut = _mm_xor_ps(cosPick, cosSign);
+	}
+
+	__m128 Gather4(const std::vector<float>& values, const TransformId* ids)
+	{
+		return _mm_set_ps(values[ids[3]], values[ids[2]], values[ids[1]], values[ids[0]]);
+	}
+}
+
+TransformId TransformStore::Create(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale)
+{
+	TransformId id;
+
+	if (!m_freeList.empty())
+	{
+		id = m_freeList.back();
+		m_freeList.pop_back();
+	} else
+	{
+		id = static_cast<TransformId>(m_matrices.size());
+
+		m_positionX.push_back(0.f);
+		m_positionY.push_back(0.f);
+		m_positionZ.push_back(0.f);
+		m_rotationX.push_back(0.f);
+		m_rotationY.push_back(0.f);
+		m_rotationZ.push_back(0.f);
+		m_scaleX.push_back(1.f);
+		m_scaleY.push_back(1.f);
+		m_scaleZ.push_back(1.f);
+		m_matrices.emplace_back(1.f);
+		m_dirty.push_back(0);
+	}
+
+	m_positionX[id] = position.x;
+	m_positionY[id] = position.y;
+	m_positionZ[id] = position.z;
+	m_rotationX[id] = rotation.x;
+	m_rotationY[id] = rotation.y;
+	m_rotationZ[id] = rotation.z;
+	m_scaleX[id] = scale.x;
+	m_scaleY[id] = scale.y;
+	m_scaleZ[id] = scale.z;
+
+	MarkDirty(id);
+
+	return id;
+}
+
+void TransformStore::Release(const TransformId id)
+{
+	// A released slot may still be in the dirty list, recomputing it is harmless
+	m_freeList.push_back(id);
+}
+
+void TransformStore::SetPosition(const TransformId id, const glm::vec3& position)
+{
+	m_positionX[id] = position.x;
+	m_positionY[id] = position.y;
+	m_positionZ[id] = position.z;
+	MarkDirty(id);
+}
+
+void TransformStore::SetRotation(const TransformId id, const glm::vec3& rotation)
+{
+	m_rotationX[id] = rotation.x;
+	m_rotationY[id] = rotation.y;
+	m_rotationZ[id] = rotation.z;
+	MarkDirty(id);
+}
+
+void TransformStore::SetScale(const TransformId id, const glm::vec3& scale)
+{
+	m_scaleX[id] = scale.x;
+	m_scaleY[id] = scale.y;
+	m_scaleZ[id] = scale.z;
+	MarkDirty(id);
+}
+
+glm::vec3 TransformStore::GetPosition(const TransformId id) const
+{
+	return glm::vec3(m_positionX[id], m_positionY[id], m_positionZ[id]);
+}
+
+glm::vec3 TransformStore::GetRotation(const TransformId id) const
+{
+	return glm::vec3(m_rotationX[id], m_rotationY[id], m_rotationZ[id]);
+}
+
+glm::vec3 TransformStore::GetScale(const TransformId id) const
+{
+	return glm::vec3(m_scaleX[id], m_scaleY[id], m_scaleZ[id]);
+}
+
+const glm::mat4& TransformStore::GetMatrix(const TransformId id) const
+{
+	return m_matrices[id];
+}
+
+bool TransformStore::IsDirty(const TransformId id) const
+{
+	return m_dirty[id] != 0;
+}
+
+const std::vector<TransformId>& TransformStore::GetDirtyList() const
+{
+	return m_dirtyList;
+}
+
+unsigned TransformStore::UpdateDirty()
+{
+	const unsigned numDirty = static_cast<unsigned>(m_dirtyList.size());
+	const TransformId* ids = m_dirtyList.data();
+
+	unsigned i = 0;
+	for (; i + 4 <= numDirty; i += 4)
+	{
+		ComputeMatrices4(ids + i);
+	}
+
+	for (; i < numDirty; ++i)
+	{
+		ComputeMatrix(ids[i]);
+	}
+
+	for (const TransformId id : m_dirtyList)
+	{
+		m_dirty[id] = 0;
+	}
+
+	m_dirtyList.clear();
+
+	return numDirty;
+}
+
+unsigned TransformStore::GetCount() const
+{
+	return static_cast<unsigned>(m_matrices.size() - m_freeList.size());
+}
+
+void TransformStore::MarkDirty(const TransformId id)
+{
+	if (m_dirty[id])
+		return;
+
+	m_dirty[id] = 1;
+	m_dirtyList.push_back(id);
+}
+
+void TransformStore::ComputeMatrices4(const TransformId* ids)
+{
+	// model = translate * rotateX * rotateY * rotateZ * scale, expanded by hand so each lane
+	// builds one matrix
+	const __m128 toRadians = _mm_set1_ps(k_degreesToRadians);
+
+	__m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+	SinCos4(_mm_mul_ps(Gather4(m_rotationX, ids), toRadians), sinX, cosX);
+	SinCos4(_mm_mul_ps(Gather4(m_rotationY, ids), toRadians), sinY, cosY);
+	SinCos4(_mm_mul_ps(Gather4(m_rotationZ, ids), toRadians), sinZ, cosZ);
+
+	const __m128 scaleX = Gather4(m_scaleX, ids);
+	const __m128 scaleY = Gather4(m_scaleY, ids);
+	const __m128 scaleZ = Gather4(m_scaleZ, ids);
+
+	const __m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+	const __m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+
+	// Each column as four registers (x, y, z, w), one lane per transform
+	__m128 c0x = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), scaleX);
+	__m128 c0y = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sinXsinY, cosZ), _mm_mul_ps(cosX, sinZ)), scaleX);
+	__m128 c0z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(cosXsinY, cosZ)), scaleX);
+	__m128 c0w = _mm_setzero_ps();
+
+	__m128 c1x = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cosY, sinZ)), scaleY);
+	__m128 c1y = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(sinXsinY, sinZ)), scaleY);
+	__m128 c1z = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cosXsinY, sinZ), _mm_mul_ps(sinX, cosZ)), scaleY);
+	__m128 c1w = _mm_setzero_ps();
+
+	__m128 c2x = _mm_mul_ps(sinY, scaleZ);
+	__m128 c2y = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sinX, cosY)), scaleZ);
+	__m128 c2z = _mm_mul_ps(_mm_mul_ps(cosX, cosY), scaleZ);
+	__m128 c2w = _mm_setzero_ps();
+
+	__m128 c3x = Gather4(m_positionX, ids);
+	__m128 c3y = Gather4(m_positionY, ids);
+	__m128 c3z = Gather4(m_positionZ, ids);
+	__m128 c3w = _mm_set1_ps(1.f);
+
+	// Transposing turns "one component for four transforms" into "one column of one transform"
+	_MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+	_MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+	_MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+	_MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+	const __m128 columns[4][4] =
+	{
+		{ c0x, c1x, c2x, c3x },
+		{ c0y, c1y, c2y, c3y },
+		{ c0z, c1z, c2z, c3z },
+		{ c0w, c1w, c2w, c3w }
+	};
+
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		float* matrix = glm::value_ptr(m_matrices[ids[lane]]);
+
+		_mm_storeu_ps(matrix + 0, columns[lane][0]);
+		_mm_storeu_ps(matrix + 4, columns[lane][1]);
+		_mm_storeu_ps(matrix + 8, columns[lane][2]);
+		_mm_storeu_ps(matrix + 12, columns[lane][3]);
+	}
+}
+
+void TransformStore::ComputeMatrix(const TransformId id)
+{
+	glm::mat4& matrix = m_matrices[id];
+	matrix = glm::mat4(1.f);
+	matrix = glm::translate(matrix, GetPosition(id));
+	matrix = glm::rotate(matrix, glm::radians(m_rotationX[id]), glm::vec3(1.f, 0.f, 0.f));
+	matrix = glm::rotate(matrix, glm::radians(m_rotationY[id]), glm::vec3(0.f, 1.f, 0.f));
+	matrix = glm::rotate(matrix, glm::radians(m_rotationZ[id]), glm::vec3(0.f, 0.f, 1.f));
+	matrix = glm::scale(matrix, GetScale(id));
+}
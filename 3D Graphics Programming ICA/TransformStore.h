@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/vec3.hpp>
+#include <glm/matrix.hpp>
+
+using TransformId = unsigned;
+
+// Structure-of-arrays storage for position/rotation/scale transforms. Setters only mark an entry
+// dirty, UpdateDirty() then rebuilds the dirty model matrices four at a time with SSE.
+// Rotations are Euler angles in degrees, applied X then Y then Z like Mesh always did.
+class TransformStore
+{
+public:
+	TransformId Create(const glm::vec3& position, const glm::vec3& rotation, const glm::vec3& scale);
+
+	void Release(TransformId id);
+
+	void SetPosition(TransformId id, const glm::vec3& position);
+	void SetRotation(TransformId id, const glm::vec3& rotation);
+	void SetScale(TransformId id, const glm::vec3& scale);
+
+	glm::vec3 GetPosition(TransformId id) const;
+	glm::vec3 GetRotation(TransformId id) const;
+	glm::vec3 GetScale(TransformId id) const;
+
+	const glm::mat4& GetMatrix(TransformId id) const;
+
+	bool IsDirty(TransformId id) const;
+
+	const std::vector<TransformId>& GetDirtyList() const;
+
+	// Returns the number of matrices rebuilt
+	unsigned UpdateDirty();
+
+	unsigned GetCount() const;
+
+private:
+	std::vector<float> m_positionX, m_positionY, m_positionZ;
+	std::vector<float> m_rotationX, m_rotationY, m_rotationZ;
+	std::vector<float> m_scaleX, m_scaleY, m_scaleZ;
+	std::vector<glm::mat4> m_matrices;
+	std::vector<uint8_t> m_dirty;
+	std::vector<TransformId> m_dirtyList;
+	std::vector<TransformId> m_freeList;
+
+	void MarkDirty(TransformId id);
+
+	void ComputeMatrices4(const TransformId* ids);
+
+	void ComputeMatrix(TransformId id);
+};
@@ -0,0 +1,357 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <immintrin.h>
+
+namespace
+{
+	constexpr float k_snorm16Max = 32767.f;
+
+	// The smallest extent a bounds axis is given so flat geometry still gets a usable scale
+	constexpr float k_minDequantScale = 1e-6f;
+
+	glm::vec3 DecodeOctahedral(const float x, const float y)
+	{
+		glm::vec3 normal(x, y, 1.f - std::abs(x) - std::abs(y));
+		const float fold = std::max(-normal.z, 0.f);
+		normal.x += normal.x >= 0.f ? -fold : fold;
+		normal.y += normal.y >= 0.f ? -fold : fold;
+
+		return glm::normalize(normal);
+	}
+
+	float DecodeSnorm16(const int16_t value)
+	{
+		return std::max(static_cast<float>(value) / k_snorm16Max, -1.f);
+	}
+}
+
+unsigned GetVertexStride(const eVertexFormat format)
+{
+	return format == eVertexFormat::e_Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
+
+void SetupVertexAttributes(const eVertexFormat format)
+{
+	if (format == eVertexFormat::e_Quantized)
+	{
+		//Position, dequantised in the vertex shader
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+			reinterpret_cast<GLvoid*>(offsetof(QuantizedVertex, m_position)));
+		glEnableVertexAttribArray(0);
+		//Color
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuantizedVertex),
+			reinterpret_cast<GLvoid*>(offsetof(QuantizedVertex, m_colour)));
+		glEnableVertexAttribArray(1);
+		//Texcoord
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(QuantizedVertex),
+			reinterpret_cast<GLvoid*>(offsetof(QuantizedVertex, m_texcoord)));
+		glEnableVertexAttribArray(2);
+		//Normal, z is left at 0 and the shader unfolds the octahedron
+		glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+			reinterpret_cast<GLvoid*>(offsetof(QuantizedVertex, m_normal)));
+		glEnableVertexAttribArray(3);
+
+		return;
+	}
+
+	//SET VERTEXATTRIBPOINTERS AND ENABLE (INPUT ASSEMBLY)
+	//Position
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<GLvoid*>(offsetof(Vertex, m_position)));
+	glEnableVertexAttribArray(0);
+	//Color
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<GLvoid*>(offsetof(Vertex, m_colour)));
+	glEnableVertexAttribArray(1);
+	//Texcoord
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<GLvoid*>(offsetof(Vertex, m_texcoord)));
+	glEnableVertexAttribArray(2);
+	//Normal
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		reinterpret_cast<GLvoid*>(offsetof(Vertex, m_normal)));
+	glEnableVertexAttribArray(3);
+}
+
+PositionDequant ComputePositionDequant(const AABB& bounds)
+{
+	const glm::vec3 extents = bounds.GetExtents();
+
+	return {
+		glm::vec3(std::max(extents.x, k_minDequantScale), std::max(extents.y, k_minDequantScale), std::max(extents.z, k_minDequantScale)),
+		bounds.GetCentre()
+	};
+}
+
+void EncodeVertices(const Vertex* vertexArray, const unsigned numOfVertices, const PositionDequant& dequant, QuantizedVertex* output)
+{
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 minusOne = _mm_set1_ps(-1.f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	const __m128 snormScale = _mm_set1_ps(k_snorm16Max);
+	const __m128 unorm8Scale = _mm_set1_ps(255.f);
+
+	const __m128 bias[3] = { _mm_set1_ps(dequant.m_bias.x), _mm_set1_ps(dequant.m_bias.y), _mm_set1_ps(dequant.m_bias.z) };
+	const __m128 inverseScale[3] = {
+		_mm_set1_ps(1.f / dequant.m_scale.x), _mm_set1_ps(1.f / dequant.m_scale.y), _mm_set1_ps(1.f / dequant.m_scale.z)
+	};
+
+	for (unsigned first = 0; first < numOfVertices; first += 4)
+	{
+		// Gather four vertices into SoA registers, the tail repeats the last vertex
+		const Vertex* v[4];
+		for (unsigned lane = 0; lane < 4; ++lane)
+		{
+			v[lane] = &vertexArray[std::min(first + lane, numOfVertices - 1)];
+		}
+
+		alignas(16) int16_t position[3][8];
+		alignas(16) int16_t normal[2][8];
+		alignas(16) uint8_t colour[3][16];
+		alignas(16) uint16_t texcoord[2][8];
+
+		//Position: into [-1, 1] across the bounds, then round to snorm16
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			__m128 p = _mm_set_ps(v[3]->m_position[axis], v[2]->m_position[axis], v[1]->m_position[axis], v[0]->m_position[axis]);
+			p = _mm_mul_ps(_mm_sub_ps(p, bias[axis]), inverseScale[axis]);
+			p = _mm_min_ps(_mm_max_ps(p, minusOne), one);
+
+			const __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(p, snormScale));
+			_mm_store_si128(reinterpret_cast<__m128i*>(position[axis]), _mm_packs_epi32(rounded, rounded));
+		}
+
+		//Normal: project onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over
+		{
+			const __m128 nx = _mm_set_ps(v[3]->m_normal.x, v[2]->m_normal.x, v[1]->m_normal.x, v[0]->m_normal.x);
+			const __m128 ny = _mm_set_ps(v[3]->m_normal.y, v[2]->m_normal.y, v[1]->m_normal.y, v[0]->m_normal.y);
+			const __m128 nz = _mm_set_ps(v[3]->m_normal.z, v[2]->m_normal.z, v[1]->m_normal.z, v[0]->m_normal.z);
+
+			const __m128 absX = _mm_andnot_ps(signMask, nx);
+			const __m128 absY = _mm_andnot_ps(signMask, ny);
+			const __m128 absZ = _mm_andnot_ps(signMask, nz);
+
+			// A zero normal would divide by zero, it encodes as straight up instead
+			const __m128 length = _mm_max_ps(_mm_add_ps(_mm_add_ps(absX, absY), absZ), _mm_set1_ps(1e-20f));
+			const __m128 inverseLength = _mm_div_ps(one, length);
+
+			const __m128 px = _mm_mul_ps(nx, inverseLength);
+			const __m128 py = _mm_mul_ps(ny, inverseLength);
+
+			const __m128 foldX = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, py)), _mm_and_ps(px, signMask));
+			const __m128 foldY = _mm_or_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, px)), _mm_and_ps(py, signMask));
+
+			const __m128 lower = _mm_cmplt_ps(nz, zero);
+			const __m128 ox = _mm_or_ps(_mm_and_ps(lower, foldX), _mm_andnot_ps(lower, px));
+			const __m128 oy = _mm_or_ps(_mm_and_ps(lower, foldY), _mm_andnot_ps(lower, py));
+
+			const __m128i roundedX = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(ox, minusOne), one), snormScale));
+			const __m128i roundedY = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(oy, minusOne), one), snormScale));
+			_mm_store_si128(reinterpret_cast<__m128i*>(normal[0]), _mm_packs_epi32(roundedX, roundedX));
+			_mm_store_si128(reinterpret_cast<__m128i*>(normal[1]), _mm_packs_epi32(roundedY, roundedY));
+		}
+
+		//Colour: clamp, scale and saturate down to bytes
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			__m128 c = _mm_set_ps(v[3]->m_colour[channel], v[2]->m_colour[channel], v[1]->m_colour[channel], v[0]->m_colour[channel]);
+			c = _mm_min_ps(_mm_max_ps(c, zero), one);
+
+			const __m128i rounded = _mm_cvtps_epi32(_mm_mul_ps(c, unorm8Scale));
+			const __m128i words = _mm_packs_epi32(rounded, rounded);
+			_mm_store_si128(reinterpret_cast<__m128i*>(colour[channel]), _mm_packus_epi16(words, words));
+		}
+
+		//Texcoord
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			const __m128 t = _mm_set_ps(v[3]->m_texcoord[axis], v[2]->m_texcoord[axis], v[1]->m_texcoord[axis], v[0]->m_texcoord[axis]);
+#if defined(__AVX2__) || defined(__F16C__)
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(texcoord[axis]), _mm_cvtps_ph(t, _MM_FROUND_TO_NEAREST_INT));
+#else
+			alignas(16) float lanes[4];
+			_mm_store_ps(lanes, t);
+			for (unsigned lane = 0; lane < 4; ++lane)
+			{
+				texcoord[axis][lane] = FloatToHalf(lanes[lane]);
+			}
+#endif
+		}
+
+		const unsigned numInBlock = std::min(4u, numOfVertices - first);
+		for (unsigned lane = 0; lane < numInBlock; ++lane)
+		{
+			QuantizedVertex& out = output[first + lane];
+			out.m_position[0] = position[0][lane];
+			out.m_position[1] = position[1][lane];
+			out.m_position[2] = position[2][lane];
+			out.m_position[3] = 0;
+			out.m_colour[0] = colour[0][lane];
+			out.m_colour[1] = colour[1][lane];
+			out.m_colour[2] = colour[2][lane];
+			out.m_colour[3] = 255;
+			out.m_texcoord[0] = texcoord[0][lane];
+			out.m_texcoord[1] = texcoord[1][lane];
+			out.m_normal[0] = normal[0][lane];
+			out.m_normal[1] = normal[1][lane];
+		}
+	}
+}
+
+Vertex DecodeVertex(const QuantizedVertex& vertex, const PositionDequant& dequant)
+{
+	const glm::vec3 position(DecodeSnorm16(vertex.m_position[0]), DecodeSnorm16(vertex.m_position[1]), DecodeSnorm16(vertex.m_position[2]));
+
+	return Vertex(
+		dequant.m_bias + dequant.m_scale * position,
+		glm::vec3(vertex.m_colour[0], vertex.m_colour[1], vertex.m_colour[2]) / 255.f,
+		glm::vec2(HalfToFloat(vertex.m_texcoord[0]), HalfToFloat(vertex.m_texcoord[1])),
+		DecodeOctahedral(DecodeSnorm16(vertex.m_normal[0]), DecodeSnorm16(vertex.m_normal[1])));
+}
+
+QuantizationError MeasureQuantizationError(const Vertex* vertexArray, const QuantizedVertex* quantizedArray,
+	const unsigned numOfVertices, const PositionDequant& dequant)
+{
+	QuantizationError error;
+
+	for (unsigned i = 0; i < numOfVertices; ++i)
+	{
+		const Vertex& source = vertexArray[i];
+		const Vertex decoded = DecodeVertex(quantizedArray[i], dequant);
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			error.m_position = std::max(error.m_position, std::abs(decoded.m_position[axis] - source.m_position[axis]));
+			error.m_colour = std::max(error.m_colour, std::abs(decoded.m_colour[axis] - std::min(std::max(source.m_colour[axis], 0.f), 1.f)));
+		}
+
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			error.m_texcoord = std::max(error.m_texcoord, std::abs(decoded.m_texcoord[axis] - source.m_texcoord[axis]));
+		}
+
+		const float sourceLength = glm::length(source.m_normal);
+		if (sourceLength > 0.f)
+		{
+			// atan2 keeps its precision for tiny angles where acos of a float dot product can't
+			const glm::vec3 sourceNormal = source.m_normal / sourceLength;
+			const float angle = std::atan2(glm::length(glm::cross(decoded.m_normal, sourceNormal)), glm::dot(decoded.m_normal, sourceNormal));
+			error.m_normalDegrees = std::max(error.m_normalDegrees, glm::degrees(angle));
+		}
+	}
+
+	return error;
+}
+
+QuantizationError GetQuantizationErrorBounds(const PositionDequant& dequant, const float maxTexcoord)
+{
+	QuantizationError bounds;
+
+	// Half a step of rounding plus a little float slack in the dequantise
+	const float largestScale = std::max(std::max(dequant.m_scale.x, dequant.m_scale.y), dequant.m_scale.z);
+	bounds.m_position = largestScale * (0.5f / k_snorm16Max + 1e-6f);
+
+	// A 16-bit octahedral step is under 0.01 degrees across the whole sphere
+	bounds.m_normalDegrees = 0.01f;
+
+	// Halves keep 11 significant bits
+	bounds.m_texcoord = std::max(std::abs(maxTexcoord), 1.f) / 2048.f;
+
+	bounds.m_colour = 0.5f / 255.f + 1e-6f;
+
+	return bounds;
+}
+
+uint16_t FloatToHalf(const float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000u;
+	const uint32_t exponent = (bits >> 23) & 0xffu;
+	uint32_t mantissa = bits & 0x7fffffu;
+
+	// NaN and infinity
+	if (exponent == 0xffu)
+		return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+
+	const int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+	if (halfExponent >= 0x1f)
+		return static_cast<uint16_t>(sign | 0x7c00u);
+
+	if (halfExponent <= 0)
+	{
+		// Subnormal half, or zero once the shift runs off the end
+		if (halfExponent < -10)
+			return static_cast<uint16_t>(sign);
+
+		mantissa |= 0x800000u;
+		const uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		const uint32_t halfway = 1u << (shift - 1);
+
+		if (remainder > halfway || (remainder == halfway && (half & 1u)))
+		{
+			half++;
+		}
+
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+	uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1fffu;
+
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+	{
+		half++;
+	}
+
+	return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(const uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1fu;
+	uint32_t mantissa = value & 0x3ffu;
+	uint32_t bits;
+
+	if (exponent == 0)
+	{
+		if (mantissa == 0)
+		{
+			bits = sign;
+		} else
+		{
+			// Renormalise the subnormal
+			int shift = 0;
+			while (!(mantissa & 0x400u))
+			{
+				mantissa <<= 1;
+				shift++;
+			}
+			mantissa &= 0x3ffu;
+			bits = sign | static_cast<uint32_t>(127 - 15 - shift + 1) << 23 | mantissa << 13;
+		}
+	} else if (exponent == 0x1fu)
+	{
+		bits = sign | 0x7f800000u | mantissa << 13;
+	} else
+	{
+		bits = sign | (exponent - 15 + 127) << 23 | mantissa << 13;
+	}
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+
+	return result;
+}
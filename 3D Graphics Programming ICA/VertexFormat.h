@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <gl/glew.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "Bounds.h"
+#include "Vertex.h"
+
+enum class eVertexFormat
+{
+	e_Float, e_Quantized
+};
+
+// 20 bytes against Vertex's 44
+struct QuantizedVertex
+{
+	int16_t m_position[4];	// snorm16 within the geometry bounds, w is padding
+	uint8_t m_colour[4];	// unorm8, alpha is always opaque
+	uint16_t m_texcoord[2];	// half floats
+	int16_t m_normal[2];	// snorm16 octahedral
+};
+
+// Object position = bias + scale * stored position. Identity for float vertices.
+struct PositionDequant
+{
+	glm::vec3 m_scale;
+	glm::vec3 m_bias;
+};
+
+// Largest difference seen between source and round-tripped vertices
+struct QuantizationError
+{
+	float m_position = 0.f;		// Per axis, object space units
+	float m_normalDegrees = 0.f;
+	float m_texcoord = 0.f;
+	float m_colour = 0.f;
+};
+
+unsigned GetVertexStride(eVertexFormat format);
+
+// Points attributes 0-3 of the currently bound VAO at the currently bound GL_ARRAY_BUFFER
+void SetupVertexAttributes(eVertexFormat format);
+
+PositionDequant ComputePositionDequant(const AABB& bounds);
+
+// SSE over four vertices at a time, half conversion uses F16C when the build targets AVX2
+void EncodeVertices(const Vertex* vertexArray, unsigned numOfVertices, const PositionDequant& dequant, QuantizedVertex* output);
+
+Vertex DecodeVertex(const QuantizedVertex& vertex, const PositionDequant& dequant);
+
+QuantizationError MeasureQuantizationError(const Vertex* vertexArray, const QuantizedVertex* quantizedArray,
+	unsigned numOfVertices, const PositionDequant& dequant);
+
+// The most each component can be off by after rounding to its storage type
+QuantizationError GetQuantizationErrorBounds(const PositionDequant& dequant, float maxTexcoord);
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
@@ -1,11 +1,38 @@
 #version 440
 
+// Variants are built by ShaderVariants, which defines these straight after #version:
+//   TEXTURE_ARRAY                      1 when the material textures are TextureArrayPool layers
+//   DIFFUSE_MAP, SPECULAR_MAP, SPECULAR the material features, true or false in a specialised
+//                                      variant, read from material.features in a fallback
+// The material features are only ever tested in if statements, so what a variant leaves out is
+// compiled away. Built without defines everything is on.
+#ifndef TEXTURE_ARRAY
+#define TEXTURE_ARRAY 0
+#endif
+#ifndef DIFFUSE_MAP
+#define DIFFUSE_MAP true
+#endif
+#ifndef SPECULAR_MAP
+#define SPECULAR_MAP true
+#endif
+#ifndef SPECULAR
+#define SPECULAR true
+#endif
+
 struct Material{
 	vec3 ambient;
 	vec3 diffuse;
 	vec3 specular;
+#if TEXTURE_ARRAY
+	sampler2DArray diffuse_tex;
+	sampler2DArray specular_tex;
+	int diffuse_layer;
+	int specular_layer;
+#else
 	sampler2D diffuse_tex;
 	sampler2D specular_tex;
+#endif
+	int features;
 };
 
 in vec3 varying_position;
@@ -17,8 +44,25 @@ out vec4 fragment_colour;
 
 uniform Material material;
 
-uniform vec3 light_position;
-uniform vec3 camera_position;
+#include "frame_constants.glsl"
+
+vec4 sample_diffuse()
+{
+#if TEXTURE_ARRAY
+	return texture(material.diffuse_tex, vec3(varying_texcoord, material.diffuse_layer));
+#else
+	return texture(material.diffuse_tex, varying_texcoord);
+#endif
+}
+
+vec3 sample_specular()
+{
+#if TEXTURE_ARRAY
+	return texture(material.specular_tex, vec3(varying_texcoord, material.specular_layer)).rgb;
+#else
+	return texture(material.specular_tex, varying_texcoord).rgb;
+#endif
+}
 
 vec3 calculate_ambient_colour(Material mat)
 {
@@ -31,7 +75,7 @@ vec3 calculate_diffuse_colour(Material mat, vec3 position, vec3 normal, vec3 lig
 	 // The dot product gives use the the diffuse amount. The dot product goes between -1 and 1, we don't want negatives so we clamp
 	float diffuseAmount = clamp(dot(positionToLightDirectionVector, normal), 0, 1);
 
-	return mat.diffuse * diffuseAmount; 
+	return mat.diffuse * diffuseAmount;
 }
 
 vec3 calculate_specular_colour(Material mat, vec3 position, vec3 normal, vec3 lightPos, vec3 cameraPos){
@@ -39,15 +83,33 @@ vec3 calculate_specular_colour(Material mat, vec3 position, vec3 normal, vec3 li
 	vec3 reflectionDirectionVector = normalize(reflect(lightToPositionDirectionVector, normalize(normal)));
 	vec3 positionToViewDirectionVector = normalize(cameraPos - position);
 	float specularConstant = pow(max(dot(positionToViewDirectionVector, reflectionDirectionVector), 0), 30);
-	return material.specular * specularConstant * texture(material.specular_tex, varying_texcoord).rgb;
+
+	return material.specular * specularConstant;
 }
 
 void main()
 {
 	vec3 ambientFinal = calculate_ambient_colour(material); // Ambient light is the "natural" light of the scene
-	vec3 diffuseFinal = calculate_diffuse_colour(material, varying_position, varying_normal, light_position);
-	vec3 specularFinal = calculate_specular_colour(material, varying_position, varying_normal, light_position, camera_position);
+	vec3 diffuseFinal = vec3(0.f);
+	vec3 specularFinal = vec3(0.f);
+
+	for (int i = 0; i < light_count; ++i)
+	{
+		diffuseFinal += calculate_diffuse_colour(material, varying_position, varying_normal, light_positions[i].xyz);
+
+		if (SPECULAR)
+			specularFinal += calculate_specular_colour(material, varying_position, varying_normal, light_positions[i].xyz, camera_position.xyz);
+	}
+
+	// The map scales every light's highlight alike, so it is fetched once after the loop
+	if (SPECULAR && SPECULAR_MAP)
+		specularFinal *= sample_specular();
+
+	vec4 baseColour = vec4(1.f);
+
+	if (DIFFUSE_MAP)
+		baseColour = sample_diffuse();
 
 //	MAKES IT RAINBOW - fragment_colour = texture(material.diffuse_tex, varying_texcoord) * vec4(varying_colour, 1.f) * (vec4(ambientLight, 1.f) + vec4(diffuseFinal, 1.f) + vec4(specularFinal, 1.f));
-	fragment_colour = texture(material.diffuse_tex, varying_texcoord) * (vec4(ambientFinal, 1.f) + vec4(diffuseFinal, 1.f) + vec4(specularFinal, 1.f));
-}
\ No newline at end of file
+	fragment_colour = baseColour * (vec4(ambientFinal, 1.f) + vec4(diffuseFinal, 1.f) + vec4(specularFinal, 1.f));
+}
@@ -0,0 +1,11 @@
+// Written once a frame by FrameConstantsBuffer, mirrors FrameConstants in FrameConstants.h
+#define MAX_LIGHTS 16
+
+layout (std140, binding = 0) uniform FrameConstants
+{
+	mat4 view_matrix;
+	mat4 projection_matrix;
+	vec4 camera_position;
+	int light_count;
+	vec4 light_positions[MAX_LIGHTS];
+};
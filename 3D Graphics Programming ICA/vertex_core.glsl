@@ -11,15 +11,36 @@ out vec2 varying_texcoord;
 out vec3 varying_normal;
 
 uniform mat4 model_matrix;
-uniform mat4 view_matrix;
-uniform mat4 projection_matrix;
+
+// Object position = position_bias + position_scale * vertex_position, w of the scale flags
+// octahedral normals
+uniform vec4 position_scale;
+uniform vec4 position_bias;
+
+#include "frame_constants.glsl"
+
+// Unfolds an octahedral encoded normal, float vertices pass theirs straight through
+vec3 DecodeNormal(vec3 normal, float octahedral)
+{
+	if (octahedral == 0.f)
+		return normal;
+
+	vec3 n = vec3(normal.xy, 1.f - abs(normal.x) - abs(normal.y));
+	float fold = max(-n.z, 0.f);
+	n.x += n.x >= 0.f ? -fold : fold;
+	n.y += n.y >= 0.f ? -fold : fold;
+
+	return normalize(n);
+}
 
 void main()
 {
-	varying_position = vec4(model_matrix * vec4(vertex_position, 1.f)).xyz;
+	const vec3 position = position_bias.xyz + position_scale.xyz * vertex_position;
+
+	varying_position = vec4(model_matrix * vec4(position, 1.f)).xyz;
 	varying_colour = vertex_colour;
 	varying_texcoord = vec2(vertex_texcoord.x, vertex_texcoord.y * -1); // textures are flipped by default. Multiply the y by -1 to fix 
-	varying_normal = mat3(model_matrix) * vertex_normal; // Normals come from world space - we don't want them to be affected by the perspective
+	varying_normal = mat3(model_matrix) * DecodeNormal(vertex_normal, position_scale.w); // Normals come from world space - we don't want them to be affected by the perspective
 
-	gl_Position = projection_matrix * view_matrix * model_matrix * vec4(vertex_position, 1.f);
+	gl_Position = projection_matrix * view_matrix * model_matrix * vec4(position, 1.f);
 }
\ No newline at end of file
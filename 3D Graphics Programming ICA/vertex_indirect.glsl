@@ -0,0 +1,56 @@
+#version 440
+#extension GL_ARB_shader_draw_parameters : require
+
+layout (location = 0) in vec3 vertex_position;
+layout (location = 1) in vec3 vertex_colour;
+layout (location = 2) in vec2 vertex_texcoord;
+layout (location = 3) in vec3 vertex_normal;
+
+out vec3 varying_position;
+out vec3 varying_colour;
+out vec2 varying_texcoord;
+out vec3 varying_normal;
+
+#include "frame_constants.glsl"
+
+// One entry per draw of a glMultiDrawElementsIndirect call. Object position =
+// position_bias + position_scale * vertex_position, w of the scale flags octahedral normals
+struct DrawData
+{
+	mat4 model_matrix;
+	vec4 position_scale;
+	vec4 position_bias;
+};
+
+layout (std430, binding = 1) readonly buffer DrawDataBlock
+{
+	DrawData draws[];
+};
+
+// Unfolds an octahedral encoded normal, float vertices pass theirs straight through
+vec3 DecodeNormal(vec3 normal, float octahedral)
+{
+	if (octahedral == 0.f)
+		return normal;
+
+	vec3 n = vec3(normal.xy, 1.f - abs(normal.x) - abs(normal.y));
+	float fold = max(-n.z, 0.f);
+	n.x += n.x >= 0.f ? -fold : fold;
+	n.y += n.y >= 0.f ? -fold : fold;
+
+	return normalize(n);
+}
+
+void main()
+{
+	const DrawData draw = draws[gl_DrawIDARB];
+	const mat4 model_matrix = draw.model_matrix;
+	const vec3 position = draw.position_bias.xyz + draw.position_scale.xyz * vertex_position;
+
+	varying_position = vec4(model_matrix * vec4(position, 1.f)).xyz;
+	varying_colour = vertex_colour;
+	varying_texcoord = vec2(vertex_texcoord.x, vertex_texcoord.y * -1); // textures are flipped by default. Multiply the y by -1 to fix 
+	varying_normal = mat3(model_matrix) * DecodeNormal(vertex_normal, draw.position_scale.w); // Normals come from world space - we don't want them to be affected by the perspective
+
+	gl_Position = projection_matrix * view_matrix * model_matrix * vec4(position, 1.f);
+}
@@ -0,0 +1,51 @@
+#version 440
+
+layout (location = 0) in vec3 vertex_position;
+layout (location = 1) in vec3 vertex_colour;
+layout (location = 2) in vec2 vertex_texcoord;
+layout (location = 3) in vec3 vertex_normal;
+
+// Per-instance attributes, advanced once per instance by glVertexAttribDivisor
+layout (location = 4) in mat4 instance_model_matrix;
+layout (location = 8) in vec4 instance_colour;
+layout (location = 9) in uint instance_material_index;
+
+out vec3 varying_position;
+out vec3 varying_colour;
+out vec2 varying_texcoord;
+out vec3 varying_normal;
+flat out uint varying_material_index;
+
+// Object position = position_bias + position_scale * vertex_position, w of the scale flags
+// octahedral normals
+uniform vec4 position_scale;
+uniform vec4 position_bias;
+
+#include "frame_constants.glsl"
+
+// Unfolds an octahedral encoded normal, float vertices pass theirs straight through
+vec3 DecodeNormal(vec3 normal, float octahedral)
+{
+	if (octahedral == 0.f)
+		return normal;
+
+	vec3 n = vec3(normal.xy, 1.f - abs(normal.x) - abs(normal.y));
+	float fold = max(-n.z, 0.f);
+	n.x += n.x >= 0.f ? -fold : fold;
+	n.y += n.y >= 0.f ? -fold : fold;
+
+	return normalize(n);
+}
+
+void main()
+{
+	const vec3 position = position_bias.xyz + position_scale.xyz * vertex_position;
+
+	varying_position = vec4(instance_model_matrix * vec4(position, 1.f)).xyz;
+	varying_colour = vertex_colour * instance_colour.rgb;
+	varying_texcoord = vec2(vertex_texcoord.x, vertex_texcoord.y * -1); // textures are flipped by default. Multiply the y by -1 to fix 
+	varying_normal = mat3(instance_model_matrix) * DecodeNormal(vertex_normal, position_scale.w);
+	varying_material_index = instance_material_index;
+
+	gl_Position = projection_matrix * view_matrix * instance_model_matrix * vec4(position, 1.f);
+}
\ No newline at end of file